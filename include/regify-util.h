@@ -707,6 +707,8 @@ typedef void* ruCleaner;
 #include <regify-util/cleaner.h>
 #include <regify-util/ini.h>
 #include <regify-util/io.h>
+#include <regify-util/aio.h>
+#include <regify-util/hash.h>
 #include <regify-util/json.h>
 #include <regify-util/kvstore.h>
 #include <regify-util/regex.h>
@@ -0,0 +1,340 @@
+/*
+ * Copyright regify
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+/**
+ * \defgroup aio Asynchronous File I/O
+ * \brief This section contains an asynchronous file I/O engine.
+ *
+ * An \ref ruAio engine owns a set of worker threads that carry out submitted
+ * read, write, fsync, rename and remove requests as well as the whole file
+ * helpers \ref ruAioFileGetContents and \ref ruAioFileSetContents.
+ *
+ * Each request completes with an \ref ruAioResult which is either handed to
+ * the given \ref ruAioFunc callback on the worker thread, or, when no callback
+ * was given, queued for retrieval with \ref ruAioPoll.
+ *
+ * A \ref ruWriteBatch groups many atomic file replacements so that their
+ * durability cost is paid once per batch rather than once per file.
+ *
+ * @{
+ */
+#ifndef REGIFY_UTIL_AIO_H
+#define REGIFY_UTIL_AIO_H
+/* Only need to export C interface if used by C++ source code */
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * \brief Opaque pointer to an asynchronous I/O engine. See \ref ruAioNew.
+ */
+typedef void* ruAio;
+
+/**
+ * \brief Operation of a \ref ruAioRead request.
+ */
+#define RU_AIO_READ 1
+/**
+ * \brief Operation of a \ref ruAioWrite request.
+ */
+#define RU_AIO_WRITE 2
+/**
+ * \brief Operation of a \ref ruAioFsync request.
+ */
+#define RU_AIO_FSYNC 3
+/**
+ * \brief Operation of a \ref ruAioRename request.
+ */
+#define RU_AIO_RENAME 4
+/**
+ * \brief Operation of a \ref ruAioRemove request.
+ */
+#define RU_AIO_REMOVE 5
+/**
+ * \brief Operation of a \ref ruAioFileGetContents request.
+ */
+#define RU_AIO_GET_CONTENTS 6
+/**
+ * \brief Operation of a \ref ruAioFileSetContents request.
+ */
+#define RU_AIO_SET_CONTENTS 7
+
+/**
+ * \brief Passing this as offset reads or writes at the current file position.
+ */
+#define RU_AIO_CUR_POS (-1)
+
+/**
+ * \brief The completion record of an asynchronous request.
+ */
+typedef struct {
+    /** \brief One of the RU_AIO_* operation constants. */
+    uint32_t op;
+    /** \brief \ref RUE_OK on success else the regify error code of the operation. */
+    int32_t code;
+    /** \brief The sequence number the submitting call returned. */
+    uint64_t id;
+    /** \brief The user context passed to the submitting call. */
+    perm_ptr ctx;
+    /** \brief The file handle of fd based requests else -1. */
+    int fd;
+    /** \brief The (first) file path of path based requests else NULL. */
+    perm_chars path;
+    /**
+     * \brief The buffer of the request.
+     * For \ref RU_AIO_GET_CONTENTS this is the allocated, NULL terminated file
+     * content. It is freed with the result unless the recipient takes
+     * ownership by setting it to NULL.
+     */
+    ptr data;
+    /** \brief The number of bytes read or written. */
+    rusize len;
+} ruAioResult;
+
+/**
+ * \brief Signature of a completion callback.
+ * It is called on a worker thread and should not block for long. The result
+ * is freed once the callback returns.
+ * @param res The result of the completed request.
+ */
+typedef void (*ruAioFunc)(ruAioResult* res);
+
+/**
+ * \brief Creates a new asynchronous I/O engine.
+ * @param threads Number of worker threads to start. If 0 a default of 4 is used.
+ * @param queueLen Maximum number of pending requests before submissions block.
+ *                 If 0 the queue is unbound.
+ * @param code (Optional) Stores regify error code of this operation.
+ * @return New engine to be freed with \ref ruAioFree.
+ */
+RUAPI ruAio ruAioNew(uint32_t threads, uint32_t queueLen, int32_t* code);
+
+/**
+ * \brief Finishes all pending requests and frees the given engine.
+ * Results that have not been polled are discarded.
+ * @param ra Engine to free.
+ * @return NULL
+ */
+RUAPI ruAio ruAioFree(ruAio ra);
+
+/**
+ * \brief Submits a read of up to len bytes into buf.
+ * @param ra Engine to submit to.
+ * @param fd Handle returned by \ref ruOpen. Must stay open until completion.
+ * @param buf Where the data will be stored. Must persist until completion.
+ * @param len Size of buf.
+ * @param offset File offset to read from or \ref RU_AIO_CUR_POS.
+ * @param cb Optional completion callback else the result goes to \ref ruAioPoll.
+ * @param ctx Optional user context passed on in the \ref ruAioResult.
+ * @param code (Optional) Stores regify error code of this operation.
+ * @return The sequence number of the request or 0 on error.
+ */
+RUAPI uint64_t ruAioRead(ruAio ra, int fd, ptr buf, rusize len, int64_t offset,
+                         ruAioFunc cb, perm_ptr ctx, int32_t* code);
+
+/**
+ * \brief Submits a write of len bytes from buf.
+ * @param ra Engine to submit to.
+ * @param fd Handle returned by \ref ruOpen. Must stay open until completion.
+ * @param buf The data to write. Must persist until completion.
+ * @param len Number of bytes to write.
+ * @param offset File offset to write at or \ref RU_AIO_CUR_POS.
+ * @param cb Optional completion callback else the result goes to \ref ruAioPoll.
+ * @param ctx Optional user context passed on in the \ref ruAioResult.
+ * @param code (Optional) Stores regify error code of this operation.
+ * @return The sequence number of the request or 0 on error.
+ */
+RUAPI uint64_t ruAioWrite(ruAio ra, int fd, perm_ptr buf, rusize len,
+                          int64_t offset, ruAioFunc cb, perm_ptr ctx,
+                          int32_t* code);
+
+/**
+ * \brief Submits a flush of the given file handle to stable storage.
+ * @param ra Engine to submit to.
+ * @param fd Handle returned by \ref ruOpen. Must stay open until completion.
+ * @param cb Optional completion callback else the result goes to \ref ruAioPoll.
+ * @param ctx Optional user context passed on in the \ref ruAioResult.
+ * @param code (Optional) Stores regify error code of this operation.
+ * @return The sequence number of the request or 0 on error.
+ */
+RUAPI uint64_t ruAioFsync(ruAio ra, int fd, ruAioFunc cb, perm_ptr ctx,
+                          int32_t* code);
+
+/**
+ * \brief Submits a \ref ruFileRename.
+ * @param ra Engine to submit to.
+ * @param oldName Path of the file to rename.
+ * @param newName New path of the file.
+ * @param cb Optional completion callback else the result goes to \ref ruAioPoll.
+ * @param ctx Optional user context passed on in the \ref ruAioResult.
+ * @param code (Optional) Stores regify error code of this operation.
+ * @return The sequence number of the request or 0 on error.
+ */
+RUAPI uint64_t ruAioRename(ruAio ra, trans_chars oldName, trans_chars newName,
+                           ruAioFunc cb, perm_ptr ctx, int32_t* code);
+
+/**
+ * \brief Submits a \ref ruFileRemove.
+ * @param ra Engine to submit to.
+ * @param filename Path of the file to remove.
+ * @param cb Optional completion callback else the result goes to \ref ruAioPoll.
+ * @param ctx Optional user context passed on in the \ref ruAioResult.
+ * @param code (Optional) Stores regify error code of this operation.
+ * @return The sequence number of the request or 0 on error.
+ */
+RUAPI uint64_t ruAioRemove(ruAio ra, trans_chars filename,
+                           ruAioFunc cb, perm_ptr ctx, int32_t* code);
+
+/**
+ * \brief Submits a \ref ruFileGetContents. The content is passed on in
+ * \ref ruAioResult.data.
+ * @param ra Engine to submit to.
+ * @param filename Path of the file to read.
+ * @param cb Optional completion callback else the result goes to \ref ruAioPoll.
+ * @param ctx Optional user context passed on in the \ref ruAioResult.
+ * @param code (Optional) Stores regify error code of this operation.
+ * @return The sequence number of the request or 0 on error.
+ */
+RUAPI uint64_t ruAioFileGetContents(ruAio ra, trans_chars filename,
+                                    ruAioFunc cb, perm_ptr ctx, int32_t* code);
+
+/**
+ * \brief Submits a \ref ruFileSetContents.
+ * @param ra Engine to submit to.
+ * @param filename Path of the file to write.
+ * @param contents The data to write. Must persist until completion.
+ * @param length Number of bytes to write or \ref RU_SIZE_AUTO.
+ * @param cb Optional completion callback else the result goes to \ref ruAioPoll.
+ * @param ctx Optional user context passed on in the \ref ruAioResult.
+ * @param code (Optional) Stores regify error code of this operation.
+ * @return The sequence number of the request or 0 on error.
+ */
+RUAPI uint64_t ruAioFileSetContents(ruAio ra, trans_chars filename,
+                                    perm_chars contents, rusize length,
+                                    ruAioFunc cb, perm_ptr ctx, int32_t* code);
+
+/**
+ * \brief Returns the next completed request that was submitted without callback.
+ * @param ra Engine to poll.
+ * @param timeoutMs Milliseconds to wait for a completion. 0 returns immediately.
+ * @param code (Optional) Stores regify error code of this operation.
+ *         \ref RUE_OK on success
+ *         \ref RUE_FILE_NOT_FOUND when the call timed out
+ *         else a regify error code.
+ * @return The result to be freed with \ref ruAioResultFree or NULL.
+ */
+RUAPI ruAioResult* ruAioPoll(ruAio ra, msec_t timeoutMs, int32_t* code);
+
+/**
+ * \brief Frees a result returned by \ref ruAioPoll.
+ * @param res Result to free.
+ * @return NULL
+ */
+RUAPI ruAioResult* ruAioResultFree(ruAioResult* res);
+
+/**
+ * \brief Waits until all submitted requests have been carried out.
+ * Polled results are not consumed by this call.
+ * @param ra Engine to wait on.
+ * @param timeoutMs Milliseconds to wait at most. 0 waits indefinitely.
+ * @return \ref RUE_OK when idle, \ref RUE_TIMEOUT on timeout else a regify
+ *         error code.
+ */
+RUAPI int32_t ruAioWait(ruAio ra, msec_t timeoutMs);
+
+/**
+ * \brief Returns the number of submitted requests that have not completed yet.
+ * @param ra Engine to query.
+ * @param code (Optional) Stores regify error code of this operation.
+ * @return Number of pending requests.
+ */
+RUAPI uint32_t ruAioPending(ruAio ra, int32_t* code);
+
+/**
+ * \brief Opaque pointer to a batch of atomic file replacements.
+ * See \ref ruWriteBatchNew.
+ */
+typedef void* ruWriteBatch;
+
+/**
+ * \brief Creates a new write batch.
+ *
+ * A write batch stages many atomic file replacements like
+ * \ref ruFileSetContents does and makes them durable together on
+ * \ref ruWriteBatchCommit. The data of all staged files is flushed, then
+ * the files are renamed into place and finally each affected folder is
+ * flushed once.
+ * @param ra Optional engine used to flush the staged files in parallel.
+ *           If NULL they are flushed one after the other. Must outlive the
+ *           batch.
+ * @param code (Optional) Stores regify error code of this operation.
+ * @return New batch to be freed with \ref ruWriteBatchFree.
+ */
+RUAPI ruWriteBatch ruWriteBatchNew(ruAio ra, int32_t* code);
+
+/**
+ * \brief Writes the given content to a temporary file next to filename.
+ * The temporary file remains open until the batch is committed or freed, so
+ * very large batches should be committed in parts.
+ * @param wb Batch to add to.
+ * @param filename Path of the file to replace. Its folder must exist.
+ * @param contents The data to write.
+ * @param length Number of bytes to write or \ref RU_SIZE_AUTO.
+ * @return \ref RUE_OK on success else an error code.
+ */
+RUAPI int32_t ruWriteBatchAdd(ruWriteBatch wb, trans_chars filename,
+                              trans_chars contents, rusize length);
+
+/**
+ * \brief Returns the number of files currently staged in the batch.
+ * @param wb Batch to query.
+ * @param code (Optional) Stores regify error code of this operation.
+ * @return Number of staged files.
+ */
+RUAPI uint32_t ruWriteBatchSize(ruWriteBatch wb, int32_t* code);
+
+/**
+ * \brief Durably replaces all staged files.
+ * If flushing any staged file fails nothing is renamed and all temporary
+ * files are removed. Rename failures leave the remaining files in place.
+ * Either way the batch is empty afterwards and may be reused.
+ * On Windows folders can not be flushed, so that step is skipped.
+ * @param wb Batch to commit.
+ * @return \ref RUE_OK on success else the first error that occurred.
+ */
+RUAPI int32_t ruWriteBatchCommit(ruWriteBatch wb);
+
+/**
+ * \brief Frees the given batch and removes any uncommitted temporary files.
+ * @param wb Batch to free.
+ * @return NULL
+ */
+RUAPI ruWriteBatch ruWriteBatchFree(ruWriteBatch wb);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}   /* extern "C" */
+#endif /* __cplusplus */
+
+#endif //REGIFY_UTIL_AIO_H
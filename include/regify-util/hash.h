@@ -0,0 +1,169 @@
+/*
+ * Copyright regify
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+/**
+ * \defgroup hash Content Hashing
+ * \brief This section contains streaming content hashes and checksums.
+ *
+ * A \ref ruHasher is fed with any number of chunks through
+ * \ref ruHasherUpdate and yields the digest of everything seen so far with
+ * \ref ruHasherDigest. For data that is already in memory \ref ruHashData
+ * does it in one call and \ref ruFileHash hashes a whole file.
+ *
+ * Digests are in canonical big endian byte order, so the hex representation of
+ * \ref RU_HASH_XXH64 and \ref RU_HASH_CRC32C matches that of the common
+ * command line tools.
+ *
+ * @{
+ */
+#ifndef REGIFY_UTIL_HASH_H
+#define REGIFY_UTIL_HASH_H
+/* Only need to export C interface if used by C++ source code */
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * \brief Opaque pointer to a streaming hash context. See \ref ruHasherNew.
+ */
+typedef void* ruHasher;
+
+/**
+ * \brief The 64 bit xxHash, a fast non cryptographic hash for fingerprinting.
+ */
+#define RU_HASH_XXH64 1
+/**
+ * \brief The Castagnoli CRC32 checksum. Uses the SSE4.2 or ARMv8 CRC
+ * instructions when the CPU has them.
+ */
+#define RU_HASH_CRC32C 2
+/**
+ * \brief The SHA-256 cryptographic hash.
+ */
+#define RU_HASH_SHA256 3
+
+/**
+ * \brief Size of the largest digest any of the algorithms produce.
+ */
+#define RU_HASH_MAX_SIZE 32
+
+/**
+ * \brief Returns the digest size of given algorithm.
+ * @param algo One of the RU_HASH_ constants such as \ref RU_HASH_XXH64.
+ * @return Digest size in bytes or 0 if the algorithm is unknown.
+ */
+RUAPI rusize ruHashSize(int32_t algo);
+
+/**
+ * \brief Creates a new streaming hash context.
+ * @param algo One of the RU_HASH_ constants such as \ref RU_HASH_XXH64.
+ * @param code (Optional) Stores regify error code of this operation.
+ * @return New context to be freed with \ref ruHasherFree.
+ */
+RUAPI ruHasher ruHasherNew(int32_t algo, int32_t* code);
+
+/**
+ * \brief Frees the given hash context.
+ * @param rh Context to free.
+ * @return NULL
+ */
+RUAPI ruHasher ruHasherFree(ruHasher rh);
+
+/**
+ * \brief Resets the context to the state of a newly created one.
+ * @param rh Context to reset.
+ * @return \ref RUE_OK on success else a regify error code.
+ */
+RUAPI int32_t ruHasherReset(ruHasher rh);
+
+/**
+ * \brief Feeds the next chunk of data into the hash.
+ * @param rh Context to update.
+ * @param data Data to hash.
+ * @param len Number of bytes in data. May be 0.
+ * @return \ref RUE_OK on success else a regify error code.
+ */
+RUAPI int32_t ruHasherUpdate(ruHasher rh, trans_ptr data, rusize len);
+
+/**
+ * \brief Returns the digest of all data fed so far.
+ * The context is not altered, so it may be updated further afterwards.
+ * @param rh Context to query.
+ * @param digest Where to store the digest.
+ * @param len Size of digest, must be at least \ref ruHashSize of the algorithm.
+ * @return \ref RUE_OK on success, \ref RUE_WRONG_PARAMETER_LENGTH if len
+ *         doesn't suffice, else a regify error code.
+ */
+RUAPI int32_t ruHasherDigest(ruHasher rh, unsigned char* digest, rusize len);
+
+/**
+ * \brief Returns the digest of all data fed so far as lower case hex string.
+ * The context is not altered, so it may be updated further afterwards.
+ * @param rh Context to query.
+ * @return Hex string to be freed by the caller or NULL on error.
+ */
+RUAPI alloc_chars ruHasherHex(ruHasher rh);
+
+/**
+ * \brief Hashes the given in memory data in one go.
+ * @param algo One of the RU_HASH_ constants such as \ref RU_HASH_XXH64.
+ * @param data Data to hash.
+ * @param len Number of bytes in data or \ref RU_SIZE_AUTO for a NULL
+ *            terminated string.
+ * @param code (Optional) Stores regify error code of this operation.
+ * @return Lower case hex digest to be freed by the caller or NULL on error.
+ */
+RUAPI alloc_chars ruHashData(int32_t algo, trans_ptr data, rusize len, int32_t* code);
+
+/**
+ * \brief Hashes the content of the given file without loading it as a whole.
+ * @param filepath Path of the file to hash.
+ * @param algo One of the RU_HASH_ constants such as \ref RU_HASH_XXH64.
+ * @param code (Optional) Stores regify error code of this operation.
+ * @return Lower case hex digest to be freed by the caller or NULL on error.
+ */
+RUAPI alloc_chars ruFileHash(trans_chars filepath, int32_t algo, int32_t* code);
+
+/**
+ * \brief Returns the 64 bit xxHash of the given span.
+ * @param data Data to hash.
+ * @param len Number of bytes in data.
+ * @param seed Seed to start with, 0 for the standard hash.
+ * @return The hash value.
+ */
+RUAPI uint64_t ruXxh64(trans_ptr data, rusize len, uint64_t seed);
+
+/**
+ * \brief Continues the CRC32C checksum crc with the given span.
+ * @param crc Checksum of the preceding data, 0 to start a new one.
+ * @param data Data to checksum.
+ * @param len Number of bytes in data.
+ * @return The updated checksum.
+ */
+RUAPI uint32_t ruCrc32c(uint32_t crc, trans_ptr data, rusize len);
+
+/**
+ * @}
+ */
+#ifdef __cplusplus
+}
+#endif /* __cplusplus */
+#endif //REGIFY_UTIL_HASH_H
@@ -70,6 +70,7 @@ RUAPI ruIni ruIniNew(void);
 
 /**
  * \brief Writes given ini object into given filename
+ * Objects opened with \ref ruIniEdit keep the layout of their file.
  * @param iniOb Ini object to write
  * @param filename Path to ini file
  * @return \ref RUE_OK on success else an error code
@@ -93,6 +94,45 @@ RUAPI int32_t ruIniWrite(ruIni iniOb, trans_chars filename);
  */
 RUAPI int32_t ruIniRead(trans_chars filename, ruIni* iniOb);
 
+/**
+ * \brief Parse given INI-style file into a flat, pre-indexed ini object.
+ * Intended for large files that are mostly read. The file is read in one go
+ * and all section names, keys and values end up in a single string arena with
+ * one hash index over them, so \ref ruIniGet and \ref ruIniGetDef are O(1)
+ * and there are no per key allocations. The syntax is the same as for
+ * \ref ruIniRead. \ref ruIniKeys and \ref ruIniSections return the entries
+ * in file order.
+ *
+ * The first \ref ruIniSet or \ref ruIniWrite converts the object to the
+ * regular map based representation, which invalidates values previously
+ * returned by \ref ruIniGet.
+ *
+ * @param filename path to file to parse
+ * @param iniOb Where the result \ref ruIni object will be stored. Free with \ref ruIniFree.
+ * @return \ref RUE_OK on success else an error code
+ */
+RUAPI int32_t ruIniReadIndexed(trans_chars filename, ruIni* iniOb);
+
+/**
+ * \brief Open given INI-style file for editing with its layout preserved.
+ * Parses the file like \ref ruIniReadIndexed but keeps its content. Changes
+ * made with \ref ruIniSet stay in the object until \ref ruIniWrite, which
+ * copies the original content byte for byte and only replaces the lines of
+ * changed keys. Comments, blank lines and ordering are kept. Removed keys
+ * lose their lines, new keys are added after the last line of their section
+ * and new sections at the end of the file. The file is replaced atomically
+ * and flushed to disk, see \ref ruWriteBatchNew.
+ *
+ * In this mode \ref ruIniSet refuses names and values that contain line
+ * breaks, section names containing ']' and keys containing '=' or ':' with
+ * \ref RUE_INVALID_PARAMETER.
+ *
+ * @param filename path to file to edit. A missing file starts out empty.
+ * @param iniOb Where the result \ref ruIni object will be stored. Free with \ref ruIniFree.
+ * @return \ref RUE_OK on success else an error code
+ */
+RUAPI int32_t ruIniEdit(trans_chars filename, ruIni* iniOb);
+
 /**
  * \brief Returns a list of sections from the given ini object
  * @param iniOb Object to get sections from
@@ -110,6 +110,35 @@ typedef struct stat ruStat_t;
  */
 RUAPI int32_t ruStat(trans_chars filepath, ruStat_t *dest);
 
+/**
+ * \brief Enables or disables the process wide stat cache.
+ *
+ * When enabled \ref ruStat, \ref ruFileExists, \ref ruIsFile, \ref ruIsDir,
+ * \ref ruIsExecutable, \ref ruFileSize, \ref ruFileUtcTime and
+ * \ref ruFileGetContents reuse the result of a previous stat of the same path
+ * for up to ttlMs milliseconds. Paths are cached verbatim, so relative paths
+ * should not be used across working directory changes. On Windows only
+ * \ref ruStat is served from the cache, the other queries keep using the wide
+ * character file API directly.
+ *
+ * Changes made through this library, such as \ref ruFileSetContents,
+ * \ref ruFileRename, \ref ruFileRemove or \ref ruMkdir, as well as events
+ * reported by a \ref ruFamMonitorFilePath monitor drop the affected paths.
+ * Changes made by other means are only seen once the TTL has expired, unless
+ * the caller uses \ref ruStatCacheInvalidate. The cache is disabled by default.
+ * @param ttlMs Validity of a cached result in milliseconds. 0 disables the
+ *              cache and drops all entries.
+ * @param maxEntries Number of cached paths at which the cache is reset.
+ *                   0 uses a default of 4096.
+ */
+RUAPI void ruStatCacheSet(msec_t ttlMs, uint32_t maxEntries);
+
+/**
+ * \brief Drops the given path and everything below it from the stat cache.
+ * @param filepath The path to forget or NULL to empty the whole cache.
+ */
+RUAPI void ruStatCacheInvalidate(trans_chars filepath);
+
 /**
  * \brief Return the size of the given file if it exists
  * @param filePath File path to get size of
@@ -429,6 +458,136 @@ RUAPI alloc_chars ruPathMultiJoin(int parts, ...);
  */
 RUAPI alloc_chars ruPathMultiJoinNative(int parts, ...);
 
+/**
+ * \brief \ref ruPathBufInit flag to use the platform native directory slash
+ * instead of the unix style one.
+ */
+#define RU_PATH_NATIVE 0x01
+
+/**
+ * \brief \ref ruPathBufInit flag to move the path to the heap when it
+ * outgrows the given buffer instead of failing with \ref RUE_OVERFLOW.
+ */
+#define RU_PATH_GROW 0x02
+
+/**
+ * \brief A path builder that works on a caller supplied buffer.
+ *
+ * It allows building up and taking apart paths without allocating memory per
+ * operation. Initialize it with \ref ruPathBufInit and, when
+ * \ref RU_PATH_GROW was used, release it with \ref ruPathBufFree. On Windows
+ * all slashes that go in are converted to the configured style.
+ * The members are to be considered private.
+ * ~~~~~{.c}
+   char buf[256];
+   ruPathBuf pb;
+   ruPathBufInit(&pb, buf, sizeof(buf), RU_PATH_GROW);
+   ruPathBufSet(&pb, "/tmp");
+   ruPathBufPush(&pb, "foo", RU_SIZE_AUTO);
+   rusize mark = ruPathBufLen(&pb);
+   ruPathBufPush(&pb, "bar.txt", RU_SIZE_AUTO);
+   // ruPathBufStr(&pb) is now "/tmp/foo/bar.txt"
+   ruPathBufTruncate(&pb, mark);
+   // ruPathBufStr(&pb) is back at "/tmp/foo"
+   ruPathBufFree(&pb);
+ * ~~~~~
+ */
+typedef struct {
+    char* buf;
+    rusize cap;
+    rusize len;
+    uint32_t flags;
+    bool heaped;
+} ruPathBuf;
+
+/**
+ * \brief Initializes the given path builder with an empty path.
+ * @param pb The builder to initialize.
+ * @param buf Buffer to build the path in. May be NULL with \ref RU_PATH_GROW
+ *            in which case the path starts out on the heap.
+ * @param cap Size of buf in bytes including the NULL terminator.
+ * @param flags A combination of \ref RU_PATH_NATIVE and \ref RU_PATH_GROW.
+ * @return \ref RUE_OK on success else \ref RUE_PARAMETER_NOT_SET.
+ */
+RUAPI int32_t ruPathBufInit(ruPathBuf* pb, char* buf, rusize cap, uint32_t flags);
+
+/**
+ * \brief Releases heap memory the builder may have acquired.
+ * @param pb The builder to release. It must be initialized again before reuse.
+ */
+RUAPI void ruPathBufFree(ruPathBuf* pb);
+
+/**
+ * \brief Replaces the current path with the given one.
+ * @param pb The builder to work on.
+ * @param path The new path.
+ * @return \ref RUE_OK on success, \ref RUE_OVERFLOW if it didn't fit in which
+ *         case the builder is unchanged, else a regify error code.
+ */
+RUAPI int32_t ruPathBufSet(ruPathBuf* pb, trans_chars path);
+
+/**
+ * \brief Appends the given characters as they are, only converting slashes.
+ * @param pb The builder to work on.
+ * @param str The characters to append.
+ * @param len Number of characters to append or \ref RU_SIZE_AUTO.
+ * @return \ref RUE_OK on success, \ref RUE_OVERFLOW if it didn't fit in which
+ *         case the builder is unchanged, else a regify error code.
+ */
+RUAPI int32_t ruPathBufAppend(ruPathBuf* pb, trans_chars str, rusize len);
+
+/**
+ * \brief Appends the given path component separated by a single slash.
+ * @param pb The builder to work on.
+ * @param name The component to append. Leading slashes are skipped.
+ * @param len Number of characters of name or \ref RU_SIZE_AUTO.
+ * @return \ref RUE_OK on success, \ref RUE_OVERFLOW if it didn't fit in which
+ *         case the builder is unchanged, else a regify error code.
+ */
+RUAPI int32_t ruPathBufPush(ruPathBuf* pb, trans_chars name, rusize len);
+
+/**
+ * \brief Removes the last path component along with its separating slash.
+ * A leading root slash is retained.
+ * @param pb The builder to work on.
+ * @return \ref RUE_OK on success, \ref RUE_FILE_NOT_FOUND if there was no
+ *         component left to remove, else a regify error code.
+ */
+RUAPI int32_t ruPathBufPop(ruPathBuf* pb);
+
+/**
+ * \brief Cuts the path back to the given length such as a previously
+ * retrieved \ref ruPathBufLen.
+ * @param pb The builder to work on.
+ * @param len The length to cut the path to.
+ * @return \ref RUE_OK on success, \ref RUE_INVALID_PARAMETER if len exceeds
+ *         the current path length, else a regify error code.
+ */
+RUAPI int32_t ruPathBufTruncate(ruPathBuf* pb, rusize len);
+
+/**
+ * \brief Collapses repeated slashes and resolves . and .. components lexically.
+ * Symbolic links are not taken into account. A trailing slash is retained.
+ * @param pb The builder to work on.
+ * @return \ref RUE_OK on success else a regify error code.
+ */
+RUAPI int32_t ruPathBufNormalize(ruPathBuf* pb);
+
+/**
+ * \brief Returns the current path.
+ * @param pb The builder to query.
+ * @return The NULL terminated path which is valid until the next modification
+ *         of the builder, or NULL if pb was NULL.
+ */
+RUAPI perm_chars ruPathBufStr(ruPathBuf* pb);
+
+/**
+ * \brief Returns the length of the current path.
+ * @param pb The builder to query.
+ * @return The length of the path in bytes.
+ */
+RUAPI rusize ruPathBufLen(ruPathBuf* pb);
+
 /**
  * @}
  */
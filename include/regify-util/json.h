@@ -25,7 +25,8 @@
  *
  * This is a wrapper of https://lloyd.github.io/yajl/
  * It wraps the the yajl_tree API for parsing small content, and the yajl_gen
- * API for generating JSON.
+ * API for generating JSON. Alternatively \ref ruJsonParseLen parses with a
+ * built in arena parser into the same tree structure.
  * See \ref ruJsonNew and \ref ruJsonStart for generation samples
  * and \ref ruJsonParse for a parsing sample.
  *
@@ -44,6 +45,16 @@ typedef void* ruJson;
 
 #define RU_JSON_PRETTIFY 0x01
 #define RU_JSON_ESCAPE_SLASH 0x02
+/**
+ * \brief \ref ruJsonParseLen flag to give objects with 16 or more keys a hash
+ * index so that key lookups no longer scan all keys.
+ *
+ * The index is built while parsing and lives in the same allocation as the
+ * tree. It costs 4 bytes per bucket with at least twice as many buckets as
+ * keys, rounded up to a power of two, so between 8 and 16 bytes per key.
+ * Smaller objects are scanned as before.
+ */
+#define RU_JSON_INDEX_KEYS 0x04
 
 
 /**
@@ -288,6 +299,26 @@ RUAPI int32_t ruJsonWrite(ruJson rj, perm_chars* output);
  */
 RUAPI ruJson ruJsonParse(trans_chars jsonStr, int32_t* status);
 
+/**
+ * Parse given buffer into a \ref ruJson object using the built in arena parser.
+ *
+ * This works like \ref ruJsonParse and the result is queried with the same
+ * getters, but the whole tree lives in a single allocation, which makes it
+ * considerably faster for many small documents. The input need not be NULL
+ * terminated, and parse errors report the offset instead of the content.
+ * C and C++ style comments are permitted as with \ref ruJsonParse.
+ *
+ * @param jsonStr The JSON content to parse.
+ * @param len Length of jsonStr in bytes or \ref RU_SIZE_AUTO if it is NULL
+ *            terminated. Must not exceed 4GB.
+ * @param flags 0 or \ref RU_JSON_INDEX_KEYS for documents with large objects
+ *              that are queried repeatedly.
+ * @param status where the \ref RUE_OK on success or an error code will be stored.
+ * @return \ref ruJson object to be freed with \ref ruJsonFree after use.
+ */
+RUAPI ruJson ruJsonParseLen(trans_chars jsonStr, rusize len, uint32_t flags,
+                            int32_t* status);
+
 /**
  * Return array size of underlying \ref ruJson reference
  * @param rj \ref ruJson reference pointing to an array
@@ -525,6 +556,463 @@ RUAPI ruJson ruJsonIdxMap(ruJson rj, rusize index, int32_t* status);
  */
 RUAPI ruJson ruJsonIdxArray(ruJson rj, rusize index, int32_t* status);
 
+/**
+ * \brief An opaque type representing a streaming JSON parser.
+ */
+typedef void* ruJsonStream;
+
+/** \brief Start of an object */
+#define RU_JSON_EV_MAP_START 1
+/** \brief End of an object */
+#define RU_JSON_EV_MAP_END 2
+/** \brief Start of an array */
+#define RU_JSON_EV_ARRAY_START 3
+/** \brief End of an array */
+#define RU_JSON_EV_ARRAY_END 4
+/** \brief An object key, see \ref ruJsonStreamStr */
+#define RU_JSON_EV_KEY 5
+/** \brief A string value, see \ref ruJsonStreamStr */
+#define RU_JSON_EV_STRING 6
+/** \brief A number, see \ref ruJsonStreamInt and \ref ruJsonStreamDouble */
+#define RU_JSON_EV_NUMBER 7
+/** \brief The literal true */
+#define RU_JSON_EV_TRUE 8
+/** \brief The literal false */
+#define RU_JSON_EV_FALSE 9
+/** \brief The literal null */
+#define RU_JSON_EV_NULL 10
+/** \brief The document is complete */
+#define RU_JSON_EV_END 11
+
+/**
+ * Creates a parser that pulls JSON through the given reader in chunks.
+ *
+ * The document is either walked event by event with \ref ruJsonStreamNext
+ * or, typically for large arrays, one element at a time with
+ * \ref ruJsonStreamValue. Only the current token or value is kept in memory,
+ * so a file of any size can be processed as long as its individual elements
+ * are reasonably small.
+ *
+ * Sample to process the records of a large array:
+ * ~~~~~{.c}
+ * ruJsonStream js = ruJsonStreamNew(reader, ctx, 0, &ret);
+ * ret = ruJsonStreamNext(js, &event); // RU_JSON_EV_ARRAY_START
+ * ruJson rec;
+ * while ((rec = ruJsonStreamValue(js, &ret))) {
+ *     perm_chars name = ruJsonKeyStr(rec, "name", &ret);
+ *     rec = ruJsonFree(rec);
+ * }
+ * // ret is RUE_FILE_NOT_FOUND here unless there was an error
+ * ret = ruJsonStreamNext(js, &event); // RU_JSON_EV_ARRAY_END
+ * js = ruJsonStreamFree(js);
+ * ~~~~~
+ *
+ * @param reader Callback providing the input, which returns the number of
+ *               bytes read, 0 at the end of input or a negative value on error.
+ * @param ctx Context passed to the reader.
+ * @param flags Flags used for values returned by \ref ruJsonStreamValue, see
+ *              \ref ruJsonParseLen.
+ * @param code where the \ref RUE_OK on success or an error code will be stored.
+ * @return \ref ruJsonStream to be freed with \ref ruJsonStreamFree after use.
+ */
+RUAPI ruJsonStream ruJsonStreamNew(rcReadFn reader, perm_ptr ctx, uint32_t flags,
+                                   int32_t* code);
+
+/**
+ * Frees the given \ref ruJsonStream. The reader is not closed.
+ * @param js \ref ruJsonStream to free
+ * @return NULL
+ */
+RUAPI ruJsonStream ruJsonStreamFree(ruJsonStream js);
+
+/**
+ * Parses up to the next event. Once the document is complete
+ * \ref RU_JSON_EV_END is returned, followed by nothing but more of those.
+ * After an error the stream can't be used anymore and keeps returning it.
+ * @param js \ref ruJsonStream to read from
+ * @param event where the RU_JSON_EV_* constant of the event will be stored.
+ * @return \ref RUE_OK on success, \ref RUE_INVALID_PARAMETER on parse errors
+ *         with details in \ref ruLastError, or another error code.
+ */
+RUAPI int32_t ruJsonStreamNext(ruJsonStream js, int32_t* event);
+
+/**
+ * Parses the next value in its entirety and returns it as \ref ruJson
+ * object built by the arena parser of \ref ruJsonParseLen.
+ *
+ * This may be mixed with \ref ruJsonStreamNext. After a
+ * \ref RU_JSON_EV_KEY it returns the value of that key, inside of an array
+ * it returns the next element. Offsets of parse errors found by the arena
+ * parser are relative to the start of the value.
+ * @param js \ref ruJsonStream to read from
+ * @param status where the \ref RUE_OK on success or an error code will be
+ *               stored. \ref RUE_FILE_NOT_FOUND signals the end of the
+ *               current container or document, whose end event is left for
+ *               \ref ruJsonStreamNext. \ref RUE_INVALID_STATE means that an
+ *               object key comes next.
+ * @return \ref ruJson object to be freed with \ref ruJsonFree after use.
+ */
+RUAPI ruJson ruJsonStreamValue(ruJsonStream js, int32_t* status);
+
+/**
+ * Returns the number of currently open objects and arrays.
+ * @param js \ref ruJsonStream to query
+ * @return the nesting depth
+ */
+RUAPI uint32_t ruJsonStreamDepth(ruJsonStream js);
+
+/**
+ * Returns the content of the last event, which is the decoded text of keys
+ * and strings and the literal text of numbers, true, false and null.
+ * @param js \ref ruJsonStream to query
+ * @param len Optional, where the length of the returned string will be stored.
+ * @param status where the \ref RUE_OK on success or an error code will be stored.
+ *               \ref RUE_INVALID_STATE when the last event has no content.
+ * @return The content, which is valid until the next call on the stream.
+ */
+RUAPI perm_chars ruJsonStreamStr(ruJsonStream js, rusize* len, int32_t* status);
+
+/**
+ * Returns the last \ref RU_JSON_EV_NUMBER event as integer.
+ * @param js \ref ruJsonStream to query
+ * @param status where the \ref RUE_OK on success or an error code will be stored.
+ *               \ref RUE_INVALID_PARAMETER when the number is no integer or
+ *               out of range.
+ * @return the integer value
+ */
+RUAPI int64_t ruJsonStreamInt(ruJsonStream js, int32_t* status);
+
+/**
+ * Returns the last \ref RU_JSON_EV_NUMBER event as double.
+ * @param js \ref ruJsonStream to query
+ * @param status where the \ref RUE_OK on success or an error code will be stored.
+ * @return the double value
+ */
+RUAPI double ruJsonStreamDouble(ruJsonStream js, int32_t* status);
+
+/**
+ * \brief An opaque type representing a JSON writer.
+ */
+typedef void* ruJsonWriter;
+
+/**
+ * Creates a JSON writer that passes its output to the given write function.
+ *
+ * Unlike \ref ruJsonNew the document is not held in memory, output is
+ * collected in a buffer of flushAt bytes which is handed to the writer
+ * whenever it fills up, and by \ref ruJsonWriterFlush.
+ *
+ * Sample:
+ * ~~~~~{.c}
+ * ruString out = ruStringNew(NULL);
+ * ruJsonWriter jw = ruJsonWriterNew(out, 0, &ret);
+ * ret = ruJsonWriterStartMap(jw);
+ * ret = ruJsonWriterKey(jw, "id");
+ * ret = ruJsonWriterInt(jw, 42);
+ * ret = ruJsonWriterEndMap(jw);
+ * ret = ruJsonWriterFlush(jw);
+ * // out now holds {"id":42}
+ * jw = ruJsonWriterFree(jw);
+ * ~~~~~
+ *
+ * @param writer The write function to be called with the output.
+ * @param ctx The context to be passed to the write function.
+ * @param flushAt Size of the output buffer, 0 for the default of 64k.
+ * @param flags A combination of \ref RU_JSON_PRETTIFY and
+ *              \ref RU_JSON_ESCAPE_SLASH. Pretty output is indented by 4
+ *              spaces.
+ * @param code where the \ref RUE_OK on success or an error code will be stored.
+ * @return \ref ruJsonWriter to be freed with \ref ruJsonWriterFree after use.
+ */
+RUAPI ruJsonWriter ruJsonWriterNewSink(rcWriteFn writer, perm_ptr ctx,
+                                       rusize flushAt, uint32_t flags,
+                                       int32_t* code);
+
+/**
+ * Creates a JSON writer that appends its output to the given \ref ruString.
+ * The string is complete after \ref ruJsonWriterFlush or
+ * \ref ruJsonWriterFree.
+ * @param out The \ref ruString to append to. It must outlive the writer.
+ * @param flags See \ref ruJsonWriterNewSink
+ * @param code where the \ref RUE_OK on success or an error code will be stored.
+ * @return \ref ruJsonWriter to be freed with \ref ruJsonWriterFree after use.
+ */
+RUAPI ruJsonWriter ruJsonWriterNew(ruString out, uint32_t flags, int32_t* code);
+
+/**
+ * Flushes remaining output and frees the given \ref ruJsonWriter. Use
+ * \ref ruJsonWriterFlush first when write errors are of interest.
+ * @param jw \ref ruJsonWriter to free
+ * @return NULL
+ */
+RUAPI ruJsonWriter ruJsonWriterFree(ruJsonWriter jw);
+
+/**
+ * Hands all buffered output to the write function.
+ * @param jw \ref ruJsonWriter to flush
+ * @return \ref RUE_OK on success, \ref RUE_CANT_WRITE if the write function
+ *         failed, after which the writer stays unusable.
+ */
+RUAPI int32_t ruJsonWriterFlush(ruJsonWriter jw);
+
+/**
+ * Opens an object.
+ * @param jw \ref ruJsonWriter to write to
+ * @return \ref RUE_OK on success, \ref RUE_INVALID_STATE if no value may
+ *         come next, else an error code.
+ */
+RUAPI int32_t ruJsonWriterStartMap(ruJsonWriter jw);
+
+/**
+ * Closes the current object.
+ * @param jw \ref ruJsonWriter to write to
+ * @return \ref RUE_OK on success, \ref RUE_INVALID_STATE if no object is
+ *         open or a key lacks its value, else an error code.
+ */
+RUAPI int32_t ruJsonWriterEndMap(ruJsonWriter jw);
+
+/**
+ * Opens an array.
+ * @param jw \ref ruJsonWriter to write to
+ * @return \ref RUE_OK on success, \ref RUE_INVALID_STATE if no value may
+ *         come next, else an error code.
+ */
+RUAPI int32_t ruJsonWriterStartArray(ruJsonWriter jw);
+
+/**
+ * Closes the current array.
+ * @param jw \ref ruJsonWriter to write to
+ * @return \ref RUE_OK on success, \ref RUE_INVALID_STATE if no array is
+ *         open, else an error code.
+ */
+RUAPI int32_t ruJsonWriterEndArray(ruJsonWriter jw);
+
+/**
+ * Writes an object key, which must be followed by its value.
+ * @param jw \ref ruJsonWriter to write to
+ * @param key The UTF-8 key
+ * @return \ref RUE_OK on success, \ref RUE_INVALID_STATE if not within an
+ *         object, \ref RUE_INVALID_PARAMETER on invalid UTF-8, else an error
+ *         code.
+ */
+RUAPI int32_t ruJsonWriterKey(ruJsonWriter jw, trans_chars key);
+
+/**
+ * Writes a string value.
+ * @param jw \ref ruJsonWriter to write to
+ * @param val The UTF-8 string. NULL results in a null value.
+ * @return \ref RUE_OK on success, \ref RUE_INVALID_STATE if no value may
+ *         come next, \ref RUE_INVALID_PARAMETER on invalid UTF-8, else an
+ *         error code.
+ */
+RUAPI int32_t ruJsonWriterStr(ruJsonWriter jw, trans_chars val);
+
+/**
+ * Writes a string value of given length, see \ref ruJsonWriterStr.
+ * @param jw \ref ruJsonWriter to write to
+ * @param val The UTF-8 string, which may contain 0 bytes.
+ * @param len Length of val in bytes or \ref RU_SIZE_AUTO
+ * @return \ref RUE_OK on success or an error code.
+ */
+RUAPI int32_t ruJsonWriterStrLen(ruJsonWriter jw, trans_chars val, rusize len);
+
+/**
+ * Writes an integer value.
+ * @param jw \ref ruJsonWriter to write to
+ * @param val The value
+ * @return \ref RUE_OK on success or an error code.
+ */
+RUAPI int32_t ruJsonWriterInt(ruJsonWriter jw, int64_t val);
+
+/**
+ * Writes a double value with the fewest digits that read back exactly.
+ * @param jw \ref ruJsonWriter to write to
+ * @param val The value
+ * @return \ref RUE_OK on success, \ref RUE_INVALID_PARAMETER for infinity
+ *         and NaN, else an error code.
+ */
+RUAPI int32_t ruJsonWriterDouble(ruJsonWriter jw, double val);
+
+/**
+ * Writes a true or false value.
+ * @param jw \ref ruJsonWriter to write to
+ * @param val The value
+ * @return \ref RUE_OK on success or an error code.
+ */
+RUAPI int32_t ruJsonWriterBool(ruJsonWriter jw, bool val);
+
+/**
+ * Writes a null value.
+ * @param jw \ref ruJsonWriter to write to
+ * @return \ref RUE_OK on success or an error code.
+ */
+RUAPI int32_t ruJsonWriterNull(ruJsonWriter jw);
+
+/**
+ * \brief An opaque type representing one or more compiled JSON paths.
+ */
+typedef void* ruJsonPath;
+
+/**
+ * Compiles a path expression for repeated lookups with \ref ruJsonPathGet.
+ *
+ * Two notations are understood:
+ * - JSON Pointer as of RFC 6901 such as "/users/0/name", where "" refers to
+ *   the whole document and ~0 and ~1 escape ~ and /.
+ * - Simple JSONPath such as "$.users[0].name", "$['odd.key'][-1]". Negative
+ *   indices count from the end of the array. Wildcards, slices and filters
+ *   are not supported.
+ *
+ * Sample:
+ * ~~~~~{.c}
+ * ruJsonPath jp = ruJsonPathCompile("$.user.address.city", &ret);
+ * for (...) {
+ *     perm_chars city = ruJsonPathStr(jp, doc, &ret);
+ * }
+ * jp = ruJsonPathFree(jp);
+ * ~~~~~
+ *
+ * @param expr The path expression
+ * @param code where the \ref RUE_OK on success or an error code will be stored.
+ *             \ref RUE_INVALID_PARAMETER on syntax errors with details in
+ *             \ref ruLastError.
+ * @return \ref ruJsonPath to be freed with \ref ruJsonPathFree after use.
+ */
+RUAPI ruJsonPath ruJsonPathCompile(trans_chars expr, int32_t* code);
+
+/**
+ * Compiles a set of paths to be extracted together with
+ * \ref ruJsonPathGetAll. Common prefixes are resolved only once, and the
+ * wanted keys of an object are looked up in a single pass over it.
+ * @param exprs Array of path expressions, see \ref ruJsonPathCompile
+ * @param count Number of expressions
+ * @param code where the \ref RUE_OK on success or an error code will be stored.
+ * @return \ref ruJsonPath to be freed with \ref ruJsonPathFree after use.
+ */
+RUAPI ruJsonPath ruJsonPathCompileAll(trans_chars* exprs, rusize count,
+                                      int32_t* code);
+
+/**
+ * Frees the given \ref ruJsonPath.
+ * @param jp \ref ruJsonPath to free
+ * @return NULL
+ */
+RUAPI ruJsonPath ruJsonPathFree(ruJsonPath jp);
+
+/**
+ * Looks up the value the (first) compiled path refers to.
+ * @param jp The compiled \ref ruJsonPath
+ * @param rj The \ref ruJson document or sub object to search
+ * @param status where the \ref RUE_OK on success or an error code will be stored.
+ *               \ref RUE_FILE_NOT_FOUND if the path doesn't exist.
+ * @return \ref ruJson reference to the value, to be queried with the
+ *         getters such as \ref ruJsonStr or \ref ruJsonKeyInt. It's valid
+ *         as long as rj is and must not be freed.
+ */
+RUAPI ruJson ruJsonPathGet(ruJsonPath jp, ruJson rj, int32_t* status);
+
+/**
+ * Looks up all compiled paths in a single traversal.
+ * @param jp The compiled \ref ruJsonPath
+ * @param rj The \ref ruJson document or sub object to search
+ * @param results Array with room for one entry per compiled path, where the
+ *                found values, see \ref ruJsonPathGet, or NULL for the
+ *                missing ones will be stored.
+ * @param status where the \ref RUE_OK on success or an error code will be stored.
+ *               \ref RUE_FILE_NOT_FOUND if none of the paths exists.
+ * @return Number of paths found
+ */
+RUAPI rusize ruJsonPathGetAll(ruJsonPath jp, ruJson rj, ruJson* results,
+                              int32_t* status);
+
+/**
+ * Returns the string the path refers to.
+ * @param jp The compiled \ref ruJsonPath
+ * @param rj The \ref ruJson document or sub object to search
+ * @param status where the \ref RUE_OK on success or an error code will be stored.
+ *               \ref RUE_INVALID_PARAMETER if the value is not a string.
+ * @return The string, which is valid as long as rj is.
+ */
+RUAPI perm_chars ruJsonPathStr(ruJsonPath jp, ruJson rj, int32_t* status);
+
+/**
+ * Returns the integer the path refers to.
+ * @param jp The compiled \ref ruJsonPath
+ * @param rj The \ref ruJson document or sub object to search
+ * @param status where the \ref RUE_OK on success or an error code will be stored.
+ *               \ref RUE_INVALID_PARAMETER if the value is not an integer.
+ * @return the integer
+ */
+RUAPI int64_t ruJsonPathInt(ruJsonPath jp, ruJson rj, int32_t* status);
+
+/**
+ * Returns the double the path refers to.
+ * @param jp The compiled \ref ruJsonPath
+ * @param rj The \ref ruJson document or sub object to search
+ * @param status where the \ref RUE_OK on success or an error code will be stored.
+ *               \ref RUE_INVALID_PARAMETER if the value is not a number.
+ * @return the double
+ */
+RUAPI double ruJsonPathDouble(ruJsonPath jp, ruJson rj, int32_t* status);
+
+/**
+ * Returns the boolean the path refers to.
+ * @param jp The compiled \ref ruJsonPath
+ * @param rj The \ref ruJson document or sub object to search
+ * @param status where the \ref RUE_OK on success or an error code will be stored.
+ *               \ref RUE_INVALID_PARAMETER if the value is not true or false.
+ * @return the boolean
+ */
+RUAPI bool ruJsonPathBool(ruJsonPath jp, ruJson rj, int32_t* status);
+
+/**
+ * Serializes a parsed document into a binary image for fast reloading with
+ * \ref ruJsonFromBinary or \ref ruJsonLoadBinary.
+ *
+ * The image is the in memory tree with pointers stored as offsets, so
+ * loading it only takes a single pass over the values without any parsing
+ * or further allocations. It's meant as a cache next to the original JSON,
+ * since it only loads on platforms with the same pointer size and byte
+ * order. Key indices of \ref RU_JSON_INDEX_KEYS are preserved.
+ *
+ * @param rj The \ref ruJson document or sub object to serialize
+ * @param len where the size of the image will be stored.
+ * @param status where the \ref RUE_OK on success or an error code will be stored.
+ * @return The image, to be freed with \ref ruFree after use.
+ */
+RUAPI alloc_ptr ruJsonToBinary(ruJson rj, rusize* len, int32_t* status);
+
+/**
+ * Loads a binary image created with \ref ruJsonToBinary.
+ * @param data The image
+ * @param len Size of the image
+ * @param status where the \ref RUE_OK on success or an error code will be stored.
+ *               \ref RUE_INVALID_PARAMETER if the image is corrupt,
+ *               \ref RUE_FEATURE_NOT_SUPPORTED if it was made on a different
+ *               platform.
+ * @return \ref ruJson object to be freed with \ref ruJsonFree after use.
+ */
+RUAPI ruJson ruJsonFromBinary(trans_ptr data, rusize len, int32_t* status);
+
+/**
+ * Writes the binary image of the given document to a file, see
+ * \ref ruJsonToBinary.
+ * @param rj The \ref ruJson document or sub object to serialize
+ * @param filePath Path of the file to write
+ * @return \ref RUE_OK on success else an error code
+ */
+RUAPI int32_t ruJsonSaveBinary(ruJson rj, trans_chars filePath);
+
+/**
+ * Loads a binary image written by \ref ruJsonSaveBinary. The file is read
+ * straight into the memory the document lives in.
+ * @param filePath Path of the file to load
+ * @param status where the \ref RUE_OK on success or an error code will be
+ *               stored, see \ref ruJsonFromBinary.
+ * @return \ref ruJson object to be freed with \ref ruJsonFree after use.
+ */
+RUAPI ruJson ruJsonLoadBinary(trans_chars filePath, int32_t* status);
+
 /**
  * @}
  */
@@ -26,7 +26,9 @@
  * \section kvstore_sec Key Value Storage
  *
  * Currently provided implementations are \ref ruFileStore for file system based
- * storage and \ref ruNullStore to omit local storage altogether.
+ * storage, \ref ruLogStore for many small values and \ref ruNullStore to omit
+ * local storage altogether. \ref ruCacheStore keeps values of any of those in
+ * memory.
  * It consists of a simple \ref kvget, \ref kvset and \ref kvlist call.
  *
  * \subsection kvstore Key Value Storage
@@ -175,6 +177,175 @@ RUAPI int32_t ruFileStoreGet (KvStore *kvs, const char* key, char **val, rusize*
  */
 RUAPI int32_t ruFileStoreList (KvStore *kvs, const char* key, ruList* result);
 
+/**
+ * \brief Opaque pointer to a log based KvStore interface.
+ */
+typedef void* ruLogStore;
+
+/**
+ * \brief Returns a newly created log based \ref KvStore object.
+ * All values are appended to a single log file in the given folder and an in
+ * memory hash index points to the current value of each key. This avoids a
+ * file per key, which makes it the better choice for many small values.
+ *
+ * Each set is handed to the operating system right away, so values survive a
+ * crash of the process. A record that was only partially written when the
+ * system went down is detected by its checksum and dropped when the store is
+ * opened again. Once more than half of a log of at least 4MB is made up of
+ * outdated values the log is compacted, see \ref ruLogStoreCompact.
+ *
+ * Only one store object may use a folder at a time.
+ * @param folderPath Top level folder under which the log will be stored.
+ * @param code Return code willbe \ref RUE_OK on success or error otherwise.
+ * @return \ref KvStore object on success else NULL.
+ */
+RUAPI KvStore* ruNewLogStore(const char *folderPath, int32_t* code);
+
+/**
+ * \brief Set the value of key in the given LogStore.
+ * @param kvs LogStore context where data will be stored.
+ * @param key The \ref kvkey to the data in question.
+ * @param val The value that will be stored or NULL if the key is to be removed.
+ *            The value will be copied.
+ * @param len The number of bytes that make up val or \ref RU_SIZE_AUTO.
+ * @return \ref RUE_OK on success else an error code.
+ */
+RUAPI int32_t ruLogStoreSet (KvStore *kvs, const char* key, const char *val, rusize len);
+
+/**
+ * \brief Get the value of key from the given LogStore.
+ * @param kvs LogStore context where data will be retrieved from.
+ * @param key The \ref kvkey to the data in question.
+ * @param val Where the retrieved value will be stored.
+ *            Caller should free this with \ref ruFree when done with it.
+ * @param len The number of bytes that make up val.
+ * @return \ref RUE_OK on success, \ref RUE_FILE_NOT_FOUND for unknown keys
+ *         else an error code.
+ */
+RUAPI int32_t ruLogStoreGet (KvStore *kvs, const char* key, char **val, rusize* len);
+
+/**
+ * \brief Returns a list of keys under the given key.
+ * @param kvs LogStore context where key will be listed from.
+ * @param key The \ref kvkey to the data in question. May end with " *"
+ * @param result An \ref ruList of \ref kvkey strings. Should be freed with
+ *               \ref ruListFree after use.
+ * @return \ref RUE_OK on success else an error code.
+ */
+RUAPI int32_t ruLogStoreList (KvStore *kvs, const char* key, ruList* result);
+
+/**
+ * \brief Rewrites the log of the given LogStore with only the current values.
+ * This happens automatically as the log grows, but may be called to reclaim
+ * space right away. The new log is flushed to disk before it replaces the old
+ * one.
+ * @param kvs LogStore to compact.
+ * @return \ref RUE_OK on success else an error code.
+ */
+RUAPI int32_t ruLogStoreCompact(KvStore *kvs);
+
+/**
+ * \brief Opaque pointer to a caching KvStore interface.
+ */
+typedef void* ruCacheStore;
+
+/**
+ * \brief Default mode of \ref ruNewCacheStore. Every set reaches the wrapped
+ * store before it returns.
+ */
+#define RU_CACHE_WRITE_THROUGH 0
+
+/**
+ * \brief Mode of \ref ruNewCacheStore where sets only update the cache.
+ * Changed values are written to the wrapped store when they are evicted, on
+ * \ref ruCacheStoreFlush, before listing and when the store is freed.
+ */
+#define RU_CACHE_WRITE_BACK 1
+
+/**
+ * \brief Counters of a \ref ruCacheStore as returned by \ref ruCacheStoreStats.
+ */
+typedef struct {
+    /** \brief Number of gets served from the cache. */
+    uint64_t hits;
+    /** \brief Number of gets passed on to the wrapped store. */
+    uint64_t misses;
+    /** \brief Number of values dropped to stay within the budget. */
+    uint64_t evictions;
+    /** \brief Number of changed values written back to the wrapped store. */
+    uint64_t writes;
+    /** \brief Bytes currently accounted to cached keys and values. */
+    rusize bytes;
+    /** \brief Number of currently cached entries. */
+    rusize entries;
+} ruCacheStats;
+
+/**
+ * \brief Returns a \ref KvStore that caches the values of the given store.
+ * Recently used values are kept in memory up to the given budget and the least
+ * recently used ones are dropped first. Values larger than the budget are
+ * never cached. Keys are listed by the wrapped store. Cache misses read the
+ * wrapped store without holding the cache lock, so it must allow a get to run
+ * alongside its other calls, as the file and log stores do.
+ * @param store The \ref KvStore to wrap. It is owned by the returned store and
+ *              freed along with it.
+ * @param budget Number of bytes the cached keys and values may take up,
+ *               including some bookkeeping per entry.
+ * @param flags \ref RU_CACHE_WRITE_THROUGH or \ref RU_CACHE_WRITE_BACK.
+ * @param code Return code willbe \ref RUE_OK on success or error otherwise.
+ * @return \ref KvStore object on success else NULL.
+ */
+RUAPI KvStore* ruNewCacheStore(KvStore* store, rusize budget, uint32_t flags,
+                               int32_t* code);
+
+/**
+ * \brief Set the value of key in the given CacheStore.
+ * @param kvs CacheStore context where data will be stored.
+ * @param key The \ref kvkey to the data in question.
+ * @param val The value that will be stored or NULL if the key is to be removed.
+ *            The value will be copied.
+ * @param len The number of bytes that make up val or \ref RU_SIZE_AUTO.
+ * @return \ref RUE_OK on success else an error code.
+ */
+RUAPI int32_t ruCacheStoreSet (KvStore *kvs, const char* key, const char *val, rusize len);
+
+/**
+ * \brief Get the value of key from the given CacheStore.
+ * @param kvs CacheStore context where data will be retrieved from.
+ * @param key The \ref kvkey to the data in question.
+ * @param val Where the retrieved value will be stored.
+ *            Caller should free this with \ref ruFree when done with it.
+ * @param len The number of bytes that make up val.
+ * @return \ref RUE_OK on success else an error code.
+ */
+RUAPI int32_t ruCacheStoreGet (KvStore *kvs, const char* key, char **val, rusize* len);
+
+/**
+ * \brief Returns a list of keys under the given key from the wrapped store.
+ * Pending changes are written back first.
+ * @param kvs CacheStore context where key will be listed from.
+ * @param key The \ref kvkey to the data in question. May end with " *"
+ * @param result An \ref ruList of \ref kvkey strings. Should be freed with
+ *               \ref ruListFree after use.
+ * @return \ref RUE_OK on success else an error code.
+ */
+RUAPI int32_t ruCacheStoreList (KvStore *kvs, const char* key, ruList* result);
+
+/**
+ * \brief Writes all pending changes of a write back CacheStore.
+ * @param kvs CacheStore to flush.
+ * @return \ref RUE_OK on success else the first error of the wrapped store.
+ */
+RUAPI int32_t ruCacheStoreFlush(KvStore *kvs);
+
+/**
+ * \brief Retrieves the counters of the given CacheStore.
+ * @param kvs CacheStore to query.
+ * @param stats Where the counters will be stored.
+ * @return \ref RUE_OK on success else an error code.
+ */
+RUAPI int32_t ruCacheStoreStats(KvStore *kvs, ruCacheStats* stats);
+
 /**
  * \brief Opaque pointer to a Null KvStore interface.
  */
@@ -39,6 +39,10 @@ extern "C" {
  * \brief These functions facilitate regular expression functionality as it is provided
  * by ICU http://site.icu-project.org/
  *
+ * A \ref ruRegex object may be shared between threads. Concurrent calls each
+ * use their own matcher cloned from the compiled pattern, so they run in
+ * parallel rather than waiting on each other.
+ *
  * Example:
  * ~~~~~{.c}
  * int32_t exp = RUE_OK;
@@ -130,6 +134,17 @@ typedef enum ruRegexFlag_ {
  */
 typedef void* ruRegex;
 
+/**
+ * \brief Location of a match group within the searched string.
+ */
+typedef struct {
+    /** Byte offset of the group in the original string or -1 if the group
+     * did not take part in the match. */
+    rusize_s offset;
+    /** Length of the group in bytes. */
+    rusize length;
+} ruRegexSpan;
+
 /**
  * \brief Frees up the resources of the given \ref ruRegex object.
  * @param rr object to free.
@@ -148,6 +163,53 @@ RUAPI ruRegex ruRegexFree(ruRegex rr);
  */
 RUAPI ruRegex ruRegexNew(const char* pattern, ruRegexFlag flags, int32_t* code);
 
+/**
+ * \brief Statistics of the process wide regex cache.
+ */
+typedef struct {
+    /** Number of \ref ruRegexCached calls served from the cache. */
+    uint64_t hits;
+    /** Number of \ref ruRegexCached calls that compiled the pattern. */
+    uint64_t misses;
+    /** Number of entries dropped to stay within the size limit. */
+    uint64_t evictions;
+    /** Number of patterns currently cached. */
+    uint32_t entries;
+} ruRegexCacheStats;
+
+/**
+ * \brief Like \ref ruRegexNew but returns a shared object from a process wide
+ * cache when the same pattern and flags were compiled before.
+ *
+ * The returned object must not be modified and is released with
+ * \ref ruRegexFree as usual. Cached objects are reference counted, so an
+ * object that is evicted while in use stays valid until it is freed.
+ * The cache keeps the \ref ruRegexCacheSet most recently used patterns.
+ * @param pattern The pattern representing the regular expression without delimiters.
+ * @param flags Flags influencing the behavior of the expression.
+ * @param code (Optional) Where the return result of this operation such as
+ *             \ref RUE_OK on success will be stored.
+ * @return The ruRegex object or NULL on failure.
+ */
+RUAPI ruRegex ruRegexCached(const char* pattern, ruRegexFlag flags,
+                            int32_t* code);
+
+/**
+ * \brief Sets the number of patterns kept by \ref ruRegexCached.
+ * Reducing the size evicts the least recently used entries.
+ * @param maxEntries Maximum number of cached patterns, defaults to 128. 0
+ *                   disables the cache so that \ref ruRegexCached compiles
+ *                   on every call.
+ */
+RUAPI void ruRegexCacheSet(uint32_t maxEntries);
+
+/**
+ * \brief Returns the statistics of the \ref ruRegexCached cache.
+ * @param stats Where the statistics will be stored.
+ * @return \ref RUE_OK on success else \ref RUE_PARAMETER_NOT_SET.
+ */
+RUAPI int32_t ruRegexCacheGetStats(ruRegexCacheStats* stats);
+
 /**
  * \brief Replace the found expression instances in original with the content
  * found in replacement and return the result.
@@ -202,6 +264,118 @@ RUAPI ruList ruRegexMatchGroups(ruRegex rr, const char* original, int32_t* code)
  */
 RUAPI ruList ruRegexFindGroups(ruRegex rr, const char* original, int32_t* code);
 
+/**
+ * \brief Returns the number of capture groups in the expression, not counting
+ * the implicit group 0 for the entire match.
+ * @param rr The \ref ruRegex object to use.
+ * @param code (Optional) Where the return result of this operation such as
+ *             \ref RUE_OK on success will be stored.
+ * @return The number of capture groups or -1 on error.
+ */
+RUAPI int32_t ruRegexGroupCount(ruRegex rr, int32_t* code);
+
+/**
+ * \brief Like \ref ruRegexMatchGroups but reports the groups as spans into
+ * original rather than as copies.
+ *
+ * The UTF-8 original is searched in place without a conversion to UTF-16 and
+ * nothing is allocated for the result.
+ * @param rr The \ref ruRegex object to use.
+ * @param original The UTF-8 source string to match.
+ * @param len Length of original in bytes or \ref RU_SIZE_AUTO if it is NULL
+ *            terminated.
+ * @param spans (Optional) Where up to spanCount group locations will be stored
+ *              on a match. Entry 0 is the entire match. Entries past
+ *              \ref ruRegexGroupCount get an offset of -1.
+ * @param spanCount Number of entries in spans.
+ * @param code (Optional) Where the return result of this operation such as
+ *             \ref RUE_OK on success will be stored.
+ * @return true or false depending on whether there was a match.
+ */
+RUAPI bool ruRegexMatchSpans(ruRegex rr, trans_chars original, rusize len,
+                             ruRegexSpan* spans, uint32_t spanCount,
+                             int32_t* code);
+
+/**
+ * \brief Like \ref ruRegexFindGroups but reports the groups as spans into
+ * original rather than as copies. See \ref ruRegexMatchSpans for details.
+ * @param rr The \ref ruRegex object to use.
+ * @param original The UTF-8 source string to search.
+ * @param len Length of original in bytes or \ref RU_SIZE_AUTO if it is NULL
+ *            terminated.
+ * @param spans (Optional) Where up to spanCount group locations will be stored
+ *              on a match.
+ * @param spanCount Number of entries in spans.
+ * @param code (Optional) Where the return result of this operation such as
+ *             \ref RUE_OK on success will be stored.
+ * @return true or false depending on whether there was a match.
+ */
+RUAPI bool ruRegexFindSpans(ruRegex rr, trans_chars original, rusize len,
+                            ruRegexSpan* spans, uint32_t spanCount,
+                            int32_t* code);
+
+/**
+ * \brief Opaque pointer to a set of regular expressions that are matched
+ * together.
+ */
+typedef void* ruRegexSet;
+
+/**
+ * \brief Creates a new empty regular expression set. Add patterns with
+ * \ref ruRegexSetAdd and free with \ref ruRegexSetFree after use.
+ *
+ * A set reports which of its patterns occur in a text with a single pass over
+ * the text. Patterns made of literals, classes, groups, alternations,
+ * quantifiers and the ^ and $ anchors are compiled into a shared DFA. Other
+ * constructs such as look arounds, backreferences or \\b as well as flags other
+ * than \ref RUREGEX_CASE_INSENSITIVE and \ref RUREGEX_DOTALL cause the pattern
+ * to be run separately by ICU. The results are the same either way.
+ * The set may be shared between threads, but matches are serialized.
+ * @param code (Optional) Where the return result of this operation such as
+ *             \ref RUE_OK on success will be stored.
+ * @return The new \ref ruRegexSet object.
+ */
+RUAPI ruRegexSet ruRegexSetNew(int32_t* code);
+
+/**
+ * \brief Frees up the resources of the given \ref ruRegexSet object.
+ * @param rs object to free.
+ * @return NULL
+ */
+RUAPI ruRegexSet ruRegexSetFree(ruRegexSet rs);
+
+/**
+ * \brief Adds a pattern to the set.
+ * @param rs The \ref ruRegexSet object to add to.
+ * @param pattern The pattern representing the regular expression without
+ *                delimiters.
+ * @param flags Flags influencing the behavior of the expression.
+ * @param code (Optional) Where the return result of this operation such as
+ *             \ref RUE_OK on success will be stored.
+ * @return The index of the pattern in the set, counting up from 0, or -1 on
+ *         failure.
+ */
+RUAPI int32_t ruRegexSetAdd(ruRegexSet rs, trans_chars pattern,
+                            ruRegexFlag flags, int32_t* code);
+
+/**
+ * \brief Reports which patterns of the set are found in text, like
+ * \ref ruRegexFind would for each pattern.
+ * @param rs The \ref ruRegexSet object to use.
+ * @param text The UTF-8 text to search.
+ * @param len Length of text in bytes or \ref RU_SIZE_AUTO if it is NULL
+ *            terminated.
+ * @param ids (Optional) Where the indexes of up to idCount matching patterns
+ *            will be stored in ascending order.
+ * @param idCount Number of entries in ids.
+ * @param code (Optional) Where the return result of this operation such as
+ *             \ref RUE_OK on success will be stored.
+ * @return The number of matching patterns, which may exceed idCount, or -1 on
+ *         failure.
+ */
+RUAPI int32_t ruRegexSetMatch(ruRegexSet rs, trans_chars text, rusize len,
+                              int32_t* ids, int32_t idCount, int32_t* code);
+
 /**
  * @}
  */
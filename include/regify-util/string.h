@@ -70,6 +70,57 @@ RUAPI ruString ruStringNewn(const char* instr, rusize size);
  */
 RUAPI ruString ruStringNewf(const char* format, ...);
 
+/**
+ * \brief An opaque data type representing a memory arena for \ref ruString
+ * objects.
+ *
+ * Strings created in an arena carry their initial buffer inline with the
+ * object and are all released together when the arena is reset or freed. This
+ * suits code that builds many short lived strings, such as per request
+ * handlers.
+ */
+typedef void* ruArena;
+
+/**
+ * \brief Creates a new arena for \ref ruStringArenaNew.
+ * @param blockSize Size of the memory blocks to carve strings from or 0 for
+ *                  the default of 4096 bytes.
+ * @return The newly created \ref ruArena to be freed with \ref ruArenaFree.
+ */
+RUAPI ruArena ruArenaNew(rusize blockSize);
+
+/**
+ * \brief Releases all strings of the arena while keeping one block for reuse.
+ * All \ref ruString objects and buffers obtained from the arena become
+ * invalid.
+ * @param ra Arena to reset.
+ * @return \ref RUE_OK on success else a regify error code.
+ */
+RUAPI int32_t ruArenaReset(ruArena ra);
+
+/**
+ * \brief Frees the arena along with all strings created in it.
+ * @param ra Arena to free.
+ * @return NULL
+ */
+RUAPI ruArena ruArenaFree(ruArena ra);
+
+/**
+ * \brief Creates a new String object in the given arena.
+ * The object behaves like any other \ref ruString, but its memory belongs to
+ * the arena. Calling \ref ruStringFree on it is optional and does not release
+ * anything, the buffer returned by \ref ruStringGetCString stays valid until
+ * the arena is reset or freed.
+ * @param ra Arena to allocate the string in.
+ * @param instr (Optional) String to start object with.
+ * @param size Initial buffer to allocate or \ref RU_SIZE_AUTO for the length of
+ *             instr. When size is less than the length of instr, only size
+ *             bytes of instr will be copied.
+ * @return The newly created \ref ruString object or NULL on error. Check
+ *         \ref ruLastError in case of NULL;
+ */
+RUAPI ruString ruStringArenaNew(ruArena ra, const char* instr, rusize size);
+
 /**
  * \brief Empties the string for reuse without freeing the buffer.
  * @param rs String to reset
@@ -79,6 +130,8 @@ RUAPI int32_t ruStringReset(ruString rs);
 
 /**
  * \brief Frees the given \ref ruString object.
+ * Strings created with \ref ruStringArenaNew are only invalidated, their
+ * memory is released with the arena.
  * @param rs String to free
  * @param keepBuffer Whether to also free the underlying char* buffer.
  */
@@ -186,6 +239,25 @@ RUAPI bool ruStringEndsWith(ruString rs, const char *suffix, int32_t *code);
  */
 RUAPI char* ruUtf8CaseNormalize(const char *instr, int32_t normMode, int32_t caseMode);
 
+/**
+ * \brief Applies \ref ruUtf8CaseNormalize to every string in the given list.
+ *
+ * The modes and ICU handles are set up once for the whole list, which makes
+ * this cheaper than individual calls when converting many names. Strings that
+ * are ASCII or already in the requested form are copied without conversion.
+ * @param strings List of UTF8 strings to convert.
+ * @param normMode Normalization mode of \ref ruUtf8Nfc, \ref ruUtf8Nfd or 0
+ *                 for untouched.
+ * @param caseMode Case toggling mode of \ref ruUtf8Lower, \ref ruUtf8Upper or
+ *                 \ref ruUtf8NoCase for untouched.
+ * @param code (Optional) Where the return result of this operation such as
+ *             \ref RUE_OK on success will be stored.
+ * @return A new list holding the converted strings in the same order or NULL
+ *         on error. Free with \ref ruListFree.
+ */
+RUAPI ruList ruUtf8CaseNormalizeList(ruList strings, int32_t normMode,
+                                     int32_t caseMode, int32_t* code);
+
 /**
  * \brief Returns the given decomposed string in precomposed form.
  *
@@ -376,6 +448,88 @@ RUAPI ruList ruStrNSplit(trans_chars instr, rusize inlen, trans_chars delim, int
  */
 RUAPI ruList ruStrSplit(trans_chars instr, trans_chars delim, int32_t maxCnt);
 
+/**
+ * \brief A piece of a string as returned by the span based split functions.
+ */
+typedef struct {
+    /** Start of the piece within the original string. It is not terminated. */
+    trans_chars start;
+    /** Length of the piece in bytes. */
+    rusize len;
+} ruStrSpan;
+
+/**
+ * \brief State of a split iteration started with \ref ruStrSplitterInit.
+ * Its members are private. It does not need to be freed.
+ */
+typedef struct {
+    trans_chars next;
+    trans_chars past;
+    trans_chars delim;
+    rusize delimLen;
+    int32_t left;
+    bool trim;
+} ruStrSplitter;
+
+/**
+ * \brief Prepares the splitting of given instr with delim without copying
+ * anything.
+ *
+ * The pieces are then retrieved with \ref ruStrSplitterNext and point into
+ * instr, which must stay valid for the duration. The pieces are the same ones
+ * \ref ruStrNSplit returns.
+ *
+ * Usage:
+ * ~~~~~{.c}
+    ruStrSplitter ss;
+    ruStrSpan sp;
+    ruStrSplitterInit(&ss, line, RU_SIZE_AUTO, ",", 0, true);
+    while (ruStrSplitterNext(&ss, &sp)) {
+        printf("%.*s\n", (int)sp.len, sp.start);
+    }
+ * ~~~~~
+ * @param ss Caller provided splitter to initialize.
+ * @param instr String to split.
+ * @param inlen Optional length delimiter. Use \ref RU_SIZE_AUTO to omit.
+ * @param delim Delimiter to split string on.
+ * @param maxCnt Maximum number of pieces to return or 0 for no limit. The
+ *        remainder will be unsplit in the last piece.
+ * @param trim Whether to trim white space off the pieces as
+ *        \ref ruStrTrimBounds does.
+ * @return \ref RUE_OK on success else a regify error code in which case
+ *         \ref ruStrSplitterNext will not return any pieces.
+ */
+RUAPI int32_t ruStrSplitterInit(ruStrSplitter* ss, trans_chars instr,
+                                rusize inlen, trans_chars delim,
+                                int32_t maxCnt, bool trim);
+
+/**
+ * \brief Returns the next piece of the split started by
+ * \ref ruStrSplitterInit.
+ * @param ss The splitter to advance.
+ * @param span (Optional) Where the location of the piece will be stored.
+ * @return true if a piece was found, false when the string is exhausted.
+ */
+RUAPI bool ruStrSplitterNext(ruStrSplitter* ss, ruStrSpan* span);
+
+/**
+ * \brief Splits given instr with delim into the caller provided span array.
+ * @param instr String to split.
+ * @param inlen Optional length delimiter. Use \ref RU_SIZE_AUTO to omit.
+ * @param delim Delimiter to split string on.
+ * @param trim Whether to trim white space off the pieces as
+ *        \ref ruStrTrimBounds does.
+ * @param spans Where the pieces will be stored.
+ * @param spanCount Number of entries in spans. When there are more pieces, the
+ *        remainder will be unsplit in the last entry.
+ * @param code (Optional) Where the return result of this operation such as
+ *             \ref RUE_OK on success will be stored.
+ * @return The number of pieces stored in spans.
+ */
+RUAPI uint32_t ruStrSplitSpans(trans_chars instr, rusize inlen,
+                               trans_chars delim, bool trim, ruStrSpan* spans,
+                               uint32_t spanCount, int32_t* code);
+
 /**
  * \brief Returns lowercase representation of given ASCII character.
  * @param in Character to lowercase.
@@ -436,6 +590,16 @@ RUAPI alloc_chars ruUtf8ToLower(trans_chars instr);
  */
 RUAPI alloc_chars ruUtf8ToUpper(trans_chars instr);
 
+/**
+ * \brief Checks whether the given string is well formed UTF-8.
+ * Overlong forms, surrogates and code points beyond U+10FFFF are rejected.
+ * @param str The string to check.
+ * @param len Length of str in bytes or \ref RU_SIZE_AUTO if it is NULL
+ *            terminated.
+ * @return true if str is valid UTF-8, false otherwise or when str is NULL.
+ */
+RUAPI bool ruStrIsUtf8(trans_chars str, rusize len);
+
 /**
  * \brief Converts given UTF16 wide character sequence to UTF8
  * @param unistr UTF16 string to convert.
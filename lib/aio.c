@@ -0,0 +1,583 @@
+/*
+ * Copyright regify
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "lib.h"
+
+#ifdef _WIN32
+#define read _read
+#endif
+
+// <editor-fold desc="aio internals">
+#define AIO_DEFAULT_THREADS 4
+#define AIO_MAX_THREADS 64
+
+typedef struct {
+    // must remain the first member so results can be freed as aioReq
+    ruAioResult res;
+    ruAioFunc cb;
+    alloc_chars path;
+    alloc_chars newPath;
+    int64_t offset;
+    rusize size;
+} aioReq;
+
+typedef struct {
+    ru_int type;
+    // pending requests
+    ruList queue;
+    // completed requests without callback
+    ruList done;
+    ruThread* workers;
+    uint32_t threads;
+    // guards pending and seq
+    ruMutex mux;
+    ruCond idle;
+    volatile uint32_t pending;
+    uint64_t seq;
+    volatile bool quitting;
+} aioCtx;
+
+ruMakeTypeGetter(aioCtx, MagicAio)
+
+static ptr reqFree(ptr o) {
+    aioReq* rq = (aioReq*)o;
+    if (!rq) return NULL;
+    if (rq->res.op == RU_AIO_GET_CONTENTS) ruFree(rq->res.data);
+    ruFree(rq->path);
+    ruFree(rq->newPath);
+    ruFree(rq);
+    return NULL;
+}
+
+static aioReq* reqNew(uint32_t op, ruAioFunc cb, perm_ptr ctx) {
+    aioReq* rq = ruMalloc0(1, aioReq);
+    rq->res.op = op;
+    rq->res.fd = -1;
+    rq->res.ctx = ctx;
+    rq->cb = cb;
+    return rq;
+}
+
+static rusize_s aioPread(int fd, ptr buf, rusize len, int64_t offset) {
+#ifdef _WIN32
+    if (offset >= 0 && _lseeki64(fd, offset, SEEK_SET) < 0) return -1;
+    return read(fd, buf, (unsigned int)len);
+#else
+    if (offset < 0) return read(fd, buf, len);
+    return pread(fd, buf, len, (off_t)offset);
+#endif
+}
+
+static rusize_s aioPwrite(int fd, trans_ptr buf, rusize len, int64_t offset) {
+#ifdef _WIN32
+    if (offset >= 0 && _lseeki64(fd, offset, SEEK_SET) < 0) return -1;
+    return ruWrite(fd, buf, len);
+#else
+    if (offset < 0) return ruWrite(fd, buf, len);
+    return pwrite(fd, buf, len, (off_t)offset);
+#endif
+}
+
+static int32_t doRead(aioReq* rq) {
+    char* buf = rq->res.data;
+    int64_t offset = rq->offset;
+    while (rq->res.len < rq->size) {
+        rusize_s rd = aioPread(rq->res.fd, buf + rq->res.len,
+                               rq->size - rq->res.len, offset);
+        if (rd == 0) break;
+        if (rd < 0) {
+            if (errno == EINTR) continue;
+            ruSetError("Failed to read from handle %d errno: %d - %s",
+                       rq->res.fd, errno, strerror(errno));
+            return RUE_CANT_OPEN_FILE;
+        }
+        rq->res.len += rd;
+        if (offset >= 0) offset += rd;
+    }
+    return RUE_OK;
+}
+
+static int32_t doWrite(aioReq* rq) {
+    const char* buf = rq->res.data;
+    int64_t offset = rq->offset;
+    while (rq->res.len < rq->size) {
+        rusize_s wr = aioPwrite(rq->res.fd, buf + rq->res.len,
+                                rq->size - rq->res.len, offset);
+        if (wr < 0) {
+            if (errno == EINTR) continue;
+            ruSetError("Failed to write to handle %d errno: %d - %s",
+                       rq->res.fd, errno, strerror(errno));
+            return RUE_CANT_WRITE;
+        }
+        rq->res.len += wr;
+        if (offset >= 0) offset += wr;
+    }
+    return RUE_OK;
+}
+
+static int32_t doFsync(int fd) {
+#ifdef _WIN32
+    if (!_commit(fd)) return RUE_OK;
+#else
+    if (!fsync(fd)) return RUE_OK;
+#endif
+    ruSetError("Failed to sync handle %d errno: %d - %s",
+               fd, errno, strerror(errno));
+    return errno2rfec(errno);
+}
+
+static void runReq(aioReq* rq) {
+    switch (rq->res.op) {
+        case RU_AIO_READ:
+            rq->res.code = doRead(rq);
+            break;
+        case RU_AIO_WRITE:
+            rq->res.code = doWrite(rq);
+            break;
+        case RU_AIO_FSYNC:
+            rq->res.code = doFsync(rq->res.fd);
+            break;
+        case RU_AIO_RENAME:
+            rq->res.code = ruFileRename(rq->path, rq->newPath);
+            break;
+        case RU_AIO_REMOVE:
+            rq->res.code = ruFileRemove(rq->path);
+            break;
+        case RU_AIO_GET_CONTENTS:
+            rq->res.code = ruFileGetContents(rq->path,
+                                             (alloc_chars*)&rq->res.data,
+                                             &rq->res.len);
+            break;
+        case RU_AIO_SET_CONTENTS:
+            rq->res.code = ruFileSetContents(rq->path, rq->res.data, rq->size);
+            if (rq->res.code == RUE_OK) rq->res.len = rq->size;
+            break;
+        default:
+            rq->res.code = RUE_INVALID_PARAMETER;
+    }
+}
+
+static void reqDone(aioCtx* ac) {
+    ruMutexLock(ac->mux);
+    if (ac->pending) ac->pending--;
+    if (!ac->pending) ruCondSignal(ac->idle);
+    ruMutexUnlock(ac->mux);
+}
+
+static ptr aioWorker(ptr p) {
+    aioCtx* ac = (aioCtx*)p;
+    int32_t ret = RUE_OK;
+    while (true) {
+        aioReq* rq = ruListTryPop(ac->queue, 250, &ret);
+        if (rq) {
+            runReq(rq);
+            logDbg("0x%p op: %u id: %" PRIu64 " ec: %d",
+                   ac, rq->res.op, rq->res.id, rq->res.code);
+            if (rq->cb) {
+                rq->cb(&rq->res);
+                reqFree(rq);
+            } else if (RUE_OK != ruListPush(ac->done, rq)) {
+                reqFree(rq);
+            }
+            reqDone(ac);
+            continue;
+        }
+        // when quitting continue while we pop requests to drain the queue
+        if (ac->quitting && !ruListSize(ac->queue, NULL)) break;
+    }
+    return NULL;
+}
+
+static uint64_t submit(ruAio ra, aioReq* rq, int32_t* code) {
+    int32_t ret;
+    aioCtx* ac = aioCtxGet(ra, &ret);
+    if (!ac) {
+        reqFree(rq);
+        ruRetWithCode(code, ret, 0);
+    }
+    if (ac->quitting) {
+        reqFree(rq);
+        ruRetWithCode(code, RUE_INVALID_STATE, 0);
+    }
+    ruMutexLock(ac->mux);
+    uint64_t id = ++ac->seq;
+    rq->res.id = id;
+    ac->pending++;
+    ruMutexUnlock(ac->mux);
+    ret = ruListPush(ac->queue, rq);
+    if (ret != RUE_OK) {
+        reqFree(rq);
+        reqDone(ac);
+        ruRetWithCode(code, ret, 0);
+    }
+    ruRetWithCode(code, RUE_OK, id);
+}
+// </editor-fold>
+
+// <editor-fold desc="aio public">
+RUAPI ruAio ruAioNew(uint32_t threads, uint32_t queueLen, int32_t* code) {
+    if (!threads) threads = AIO_DEFAULT_THREADS;
+    if (threads > AIO_MAX_THREADS) ruRetWithCode(code, RUE_INVALID_PARAMETER, NULL);
+    aioCtx* ac = ruMalloc0(1, aioCtx);
+    ac->type = MagicAio;
+    ac->mux = ruMutexInit();
+    ac->idle = ruCondInit();
+    ac->queue = ruListNewBound(ruTypePtr(reqFree), queueLen, true);
+    ac->done = ruListNewBound(ruTypePtr(reqFree), 0, false);
+    ac->threads = threads;
+    ac->workers = ruMalloc0(threads, ruThread);
+    for (uint32_t i = 0; i < threads; i++) {
+        ac->workers[i] = ruThreadCreate(
+                aioWorker, ruDupPrintf("aio%u", i), ac);
+    }
+    ruRetWithCode(code, RUE_OK, ac);
+}
+
+RUAPI ruAio ruAioFree(ruAio ra) {
+    aioCtx* ac = aioCtxGet(ra, NULL);
+    if (!ac) return NULL;
+    ac->quitting = true;
+    for (uint32_t i = 0; i < ac->threads; i++) {
+        if (ac->workers[i]) ruThreadJoin(ac->workers[i], NULL);
+    }
+    ruFree(ac->workers);
+    ac->queue = ruListFree(ac->queue);
+    ac->done = ruListFree(ac->done);
+    ac->idle = ruCondFree(ac->idle);
+    ac->mux = ruMutexFree(ac->mux);
+    ac->type = 0;
+    ruFree(ac);
+    return NULL;
+}
+
+RUAPI uint64_t ruAioRead(ruAio ra, int fd, ptr buf, rusize len, int64_t offset,
+                         ruAioFunc cb, perm_ptr ctx, int32_t* code) {
+    if (fd < 0) ruRetWithCode(code, RUE_INVALID_PARAMETER, 0);
+    if (!buf) ruRetWithCode(code, RUE_PARAMETER_NOT_SET, 0);
+    aioReq* rq = reqNew(RU_AIO_READ, cb, ctx);
+    rq->res.fd = fd;
+    rq->res.data = buf;
+    rq->size = len;
+    rq->offset = offset;
+    return submit(ra, rq, code);
+}
+
+RUAPI uint64_t ruAioWrite(ruAio ra, int fd, perm_ptr buf, rusize len,
+                          int64_t offset, ruAioFunc cb, perm_ptr ctx,
+                          int32_t* code) {
+    if (fd < 0) ruRetWithCode(code, RUE_INVALID_PARAMETER, 0);
+    if (!buf && len) ruRetWithCode(code, RUE_PARAMETER_NOT_SET, 0);
+    aioReq* rq = reqNew(RU_AIO_WRITE, cb, ctx);
+    rq->res.fd = fd;
+    rq->res.data = (ptr)buf;
+    rq->size = len;
+    rq->offset = offset;
+    return submit(ra, rq, code);
+}
+
+RUAPI uint64_t ruAioFsync(ruAio ra, int fd, ruAioFunc cb, perm_ptr ctx,
+                          int32_t* code) {
+    if (fd < 0) ruRetWithCode(code, RUE_INVALID_PARAMETER, 0);
+    aioReq* rq = reqNew(RU_AIO_FSYNC, cb, ctx);
+    rq->res.fd = fd;
+    return submit(ra, rq, code);
+}
+
+RUAPI uint64_t ruAioRename(ruAio ra, trans_chars oldName, trans_chars newName,
+                           ruAioFunc cb, perm_ptr ctx, int32_t* code) {
+    if (!oldName || !newName) ruRetWithCode(code, RUE_PARAMETER_NOT_SET, 0);
+    aioReq* rq = reqNew(RU_AIO_RENAME, cb, ctx);
+    rq->path = ruStrDup(oldName);
+    rq->newPath = ruStrDup(newName);
+    rq->res.path = rq->path;
+    return submit(ra, rq, code);
+}
+
+RUAPI uint64_t ruAioRemove(ruAio ra, trans_chars filename,
+                           ruAioFunc cb, perm_ptr ctx, int32_t* code) {
+    if (!filename) ruRetWithCode(code, RUE_PARAMETER_NOT_SET, 0);
+    aioReq* rq = reqNew(RU_AIO_REMOVE, cb, ctx);
+    rq->path = ruStrDup(filename);
+    rq->res.path = rq->path;
+    return submit(ra, rq, code);
+}
+
+RUAPI uint64_t ruAioFileGetContents(ruAio ra, trans_chars filename,
+                                    ruAioFunc cb, perm_ptr ctx, int32_t* code) {
+    if (!filename) ruRetWithCode(code, RUE_PARAMETER_NOT_SET, 0);
+    aioReq* rq = reqNew(RU_AIO_GET_CONTENTS, cb, ctx);
+    rq->path = ruStrDup(filename);
+    rq->res.path = rq->path;
+    return submit(ra, rq, code);
+}
+
+RUAPI uint64_t ruAioFileSetContents(ruAio ra, trans_chars filename,
+                                    perm_chars contents, rusize length,
+                                    ruAioFunc cb, perm_ptr ctx, int32_t* code) {
+    if (!filename) ruRetWithCode(code, RUE_PARAMETER_NOT_SET, 0);
+    if (length == RU_SIZE_AUTO) length = contents? strlen(contents) : 0;
+    if (!contents) length = 0;
+    aioReq* rq = reqNew(RU_AIO_SET_CONTENTS, cb, ctx);
+    rq->path = ruStrDup(filename);
+    rq->res.path = rq->path;
+    rq->res.data = (ptr)contents;
+    rq->size = length;
+    return submit(ra, rq, code);
+}
+
+RUAPI ruAioResult* ruAioPoll(ruAio ra, msec_t timeoutMs, int32_t* code) {
+    int32_t ret;
+    aioCtx* ac = aioCtxGet(ra, &ret);
+    if (!ac) ruRetWithCode(code, ret, NULL);
+    aioReq* rq = ruListTryPop(ac->done, timeoutMs, code);
+    return rq? &rq->res : NULL;
+}
+
+RUAPI ruAioResult* ruAioResultFree(ruAioResult* res) {
+    return reqFree(res);
+}
+
+RUAPI int32_t ruAioWait(ruAio ra, msec_t timeoutMs) {
+    int32_t ret;
+    aioCtx* ac = aioCtxGet(ra, &ret);
+    if (!ac) return ret;
+    msec_t until = timeoutMs? ruTimeMs() + timeoutMs : 0;
+    ret = RUE_OK;
+    ruMutexLock(ac->mux);
+    while (ac->pending) {
+        if (until && ruTimeMsEllapsed(until)) {
+            ret = RUE_TIMEOUT;
+            break;
+        }
+        // short waits so several waiters all get to see the idle state
+        ruCondWaitTil(ac->idle, ac->mux, 50);
+    }
+    ruMutexUnlock(ac->mux);
+    return ret;
+}
+
+RUAPI uint32_t ruAioPending(ruAio ra, int32_t* code) {
+    int32_t ret;
+    aioCtx* ac = aioCtxGet(ra, &ret);
+    if (!ac) ruRetWithCode(code, ret, 0);
+    ruMutexLock(ac->mux);
+    uint32_t pending = ac->pending;
+    ruMutexUnlock(ac->mux);
+    ruRetWithCode(code, RUE_OK, pending);
+}
+// </editor-fold>
+
+// <editor-fold desc="write batch">
+typedef struct {
+    ru_int type;
+    ruAio ra;
+    ruList entries;
+    // tracks outstanding parallel flushes
+    ruMutex mux;
+    ruCond synced;
+    volatile uint32_t outstanding;
+} writeBatch;
+
+typedef struct {
+    writeBatch* wb;
+    alloc_chars path;
+    alloc_chars tmpPath;
+    int fd;
+    int32_t code;
+} batchEntry;
+
+ruMakeTypeGetter(writeBatch, MagicWriteBatch)
+
+static ptr entryFree(ptr o) {
+    batchEntry* be = (batchEntry*)o;
+    if (!be) return NULL;
+    if (be->fd >= 0) close(be->fd);
+    if (be->tmpPath) ruFileRemove(be->tmpPath);
+    ruFree(be->tmpPath);
+    ruFree(be->path);
+    ruFree(be);
+    return NULL;
+}
+
+static void entrySynced(ruAioResult* res) {
+    batchEntry* be = (batchEntry*)res->ctx;
+    writeBatch* wb = be->wb;
+    be->code = res->code;
+    ruMutexLock(wb->mux);
+    wb->outstanding--;
+    if (!wb->outstanding) ruCondSignal(wb->synced);
+    ruMutexUnlock(wb->mux);
+}
+
+static int32_t syncEntries(writeBatch* wb) {
+    int32_t ret = RUE_OK;
+    ruIterator li = ruListIter(wb->entries);
+    for (batchEntry* be = ruIterNext(li, batchEntry*); li;
+         be = ruIterNext(li, batchEntry*)) {
+        if (!wb->ra) {
+            be->code = doFsync(be->fd);
+            continue;
+        }
+        ruMutexLock(wb->mux);
+        wb->outstanding++;
+        ruMutexUnlock(wb->mux);
+        // the worker reports into be->code, so keep the submit result apart
+        int32_t code;
+        if (!ruAioFsync(wb->ra, be->fd, entrySynced, be, &code)) {
+            be->code = code;
+            ruMutexLock(wb->mux);
+            wb->outstanding--;
+            ruMutexUnlock(wb->mux);
+        }
+    }
+    ruMutexLock(wb->mux);
+    while (wb->outstanding) {
+        ruCondWaitTil(wb->synced, wb->mux, 50);
+    }
+    ruMutexUnlock(wb->mux);
+
+    li = ruListIter(wb->entries);
+    for (batchEntry* be = ruIterNext(li, batchEntry*); li;
+         be = ruIterNext(li, batchEntry*)) {
+        if (ret == RUE_OK && be->code != RUE_OK) {
+            ruSetError("Failed to sync '%s' ec: %d", be->tmpPath, be->code);
+            ret = be->code;
+        }
+    }
+    return ret;
+}
+
+static int32_t syncFolder(trans_chars folder) {
+#ifdef _WIN32
+    // folders can't be flushed on Windows
+    return RUE_OK;
+#else
+    int fd = open(folder, O_RDONLY);
+    if (fd < 0) return errno2rfec(errno);
+    int32_t ret = RUE_OK;
+    if (fsync(fd)) {
+        ruSetError("Failed to sync folder '%s' errno: %d - %s",
+                   folder, errno, strerror(errno));
+        ret = errno2rfec(errno);
+    }
+    close(fd);
+    return ret;
+#endif
+}
+
+RUAPI ruWriteBatch ruWriteBatchNew(ruAio ra, int32_t* code) {
+    int32_t ret = RUE_OK;
+    if (ra && !aioCtxGet(ra, &ret)) ruRetWithCode(code, ret, NULL);
+    writeBatch* wb = ruMalloc0(1, writeBatch);
+    wb->type = MagicWriteBatch;
+    wb->ra = ra;
+    wb->entries = ruListNew(ruTypePtr(entryFree));
+    wb->mux = ruMutexInit();
+    wb->synced = ruCondInit();
+    ruRetWithCode(code, RUE_OK, wb);
+}
+
+RUAPI int32_t ruWriteBatchAdd(ruWriteBatch rwb, trans_chars filename,
+                              trans_chars contents, rusize length) {
+    ruClearError();
+    int32_t ret;
+    writeBatch* wb = writeBatchGet(rwb, &ret);
+    if (!wb) return ret;
+    if (!filename) return RUE_PARAMETER_NOT_SET;
+    batchEntry* be = ruMalloc0(1, batchEntry);
+    be->wb = wb;
+    ret = writeTmpFile(filename, contents, length, &be->tmpPath, &be->fd);
+    if (ret != RUE_OK) {
+        ruFree(be);
+        return ret;
+    }
+#ifdef ITS_OSX
+    be->path = ruStrToNfd(filename);
+#else
+    be->path = ruStrDup(filename);
+#endif
+    return ruListAppend(wb->entries, be);
+}
+
+RUAPI uint32_t ruWriteBatchSize(ruWriteBatch rwb, int32_t* code) {
+    int32_t ret;
+    writeBatch* wb = writeBatchGet(rwb, &ret);
+    if (!wb) ruRetWithCode(code, ret, 0);
+    return ruListSize(wb->entries, code);
+}
+
+RUAPI int32_t ruWriteBatchCommit(ruWriteBatch rwb) {
+    ruClearError();
+    int32_t ret;
+    writeBatch* wb = writeBatchGet(rwb, &ret);
+    if (!wb) return ret;
+
+    ret = syncEntries(wb);
+    if (ret != RUE_OK) {
+        ruListClear(wb->entries);
+        return ret;
+    }
+
+    // folder paths of the renamed files to flush once each
+    ruMap folders = ruMapNew(ruTypeStrFree(), ruTypeStrRef());
+    ruIterator li = ruListIter(wb->entries);
+    for (batchEntry* be = ruIterNext(li, batchEntry*); li;
+         be = ruIterNext(li, batchEntry*)) {
+        close(be->fd);
+        be->fd = -1;
+        int32_t rc = ruFileRename(be->tmpPath, be->path);
+        if (rc != RUE_OK) {
+            if (ret == RUE_OK) ret = rc;
+            continue;
+        }
+        // renamed so there is nothing to clean up anymore
+        ruFree(be->tmpPath);
+        alloc_chars folder = ruDirName(be->path);
+        if (!folder) folder = ruStrDup(".");
+        if (ruMapHas(folders, folder, NULL)) {
+            ruFree(folder);
+        } else {
+            ruMapPut(folders, folder, folder);
+        }
+    }
+    ruListClear(wb->entries);
+
+    char* folder = NULL;
+    for (int32_t rc = ruMapFirst(folders, &folder, NULL); rc == RUE_OK;
+         rc = ruMapNext(folders, &folder, NULL)) {
+        int32_t sc = syncFolder(folder);
+        if (sc != RUE_OK && ret == RUE_OK) ret = sc;
+    }
+    ruMapFree(folders);
+    return ret;
+}
+
+RUAPI ruWriteBatch ruWriteBatchFree(ruWriteBatch rwb) {
+    writeBatch* wb = writeBatchGet(rwb, NULL);
+    if (!wb) return NULL;
+    wb->entries = ruListFree(wb->entries);
+    wb->synced = ruCondFree(wb->synced);
+    wb->mux = ruMutexFree(wb->mux);
+    wb->type = 0;
+    ruFree(wb);
+    return NULL;
+}
+// </editor-fold>
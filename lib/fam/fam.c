@@ -83,6 +83,10 @@ RUAPI ruFamEvent* ruFamEventNew(int eventType, trans_chars filePath, trans_chars
     fe->eventType = eventType;
     fe->srcPath = ruStrDup(filePath);
     fe->dstPath = ruStrDup(destPath);
+    // the change may not have gone through this library
+    // NULL would empty the whole cache
+    if (filePath) ruStatCacheInvalidate(filePath);
+    if (destPath) ruStatCacheInvalidate(destPath);
 //    famEventLog(RU_LOG_VERB, fe, "Created");
     return fe;
 }
@@ -0,0 +1,666 @@
+/*
+ * Copyright regify
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "lib.h"
+#if defined(__GNUC__) && defined(__x86_64__)
+#define HASH_HW_X64
+#include <immintrin.h>
+#include <cpuid.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define HASH_HW_X64
+#include <immintrin.h>
+#include <intrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#define CRC_HW_ARM
+#include <arm_acle.h>
+#endif
+
+#ifdef _WIN32
+#define read _read
+#define close _close
+#endif
+
+#define HASH_CHUNK 0x10000
+
+// <editor-fold desc="xxh64">
+#define XXP1 0x9E3779B185EBCA87ULL
+#define XXP2 0xC2B2AE3D27D4EB4FULL
+#define XXP3 0x165667B19E3779F9ULL
+#define XXP4 0x85EBCA77C2B2AE63ULL
+#define XXP5 0x27D4EB2F165667C5ULL
+
+typedef struct {
+    uint64_t total;
+    uint64_t v[4];
+    uint64_t seed;
+    unsigned char mem[32];
+    uint32_t memSize;
+} xxh64State;
+
+static uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+static uint64_t readLe64(const unsigned char* p) {
+    return (uint64_t)p[0] | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) |
+           ((uint64_t)p[3] << 24) | ((uint64_t)p[4] << 32) |
+           ((uint64_t)p[5] << 40) | ((uint64_t)p[6] << 48) |
+           ((uint64_t)p[7] << 56);
+}
+
+static uint32_t readLe32(const unsigned char* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+static uint64_t xxRound(uint64_t acc, uint64_t input) {
+    acc += input * XXP2;
+    acc = rotl64(acc, 31);
+    return acc * XXP1;
+}
+
+static uint64_t xxMerge(uint64_t acc, uint64_t val) {
+    acc ^= xxRound(0, val);
+    return acc * XXP1 + XXP4;
+}
+
+static void xxh64Reset(xxh64State* xs, uint64_t seed) {
+    memset(xs, 0, sizeof(xxh64State));
+    xs->seed = seed;
+    xs->v[0] = seed + XXP1 + XXP2;
+    xs->v[1] = seed + XXP2;
+    xs->v[2] = seed;
+    xs->v[3] = seed - XXP1;
+}
+
+static const unsigned char* xxStripes(uint64_t* v, const unsigned char* p,
+                                      const unsigned char* end) {
+    uint64_t v0 = v[0], v1 = v[1], v2 = v[2], v3 = v[3];
+    while (p + 32 <= end) {
+        v0 = xxRound(v0, readLe64(p));
+        v1 = xxRound(v1, readLe64(p + 8));
+        v2 = xxRound(v2, readLe64(p + 16));
+        v3 = xxRound(v3, readLe64(p + 24));
+        p += 32;
+    }
+    v[0] = v0; v[1] = v1; v[2] = v2; v[3] = v3;
+    return p;
+}
+
+static void xxh64Update(xxh64State* xs, const unsigned char* p, rusize len) {
+    const unsigned char* end = p + len;
+    xs->total += len;
+    if (xs->memSize + len < 32) {
+        memcpy(xs->mem + xs->memSize, p, len);
+        xs->memSize += (uint32_t)len;
+        return;
+    }
+    if (xs->memSize) {
+        rusize fill = 32 - xs->memSize;
+        memcpy(xs->mem + xs->memSize, p, fill);
+        xxStripes(xs->v, xs->mem, xs->mem + 32);
+        p += fill;
+        xs->memSize = 0;
+    }
+    p = xxStripes(xs->v, p, end);
+    if (p < end) {
+        xs->memSize = (uint32_t)(end - p);
+        memcpy(xs->mem, p, xs->memSize);
+    }
+}
+
+static uint64_t xxh64Digest(const xxh64State* xs) {
+    uint64_t h;
+    if (xs->total >= 32) {
+        const uint64_t* v = xs->v;
+        h = rotl64(v[0], 1) + rotl64(v[1], 7) + rotl64(v[2], 12) + rotl64(v[3], 18);
+        h = xxMerge(h, v[0]);
+        h = xxMerge(h, v[1]);
+        h = xxMerge(h, v[2]);
+        h = xxMerge(h, v[3]);
+    } else {
+        h = xs->seed + XXP5;
+    }
+    h += xs->total;
+
+    const unsigned char* p = xs->mem;
+    const unsigned char* end = p + xs->memSize;
+    while (p + 8 <= end) {
+        h ^= xxRound(0, readLe64(p));
+        h = rotl64(h, 27) * XXP1 + XXP4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h ^= (uint64_t)readLe32(p) * XXP1;
+        h = rotl64(h, 23) * XXP2 + XXP3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= (*p) * XXP5;
+        h = rotl64(h, 11) * XXP1;
+        p++;
+    }
+    h ^= h >> 33;
+    h *= XXP2;
+    h ^= h >> 29;
+    h *= XXP3;
+    h ^= h >> 32;
+    return h;
+}
+
+RUAPI uint64_t ruXxh64(trans_ptr data, rusize len, uint64_t seed) {
+    xxh64State xs;
+    xxh64Reset(&xs, seed);
+    if (data && len) {
+        // spare the copy through mem for the bulk of the data
+        const unsigned char* p = (const unsigned char*)data;
+        const unsigned char* rest = xxStripes(xs.v, p, p + len);
+        xs.total = len;
+        xs.memSize = (uint32_t)(p + len - rest);
+        memcpy(xs.mem, rest, xs.memSize);
+    }
+    return xxh64Digest(&xs);
+}
+// </editor-fold>
+
+// <editor-fold desc="crc32c">
+static const uint32_t crc32cTable[256] = {
+        0x00000000, 0xf26b8303, 0xe13b70f7, 0x1350f3f4, 0xc79a971f, 0x35f1141c,
+        0x26a1e7e8, 0xd4ca64eb, 0x8ad958cf, 0x78b2dbcc, 0x6be22838, 0x9989ab3b,
+        0x4d43cfd0, 0xbf284cd3, 0xac78bf27, 0x5e133c24, 0x105ec76f, 0xe235446c,
+        0xf165b798, 0x030e349b, 0xd7c45070, 0x25afd373, 0x36ff2087, 0xc494a384,
+        0x9a879fa0, 0x68ec1ca3, 0x7bbcef57, 0x89d76c54, 0x5d1d08bf, 0xaf768bbc,
+        0xbc267848, 0x4e4dfb4b, 0x20bd8ede, 0xd2d60ddd, 0xc186fe29, 0x33ed7d2a,
+        0xe72719c1, 0x154c9ac2, 0x061c6936, 0xf477ea35, 0xaa64d611, 0x580f5512,
+        0x4b5fa6e6, 0xb93425e5, 0x6dfe410e, 0x9f95c20d, 0x8cc531f9, 0x7eaeb2fa,
+        0x30e349b1, 0xc288cab2, 0xd1d83946, 0x23b3ba45, 0xf779deae, 0x05125dad,
+        0x1642ae59, 0xe4292d5a, 0xba3a117e, 0x4851927d, 0x5b016189, 0xa96ae28a,
+        0x7da08661, 0x8fcb0562, 0x9c9bf696, 0x6ef07595, 0x417b1dbc, 0xb3109ebf,
+        0xa0406d4b, 0x522bee48, 0x86e18aa3, 0x748a09a0, 0x67dafa54, 0x95b17957,
+        0xcba24573, 0x39c9c670, 0x2a993584, 0xd8f2b687, 0x0c38d26c, 0xfe53516f,
+        0xed03a29b, 0x1f682198, 0x5125dad3, 0xa34e59d0, 0xb01eaa24, 0x42752927,
+        0x96bf4dcc, 0x64d4cecf, 0x77843d3b, 0x85efbe38, 0xdbfc821c, 0x2997011f,
+        0x3ac7f2eb, 0xc8ac71e8, 0x1c661503, 0xee0d9600, 0xfd5d65f4, 0x0f36e6f7,
+        0x61c69362, 0x93ad1061, 0x80fde395, 0x72966096, 0xa65c047d, 0x5437877e,
+        0x4767748a, 0xb50cf789, 0xeb1fcbad, 0x197448ae, 0x0a24bb5a, 0xf84f3859,
+        0x2c855cb2, 0xdeeedfb1, 0xcdbe2c45, 0x3fd5af46, 0x7198540d, 0x83f3d70e,
+        0x90a324fa, 0x62c8a7f9, 0xb602c312, 0x44694011, 0x5739b3e5, 0xa55230e6,
+        0xfb410cc2, 0x092a8fc1, 0x1a7a7c35, 0xe811ff36, 0x3cdb9bdd, 0xceb018de,
+        0xdde0eb2a, 0x2f8b6829, 0x82f63b78, 0x709db87b, 0x63cd4b8f, 0x91a6c88c,
+        0x456cac67, 0xb7072f64, 0xa457dc90, 0x563c5f93, 0x082f63b7, 0xfa44e0b4,
+        0xe9141340, 0x1b7f9043, 0xcfb5f4a8, 0x3dde77ab, 0x2e8e845f, 0xdce5075c,
+        0x92a8fc17, 0x60c37f14, 0x73938ce0, 0x81f80fe3, 0x55326b08, 0xa759e80b,
+        0xb4091bff, 0x466298fc, 0x1871a4d8, 0xea1a27db, 0xf94ad42f, 0x0b21572c,
+        0xdfeb33c7, 0x2d80b0c4, 0x3ed04330, 0xccbbc033, 0xa24bb5a6, 0x502036a5,
+        0x4370c551, 0xb11b4652, 0x65d122b9, 0x97baa1ba, 0x84ea524e, 0x7681d14d,
+        0x2892ed69, 0xdaf96e6a, 0xc9a99d9e, 0x3bc21e9d, 0xef087a76, 0x1d63f975,
+        0x0e330a81, 0xfc588982, 0xb21572c9, 0x407ef1ca, 0x532e023e, 0xa145813d,
+        0x758fe5d6, 0x87e466d5, 0x94b49521, 0x66df1622, 0x38cc2a06, 0xcaa7a905,
+        0xd9f75af1, 0x2b9cd9f2, 0xff56bd19, 0x0d3d3e1a, 0x1e6dcdee, 0xec064eed,
+        0xc38d26c4, 0x31e6a5c7, 0x22b65633, 0xd0ddd530, 0x0417b1db, 0xf67c32d8,
+        0xe52cc12c, 0x1747422f, 0x49547e0b, 0xbb3ffd08, 0xa86f0efc, 0x5a048dff,
+        0x8ecee914, 0x7ca56a17, 0x6ff599e3, 0x9d9e1ae0, 0xd3d3e1ab, 0x21b862a8,
+        0x32e8915c, 0xc083125f, 0x144976b4, 0xe622f5b7, 0xf5720643, 0x07198540,
+        0x590ab964, 0xab613a67, 0xb831c993, 0x4a5a4a90, 0x9e902e7b, 0x6cfbad78,
+        0x7fab5e8c, 0x8dc0dd8f, 0xe330a81a, 0x115b2b19, 0x020bd8ed, 0xf0605bee,
+        0x24aa3f05, 0xd6c1bc06, 0xc5914ff2, 0x37faccf1, 0x69e9f0d5, 0x9b8273d6,
+        0x88d28022, 0x7ab90321, 0xae7367ca, 0x5c18e4c9, 0x4f48173d, 0xbd23943e,
+        0xf36e6f75, 0x0105ec76, 0x12551f82, 0xe03e9c81, 0x34f4f86a, 0xc69f7b69,
+        0xd5cf889d, 0x27a40b9e, 0x79b737ba, 0x8bdcb4b9, 0x988c474d, 0x6ae7c44e,
+        0xbe2da0a5, 0x4c4623a6, 0x5f16d052, 0xad7d5351
+};
+
+static uint32_t crc32cSw(uint32_t crc, const unsigned char* p, rusize len) {
+    while (len--) {
+        crc = crc32cTable[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#if defined(HASH_HW_X64)
+#ifdef __GNUC__
+__attribute__((target("sse4.2")))
+#endif
+static uint32_t crc32cHw(uint32_t crc, const unsigned char* p, rusize len) {
+    uint64_t c = crc;
+    while (len && ((uintptr_t)p & 7)) {
+        c = _mm_crc32_u8((uint32_t)c, *p++);
+        len--;
+    }
+    while (len >= 8) {
+        c = _mm_crc32_u64(c, *(const uint64_t*)p);
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        c = _mm_crc32_u8((uint32_t)c, *p++);
+    }
+    return (uint32_t)c;
+}
+
+static bool crc32cHwAvailable(void) {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 20)) != 0;
+#else
+    return __builtin_cpu_supports("sse4.2");
+#endif
+}
+#elif defined(CRC_HW_ARM)
+static uint32_t crc32cHw(uint32_t crc, const unsigned char* p, rusize len) {
+    while (len && ((uintptr_t)p & 7)) {
+        crc = __crc32cb(crc, *p++);
+        len--;
+    }
+    while (len >= 8) {
+        crc = __crc32cd(crc, *(const uint64_t*)p);
+        p += 8;
+        len -= 8;
+    }
+    while (len--) {
+        crc = __crc32cb(crc, *p++);
+    }
+    return crc;
+}
+
+static bool crc32cHwAvailable(void) {
+    return true;
+}
+#endif
+
+RUAPI uint32_t ruCrc32c(uint32_t crc, trans_ptr data, rusize len) {
+    if (!data || !len) return crc;
+    const unsigned char* p = (const unsigned char*)data;
+#if defined(HASH_HW_X64) || defined(CRC_HW_ARM)
+    // -1 unknown, 0 software, 1 hardware. Racing threads store the same value.
+    static volatile int hwCrc = -1;
+    if (hwCrc < 0) hwCrc = crc32cHwAvailable();
+    if (hwCrc) return ~crc32cHw(~crc, p, len);
+#endif
+    return ~crc32cSw(~crc, p, len);
+}
+// </editor-fold>
+
+// <editor-fold desc="sha256">
+typedef struct {
+    uint64_t total;
+    uint32_t h[8];
+    unsigned char mem[64];
+    uint32_t memSize;
+} sha256State;
+
+static const uint32_t sha256K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+        0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+        0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+        0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+        0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+        0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+        0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+        0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+        0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+#define ROR32(x, r) (((x) >> (r)) | ((x) << (32 - (r))))
+
+static void sha256Reset(sha256State* ss) {
+    static const uint32_t init[8] = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+            0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memset(ss, 0, sizeof(sha256State));
+    memcpy(ss->h, init, sizeof(init));
+}
+
+static void sha256Block(uint32_t* h, const unsigned char* p) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)p[i*4] << 24) | ((uint32_t)p[i*4+1] << 16) |
+               ((uint32_t)p[i*4+2] << 8) | (uint32_t)p[i*4+3];
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = ROR32(w[i-15], 7) ^ ROR32(w[i-15], 18) ^ (w[i-15] >> 3);
+        uint32_t s1 = ROR32(w[i-2], 17) ^ ROR32(w[i-2], 19) ^ (w[i-2] >> 10);
+        w[i] = w[i-16] + s0 + w[i-7] + s1;
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3],
+             e = h[4], f = h[5], g = h[6], k = h[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t s1 = ROR32(e, 6) ^ ROR32(e, 11) ^ ROR32(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = k + s1 + ch + sha256K[i] + w[i];
+        uint32_t s0 = ROR32(a, 2) ^ ROR32(a, 13) ^ ROR32(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + maj;
+        k = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+#if defined(HASH_HW_X64)
+/*
+ * SHA-256 with the SHA extensions. The rounds instruction wants the state as
+ * ABEF and CDGH rather than ABCD and EFGH, so it's shuffled on the way in and
+ * out, and each 4 word group of the message schedule is derived from the
+ * previous four groups as the rounds go.
+ */
+#ifdef __GNUC__
+__attribute__((target("sha,sse4.1")))
+#endif
+static void sha256BlocksHw(uint32_t* h, const unsigned char* p, rusize n) {
+    const __m128i swap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL,
+                                        0x0405060700010203ULL);
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)h), 0xb1);
+    __m128i st1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)(h + 4)),
+                                    0x1b);
+    __m128i st0 = _mm_alignr_epi8(tmp, st1, 8);
+    st1 = _mm_blend_epi16(st1, tmp, 0xf0);
+    for (; n; n--, p += 64) {
+        __m128i abef = st0, cdgh = st1, m[4];
+        for (int i = 0; i < 16; i++) {
+            __m128i* cur = &m[i & 3];
+            if (i < 4) {
+                *cur = _mm_shuffle_epi8(
+                        _mm_loadu_si128((const __m128i*)(p + i * 16)), swap);
+            } else {
+                // cur still holds the group 4 back, the others follow it
+                __m128i prev = m[(i + 3) & 3];
+                *cur = _mm_sha256msg1_epu32(*cur, m[(i + 1) & 3]);
+                *cur = _mm_add_epi32(*cur,
+                                     _mm_alignr_epi8(prev, m[(i + 2) & 3], 4));
+                *cur = _mm_sha256msg2_epu32(*cur, prev);
+            }
+            __m128i msg = _mm_add_epi32(*cur,
+                    _mm_loadu_si128((const __m128i*)(sha256K + i * 4)));
+            st1 = _mm_sha256rnds2_epu32(st1, st0, msg);
+            st0 = _mm_sha256rnds2_epu32(st0, st1, _mm_shuffle_epi32(msg, 0x0e));
+        }
+        st0 = _mm_add_epi32(st0, abef);
+        st1 = _mm_add_epi32(st1, cdgh);
+    }
+    tmp = _mm_shuffle_epi32(st0, 0x1b);
+    st1 = _mm_shuffle_epi32(st1, 0xb1);
+    _mm_storeu_si128((__m128i*)h, _mm_blend_epi16(tmp, st1, 0xf0));
+    _mm_storeu_si128((__m128i*)(h + 4), _mm_alignr_epi8(st1, tmp, 8));
+}
+
+static bool sha256HwAvailable(void) {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    if (!(info[2] & (1 << 19))) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 29)) != 0;
+#else
+    // asked for directly since older compilers don't know "sha" as a name
+    unsigned int a, b, c, d;
+    if (!__get_cpuid(1, &a, &b, &c, &d) || !(c & (1 << 19))) return false;
+    if (!__get_cpuid_count(7, 0, &a, &b, &c, &d)) return false;
+    return (b & (1 << 29)) != 0;
+#endif
+}
+#endif
+
+static void sha256Blocks(uint32_t* h, const unsigned char* p, rusize n) {
+#if defined(HASH_HW_X64)
+    // -1 unknown, 0 software, 1 hardware. Racing threads store the same value.
+    static volatile int hwSha = -1;
+    if (hwSha < 0) hwSha = sha256HwAvailable();
+    if (hwSha) {
+        sha256BlocksHw(h, p, n);
+        return;
+    }
+#endif
+    for (; n; n--, p += 64) sha256Block(h, p);
+}
+
+static void sha256Update(sha256State* ss, const unsigned char* p, rusize len) {
+    ss->total += len;
+    if (ss->memSize) {
+        rusize fill = 64 - ss->memSize;
+        if (len < fill) fill = len;
+        memcpy(ss->mem + ss->memSize, p, fill);
+        ss->memSize += (uint32_t)fill;
+        p += fill;
+        len -= fill;
+        if (ss->memSize < 64) return;
+        sha256Blocks(ss->h, ss->mem, 1);
+        ss->memSize = 0;
+    }
+    if (len >= 64) {
+        sha256Blocks(ss->h, p, len / 64);
+        p += len & ~(rusize)63;
+        len &= 63;
+    }
+    if (len) {
+        memcpy(ss->mem, p, len);
+        ss->memSize = (uint32_t)len;
+    }
+}
+
+static void sha256Digest(const sha256State* ss, unsigned char* out) {
+    // pad a copy so the state can be fed further
+    sha256State fin = *ss;
+    uint64_t bits = ss->total * 8;
+    unsigned char pad[72];
+    rusize padLen = (fin.memSize < 56? 56 : 120) - fin.memSize;
+    memset(pad, 0, sizeof(pad));
+    pad[0] = 0x80;
+    for (int i = 0; i < 8; i++) {
+        pad[padLen + i] = (unsigned char)(bits >> (56 - i * 8));
+    }
+    sha256Update(&fin, pad, padLen + 8);
+    for (int i = 0; i < 8; i++) {
+        out[i*4] = (unsigned char)(fin.h[i] >> 24);
+        out[i*4+1] = (unsigned char)(fin.h[i] >> 16);
+        out[i*4+2] = (unsigned char)(fin.h[i] >> 8);
+        out[i*4+3] = (unsigned char)fin.h[i];
+    }
+}
+// </editor-fold>
+
+// <editor-fold desc="hasher">
+typedef struct {
+    ru_int type;
+    int32_t algo;
+    union {
+        xxh64State xxh;
+        uint32_t crc;
+        sha256State sha;
+    } u;
+} Hasher;
+
+ruMakeTypeGetter(Hasher, MagicHasher)
+
+RUAPI rusize ruHashSize(int32_t algo) {
+    switch (algo) {
+        case RU_HASH_XXH64: return 8;
+        case RU_HASH_CRC32C: return 4;
+        case RU_HASH_SHA256: return 32;
+        default: return 0;
+    }
+}
+
+RUAPI ruHasher ruHasherNew(int32_t algo, int32_t* code) {
+    if (!ruHashSize(algo)) {
+        ruSetError("unknown hash algorithm %d", algo);
+        ruRetWithCode(code, RUE_INVALID_PARAMETER, NULL);
+    }
+    Hasher* hs = ruMalloc0(1, Hasher);
+    hs->type = MagicHasher;
+    hs->algo = algo;
+    ruHasherReset(hs);
+    ruRetWithCode(code, RUE_OK, hs);
+}
+
+RUAPI ruHasher ruHasherFree(ruHasher rh) {
+    Hasher* hs = HasherGet(rh, NULL);
+    if (!hs) return NULL;
+    memset(hs, 0, sizeof(Hasher));
+    ruFree(hs);
+    return NULL;
+}
+
+RUAPI int32_t ruHasherReset(ruHasher rh) {
+    int32_t ret;
+    Hasher* hs = HasherGet(rh, &ret);
+    if (!hs) return ret;
+    switch (hs->algo) {
+        case RU_HASH_XXH64:
+            xxh64Reset(&hs->u.xxh, 0);
+            break;
+        case RU_HASH_CRC32C:
+            hs->u.crc = 0;
+            break;
+        case RU_HASH_SHA256:
+            sha256Reset(&hs->u.sha);
+            break;
+    }
+    return RUE_OK;
+}
+
+RUAPI int32_t ruHasherUpdate(ruHasher rh, trans_ptr data, rusize len) {
+    int32_t ret;
+    Hasher* hs = HasherGet(rh, &ret);
+    if (!hs) return ret;
+    if (!len) return RUE_OK;
+    if (!data) return RUE_PARAMETER_NOT_SET;
+    const unsigned char* p = (const unsigned char*)data;
+    switch (hs->algo) {
+        case RU_HASH_XXH64:
+            xxh64Update(&hs->u.xxh, p, len);
+            break;
+        case RU_HASH_CRC32C:
+            hs->u.crc = ruCrc32c(hs->u.crc, p, len);
+            break;
+        case RU_HASH_SHA256:
+            sha256Update(&hs->u.sha, p, len);
+            break;
+    }
+    return RUE_OK;
+}
+
+RUAPI int32_t ruHasherDigest(ruHasher rh, unsigned char* digest, rusize len) {
+    int32_t ret;
+    Hasher* hs = HasherGet(rh, &ret);
+    if (!hs) return ret;
+    if (!digest) return RUE_PARAMETER_NOT_SET;
+    if (len < ruHashSize(hs->algo)) return RUE_WRONG_PARAMETER_LENGTH;
+    uint64_t val = 0;
+    switch (hs->algo) {
+        case RU_HASH_XXH64:
+            val = xxh64Digest(&hs->u.xxh);
+            for (int i = 0; i < 8; i++) {
+                digest[i] = (unsigned char)(val >> (56 - i * 8));
+            }
+            break;
+        case RU_HASH_CRC32C:
+            val = hs->u.crc;
+            for (int i = 0; i < 4; i++) {
+                digest[i] = (unsigned char)(val >> (24 - i * 8));
+            }
+            break;
+        case RU_HASH_SHA256:
+            sha256Digest(&hs->u.sha, digest);
+            break;
+    }
+    return RUE_OK;
+}
+
+RUAPI alloc_chars ruHasherHex(ruHasher rh) {
+    static const char hex[] = "0123456789abcdef";
+    unsigned char digest[RU_HASH_MAX_SIZE];
+    Hasher* hs = HasherGet(rh, NULL);
+    if (!hs) return NULL;
+    if (ruHasherDigest(hs, digest, sizeof(digest)) != RUE_OK) return NULL;
+    rusize len = ruHashSize(hs->algo);
+    alloc_chars out = ruMalloc0(len * 2 + 1, char);
+    for (rusize i = 0; i < len; i++) {
+        out[i*2] = hex[digest[i] >> 4];
+        out[i*2+1] = hex[digest[i] & 0xf];
+    }
+    return out;
+}
+
+RUAPI alloc_chars ruHashData(int32_t algo, trans_ptr data, rusize len, int32_t* code) {
+    if (len == RU_SIZE_AUTO) len = data? strlen((trans_chars)data) : 0;
+    if (!data && len) ruRetWithCode(code, RUE_PARAMETER_NOT_SET, NULL);
+    int32_t ret;
+    Hasher hs;
+    memset(&hs, 0, sizeof(Hasher));
+    hs.type = MagicHasher;
+    hs.algo = algo;
+    if (!ruHashSize(algo)) {
+        ruSetError("unknown hash algorithm %d", algo);
+        ruRetWithCode(code, RUE_INVALID_PARAMETER, NULL);
+    }
+    ruHasherReset(&hs);
+    ret = ruHasherUpdate(&hs, data, len);
+    if (ret != RUE_OK) ruRetWithCode(code, ret, NULL);
+    ruRetWithCode(code, RUE_OK, ruHasherHex(&hs));
+}
+
+RUAPI alloc_chars ruFileHash(trans_chars filepath, int32_t algo, int32_t* code) {
+    ruClearError();
+    if (!filepath) ruRetWithCode(code, RUE_PARAMETER_NOT_SET, NULL);
+    int32_t ret;
+    ruHasher rh = ruHasherNew(algo, &ret);
+    if (!rh) ruRetWithCode(code, ret, NULL);
+
+    int rflags = O_RDONLY;
+#ifdef _WIN32
+    rflags |= O_BINARY;
+#endif
+    int fd = ruOpen(filepath, rflags, 0, &ret);
+    if (ret != RUE_OK) {
+        ruHasherFree(rh);
+        ruRetWithCode(code, ret, NULL);
+    }
+    alloc_chars out = NULL;
+    unsigned char* buf = ruMalloc0(HASH_CHUNK, unsigned char);
+    while (true) {
+        rusize_s got = read(fd, buf, HASH_CHUNK);
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            ruSetError("failed reading '%s' errno: %d - %s",
+                       filepath, errno, strerror(errno));
+            ret = errno2rfec(errno);
+            break;
+        }
+        if (!got) {
+            out = ruHasherHex(rh);
+            break;
+        }
+        ruHasherUpdate(rh, buf, got);
+    }
+    close(fd);
+    ruFree(buf);
+    ruHasherFree(rh);
+    ruRetWithCode(code, ret, out);
+}
+// </editor-fold>
@@ -20,6 +20,14 @@
  * SOFTWARE.
  */
 #include "lib.h"
+#if defined(__GNUC__) && defined(__x86_64__)
+#define UTF_SIMD_X64
+#include <immintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define UTF_SIMD_X64
+#include <immintrin.h>
+#include <intrin.h>
+#endif
 
 #ifdef __GNUC__
 // A long story, not having this caused uregex_open to crash at
@@ -58,9 +66,372 @@ UConverter* getConverter(void) {
 
 }
 
+/*
+ * Converters carry conversion state and cannot be shared between threads, so
+ * each thread keeps its own. The holder closes it when the thread exits.
+ */
+struct ThreadConverter {
+    UConverter* conv = nullptr;
+    ~ThreadConverter() {
+        if (conv) ucnv_close(conv);
+    }
+};
+static thread_local ThreadConverter threadConv_;
+
+static UConverter* threadConverter(void) {
+    if (!threadConv_.conv) threadConv_.conv = getConverter();
+    return threadConv_.conv;
+}
+
+// case mapping only reads the map, so one instance serves all threads
+static const UCaseMap* caseMap(void) {
+    static UCaseMap* ucm = [] {
+        UErrorCode errorCode = U_ZERO_ERROR;
+        UCaseMap* map = ucasemap_open("utf8", 0, &errorCode);
+        if (U_FAILURE(errorCode)) {
+            ruAbortf("error in ucasemap_open error=%s\n",
+                     u_errorName(errorCode));
+        }
+        return map;
+    }();
+    return ucm;
+}
+
+/*
+ * Case maps pure ASCII input 16 bytes at a time with SSE2 on x86-64 and 8
+ * bytes at a time otherwise. Returns false as soon as a non ASCII byte turns
+ * up so that the caller can hand over to ICU.
+ */
+static bool asciiSwitchCase(trans_chars in, rusize len, char* out,
+                            bool isUpper) {
+    const uint64_t high = 0x8080808080808080ULL;
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint8_t first = isUpper ? 'a' : 'A';
+    // adding these sets the high bit of bytes >= first and >= first + 26
+    const uint64_t from = ones * (uint8_t)(0x80 - first);
+    const uint64_t past = ones * (uint8_t)(0x80 - first - 26);
+    rusize i = 0;
+#ifdef UTF_SIMD_X64
+    // signed compares are fine as long as the high bits are clear
+    const __m128i below = _mm_set1_epi8((char)(first - 1));
+    const __m128i above = _mm_set1_epi8((char)(first + 26));
+    const __m128i flip = _mm_set1_epi8(0x20);
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+        if (_mm_movemask_epi8(v)) return false;
+        __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(v, below),
+                                        _mm_cmpgt_epi8(above, v));
+        _mm_storeu_si128((__m128i*)(out + i),
+                         _mm_xor_si128(v, _mm_and_si128(letters, flip)));
+    }
+#endif
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, in + i, 8);
+        if (w & high) return false;
+        uint64_t letters = ((w + from) ^ (w + past)) & high;
+        w ^= letters >> 2;
+        memcpy(out + i, &w, 8);
+    }
+    for (; i < len; i++) {
+        uint8_t c = (uint8_t)in[i];
+        if (c & 0x80) return false;
+        if ((uint8_t)(c - first) < 26) c ^= 0x20;
+        out[i] = (char)c;
+    }
+    out[len] = '\0';
+    return true;
+}
+
+/*
+ * UTF-8 <-> UTF-16 kernels for well formed input. Each conversion makes one
+ * pass to validate and size the output exactly and one to fill it, skipping
+ * over ASCII runs in bulk. Malformed input is left to ICU, which
+ * substitutes the offending sequences.
+ */
+static const uint64_t highBits8_ = 0x8080808080808080ULL;
+static const uint64_t highBits16_ = 0xff80ff80ff80ff80ULL;
+
+/*
+ * ASCII runs dominate most of our text, so finding where one ends and
+ * widening or narrowing it are done with vector instructions where we have
+ * them. SSE2 is part of x86-64, AVX2 is looked up at runtime as for CRC32C in
+ * hash.c. Other platforms use the portable word-at-a-time loops.
+ */
+// length of the ASCII run at the start of s
+static rusize asciiRunSwar(const uint8_t* s, rusize len) {
+    rusize i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, s + i, 8);
+        if (w & highBits8_) break;
+    }
+    while (i < len && s[i] < 0x80) i++;
+    return i;
+}
+
+// length of the run of UTF-16 units below 0x80 at the start of s
+static rusize unitsAsciiRunSwar(const UChar* s, rusize len) {
+    rusize i = 0;
+    for (; i + 4 <= len; i += 4) {
+        uint64_t w;
+        memcpy(&w, s + i, 8);
+        if (w & highBits16_) break;
+    }
+    while (i < len && s[i] < 0x80) i++;
+    return i;
+}
+
+#ifdef UTF_SIMD_X64
+static inline uint32_t lowBit(uint32_t mask) {
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return (uint32_t)idx;
+#else
+    return (uint32_t)__builtin_ctz(mask);
+#endif
+}
+
+static rusize asciiRunSse2(const uint8_t* s, rusize len) {
+    rusize i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(v);
+        if (mask) return i + lowBit(mask);
+    }
+    return i + asciiRunSwar(s + i, len - i);
+}
+
+#ifdef __GNUC__
+__attribute__((target("avx2")))
+#endif
+static rusize asciiRunAvx2(const uint8_t* s, rusize len) {
+    rusize i = 0;
+    uint32_t mask = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(s + i));
+        mask = (uint32_t)_mm256_movemask_epi8(v);
+        if (mask) break;
+    }
+    // leave the upper halves clean or the following SSE code stalls
+    _mm256_zeroupper();
+    if (mask) return i + lowBit(mask);
+    return i + asciiRunSse2(s + i, len - i);
+}
+
+static bool avx2Available() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    // the OS must save the AVX registers as well
+    if (!(info[2] & (1 << 27)) || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+static rusize asciiRun(const uint8_t* s, rusize len) {
+    // -1 unknown, 0 SSE2, 1 AVX2. Racing threads store the same value.
+    static volatile int avx2 = -1;
+    if (avx2 < 0) avx2 = avx2Available();
+    // short inputs don't amortize the switch to 256 bit registers
+    if (avx2 && len >= 64) return asciiRunAvx2(s, len);
+    return asciiRunSse2(s, len);
+}
+
+static rusize unitsAsciiRun(const UChar* s, rusize len) {
+    const __m128i high = _mm_set1_epi16((short)0xff80);
+    const __m128i zero = _mm_setzero_si128();
+    rusize i = 0;
+    for (; i + 8 <= len; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(
+                _mm_cmpeq_epi16(_mm_and_si128(v, high), zero)) ^ 0xffff;
+        if (mask) return i + lowBit(mask) / 2;
+    }
+    return i + unitsAsciiRunSwar(s + i, len - i);
+}
+
+// widens len ASCII bytes to UTF-16
+static void asciiWiden(const uint8_t* s, rusize len, UChar* out) {
+    const __m128i zero = _mm_setzero_si128();
+    rusize i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_unpacklo_epi8(v, zero));
+        _mm_storeu_si128((__m128i*)(out + i + 8), _mm_unpackhi_epi8(v, zero));
+    }
+    for (; i < len; i++) out[i] = s[i];
+}
+
+// narrows len UTF-16 units below 0x80 to bytes
+static void asciiNarrow(const UChar* s, rusize len, uint8_t* out) {
+    rusize i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i*)(s + i));
+        __m128i b = _mm_loadu_si128((const __m128i*)(s + i + 8));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(a, b));
+    }
+    for (; i < len; i++) out[i] = (uint8_t)s[i];
+}
+#else
+#define asciiRun asciiRunSwar
+#define unitsAsciiRun unitsAsciiRunSwar
+
+static void asciiWiden(const uint8_t* s, rusize len, UChar* out) {
+    for (rusize i = 0; i < len; i++) out[i] = s[i];
+}
+
+static void asciiNarrow(const UChar* s, rusize len, uint8_t* out) {
+    for (rusize i = 0; i < len; i++) out[i] = (uint8_t)s[i];
+}
+#endif
+
+// returns the number of UTF-16 units s converts to or -1 if it is malformed
+static int64_t utf8Units(const uint8_t* s, rusize len) {
+    int64_t units = 0;
+    rusize i = 0;
+    while (i < len) {
+        uint8_t c = s[i];
+        if (c < 0x80) {
+            rusize run = asciiRun(s + i, len - i);
+            i += run;
+            units += run;
+            continue;
+        }
+        // trailing byte count and the valid range of the first one, which
+        // rules out overlong forms, surrogates and code points past U+10FFFF
+        rusize n;
+        uint8_t lo = 0x80, hi = 0xbf;
+        if (c >= 0xc2 && c <= 0xdf) {
+            n = 1;
+        } else if (c >= 0xe0 && c <= 0xef) {
+            n = 2;
+            if (c == 0xe0) lo = 0xa0;
+            else if (c == 0xed) hi = 0x9f;
+        } else if (c >= 0xf0 && c <= 0xf4) {
+            n = 3;
+            if (c == 0xf0) lo = 0x90;
+            else if (c == 0xf4) hi = 0x8f;
+        } else {
+            return -1;
+        }
+        if (i + n >= len || s[i+1] < lo || s[i+1] > hi) return -1;
+        for (rusize k = 2; k <= n; k++) {
+            if ((s[i+k] & 0xc0) != 0x80) return -1;
+        }
+        units += n == 3 ? 2 : 1;
+        i += n + 1;
+    }
+    return units;
+}
+
+// converts well formed UTF-8 as validated by utf8Units
+static void utf8ToUnits(const uint8_t* s, rusize len, UChar* out) {
+    rusize i = 0;
+    while (i < len) {
+        uint8_t c = s[i];
+        if (c < 0x80) {
+            rusize run = asciiRun(s + i, len - i);
+            asciiWiden(s + i, run, out);
+            out += run;
+            i += run;
+        } else if (c < 0xe0) {
+            *out++ = (UChar)(((c & 0x1f) << 6) | (s[i+1] & 0x3f));
+            i += 2;
+        } else if (c < 0xf0) {
+            *out++ = (UChar)(((c & 0x0f) << 12) | ((s[i+1] & 0x3f) << 6) |
+                             (s[i+2] & 0x3f));
+            i += 3;
+        } else {
+            uint32_t cp = ((uint32_t)(c & 0x07) << 18) |
+                          ((uint32_t)(s[i+1] & 0x3f) << 12) |
+                          ((uint32_t)(s[i+2] & 0x3f) << 6) |
+                          (uint32_t)(s[i+3] & 0x3f);
+            cp -= 0x10000;
+            *out++ = (UChar)(0xd800 + (cp >> 10));
+            *out++ = (UChar)(0xdc00 + (cp & 0x3ff));
+            i += 4;
+        }
+    }
+}
+
+// returns the number of UTF-8 bytes s converts to or -1 on lone surrogates
+static int64_t utf16Bytes(const UChar* s, rusize len) {
+    int64_t bytes = 0;
+    rusize i = 0;
+    while (i < len) {
+        if (s[i] < 0x80) {
+            rusize run = unitsAsciiRun(s + i, len - i);
+            i += run;
+            bytes += run;
+            continue;
+        }
+        UChar c = s[i++];
+        if (c < 0x800) {
+            bytes += 2;
+        } else if (c < 0xd800 || c > 0xdfff) {
+            bytes += 3;
+        } else if (c <= 0xdbff && i < len && s[i] >= 0xdc00 && s[i] <= 0xdfff) {
+            bytes += 4;
+            i++;
+        } else {
+            return -1;
+        }
+    }
+    return bytes;
+}
+
+// converts well formed UTF-16 as validated by utf16Bytes
+static void unitsToUtf8(const UChar* s, rusize len, uint8_t* out) {
+    rusize i = 0;
+    while (i < len) {
+        if (s[i] < 0x80) {
+            rusize run = unitsAsciiRun(s + i, len - i);
+            asciiNarrow(s + i, run, out);
+            out += run;
+            i += run;
+            continue;
+        }
+        uint32_t c = s[i++];
+        if (c < 0x800) {
+            *out++ = (uint8_t)(0xc0 | (c >> 6));
+            *out++ = (uint8_t)(0x80 | (c & 0x3f));
+        } else if (c < 0xd800 || c > 0xdfff) {
+            *out++ = (uint8_t)(0xe0 | (c >> 12));
+            *out++ = (uint8_t)(0x80 | ((c >> 6) & 0x3f));
+            *out++ = (uint8_t)(0x80 | (c & 0x3f));
+        } else {
+            c = 0x10000 + ((c - 0xd800) << 10) + (s[i++] - 0xdc00);
+            *out++ = (uint8_t)(0xf0 | (c >> 18));
+            *out++ = (uint8_t)(0x80 | ((c >> 12) & 0x3f));
+            *out++ = (uint8_t)(0x80 | ((c >> 6) & 0x3f));
+            *out++ = (uint8_t)(0x80 | (c & 0x3f));
+        }
+    }
+}
+
+RUAPI bool ruStrIsUtf8(trans_chars str, rusize len) {
+    if (!str) return false;
+    if (len == RU_SIZE_AUTO) len = strlen(str);
+    return utf8Units((const uint8_t*)str, len) >= 0;
+}
+
 UChar* convToUni(UConverter *conv, trans_chars  instr, int32_t inlen) {
     if (!conv || !instr) return NULL;
     if (inlen < 0) inlen = -1;
+    rusize len = inlen < 0 ? strlen(instr) : (rusize)inlen;
+    int64_t units = utf8Units((const uint8_t*)instr, len);
+    if (units >= 0 && units < INT32_MAX) {
+        UChar *usrc = ruMalloc0((rusize)units + 1, UChar);
+        utf8ToUnits((const uint8_t*)instr, len, usrc);
+        return usrc;
+    }
     UErrorCode errorCode = U_ZERO_ERROR;
     int32_t needed = ucnv_toUChars(conv, NULL, 0,
                                    instr, inlen, &errorCode);
@@ -80,6 +451,7 @@ UChar* convToUni(UConverter *conv, trans_chars  instr, int32_t inlen) {
 }
 
 alloc_chars convToStr(UConverter *conv, UChar *usrc, int32_t uclen) {
+    if (!conv || !usrc) return NULL;
     UErrorCode errorCode = U_ZERO_ERROR;
     // convert it back
     if (uclen < 0) {
@@ -88,7 +460,14 @@ alloc_chars convToStr(UConverter *conv, UChar *usrc, int32_t uclen) {
     } else {
         // we accept bytes, but ucnv seems to want chars
         uclen /= 2;
-        if (!usrc[uclen-1]) uclen -= 1; // subtract null teminator
+        if (uclen && !usrc[uclen-1]) uclen -= 1; // subtract null teminator
+    }
+    rusize len = uclen < 0 ? (rusize)u_strlen(usrc) : (rusize)uclen;
+    int64_t bytes = utf16Bytes(usrc, len);
+    if (bytes >= 0 && bytes < INT32_MAX) {
+        char *out = ruMalloc0((rusize)bytes + 1, char);
+        unitsToUtf8(usrc, len, (uint8_t*)out);
+        return out;
     }
     int32_t needed = ucnv_fromUChars(conv, NULL, 0,
                                      usrc, uclen,
@@ -108,17 +487,11 @@ alloc_chars convToStr(UConverter *conv, UChar *usrc, int32_t uclen) {
 }
 
 UChar* charToUni(const char *instr) {
-    UConverter *conv = getConverter();
-    UChar *upat = convToUni(conv, instr, -1);
-    ucnv_close(conv);
-    return upat;
+    return convToUni(threadConverter(), instr, -1);
 }
 
 alloc_chars uniToChar(UChar *usrc) {
-    UConverter *conv = getConverter();
-    alloc_chars upat = convToStr(conv, usrc, -1);
-    ucnv_close(conv);
-    return upat;
+    return convToStr(threadConverter(), usrc, -1);
 }
 
 UChar* uniSwitchCase(UChar* usrc, bool isUpper) {
@@ -142,7 +515,7 @@ UChar* uniSwitchCase(UChar* usrc, bool isUpper) {
         errorCode == U_STRING_NOT_TERMINATED_WARNING) { // terminator missing
         // cache miss?
         ruVerbLogf("size mismatch in u_strTo(Lower|Upper) needed: %ld", needed);
-        udst = ruRealloc(udst, (rusize)slen, UChar);
+        udst = ruRealloc(udst, (rusize)len, UChar);
         errorCode = U_ZERO_ERROR;
         if (isUpper) {
             needed = u_strToUpper(udst, len,
@@ -167,11 +540,15 @@ alloc_chars utf8SwitchCase(trans_chars instr, bool isUpper) {
     ruClearError();
     if (!instr) return NULL;
 
+    rusize asciilen = strlen(instr);
+    char *dst = ruMalloc0(asciilen + 1, char);
+    // most identifiers and headers never need ICU
+    if (asciiSwitchCase(instr, asciilen, dst, isUpper)) return dst;
+
     UErrorCode errorCode = U_ZERO_ERROR;
-    UCaseMap* ucm = ucasemap_open("utf8", 0, &errorCode);
-    int32_t inlen = (int32_t)strlen(instr);
+    const UCaseMap* ucm = caseMap();
+    int32_t inlen = (int32_t)asciilen;
     int32_t dstlen = inlen + 1; //terminator
-    char *dst = ruMalloc0((rusize)dstlen, char);
     int32_t needed;
     if (isUpper) {
         needed = ucasemap_utf8ToUpper(ucm, dst, dstlen,
@@ -199,7 +576,6 @@ alloc_chars utf8SwitchCase(trans_chars instr, bool isUpper) {
                                           &errorCode);
         }
     }
-    ucasemap_close(ucm);
     if(U_FAILURE(errorCode)) {
         ruSetError("error in ucasemap_utf8To(Upper|Lower) error=%s\n",
                 u_errorName(errorCode));
@@ -214,10 +590,7 @@ RUAPI alloc_chars ruStrFromUtf16(trans_uni unistr) {
 }
 
 RUAPI alloc_chars ruStrFromNUtf16(trans_uni unistr, int32_t bytelen) {
-    UConverter *conv = getConverter();
-    alloc_chars upat = convToStr(conv, (UChar*)unistr, bytelen);
-    ucnv_close(conv);
-    return upat;
+    return convToStr(threadConverter(), (UChar*)unistr, bytelen);
 }
 
 RUAPI alloc_uni ruStrToUtf16(trans_chars str) {
@@ -225,10 +598,7 @@ RUAPI alloc_uni ruStrToUtf16(trans_chars str) {
 }
 
 RUAPI alloc_uni ruStrNToUtf16(trans_chars str, int32_t bytelen) {
-    UConverter *conv = getConverter();
-    alloc_uni upat = (alloc_uni)convToUni(conv, str, bytelen);
-    ucnv_close(conv);
-    return upat;
+    return (alloc_uni)convToUni(threadConverter(), str, bytelen);
 }
 
 RUAPI alloc_chars ruStrFromNfd(trans_chars instr) {
@@ -239,47 +609,76 @@ RUAPI alloc_chars ruStrToNfd(trans_chars instr) {
     return ruUtf8CaseNormalize(instr, ruUtf8Nfd, ruUtf8NoCase);
 }
 
-RUAPI alloc_chars ruUtf8CaseNormalize(trans_chars  instr, int32_t normMode, int32_t caseMode) {
-    ruClearError();
-    if (!instr) return NULL;
+// whether s holds nothing but ASCII, which all normal forms leave alone
+static bool isAscii(trans_chars s, rusize len) {
+    return asciiRun((const uint8_t*)s, len) == len;
+}
+
+/*
+ * Validates the modes and looks up the normalizer for normMode, which is NULL
+ * when no normalization was requested.
+ */
+static bool normalizerGet(int32_t normMode, int32_t caseMode,
+                          const UNormalizer2** un) {
+    UErrorCode errorCode = U_ZERO_ERROR;
+    *un = NULL;
+    if (caseMode && caseMode != ruUtf8Lower && caseMode != ruUtf8Upper) {
+        ruSetError("casemode was invalid or failed");
+        return false;
+    }
+    if (!normMode) return true;
+    switch(normMode) {
+        case ruUtf8Nfc:
+            *un = unorm2_getNFCInstance(&errorCode);
+            break;
+        case ruUtf8Nfd:
+            *un = unorm2_getNFDInstance(&errorCode);
+            break;
+//        case ruUtf8Nfkc:
+//            *un = unorm2_getNFKCInstance(&errorCode);
+//            break;
+//        case ruUtf8Nfkd:
+//            *un = unorm2_getNFKDInstance(&errorCode);
+//            break;
+    }
+    if (*un) return true;
+    if(U_FAILURE(errorCode)) {
+        ruSetError("error in unorm2_getInstance error=%s\n",
+                 u_errorName(errorCode));
+    } else {
+        ruSetError("invalid normMode");
+    }
+    return false;
+}
+
+static alloc_chars caseNormalize(UConverter *conv, const UNormalizer2 *un,
+                                 trans_chars instr, int32_t caseMode) {
+    rusize len = strlen(instr);
+    if (isAscii(instr, len)) {
+        if (!caseMode) return ruStrDup(instr);
+        char* dst = ruMalloc0(len + 1, char);
+        asciiSwitchCase(instr, len, dst, caseMode == ruUtf8Upper);
+        return dst;
+    }
 
     UChar *usrc = NULL, *utmp = NULL;
     char* out = NULL;
     UErrorCode errorCode = U_ZERO_ERROR;
     int32_t needed, dstlen;
-    // get a converter
-    UConverter *conv = getConverter();
     do {
         // make unicode
-        usrc = convToUni(conv, instr, -1);
+        usrc = convToUni(conv, instr, (int32_t)len);
         if (!usrc) break;
-        // do the transform
-        const UNormalizer2 *un = NULL;
-        if (normMode) {
-            switch(normMode) {
-                case ruUtf8Nfc:
-                    un = unorm2_getNFCInstance(&errorCode);
-                    break;
-                case ruUtf8Nfd:
-                    un = unorm2_getNFDInstance(&errorCode);
-                    break;
-//                case ruUtf8Nfkc:
-//                    un = unorm2_getNFKCInstance(&errorCode);
-//                    break;
-//                case ruUtf8Nfkd:
-//                    un = unorm2_getNFKDInstance(&errorCode);
-//                    break;
-            }
-            if (!un) {
-                if(U_FAILURE(errorCode)) {
-                    ruSetError("error in unorm2_getInstance error=%s\n",
-                             u_errorName(errorCode));
-                    break;
-                } else {
-                    ruSetError("invalid normMode");
-                    break;
-                }
+        if (un && unorm2_isNormalized(un, usrc, -1, &errorCode)) {
+            // most names already are in the requested form
+            un = NULL;
+            if (!caseMode) {
+                out = ruStrDup(instr);
+                break;
             }
+        }
+        errorCode = U_ZERO_ERROR;
+        if (un) {
             // get needed transform space
             needed = unorm2_normalize(un, usrc, -1,
                                       NULL, 0, &errorCode);
@@ -304,14 +703,7 @@ RUAPI alloc_chars ruUtf8CaseNormalize(trans_chars  instr, int32_t normMode, int3
             utmp = NULL;
         }
         if(caseMode) {
-            switch(caseMode) {
-                case ruUtf8Lower:
-                    utmp = uniSwitchCase(usrc, false);
-                    break;
-                case ruUtf8Upper:
-                    utmp = uniSwitchCase(usrc, true);
-                    break;
-            }
+            utmp = uniSwitchCase(usrc, caseMode == ruUtf8Upper);
             if (!utmp) {
                 ruSetError("casemode was invalid or failed");
                 break;
@@ -323,8 +715,40 @@ RUAPI alloc_chars ruUtf8CaseNormalize(trans_chars  instr, int32_t normMode, int3
         out = convToStr(conv, usrc, -1);
     } while(0);
     // clean up
-    ucnv_close(conv);
     ruFree(usrc);
     ruFree(utmp);
     return out;
 }
+
+RUAPI alloc_chars ruUtf8CaseNormalize(trans_chars  instr, int32_t normMode, int32_t caseMode) {
+    ruClearError();
+    if (!instr) return NULL;
+    const UNormalizer2 *un = NULL;
+    if (!normalizerGet(normMode, caseMode, &un)) return NULL;
+    return caseNormalize(threadConverter(), un, instr, caseMode);
+}
+
+RUAPI ruList ruUtf8CaseNormalizeList(ruList strings, int32_t normMode,
+                                     int32_t caseMode, int32_t* code) {
+    ruClearError();
+    if (!strings) ruRetWithCode(code, RUE_PARAMETER_NOT_SET, NULL);
+    const UNormalizer2 *un = NULL;
+    if (!normalizerGet(normMode, caseMode, &un)) {
+        ruRetWithCode(code, RUE_INVALID_PARAMETER, NULL);
+    }
+    UConverter *conv = threadConverter();
+    int32_t ret = RUE_OK;
+    ruList out = ruListNew(ruTypePtrFree());
+    ruIterator li = ruListIter(strings);
+    for (char* str = ruIterNext(li, char*); li; str = ruIterNext(li, char*)) {
+        alloc_chars res = str ? caseNormalize(conv, un, str, caseMode) : NULL;
+        if (!res) {
+            if (!str) ruSetError("list contains a NULL entry");
+            ret = RUE_INVALID_PARAMETER;
+            break;
+        }
+        ruListAppend(out, res);
+    }
+    if (ret != RUE_OK) out = ruListFree(out);
+    ruRetWithCode(code, ret, out);
+}
@@ -271,6 +271,594 @@ static bool iniParseCb(void* user, trans_chars section, trans_chars name,
     return true;
 }
 
+// <editor-fold desc="indexed engine">
+/*
+ * The indexed engine keeps the whole file in one string arena and a single
+ * open addressing table over (section, key). Section headers are entries
+ * themselves, so a section number is the entry number of its header plus one
+ * and 0 stands for the global keys.
+ *
+ * In editing mode the file content is kept as well, together with a record
+ * of every section and key line in file order. Writing copies the content
+ * and only replaces the lines of changed keys.
+ */
+#define INI_NONE        UINT32_MAX  // no value / section header marker
+#define INI_MAX_CHARS   (UINT32_MAX - 1)
+
+typedef struct {
+    uint32_t section;   // section number or INI_NONE for a section header
+    uint32_t key;       // offset of the key or section name in chars
+    uint32_t value;     // offset of the value in chars or INI_NONE
+    uint32_t hash;
+    uint32_t line;      // first line record of the entry, editing mode only
+    uint32_t state;     // entClean, entDirty or entGone
+} iniEntry;
+
+enum {
+    entClean = 0,
+    entDirty,
+    entGone
+};
+
+typedef struct {
+    uint32_t entry;
+    uint32_t start;     // first byte of the line
+    uint32_t end;       // one past the line including its newline
+    uint32_t valStart;  // span of the value to replace on changes
+    uint32_t valEnd;
+} iniLine;
+
+struct IniIndex_ {
+    char* chars;
+    uint32_t charLen;
+    uint32_t charCap;
+    iniEntry* entries;
+    uint32_t count;
+    uint32_t cap;
+    uint32_t* slots;    // entry number + 1 or 0 when empty
+    uint32_t mask;
+    // editing mode only
+    char* src;          // file content the line records refer to
+    uint32_t srcLen;
+    iniLine* lines;
+    uint32_t lineCount;
+    uint32_t lineCap;
+};
+
+static uint32_t indexHash(uint32_t section, trans_chars key, rusize len) {
+    uint32_t h = 2166136261u ^ (section * 0x9e3779b1u);
+    for (rusize i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)key[i]) * 16777619u;
+    }
+    return h;
+}
+
+static IniIndex* indexFree(IniIndex* ix) {
+    if (!ix) return NULL;
+    ruFree(ix->chars);
+    ruFree(ix->entries);
+    ruFree(ix->slots);
+    ruFree(ix->src);
+    ruFree(ix->lines);
+    ruFree(ix);
+    return NULL;
+}
+
+static IniIndex* indexNew(rusize size) {
+    IniIndex* ix = ruMalloc0(1, IniIndex);
+    ix->charCap = (uint32_t)size + 16;
+    ix->chars = ruMalloc0(ix->charCap, char);
+    ix->cap = 64;
+    ix->entries = ruMalloc0(ix->cap, iniEntry);
+    ix->mask = 127;
+    ix->slots = ruMalloc0(ix->mask + 1, uint32_t);
+    return ix;
+}
+
+static uint32_t indexFind(IniIndex* ix, uint32_t section, trans_chars key,
+                          rusize len, uint32_t hash) {
+    for (uint32_t s = hash & ix->mask; ix->slots[s]; s = (s + 1) & ix->mask) {
+        iniEntry* e = &ix->entries[ix->slots[s] - 1];
+        if (e->hash == hash && e->section == section &&
+            !strncmp(ix->chars + e->key, key, len) && !ix->chars[e->key + len]) {
+            return ix->slots[s] - 1;
+        }
+    }
+    return INI_NONE;
+}
+
+static bool indexReserve(IniIndex* ix, rusize len) {
+    rusize need = (rusize)ix->charLen + len;
+    if (need > INI_MAX_CHARS) return false;
+    if (need > ix->charCap) {
+        rusize cap = (rusize)ix->charCap * 2;
+        if (cap < need) cap = need;
+        if (cap > INI_MAX_CHARS) cap = INI_MAX_CHARS;
+        ix->charCap = (uint32_t)cap;
+        ix->chars = ruRealloc(ix->chars, ix->charCap, char);
+    }
+    return true;
+}
+
+static uint32_t indexChars(IniIndex* ix, trans_chars a, rusize alen,
+                           trans_chars b, rusize blen) {
+    if (!indexReserve(ix, alen + blen + 1)) return INI_NONE;
+    uint32_t off = ix->charLen;
+    if (alen) memcpy(ix->chars + off, a, alen);
+    if (blen) memcpy(ix->chars + off + alen, b, blen);
+    ix->chars[off + alen + blen] = '\0';
+    ix->charLen += (uint32_t)(alen + blen + 1);
+    return off;
+}
+
+static void indexSlot(IniIndex* ix, uint32_t entry) {
+    uint32_t s = ix->entries[entry].hash & ix->mask;
+    while (ix->slots[s]) s = (s + 1) & ix->mask;
+    ix->slots[s] = entry + 1;
+}
+
+static int32_t indexAdd(IniIndex* ix, uint32_t section, trans_chars key,
+                        rusize len, uint32_t hash, uint32_t* entry) {
+    if (ix->count == ix->cap) {
+        ix->cap *= 2;
+        ix->entries = ruRealloc(ix->entries, ix->cap, iniEntry);
+    }
+    if (ix->count * 2 >= ix->mask) {
+        ix->mask = ix->mask * 2 + 1;
+        ruFree(ix->slots);
+        ix->slots = ruMalloc0(ix->mask + 1, uint32_t);
+        for (uint32_t i = 0; i < ix->count; i++) indexSlot(ix, i);
+    }
+    iniEntry* e = &ix->entries[ix->count];
+    e->key = indexChars(ix, key, len, NULL, 0);
+    if (e->key == INI_NONE) return RUE_OVERFLOW;
+    e->section = section;
+    e->value = INI_NONE;
+    e->hash = hash;
+    e->line = INI_NONE;
+    e->state = entClean;
+    *entry = ix->count++;
+    indexSlot(ix, *entry);
+    return RUE_OK;
+}
+
+static uint32_t indexSection(IniIndex* ix, trans_chars name) {
+    if (!name) return 0;
+    rusize len = strlen(name);
+    uint32_t e = indexFind(ix, INI_NONE, name, len,
+                           indexHash(INI_NONE, name, len));
+    return e == INI_NONE ? INI_NONE : e + 1;
+}
+
+/* Same semantics as iniParseCb: a repeated key appends to its value */
+static int32_t indexPut(IniIndex* ix, uint32_t section, trans_chars key,
+                        rusize klen, trans_chars value, rusize vlen,
+                        uint32_t* entry) {
+    // like the line based parser, names end at a stray NUL
+    perm_chars nul = memchr(key, '\0', klen);
+    if (nul) klen = nul - key;
+    uint32_t hash = indexHash(section, key, klen);
+    *entry = indexFind(ix, section, key, klen, hash);
+    if (*entry == INI_NONE) {
+        int32_t ret = indexAdd(ix, section, key, klen, hash, entry);
+        if (ret != RUE_OK) return ret;
+    }
+    iniEntry* e = &ix->entries[*entry];
+    if (!value) return RUE_OK;
+    if (e->value == INI_NONE) {
+        e->value = indexChars(ix, value, vlen, NULL, 0);
+    } else if (vlen) {
+        // the old value is left behind in the arena
+        rusize olen = strlen(ix->chars + e->value);
+        if (!indexReserve(ix, olen + vlen + 1)) return RUE_OVERFLOW;
+        e->value = indexChars(ix, ix->chars + e->value, olen, value, vlen);
+    }
+    return e->value == INI_NONE ? RUE_OVERFLOW : RUE_OK;
+}
+
+static void indexLine(IniIndex* ix, uint32_t entry, perm_chars start,
+                      perm_chars end, perm_chars valStart, perm_chars valEnd) {
+    if (!ix->lines) return;
+    if (ix->lineCount == ix->lineCap) {
+        ix->lineCap *= 2;
+        ix->lines = ruRealloc(ix->lines, ix->lineCap, iniLine);
+    }
+    iniLine* l = &ix->lines[ix->lineCount];
+    l->entry = entry;
+    l->start = (uint32_t)(start - ix->src);
+    l->end = (uint32_t)(end - ix->src);
+    l->valStart = (uint32_t)(valStart - ix->src);
+    l->valEnd = (uint32_t)(valEnd - ix->src);
+    if (ix->entries[entry].line == INI_NONE) {
+        ix->entries[entry].line = ix->lineCount;
+    }
+    ix->lineCount++;
+}
+
+/* Like find_chars_or_comment but for a bounded span */
+static perm_chars spanChars(perm_chars s, perm_chars end, trans_chars chars) {
+    bool wasSpace = false;
+    for (; s < end; s++) {
+        if (chars && strchr(chars, *s)) break;
+        if (wasSpace && *s == ';') break;
+        wasSpace = isspace((uint8_t)*s);
+    }
+    return s;
+}
+
+static perm_chars spanLskip(perm_chars s, perm_chars end) {
+    while (s < end && isspace((uint8_t)*s)) s++;
+    return s;
+}
+
+static perm_chars spanRtrim(perm_chars s, perm_chars end) {
+    while (end > s && isspace((uint8_t)end[-1])) end--;
+    return end;
+}
+
+static int32_t indexParse(IniIndex* ix, perm_chars buf, rusize len,
+                          int* errLineNo) {
+    perm_chars bufEnd = buf + len;
+    perm_chars line = buf, start, end, lineEnd;
+    uint32_t section = 0, prevKey = INI_NONE;
+    int lineno = 0;
+    int32_t ret = RUE_OK;
+
+    if (len >= 3 && (uint8_t)buf[0] == 0xEF && (uint8_t)buf[1] == 0xBB &&
+        (uint8_t)buf[2] == 0xBF) {
+        // cope with UTF-8 BOM
+        line += 3;
+    }
+    for (; line < bufEnd && ret == RUE_OK; line = lineEnd + 1) {
+        lineno++;
+        lineEnd = memchr(line, '\n', bufEnd - line);
+        if (!lineEnd) lineEnd = bufEnd;
+        perm_chars next = lineEnd < bufEnd ? lineEnd + 1 : bufEnd;
+        start = spanLskip(line, lineEnd);
+        end = spanRtrim(start, lineEnd);
+
+        if (start == end || strchr(INI_START_COMMENT_PREFIXES, *start)) {
+            continue;
+        }
+        if (prevKey != INI_NONE && start > line) {
+            // continuation of the previous value
+            end = spanRtrim(start, spanChars(start, end, NULL));
+            iniEntry* e = &ix->entries[prevKey];
+            trans_chars key = ix->chars + e->key;
+            ret = indexPut(ix, e->section, key, strlen(key), start,
+                           end - start, &prevKey);
+            if (ret == RUE_OK) indexLine(ix, prevKey, line, next, start, end);
+
+        } else if (*start == '[') {
+            perm_chars close = spanChars(start + 1, end, "]");
+            if (close < end && *close == ']') {
+                perm_chars nul = memchr(start + 1, '\0', close - start - 1);
+                rusize nlen = (nul ? nul : close) - start - 1;
+                uint32_t hash = indexHash(INI_NONE, start + 1, nlen);
+                uint32_t e = indexFind(ix, INI_NONE, start + 1, nlen, hash);
+                if (e == INI_NONE) {
+                    ret = indexAdd(ix, INI_NONE, start + 1, nlen, hash, &e);
+                }
+                section = e + 1;
+                prevKey = INI_NONE;
+                if (ret == RUE_OK) indexLine(ix, e, line, next, close, close);
+            } else if (!*errLineNo) {
+                *errLineNo = lineno;
+            }
+
+        } else {
+            perm_chars eq = spanChars(start, end, "=:");
+            if (eq < end && (*eq == '=' || *eq == ':')) {
+                perm_chars kend = spanRtrim(start, eq);
+                perm_chars value = eq + 1;
+                perm_chars vend = spanChars(value, end, NULL);
+                value = spanLskip(value, vend);
+                vend = spanRtrim(value, vend);
+                ret = indexPut(ix, section, start, kend - start, value,
+                               vend - value, &prevKey);
+                if (ret == RUE_OK) indexLine(ix, prevKey, line, next, value, vend);
+            } else if (!*errLineNo) {
+                uint32_t entry;
+                end = spanRtrim(start, eq);
+                ret = indexPut(ix, section, start, end - start, NULL, 0, &entry);
+                if (ret == RUE_OK) indexLine(ix, entry, line, next, end, end);
+            }
+        }
+    }
+    if (ret == RUE_OVERFLOW) {
+        ruSetError("ini content is too large for the index");
+    }
+    return ret;
+}
+
+/* Moves an indexed ini object over to the map representation */
+static void indexUnpack(Ini* ini) {
+    IniIndex* ix = ini->idx;
+    if (!ix) return;
+    ini->keys = ruMapNew(ruTypeStrDup(), ruTypeStrDup());
+    ini->sections = ruMapNew(ruTypeStrDup(), ruTypePtr(ruMapFree));
+    for (uint32_t i = 0; i < ix->count; i++) {
+        iniEntry* e = &ix->entries[i];
+        if (e->state == entGone) continue;
+        if (e->section == INI_NONE) {
+            iniParseCb(ini, ix->chars + e->key, NULL, NULL, 0);
+        } else {
+            trans_chars section = NULL;
+            if (e->section) section = ix->chars + ix->entries[e->section - 1].key;
+            iniParseCb(ini, section, ix->chars + e->key,
+                       e->value == INI_NONE ? NULL : ix->chars + e->value, 0);
+        }
+    }
+    ini->idx = indexFree(ix);
+}
+
+static int32_t indexGet(Ini* ini, trans_chars section, trans_chars key,
+                        perm_chars* value) {
+    IniIndex* ix = ini->idx;
+    uint32_t sec = indexSection(ix, section);
+    if (sec == INI_NONE) return RUE_FILE_NOT_FOUND;
+    rusize len = strlen(key);
+    uint32_t e = indexFind(ix, sec, key, len, indexHash(sec, key, len));
+    if (e == INI_NONE || ix->entries[e].state == entGone) {
+        return RUE_FILE_NOT_FOUND;
+    }
+    e = ix->entries[e].value;
+    *value = e == INI_NONE ? NULL : ix->chars + e;
+    return RUE_OK;
+}
+
+static int32_t indexList(Ini* ini, uint32_t section, ruList* list) {
+    IniIndex* ix = ini->idx;
+    ruList lst = ruListNew(ruTypeStrDup());
+    for (uint32_t i = 0; i < ix->count; i++) {
+        if (ix->entries[i].section == section &&
+            ix->entries[i].state != entGone) {
+            ruListAppend(lst, ix->chars + ix->entries[i].key);
+        }
+    }
+    *list = lst;
+    return RUE_OK;
+}
+
+/* Editing mode setter, changes are kept in the index until written */
+static int32_t indexSet(IniIndex* ix, trans_chars section, trans_chars key,
+                        trans_chars value) {
+    if ((section && strpbrk(section, "]\r\n")) ||
+        (key && strpbrk(key, "=:\r\n")) || (value && strpbrk(value, "\r\n"))) {
+        ruSetError("ini names or values must not contain line breaks or "
+                   "separators");
+        return RUE_INVALID_PARAMETER;
+    }
+    int32_t ret;
+    uint32_t sec = 0, entry;
+    rusize len;
+    if (section) {
+        len = strlen(section);
+        uint32_t hash = indexHash(INI_NONE, section, len);
+        entry = indexFind(ix, INI_NONE, section, len, hash);
+        if (entry == INI_NONE) {
+            ret = indexAdd(ix, INI_NONE, section, len, hash, &entry);
+            if (ret != RUE_OK) return ret;
+            ix->entries[entry].state = entDirty;
+        }
+        sec = entry + 1;
+    }
+    if (!key) return RUE_OK;
+
+    len = strlen(key);
+    uint32_t hash = indexHash(sec, key, len);
+    entry = indexFind(ix, sec, key, len, hash);
+    if (!value) {
+        if (entry != INI_NONE) ix->entries[entry].state = entGone;
+        return RUE_OK;
+    }
+    if (entry == INI_NONE) {
+        ret = indexAdd(ix, sec, key, len, hash, &entry);
+        if (ret != RUE_OK) return ret;
+    }
+    iniEntry* e = &ix->entries[entry];
+    rusize vlen = strlen(value);
+    if (e->value != INI_NONE && strlen(ix->chars + e->value) >= vlen) {
+        // reuse the old slot, value may well come from there
+        memmove(ix->chars + e->value, value, vlen + 1);
+    } else {
+        if (value >= ix->chars && value < ix->chars + ix->charLen) {
+            rusize off = value - ix->chars;
+            if (!indexReserve(ix, vlen + 1)) return RUE_OVERFLOW;
+            value = ix->chars + off;
+        }
+        e->value = indexChars(ix, value, vlen, NULL, 0);
+        if (e->value == INI_NONE) return RUE_OVERFLOW;
+    }
+    e->state = entDirty;
+    return RUE_OK;
+}
+
+typedef struct {
+    ruString out;
+    iniLine* lines;
+    uint32_t count;
+    uint32_t cap;
+} iniEmit;
+
+static rusize emitLen(iniEmit* em) {
+    return ruStringLen(em->out, NULL);
+}
+
+static void emitRecord(iniEmit* em, uint32_t entry, rusize start,
+                       rusize valStart, rusize valEnd) {
+    if (em->count == em->cap) {
+        em->cap *= 2;
+        em->lines = ruRealloc(em->lines, em->cap, iniLine);
+    }
+    iniLine* l = &em->lines[em->count++];
+    l->entry = entry;
+    l->start = (uint32_t)start;
+    l->end = (uint32_t)emitLen(em);
+    l->valStart = (uint32_t)valStart;
+    l->valEnd = (uint32_t)valEnd;
+}
+
+/* Makes sure that appended lines start on a line of their own */
+static void emitNewline(iniEmit* em) {
+    rusize len = emitLen(em);
+    if (len && ruStringGetCString(em->out)[len - 1] != '\n') {
+        ruStringAppendn(em->out, "\n", 1);
+    }
+}
+
+static void emitFresh(IniIndex* ix, iniEmit* em, uint32_t* next,
+                      uint32_t entry) {
+    for (; entry != INI_NONE; entry = next[entry]) {
+        iniEntry* e = &ix->entries[entry];
+        emitNewline(em);
+        rusize start = emitLen(em);
+        ruStringAppendf(em->out, "%s = ", ix->chars + e->key);
+        rusize valStart = emitLen(em);
+        ruStringAppend(em->out, ix->chars + e->value);
+        rusize valEnd = emitLen(em);
+        ruStringAppendn(em->out, "\n", 1);
+        emitRecord(em, entry, start, valStart, valEnd);
+    }
+}
+
+/* Replaces the value of a changed key keeping the rest of its line */
+static void emitPatched(IniIndex* ix, iniEmit* em, iniLine* l, iniEntry* e) {
+    perm_chars src = ix->src;
+    perm_chars value = ix->chars + e->value;
+    perm_chars sep = spanRtrim(src + l->start, src + l->valStart);
+    rusize start = emitLen(em);
+    ruStringAppendn(em->out, src + l->start, l->valStart - l->start);
+    if (sep == src + l->start || (sep[-1] != '=' && sep[-1] != ':')) {
+        // a bare name so far
+        ruStringAppendn(em->out, " = ", 3);
+    } else if (sep == src + l->valStart && l->valStart == l->valEnd &&
+               *value) {
+        // keep the value apart from an empty separator
+        ruStringAppendn(em->out, " ", 1);
+    }
+    rusize valStart = emitLen(em);
+    ruStringAppend(em->out, value);
+    rusize valEnd = emitLen(em);
+    if (l->valEnd < l->end && src[l->valEnd] == ';' && *value) {
+        // keep the inline comment a comment
+        ruStringAppendn(em->out, " ", 1);
+    }
+    ruStringAppendn(em->out, src + l->valEnd, l->end - l->valEnd);
+    emitRecord(em, l->entry, start, valStart, valEnd);
+}
+
+/* Writes the original content with all pending changes applied */
+static int32_t indexWrite(IniIndex* ix, trans_chars filename) {
+    uint32_t* tail = ruMalloc0(ix->count + 1, uint32_t);
+    uint32_t* head = ruMalloc0(ix->count + 1, uint32_t);
+    uint32_t* next = ruMalloc0(ix->count + 1, uint32_t);
+    for (uint32_t i = 0; i <= ix->count; i++) tail[i] = head[i] = INI_NONE;
+    for (uint32_t i = 0; i < ix->lineCount; i++) {
+        iniLine* l = &ix->lines[i];
+        uint32_t sec = ix->entries[l->entry].section;
+        tail[sec == INI_NONE ? l->entry + 1 : sec] = i;
+    }
+    // chains of new keys per section in entry order
+    for (uint32_t i = ix->count; i-- > 0;) {
+        iniEntry* e = &ix->entries[i];
+        if (e->section == INI_NONE || e->line != INI_NONE ||
+            e->state != entDirty) continue;
+        next[i] = head[e->section];
+        head[e->section] = i;
+    }
+
+    iniEmit em;
+    em.out = ruStringNewn("", ix->srcLen + 256);
+    em.cap = ix->lineCount + 64;
+    em.count = 0;
+    em.lines = ruMalloc0(em.cap, iniLine);
+
+    perm_chars src = ix->src;
+    uint32_t pos = 0;
+    bool globalDone = tail[0] != INI_NONE;
+    for (uint32_t i = 0; i < ix->lineCount; i++) {
+        iniLine* l = &ix->lines[i];
+        iniEntry* e = &ix->entries[l->entry];
+        bool header = e->section == INI_NONE;
+        ruStringAppendn(em.out, src + pos, l->start - pos);
+        pos = l->end;
+        if (header && !globalDone) {
+            // new global keys go in front of the first section
+            emitFresh(ix, &em, next, head[0]);
+            globalDone = true;
+        }
+        if (header || e->state == entClean) {
+            rusize start = emitLen(&em);
+            ruStringAppendn(em.out, src + l->start, l->end - l->start);
+            emitRecord(&em, l->entry, start, start + l->valStart - l->start,
+                       start + l->valEnd - l->start);
+        } else if (e->state == entDirty && e->line == i) {
+            emitPatched(ix, &em, l, e);
+        }
+        // the other lines of changed or removed keys are dropped
+        uint32_t sec = header ? l->entry + 1 : e->section;
+        if (tail[sec] == i) emitFresh(ix, &em, next, head[sec]);
+    }
+    ruStringAppendn(em.out, src + pos, ix->srcLen - pos);
+    if (!globalDone) emitFresh(ix, &em, next, head[0]);
+    for (uint32_t i = 0; i < ix->count; i++) {
+        iniEntry* e = &ix->entries[i];
+        if (e->section != INI_NONE || e->line != INI_NONE) continue;
+        // new section at the end
+        emitNewline(&em);
+        if (emitLen(&em)) ruStringAppendn(em.out, "\n", 1);
+        rusize start = emitLen(&em);
+        ruStringAppendf(em.out, "[%s]", ix->chars + e->key);
+        rusize close = emitLen(&em) - 1;
+        ruStringAppendn(em.out, "\n", 1);
+        emitRecord(&em, i, start, close, close);
+        emitFresh(ix, &em, next, head[i + 1]);
+    }
+    ruFree(tail);
+    ruFree(head);
+    ruFree(next);
+
+    rusize len = emitLen(&em);
+    int32_t ret = RUE_OK;
+    if (len > INI_MAX_CHARS) {
+        ruSetError("ini content is too large for the index");
+        ret = RUE_OVERFLOW;
+    }
+    if (ret == RUE_OK) {
+        ruWriteBatch wb = ruWriteBatchNew(NULL, &ret);
+        if (wb) {
+            ret = ruWriteBatchAdd(wb, filename, ruStringGetCString(em.out), len);
+            if (ret == RUE_OK) ret = ruWriteBatchCommit(wb);
+            wb = ruWriteBatchFree(wb);
+        }
+    }
+    if (ret != RUE_OK) {
+        // pending changes stay pending
+        em.out = ruStringFree(em.out, false);
+        ruFree(em.lines);
+        return ret;
+    }
+
+    ruFree(ix->src);
+    ix->src = ruStringGetCString(em.out);
+    ix->srcLen = (uint32_t)len;
+    em.out = ruStringFree(em.out, true);
+    ruFree(ix->lines);
+    ix->lines = em.lines;
+    ix->lineCount = em.count;
+    ix->lineCap = em.cap;
+    for (uint32_t i = 0; i < ix->count; i++) {
+        ix->entries[i].line = INI_NONE;
+        if (ix->entries[i].state == entDirty) ix->entries[i].state = entClean;
+    }
+    for (uint32_t i = ix->lineCount; i-- > 0;) {
+        ix->entries[ix->lines[i].entry].line = i;
+    }
+    return RUE_OK;
+}
+// </editor-fold>
+
 Ini* iniNew(void) {
     Ini* i = ruMalloc0(1, Ini);
     i->type = MagicIni;
@@ -286,6 +874,7 @@ RUAPI ruIni ruIniNew(void) {
 
 Ini* iniFree(Ini* i) {
     if (!i) return NULL;
+    i->idx = indexFree(i->idx);
     i->keys = ruMapFree(i->keys);
     i->sections = ruMapFree(i->sections);
     i->type = 0;
@@ -318,6 +907,11 @@ RUAPI int32_t ruIniWrite(ruIni iniOb, trans_chars filename) {
     int32_t ret;
     Ini* ini = IniGet(iniOb, &ret);
     if (!ini) return ret;
+    if (ini->idx && ini->idx->lines) {
+        if (!filename) return RUE_PARAMETER_NOT_SET;
+        return indexWrite(ini->idx, filename);
+    }
+    indexUnpack(ini);
     FILE* file = ruFOpen(filename, "w", &ret);
     if (!file) return ret;
     bool used = dumpMap(file, ini->keys);
@@ -353,12 +947,80 @@ RUAPI int32_t ruIniRead(trans_chars filename, ruIni* iniOb) {
     return code;
 }
 
+RUAPI int32_t ruIniReadIndexed(trans_chars filename, ruIni* iniOb) {
+    if (!filename || !iniOb) return RUE_PARAMETER_NOT_SET;
+    alloc_chars buf = NULL;
+    rusize len = 0;
+    int32_t code = ruFileGetContents(filename, &buf, &len);
+    if (code != RUE_OK) return code;
+    if (len >= INI_MAX_CHARS) {
+        ruFree(buf);
+        ruSetError("ini file '%s' is too large for the index", filename);
+        return RUE_OVERFLOW;
+    }
+    Ini* ini = ruMalloc0(1, Ini);
+    ini->type = MagicIni;
+    ini->idx = indexNew(len);
+    int errLineNo = 0;
+    code = indexParse(ini->idx, buf, len, &errLineNo);
+    ruFree(buf);
+    if (code == RUE_OK && errLineNo) {
+        ruSetError("Failed parsing ini file '%s' error on line %d",
+                   filename, errLineNo);
+        code = RUE_GENERAL;
+    }
+    if (code != RUE_OK) ini = iniFree(ini);
+    *iniOb = ini;
+    return code;
+}
+
+RUAPI int32_t ruIniEdit(trans_chars filename, ruIni* iniOb) {
+    if (!filename || !iniOb) return RUE_PARAMETER_NOT_SET;
+    alloc_chars buf = NULL;
+    rusize len = 0;
+    int32_t code = ruFileGetContents(filename, &buf, &len);
+    if (code == RUE_FILE_NOT_FOUND) {
+        // starting a new file
+        len = 0;
+        code = RUE_OK;
+    }
+    if (code != RUE_OK) return code;
+    if (len >= INI_MAX_CHARS) {
+        ruFree(buf);
+        ruSetError("ini file '%s' is too large for the index", filename);
+        return RUE_OVERFLOW;
+    }
+    Ini* ini = ruMalloc0(1, Ini);
+    ini->type = MagicIni;
+    ini->idx = indexNew(len);
+    ini->idx->src = buf ? buf : ruMalloc0(1, char);
+    ini->idx->srcLen = (uint32_t)len;
+    ini->idx->lineCap = 64;
+    ini->idx->lines = ruMalloc0(ini->idx->lineCap, iniLine);
+    int errLineNo = 0;
+    code = indexParse(ini->idx, ini->idx->src, len, &errLineNo);
+    if (code == RUE_OK && errLineNo) {
+        ruSetError("Failed parsing ini file '%s' error on line %d",
+                   filename, errLineNo);
+        code = RUE_GENERAL;
+    }
+    if (code != RUE_OK) ini = iniFree(ini);
+    *iniOb = ini;
+    return code;
+}
+
 RUAPI int32_t ruIniKeys(ruIni iniOb, trans_chars section, ruList* keys) {
     int32_t ret;
     Ini* ini = IniGet(iniOb, &ret);
     if (!ini) return ret;
     if (!keys) return RUE_PARAMETER_NOT_SET;
 
+    if (ini->idx) {
+        uint32_t sec = indexSection(ini->idx, section);
+        if (sec != INI_NONE) return indexList(ini, sec, keys);
+        *keys = ruListNew(ruTypeStrDup());
+        return RUE_OK;
+    }
     ruMap map = getIniMap(ini, section);
     return ruMapKeyList(map, keys);
 }
@@ -368,6 +1030,7 @@ RUAPI int32_t ruIniSections(ruIni iniOb, ruList* sections) {
     Ini* ini = IniGet(iniOb, &ret);
     if (!ini) return ret;
     if (!sections) return RUE_PARAMETER_NOT_SET;
+    if (ini->idx) return indexList(ini, INI_NONE, sections);
 
     ruMap map = ini->sections;
     return ruMapKeyList(map, sections);
@@ -381,12 +1044,20 @@ RUAPI perm_chars ruIniGetDef(ruIni iniOb, trans_chars section, trans_chars key,
     if (!ini) ruRetWithCode(code, ret, NULL);
     if (!key) ruRetWithCode(code, RUE_PARAMETER_NOT_SET, NULL);
 
+    const char* value = NULL;
+    if (ini->idx) {
+        ret = indexGet(ini, section, key, &value);
+        if (def && (!value || !*value)) {
+            value = def;
+            ret = RUE_OK;
+        }
+        ruRetWithCode(code, ret, value);
+    }
     ruMap map = ini->keys;
     if (section) {
         ret = ruMapGet(ini->sections, section, &map);
         if (ret != RUE_OK && !def) ruRetWithCode(code, ret, NULL);
     }
-    const char* value = NULL;
     ret = ruMapGet(map, key, &value);
     if (def) {
         if (!value || ruStrCmp(value, "") == 0) {
@@ -410,6 +1081,10 @@ RUAPI int32_t ruIniSet(ruIni iniOb, trans_chars section, trans_chars key, trans_
     if (!ini) return ret;
     if (!section && !key) return RUE_PARAMETER_NOT_SET;
 
+    if (ini->idx && ini->idx->lines) {
+        return indexSet(ini->idx, section, key, value);
+    }
+    indexUnpack(ini);
     ruMap map = getIniMap(ini, section);
     if (key) {
         if (value) {
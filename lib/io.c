@@ -25,6 +25,145 @@
 unsigned int ruIntChunk = (unsigned int)-1;
 int ruIoChunk = 0x7ffff000;
 
+// <editor-fold desc="stat cache">
+#define STAT_CACHE_DEFAULT_SIZE 4096
+
+typedef struct {
+    ruStat_t st;
+    int32_t code;
+    msec_t expires;
+} statEntry;
+
+static volatile msec_t statTtl_ = 0;
+static uint32_t statMax_ = STAT_CACHE_DEFAULT_SIZE;
+static ruOnce_t statOnce_ = RU_ONCE_INIT;
+static ruMutex statMux_ = NULL;
+static ruMap statCache_ = NULL;
+// bumped on every drop so a stat that raced with it is not cached
+static uint64_t statGen_ = 0;
+
+static void statMuxInit(void) {
+    statMux_ = ruMutexInit();
+}
+
+static int32_t statCall(trans_chars filepath, ruStat_t* dest) {
+    if (!stat(filepath, dest)) return RUE_OK;
+    if(errno == ENOENT) return RUE_FILE_NOT_FOUND;
+    return RUE_CANT_OPEN_FILE;
+}
+
+/*
+ * Our single stat entry point which is served from the cache when enabled.
+ * Unlike ruStat it does not set the error message.
+ */
+static int32_t statPath(trans_chars filepath, ruStat_t* dest) {
+    if (!statTtl_) return statCall(filepath, dest);
+    msec_t now = ruTimeMs();
+    statEntry* se = NULL;
+    ruMutexLock(statMux_);
+    if (statCache_ && RUE_OK == ruMapGet(statCache_, filepath, &se) &&
+        se->expires > now) {
+        int32_t ret = se->code;
+        *dest = se->st;
+        ruMutexUnlock(statMux_);
+        return ret;
+    }
+    uint64_t gen = statGen_;
+    ruMutexUnlock(statMux_);
+
+    int32_t ret = statCall(filepath, dest);
+    // only cache definite answers
+    if (ret == RUE_CANT_OPEN_FILE) return ret;
+    ruMutexLock(statMux_);
+    // skip the insert when an invalidation came in while we were statting
+    if (statCache_ && gen == statGen_) {
+        if (ruMapSize(statCache_, NULL) >= statMax_) ruMapRemoveAll(statCache_);
+        se = ruMalloc0(1, statEntry);
+        se->st = *dest;
+        se->code = ret;
+        se->expires = now + statTtl_;
+        ruMapPut(statCache_, filepath, se);
+    }
+    ruMutexUnlock(statMux_);
+    return ret;
+}
+
+/*
+ * Drops the cached result of filepath. Only when tree is set and the path may
+ * have been a folder, entries below it are searched for and dropped as well.
+ */
+static void statDrop(trans_chars filepath, bool tree) {
+    if (!statTtl_ || !filepath) return;
+    ruMutexLock(statMux_);
+    statGen_++;
+    if (!statCache_) {
+        ruMutexUnlock(statMux_);
+        return;
+    }
+    statEntry* se = NULL;
+    bool isFile = false;
+    // walkers hand out folders with a trailing slash
+    rusize len = strlen(filepath);
+    while (len > 1 && (filepath[len-1] == '/' || filepath[len-1] == RU_SLASH)) {
+        len--;
+    }
+    alloc_chars path = ruStrNDup(filepath, len);
+    if (RUE_OK == ruMapRemove(statCache_, path, &se)) {
+        isFile = se->code == RUE_OK && !S_ISDIR(se->st.st_mode);
+        ruFree(se);
+    }
+    if (len < strlen(filepath)) {
+        se = NULL;
+        ruMapRemove(statCache_, filepath, &se);
+        ruFree(se);
+    }
+    if (tree && !isFile) {
+        // potentially a folder so drop everything below it as well
+        ruList keys = NULL;
+        ruMapKeyList(statCache_, &keys);
+        ruIterator li = ruListIter(keys);
+        for (char* key = ruIterNext(li, char*); li;
+             key = ruIterNext(li, char*)) {
+            if (!strncmp(key, path, len) &&
+                (key[len] == '/' || key[len] == RU_SLASH)) {
+                se = NULL;
+                ruMapRemove(statCache_, key, &se);
+                ruFree(se);
+            }
+        }
+        ruListFree(keys);
+    }
+    ruFree(path);
+    ruMutexUnlock(statMux_);
+}
+
+RUAPI void ruStatCacheSet(msec_t ttlMs, uint32_t maxEntries) {
+    runOnce(&statOnce_, statMuxInit);
+    ruMutexLock(statMux_);
+    statGen_++;
+    statTtl_ = ttlMs > 0? ttlMs : 0;
+    statMax_ = maxEntries? maxEntries : STAT_CACHE_DEFAULT_SIZE;
+    if (statTtl_ && !statCache_) {
+        statCache_ = ruMapNew(ruTypeStrDup(), ruTypePtrFree());
+    } else if (!statTtl_ && statCache_) {
+        statCache_ = ruMapFree(statCache_);
+    }
+    ruMutexUnlock(statMux_);
+}
+
+RUAPI void ruStatCacheInvalidate(trans_chars filepath) {
+    if (!statTtl_) return;
+    if (filepath) {
+        statDrop(filepath, true);
+        return;
+    }
+    ruMutexLock(statMux_);
+    statGen_++;
+    if (statCache_) ruMapRemoveAll(statCache_);
+    ruMutexUnlock(statMux_);
+}
+// </editor-fold>
+
 #ifdef _WIN32
 #include <direct.h>
 #define open _open
@@ -141,6 +280,7 @@ RUAPI bool ruIsExecutable(const char* filename) {
 
 int ruOpen(const char *filepath, int flags, int mode, int32_t* code) {
     if (!filepath) ruRetWithCode(code, RUE_PARAMETER_NOT_SET, 0);
+    if (flags & (O_WRONLY | O_RDWR)) statDrop(filepath, false);
     wchar_t *wpath = getWPath(filepath);
     int fd = _wopen((const wchar_t*)wpath, flags, mode);
     ruFree (wpath);
@@ -237,6 +377,7 @@ RUAPI int32_t ruFileSetUtcTime(trans_chars filePath, sec_t date) {
         ret = errno2rfec(errno);
     }
     ruFree (wfilename);
+    statDrop(filePath, false);
     return ret;
 }
 
@@ -253,29 +394,33 @@ RUAPI bool ruIsSymlink(const char* filename) {
 
 RUAPI bool ruFileExists(const char* filename) {
     ruClearError();
+    if (!filename) return false;
     struct stat s;
-    if (stat(filename, &s) == 0) return true;
+    if (statPath(filename, &s) == RUE_OK) return true;
     return false;
 }
 
 RUAPI bool ruIsFile(const char* filename) {
     ruClearError();
+    if (!filename) return false;
     struct stat s;
-    if (stat(filename, &s) == 0 && S_ISREG (s.st_mode)) return true;
+    if (statPath(filename, &s) == RUE_OK && S_ISREG (s.st_mode)) return true;
     return false;
 }
 
 RUAPI bool ruIsDir(const char* filename) {
     ruClearError();
+    if (!filename) return false;
     struct stat s;
-    if (stat (filename, &s) == 0 && S_ISDIR (s.st_mode)) return true;
+    if (statPath(filename, &s) == RUE_OK && S_ISDIR (s.st_mode)) return true;
     return false;
 }
 
 RUAPI bool ruIsExecutable(const char* filename) {
     ruClearError();
+    if (!filename) return false;
     struct stat s;
-    if (stat(filename, &s) != 0) return false;
+    if (statPath(filename, &s) != RUE_OK) return false;
     if((s.st_mode & S_IXOTH) || (s.st_mode & S_IXUSR) || (s.st_mode & S_IXGRP)) {
         return true;
     }
@@ -297,6 +442,8 @@ RUAPI int ruOpen(const char *filepath, int flags, int mode, int32_t* code) {
         ruRetWithCode(code, RUE_INVALID_PARAMETER, 0);
     }
     if (!mode) ruRetWithCode(code, RUE_INVALID_PARAMETER, 0);
+    // may create or truncate the file
+    statDrop(filepath, false);
 #ifdef ITS_OSX
     alloc_chars nfdpath = ruStrToNfd(filepath);
     int fd = open(nfdpath, flags, mode);
@@ -371,6 +518,7 @@ RUAPI int32_t ruFileSetUtcTime(trans_chars filePath, sec_t date) {
     struct utimbuf tb;
     tb.actime = date;
     tb.modtime = date;
+    statDrop(filePath, false);
     if(utime(filePath, &tb)) {
         return errno2rfec(errno);
     }
@@ -437,8 +585,8 @@ int32_t errno2rfec(int err) {
 RUAPI int ruStat(const char*filepath, ruStat_t *dest) {
     ruClearError();
     if (!filepath || !dest) return RUE_PARAMETER_NOT_SET;
-    if (!stat(filepath, dest)) return RUE_OK;
-    if(errno == ENOENT) return RUE_FILE_NOT_FOUND;
+    int32_t ret = statPath(filepath, dest);
+    if (ret != RUE_CANT_OPEN_FILE) return ret;
     ruSetError("failed accessing '%s' errno: %d - %s",
                filepath, errno, strerror(errno));
     return RUE_CANT_OPEN_FILE;
@@ -479,59 +627,74 @@ RUAPI int ruOpenTmp(char *pathTemplate, int flags, int mode, int32_t *code) {
     ruRetWithCode(code, ret, fd);
 }
 
-RUAPI int32_t ruFileSetContents(trans_chars filename, trans_chars contents,
-                              rusize length) {
-    ruClearError();
-    if (!filename) return RUE_PARAMETER_NOT_SET;
-
+int32_t writeTmpFile(trans_chars filename, trans_chars contents,
+                     rusize length, alloc_chars* tmpName, int* fd) {
+    *fd = -1;
+    *tmpName = NULL;
     int32_t ret = RUE_OK;
     if (length == RU_SIZE_AUTO && contents) length = strlen (contents);
-    char *tmpName = ruDupPrintf("%s.^^^", filename);
+    char *tmpFile = ruDupPrintf("%s.^^^", filename);
     int wflags = O_CREAT | O_RDWR;
 #ifdef WIN32
     // let the caller worry about line endings
     wflags |= O_BINARY;
 #endif
-    int oh = ruOpenTmp(tmpName, wflags, 0666, &ret);
-    do {
-        if (ret != RUE_OK) {
-            ruSetError("could not open '%s' ec: %d", tmpName, ret);
-            break;
-        }
-        if (!contents) length = 0;
-        while (length > 0) {
-            rusize_s s = ruWrite(oh, contents, length);
+    int oh = ruOpenTmp(tmpFile, wflags, 0666, &ret);
+    if (ret != RUE_OK) {
+        ruSetError("could not open '%s' ec: %d", tmpFile, ret);
+        ruFree(tmpFile);
+        return ret;
+    }
+    if (!contents) length = 0;
+    while (length > 0) {
+        rusize_s s = ruWrite(oh, contents, length);
 
-            if (s < 0) {
-                int saved_errno = errno;
-                if (saved_errno == EINTR) continue;
+        if (s < 0) {
+            int saved_errno = errno;
+            if (saved_errno == EINTR) continue;
 
-                ruSetError("Failed to write file '%s' errno: %d - %s",
-                           tmpName, saved_errno, strerror(saved_errno));
-                ret = RUE_CANT_WRITE;
-                break;
-            }
-            contents += s;
-            length -= s;
+            ruSetError("Failed to write file '%s' errno: %d - %s",
+                       tmpFile, saved_errno, strerror(saved_errno));
+            ret = RUE_CANT_WRITE;
+            break;
         }
+        contents += s;
+        length -= s;
+    }
+    if (ret != RUE_OK) {
+        close(oh);
+        ruFileRemove(tmpFile);
+        ruFree(tmpFile);
+        return ret;
+    }
+    *fd = oh;
+    *tmpName = tmpFile;
+    return ret;
+}
 
-    } while(0);
+RUAPI int32_t ruFileSetContents(trans_chars filename, trans_chars contents,
+                              rusize length) {
+    ruClearError();
+    if (!filename) return RUE_PARAMETER_NOT_SET;
 
-    // clean up
-    if (oh >= 0) {
-        close(oh);
+    alloc_chars tmpName = NULL;
+    int oh = -1;
+    int32_t ret = writeTmpFile(filename, contents, length, &tmpName, &oh);
+    if (ret != RUE_OK) return ret;
+
+    close(oh);
 #ifdef ITS_OSX
-        alloc_chars nfdpath = ruStrToNfd(filename);
-        ret = ruFileRename(tmpName, nfdpath);
-        ruFree(nfdpath);
+    alloc_chars nfdpath = ruStrToNfd(filename);
+    ret = ruFileRename(tmpName, nfdpath);
+    ruFree(nfdpath);
 #else
-        ret = ruFileRename(tmpName, filename);
+    ret = ruFileRename(tmpName, filename);
 #endif
-        if (ret != RUE_OK) {
-            ruFileRemove(tmpName);
-        }
+    if (ret != RUE_OK) {
+        ruFileRemove(tmpName);
     }
 
+    statDrop(filename, false);
     ruFree(tmpName);
     return ret;
 }
@@ -542,14 +705,25 @@ RUAPI int ruFileGetContents(trans_chars filename, alloc_chars* contents, rusize*
     *contents = NULL;
     if (length) *length = 0;
 
+#ifdef _WIN32
     if (!ruFileExists(filename)) {
         return RUE_FILE_NOT_FOUND;
     }
 
     if (!ruIsFile(filename)) {
-        ruSetError("File '%s' is not a regular file to read");
+        ruSetError("File '%s' is not a regular file to read", filename);
         return RUE_INVALID_PARAMETER;
     }
+#else
+    // one stat answers both questions
+    struct stat st;
+    int32_t sc = statPath(filename, &st);
+    if (sc == RUE_FILE_NOT_FOUND) return sc;
+    if (sc == RUE_OK && !S_ISREG(st.st_mode)) {
+        ruSetError("File '%s' is not a regular file to read", filename);
+        return RUE_INVALID_PARAMETER;
+    }
+#endif
     int rflags = O_RDONLY;
 #ifdef WIN32
     // let the caller worry about line endings
@@ -660,6 +834,7 @@ RUAPI int ruFileCopy(trans_chars srcpath, trans_chars destpath) {
     if (ih) close(ih);
     if (oh >= 0) {
         close(oh);
+        // ruFileRename drops destpath from the stat cache
         ret = ruFileRename(tmpName, destpath);
         if (ret != RUE_OK) {
             ruFileRemove(tmpName);
@@ -721,11 +896,17 @@ static int fileRename(const char* oldName, const char* newName, bool force) {
 }
 
 RUAPI int ruFileRename(const char* oldName, const char* newName) {
-    return fileRename(oldName, newName, true);
+    int ret = fileRename(oldName, newName, true);
+    statDrop(oldName, true);
+    statDrop(newName, true);
+    return ret;
 }
 
 RUAPI int ruFileTryRename(const char* oldName, const char* newName) {
-    return fileRename(oldName, newName, false);
+    int ret = fileRename(oldName, newName, false);
+    statDrop(oldName, true);
+    statDrop(newName, true);
+    return ret;
 }
 
 RUAPI rusize_s ruWrite(int oh, trans_ptr contents, rusize length) {
@@ -764,30 +945,38 @@ static int32_t remover(trans_chars fullPath, bool isDir, ptr ctx) {
     return RUE_OK;
 }
 
-static int32_t folderWalk(trans_chars folder, uint32_t flags,
+/*
+ * Walks the folder held by pb, which must end with a slash when it is one.
+ * Entries are pushed onto pb and cut off again, so the only allocations are
+ * the ones needed to grow pb to the deepest path.
+ */
+static int32_t folderWalk(ruPathBuf* pb, uint32_t flags,
                           entryFilter filter, entryMgr actor, ptr ctx) {
     // sanity checks
-    if (!folder) return RUE_PARAMETER_NOT_SET;
+    trans_chars folder = ruPathBufStr(pb);
     int32_t ret = RUE_OK;
     if (!ruFileExists(folder)) return ret;
     bool isFolder = ruIsDir(folder);
+    rusize mark = ruPathBufLen(pb);
 
     alloc_chars mFolder = NULL;
     alloc_chars dirname = NULL;
     alloc_chars mBaseName = NULL;
-    perm_chars actorFolder = folder;
     perm_chars basename = NULL;
 #ifdef _WIN32
     if (flags & RU_WALK_UNIX_SLASHES) {
-        actorFolder = mFolder = ruStrReplace(folder, "\\", "/");
+        mFolder = ruStrReplace(folder, "\\", "/");
     }
+#define actorFolder (mFolder? mFolder : ruPathBufStr(pb))
+#else
+#define actorFolder ruPathBufStr(pb)
 #endif
     if (filter) {
         dirname = ruDirName(actorFolder);
 #ifdef ITS_OSX
         basename = mBaseName = ruStrToNfd(ruBaseName(folder));
 #else
-        basename = ruBaseName(folder);
+        basename = mBaseName = ruStrDup(ruBaseName(folder));
 #endif
     }
 
@@ -829,7 +1018,7 @@ static int32_t folderWalk(trans_chars folder, uint32_t flags,
             goto cleanup;
         }
 
-        char *path = NULL, *fileName = NULL;
+        char *fileName = NULL;
         // List all the files in the directory with some info about them.
         do {
             ruFree(fileName);
@@ -838,6 +1027,7 @@ static int32_t folderWalk(trans_chars folder, uint32_t flags,
                 ruStrCmp(".", fileName) == 0)
                 continue;
 
+            ruPathBufTruncate(pb, mark);
             if (filter) {
                 if (filter(actorFolder, fileName,
                            ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY,
@@ -845,19 +1035,18 @@ static int32_t folderWalk(trans_chars folder, uint32_t flags,
                     continue;
                 }
             }
-            ruFree(path);
-            if (ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
-                path = ruDupPrintf("%s%s%c", folder, fileName, RU_SLASH);
-            } else {
-                path = ruDupPrintf("%s%s", folder, fileName);
+            ret = ruPathBufAppend(pb, fileName, RU_SIZE_AUTO);
+            if (ret == RUE_OK && ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+                ret = ruPathBufAppend(pb, RU_SLASH_S, 1);
             }
+            if (ret != RUE_OK) break;
             if ((flags & RU_WALK_NO_RECURSE) ||
                 !(ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
                 if (actor) {
-                    perm_chars actorPath = path;
+                    perm_chars actorPath = ruPathBufStr(pb);
                     alloc_chars mPath = NULL;
                     if (flags & RU_WALK_UNIX_SLASHES) {
-                        actorPath = mPath = ruStrReplace(path, "\\", "/");
+                        actorPath = mPath = ruStrReplace(actorPath, "\\", "/");
                     }
                     ret = actor(actorPath,
                                 (ffd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0,
@@ -867,13 +1056,12 @@ static int32_t folderWalk(trans_chars folder, uint32_t flags,
                 }
                 continue;
             }
-            ret = folderWalk(path, flags &~RU_WALK_NO_SELF, filter, actor, ctx);
+            ret = folderWalk(pb, flags &~RU_WALK_NO_SELF, filter, actor, ctx);
             if (ret != RUE_OK) break;
 
         } while (FindNextFileW(hFind, &ffd) != 0);
 
         ruFree(fileName);
-        ruFree(path);
         FindClose(hFind);
 
 #else
@@ -890,7 +1078,6 @@ static int32_t folderWalk(trans_chars folder, uint32_t flags,
         }
 
         struct dirent *dir;
-        char* path = NULL;
         char* name = NULL;
 
         while ((dir = readdir(d)) != NULL) {
@@ -901,35 +1088,35 @@ static int32_t folderWalk(trans_chars folder, uint32_t flags,
 #else
             name = dir->d_name;
 #endif
-
+            // the previous entry may have grown the buffer
+            ruPathBufTruncate(pb, mark);
             if (filter) {
-                if (filter(folder, name,
+                if (filter(ruPathBufStr(pb), name,
                            dir->d_type == DT_DIR, ctx)) {
                     continue;
                 }
             }
-            ruFree(path);
-            if (dir->d_type == DT_DIR) {
-                path = ruDupPrintf("%s%s%c", folder, name, RU_SLASH);
-            } else {
-                path = ruDupPrintf("%s%s", folder, name);
+            ret = ruPathBufAppend(pb, name, RU_SIZE_AUTO);
+            if (ret == RUE_OK && dir->d_type == DT_DIR) {
+                ret = ruPathBufAppend(pb, RU_SLASH_S, 1);
             }
+            if (ret != RUE_OK) break;
             if ((flags & RU_WALK_NO_RECURSE) || dir->d_type != DT_DIR) {
                 if (actor) {
-                    ret = actor(path, dir->d_type == DT_DIR, ctx);
+                    ret = actor(ruPathBufStr(pb), dir->d_type == DT_DIR, ctx);
                     if (ret != RUE_OK) break;
                 }
                 continue;
             }
-            ret = folderWalk(path, flags &~RU_WALK_NO_SELF, filter, actor, ctx);
+            ret = folderWalk(pb, flags &~RU_WALK_NO_SELF, filter, actor, ctx);
             if (ret != RUE_OK) break;
         }
 #ifdef ITS_OSX
         ruFree(name);
 #endif
-        ruFree(path);
         closedir(d);
 #endif
+        ruPathBufTruncate(pb, mark);
     }
     if (!isFolder ||
         (flags & (RU_WALK_FOLDER_LAST|RU_WALK_NO_SELF)) == RU_WALK_FOLDER_LAST) {
@@ -939,8 +1126,10 @@ static int32_t folderWalk(trans_chars folder, uint32_t flags,
             }
         }
     }
+#undef actorFolder
 
 cleanup:
+    ruPathBufTruncate(pb, mark);
     ruFree(mFolder);
     ruFree(mBaseName);
     ruFree(dirname);
@@ -979,21 +1168,28 @@ alloc_chars fixSlashes(perm_chars* filePath) {
     return path;
 }
 
-RUAPI int32_t ruFilteredFolderWalk(trans_chars folder, uint32_t flags,
-                                   entryFilter filter, entryMgr actor, ptr ctx) {
-    if (!folder) return RUE_PARAMETER_NOT_SET;
+static int32_t walk(trans_chars folder, uint32_t flags,
+                    entryFilter filter, entryMgr actor, ptr ctx) {
     alloc_chars path = fixSlashes(&folder);
-    int32_t ret = folderWalk(folder, flags, filter, actor, ctx);
+    char buf[PATH_BUF_MIN];
+    ruPathBuf pb;
+    ruPathBufInit(&pb, buf, sizeof(buf), RU_PATH_NATIVE | RU_PATH_GROW);
+    int32_t ret = ruPathBufSet(&pb, folder);
+    if (ret == RUE_OK) ret = folderWalk(&pb, flags, filter, actor, ctx);
+    ruPathBufFree(&pb);
     ruFree(path);
     return ret;
 }
 
+RUAPI int32_t ruFilteredFolderWalk(trans_chars folder, uint32_t flags,
+                                   entryFilter filter, entryMgr actor, ptr ctx) {
+    if (!folder) return RUE_PARAMETER_NOT_SET;
+    return walk(folder, flags, filter, actor, ctx);
+}
+
 RUAPI int32_t ruFolderWalk(trans_chars folder, uint32_t flags, entryMgr actor, ptr ctx) {
     if (!folder) return RUE_PARAMETER_NOT_SET;
-    alloc_chars path = fixSlashes(&folder);
-    int32_t ret = folderWalk(folder, flags, NULL, actor, ctx);
-    ruFree(path);
-    return ret;
+    return walk(folder, flags, NULL, actor, ctx);
 }
 
 static int32_t cntLst(trans_chars fullPath, bool isFolder, ptr o) {
@@ -1004,10 +1200,7 @@ static int32_t cntLst(trans_chars fullPath, bool isFolder, ptr o) {
 
 RUAPI ru_int ruFolderEntries(trans_chars folder) {
     ru_int cnt = 0;
-    alloc_chars path = fixSlashes(&folder);
-    folderWalk(folder, RU_WALK_NO_RECURSE | RU_WALK_FOLDER_FIRST,
-               NULL, cntLst, &cnt);
-    ruFree(path);
+    walk(folder, RU_WALK_NO_RECURSE | RU_WALK_FOLDER_FIRST, NULL, cntLst, &cnt);
     return cnt;
 }
 
@@ -1026,8 +1219,7 @@ RUAPI int32_t ruFolderRemove(trans_chars folder) {
     return ruFolderWalk(folder, RU_WALK_FOLDER_LAST, remover, NULL);
 }
 
-RUAPI int ruFileRemove(const char* filename) {
-    ruDbgLogf("delete '%s'", filename);
+static int fileRemove(const char* filename) {
 #ifdef _WIN32
     wchar_t *wpath = getWPath(filename);
     int ret = 0, waDir = 0;
@@ -1065,6 +1257,16 @@ RUAPI int ruFileRemove(const char* filename) {
 #endif
 }
 
+RUAPI int ruFileRemove(const char* filename) {
+    ruDbgLogf("delete '%s'", filename);
+    // dropped before so the checks within see the current state, folders are
+    // only removed when empty, so there is nothing below to drop
+    statDrop(filename, false);
+    int ret = fileRemove(filename);
+    statDrop(filename, false);
+    return ret;
+}
+
 char* getDirNameTerminator(trans_chars filePath) {
     if (!filePath) return NULL;
     char *pfile = (char*)filePath + strlen(filePath)-1;
@@ -1102,15 +1304,18 @@ int32_t ruMkdirRecurse(char *pathname, int mode, bool deep) {
     *ptr = oldVal; // remove the terminator again
 #ifdef _WIN32
     wchar_t *wpath = getWPath(pathname);
+    statDrop(pathname, false);
     if (_wmkdir(wpath)) {
         if (!ruWIsDir(wpath)) ret = RUE_CANT_WRITE;
     }
     ruFree(wpath);
 #else
+    statDrop(pathname, false);
     if (mkdir(pathname, mode)) {
         if (!ruIsDir(pathname)) ret = RUE_CANT_WRITE;
     }
 #endif
+    statDrop(pathname, false);
     return ret;
 }
 
@@ -1321,3 +1526,190 @@ RUAPI alloc_chars ruPathMultiJoinNative(int parts, ...) {
             va_end (args);
     return out;
 }
+
+// <editor-fold desc="path builder">
+
+static char pathBufSlash(ruPathBuf* pb) {
+    return (pb->flags & RU_PATH_NATIVE)? RU_SLASH : '/';
+}
+
+static bool isSlash(char c) {
+#ifdef _WIN32
+    return c == '/' || c == '\\';
+#else
+    return c == '/';
+#endif
+}
+
+static int32_t pathBufRoom(ruPathBuf* pb, rusize add) {
+    rusize need = pb->len + add + 1;
+    if (need <= pb->cap) return RUE_OK;
+    if (!(pb->flags & RU_PATH_GROW)) return RUE_OVERFLOW;
+    rusize cap = pb->cap? pb->cap : PATH_BUF_MIN;
+    while (cap < need) cap *= 2;
+    if (pb->heaped) {
+        pb->buf = ruRealloc(pb->buf, cap, char);
+    } else {
+        char* buf = ruMalloc0(cap, char);
+        if (pb->len) memcpy(buf, pb->buf, pb->len);
+        pb->buf = buf;
+        pb->heaped = true;
+    }
+    pb->cap = cap;
+    return RUE_OK;
+}
+
+static void pathBufPut(ruPathBuf* pb, trans_chars str, rusize len) {
+    char slash = pathBufSlash(pb);
+    char* t = pb->buf + pb->len;
+    for (rusize i = 0; i < len; i++) {
+        t[i] = isSlash(str[i])? slash : str[i];
+    }
+    pb->len += len;
+    pb->buf[pb->len] = '\0';
+}
+
+RUAPI int32_t ruPathBufInit(ruPathBuf* pb, char* buf, rusize cap, uint32_t flags) {
+    if (!pb) return RUE_PARAMETER_NOT_SET;
+    memset(pb, 0, sizeof(ruPathBuf));
+    pb->flags = flags;
+    if (!buf || !cap) {
+        if (!(flags & RU_PATH_GROW)) return RUE_PARAMETER_NOT_SET;
+        return pathBufRoom(pb, 0);
+    }
+    pb->buf = buf;
+    pb->cap = cap;
+    pb->buf[0] = '\0';
+    return RUE_OK;
+}
+
+RUAPI void ruPathBufFree(ruPathBuf* pb) {
+    if (!pb) return;
+    if (pb->heaped) ruFree(pb->buf);
+    memset(pb, 0, sizeof(ruPathBuf));
+}
+
+RUAPI int32_t ruPathBufSet(ruPathBuf* pb, trans_chars path) {
+    if (!pb || !pb->buf || !path) return RUE_PARAMETER_NOT_SET;
+    rusize len = strlen(path);
+    rusize cur = pb->len;
+    pb->len = 0;
+    if (pathBufRoom(pb, len) != RUE_OK) {
+        pb->len = cur;
+        return RUE_OVERFLOW;
+    }
+    pathBufPut(pb, path, len);
+    return RUE_OK;
+}
+
+RUAPI int32_t ruPathBufAppend(ruPathBuf* pb, trans_chars str, rusize len) {
+    if (!pb || !pb->buf || !str) return RUE_PARAMETER_NOT_SET;
+    if (len == RU_SIZE_AUTO) len = strlen(str);
+    if (pathBufRoom(pb, len) != RUE_OK) return RUE_OVERFLOW;
+    pathBufPut(pb, str, len);
+    return RUE_OK;
+}
+
+RUAPI int32_t ruPathBufPush(ruPathBuf* pb, trans_chars name, rusize len) {
+    if (!pb || !pb->buf || !name) return RUE_PARAMETER_NOT_SET;
+    if (len == RU_SIZE_AUTO) len = strlen(name);
+    while (len && isSlash(*name)) {
+        name++;
+        len--;
+    }
+    bool sep = pb->len && !isSlash(pb->buf[pb->len-1]);
+    if (pathBufRoom(pb, len + sep) != RUE_OK) return RUE_OVERFLOW;
+    if (sep) {
+        pb->buf[pb->len++] = pathBufSlash(pb);
+    }
+    pathBufPut(pb, name, len);
+    return RUE_OK;
+}
+
+RUAPI int32_t ruPathBufPop(ruPathBuf* pb) {
+    if (!pb || !pb->buf) return RUE_PARAMETER_NOT_SET;
+    rusize len = pb->len;
+    // trailing slashes don't make up a component
+    while (len > 1 && isSlash(pb->buf[len-1])) len--;
+    if (!len || (len == 1 && isSlash(pb->buf[0]))) return RUE_FILE_NOT_FOUND;
+    while (len && !isSlash(pb->buf[len-1])) len--;
+    // drop the separator unless it's the root
+    while (len > 1 && isSlash(pb->buf[len-1])) len--;
+    pb->len = len;
+    pb->buf[len] = '\0';
+    return RUE_OK;
+}
+
+RUAPI int32_t ruPathBufTruncate(ruPathBuf* pb, rusize len) {
+    if (!pb || !pb->buf) return RUE_PARAMETER_NOT_SET;
+    if (len > pb->len) return RUE_INVALID_PARAMETER;
+    pb->len = len;
+    pb->buf[len] = '\0';
+    return RUE_OK;
+}
+
+RUAPI int32_t ruPathBufNormalize(ruPathBuf* pb) {
+    if (!pb || !pb->buf) return RUE_PARAMETER_NOT_SET;
+    if (!pb->len) return RUE_OK;
+    char slash = pathBufSlash(pb);
+    char* p = pb->buf;
+    char* end = p + pb->len;
+    bool trailing = isSlash(end[-1]);
+    // t is where the next component goes and root the part we never pop
+    char* t = p;
+    if (isSlash(*p)) {
+        *t++ = slash;
+#ifdef _WIN32
+        // keep UNC prefixes intact
+        if (pb->len > 1 && isSlash(p[1]) && (pb->len == 2 || !isSlash(p[2]))) {
+            *t++ = slash;
+        }
+#endif
+    }
+    char* root = t;
+    const char* s = root;
+    while (s < end) {
+        while (s < end && isSlash(*s)) s++;
+        if (s >= end) break;
+        const char* c = s;
+        while (s < end && !isSlash(*s)) s++;
+        rusize clen = s - c;
+        if (clen == 1 && c[0] == '.') continue;
+        if (clen == 2 && c[0] == '.' && c[1] == '.') {
+            // find the start of the previous component
+            char* prev = t;
+            while (prev > root && !isSlash(prev[-1])) prev--;
+            bool prevUp = t - prev == 2 && prev[0] == '.' && prev[1] == '.';
+            if (t > root && !prevUp) {
+                t = prev;
+                // along with its separator
+                if (t > root) t--;
+                continue;
+            }
+            // nothing above root to go to
+            if (root > p) continue;
+        }
+        if (t > root) *t++ = slash;
+        memmove(t, c, clen);
+        t += clen;
+    }
+    if (t == p) {
+        *t++ = '.';
+    } else if (trailing && t > root) {
+        *t++ = slash;
+    }
+    pb->len = t - p;
+    pb->buf[pb->len] = '\0';
+    return RUE_OK;
+}
+
+RUAPI perm_chars ruPathBufStr(ruPathBuf* pb) {
+    if (!pb) return NULL;
+    return pb->buf;
+}
+
+RUAPI rusize ruPathBufLen(ruPathBuf* pb) {
+    if (!pb) return 0;
+    return pb->len;
+}
+// </editor-fold>
@@ -23,10 +23,69 @@
  * with C" by Kyle Loudon, published by O'Reilly & Associates.
  */
 #include "lib.h"
+#include <math.h>
+#if (defined(__GNUC__) && defined(__x86_64__)) || \
+    (defined(_MSC_VER) && defined(_M_X64))
+#define JSON_SSE2
+#include <emmintrin.h>
+#endif
 
 //<editor-fold desc="internal">
 ruMakeTypeGetter(json, MagicJson)
 
+/*
+ * Objects parsed with RU_JSON_INDEX_KEYS get an open addressing table of
+ * key positions placed right behind their value array. The bucket count is
+ * kept in the otherwise unused number.flags bytes of the node, which yajl
+ * and the arena parser both leave zeroed for objects.
+ */
+#define JSON_INDEX_MIN 16
+
+static uint32_t indexBuckets(rusize keys) {
+    uint32_t buckets = 32;
+    while (buckets < keys * 2) buckets <<= 1;
+    return buckets;
+}
+
+static uint32_t keyHash(trans_chars key) {
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)key; *p; p++) {
+        h = (h ^ *p) * 16777619u;
+    }
+    return h;
+}
+
+static void indexPut(yajl_val node, uint32_t* table, uint32_t buckets) {
+    uint32_t mask = buckets - 1;
+    for (rusize i = 0; i < node->u.object.len; i++) {
+        trans_chars key = node->u.object.keys[i];
+        uint32_t b = keyHash(key) & mask;
+        bool dupe = false;
+        while (table[b] && !dupe) {
+            // like yajl_tree_get the first of duplicate keys wins
+            dupe = !strcmp(node->u.object.keys[table[b]-1], key);
+            b = (b + 1) & mask;
+        }
+        if (!dupe) table[b] = (uint32_t)i + 1;
+    }
+    node->u.number.flags = buckets;
+}
+
+static yajl_val indexFind(yajl_val node, trans_chars key, uint32_t hash) {
+    uint32_t mask = node->u.number.flags - 1;
+    uint32_t* table = (uint32_t*)(node->u.object.values + node->u.object.len);
+    for (uint32_t b = hash & mask; table[b]; b = (b + 1) & mask) {
+        uint32_t i = table[b] - 1;
+        if (!strcmp(node->u.object.keys[i], key)) return node->u.object.values[i];
+    }
+    return NULL;
+}
+
+static yajl_val indexGet(yajl_val node, trans_chars key) {
+    return indexFind(node, key, keyHash(key));
+}
+
 // differs between jsonGet and jsonSet
 static json* jsonGetWhat(ptr o, int32_t* code, bool setter) {
     int32_t ret = RUE_GENERAL;
@@ -149,8 +208,14 @@ static yajl_val jsonKey(ruJson rj, trans_chars key, yajl_type type, int32_t* sta
     yajl_val node = getYajlVal(rj, status);
     if (!node) return NULL;
     if (!key) ruRetWithCode(status, RUE_PARAMETER_NOT_SET, NULL);
-    const char * path[] = { key, (const char *) 0 };
-    yajl_val v = yajl_tree_get(node, path, type);
+    yajl_val v;
+    if (YAJL_IS_OBJECT(node) && node->u.number.flags) {
+        v = indexGet(node, key);
+        if (v && type != yajl_t_any && v->type != type) v = NULL;
+    } else {
+        const char * path[] = { key, (const char *) 0 };
+        v = yajl_tree_get(node, path, type);
+    }
     if (v) {
         ruVerbLogf("returning key '%s'", key);
         ruRetWithCode(status, RUE_OK, v);
@@ -246,12 +311,597 @@ ruJson nodeArray(yajl_val v, int32_t* status) {
 
 //</editor-fold>
 
+//<editor-fold desc="arena parser">
+/*
+ * The arena parser works in two passes. The first one indexes the structural
+ * characters and scalar boundaries of the input and counts the children of
+ * each container. With these numbers known up front the second pass builds
+ * the usual yajl_val tree out of a single allocation, so the getters work
+ * unchanged and the whole tree goes away with one free.
+ */
+#define JSON_MAX_DEPTH 1024
+
+typedef struct {
+    uint32_t pos;
+    // child count of containers, end offset of strings and scalars
+    uint32_t aux;
+} jsonTok;
+
+typedef struct {
+    uint32_t tok;
+    uint32_t commas;
+    bool items;
+} jsonOpen;
+
+typedef struct {
+    trans_chars in;
+    uint32_t len;
+    jsonTok* toks;
+    uint32_t cnt;
+    uint32_t cap;
+    uint32_t cur;
+    // sizing for the arena
+    rusize values;
+    rusize children;
+    rusize bytes;
+    bool index;
+    // bump pointers into the arena
+    yajl_val nodes;
+    ptr* slots;
+    char* chars;
+    perm_chars err;
+    uint32_t errPos;
+} jsonScan;
+
+static int32_t scanFail(jsonScan* js, uint32_t pos, perm_chars err) {
+    if (!js->err) {
+        js->err = err;
+        js->errPos = pos;
+    }
+    return RUE_INVALID_PARAMETER;
+}
+
+static void scanTok(jsonScan* js, uint32_t pos, uint32_t aux) {
+    if (js->cnt == js->cap) {
+        js->cap = js->cap? js->cap * 2 : 64;
+        js->toks = ruRealloc(js->toks, js->cap, jsonTok);
+    }
+    js->toks[js->cnt].pos = pos;
+    js->toks[js->cnt].aux = aux;
+    js->cnt++;
+}
+
+#define SWAR_ONES 0x0101010101010101ULL
+#define SWAR_HIGHS 0x8080808080808080ULL
+#define swarHasZero(v) (((v) - SWAR_ONES) & ~(v) & SWAR_HIGHS)
+
+#ifdef JSON_SSE2
+/*
+ * SSE2 is part of x86-64, so unlike the CRC32C instruction in hash.c it needs
+ * no runtime check. The string scans below look at 16 bytes at a time with
+ * it and at 8 with the SWAR macros above everywhere else.
+ */
+static inline uint32_t lowBit(uint32_t mask) {
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return (uint32_t)idx;
+#else
+    return (uint32_t)__builtin_ctz(mask);
+#endif
+}
+
+#define sseLoad(p) _mm_loadu_si128((const __m128i*)(p))
+// bit mask of the bytes of v that equal c
+#define sseEq(v, c) \
+    (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)))
+// bit mask of the bytes of v below 0x20
+#define sseCtrl(v) (uint32_t)_mm_movemask_epi8( \
+    _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(0x1f)), v))
+// bit mask of the bytes of v above 0x7f
+#define sseHigh(v) (uint32_t)_mm_movemask_epi8(v)
+#endif
+
+/*
+ * Returns the closing quote of the string starting at p or NULL. Quotes and
+ * backslashes are looked for in blocks of 16 or 8 bytes.
+ */
+static const char* strEnd(const char* p, const char* end) {
+    while (p < end) {
+#ifdef JSON_SSE2
+        if (p + 16 <= end) {
+            __m128i v = sseLoad(p);
+            uint32_t mask = sseEq(v, '"') | sseEq(v, '\\');
+            if (!mask) {
+                p += 16;
+                continue;
+            }
+            p += lowBit(mask);
+        }
+#else
+        if (p + 8 <= end) {
+            uint64_t w;
+            memcpy(&w, p, 8);
+            if (!swarHasZero(w ^ (SWAR_ONES * '"')) &&
+                !swarHasZero(w ^ (SWAR_ONES * '\\'))) {
+                p += 8;
+                continue;
+            }
+        }
+#endif
+        if (*p == '"') return p;
+        p += *p == '\\'? 2 : 1;
+    }
+    return NULL;
+}
+
+static bool isDelim(char c) {
+    switch (c) {
+        case ' ': case '\t': case '\n': case '\r': case '/':
+        case ',': case ':': case '[': case ']': case '{': case '}': case '"':
+            return true;
+        default:
+            return false;
+    }
+}
+
+static int32_t skipComment(jsonScan* js, uint32_t* pos) {
+    trans_chars s = js->in;
+    uint32_t i = *pos;
+    if (i + 1 < js->len && s[i+1] == '/') {
+        for (i += 2; i < js->len && s[i] != '\n'; i++);
+    } else if (i + 1 < js->len && s[i+1] == '*') {
+        for (i += 2; i + 1 < js->len && (s[i] != '*' || s[i+1] != '/'); i++);
+        if (i + 1 >= js->len) return scanFail(js, *pos, "unterminated comment");
+        i += 2;
+    } else {
+        return scanFail(js, i, "invalid character");
+    }
+    *pos = i;
+    return RUE_OK;
+}
+
+static int32_t scanIndex(jsonScan* js) {
+    trans_chars s = js->in;
+    uint32_t i = 0, depth = 0;
+    jsonOpen stack[JSON_MAX_DEPTH];
+    int32_t ret = RUE_OK;
+    js->cap = js->len / 4 + 16;
+    js->toks = ruMalloc0(js->cap, jsonTok);
+
+    while (i < js->len && ret == RUE_OK) {
+        char c = s[i];
+        switch (c) {
+            case ' ': case '\t': case '\n': case '\r':
+                i++;
+                break;
+            case '/':
+                ret = skipComment(js, &i);
+                break;
+            case '{': case '[':
+                if (depth == JSON_MAX_DEPTH) {
+                    ret = scanFail(js, i, "nesting too deep");
+                    break;
+                }
+                if (depth) stack[depth-1].items = true;
+                stack[depth].tok = js->cnt;
+                stack[depth].commas = 0;
+                stack[depth].items = false;
+                depth++;
+                js->values++;
+                scanTok(js, i++, 0);
+                break;
+            case '}': case ']':
+                if (!depth || s[js->toks[stack[depth-1].tok].pos] != (c == '}'? '{' : '[')) {
+                    ret = scanFail(js, i, "unbalanced brackets");
+                    break;
+                }
+                depth--;
+                uint32_t n = stack[depth].items? stack[depth].commas + 1 : 0;
+                js->toks[stack[depth].tok].aux = n;
+                // objects hold keys and values
+                js->children += c == '}'? 2 * (rusize)n : n;
+                if (c == '}' && js->index && n >= JSON_INDEX_MIN) {
+                    js->children += (indexBuckets(n) * sizeof(uint32_t) +
+                                     sizeof(ptr) - 1) / sizeof(ptr);
+                }
+                scanTok(js, i++, 0);
+                break;
+            case ',':
+                if (depth) stack[depth-1].commas++;
+                scanTok(js, i++, 0);
+                break;
+            case ':':
+                scanTok(js, i++, 0);
+                break;
+            case '"': {
+                const char* e = strEnd(s + i + 1, s + js->len);
+                if (!e) {
+                    ret = scanFail(js, i, "unterminated string");
+                    break;
+                }
+                uint32_t end = (uint32_t)(e - s);
+                if (depth) stack[depth-1].items = true;
+                js->values++;
+                // the closing quote leaves room for the terminator
+                js->bytes += end - i;
+                scanTok(js, i, end);
+                i = end + 1;
+                break;
+            }
+            default: {
+                uint32_t j = i;
+                while (j < js->len && !isDelim(s[j])) j++;
+                if (depth) stack[depth-1].items = true;
+                js->values++;
+                js->bytes += j - i + 1;
+                scanTok(js, i, j);
+                i = j;
+                break;
+            }
+        }
+    }
+    if (ret == RUE_OK && depth) {
+        ret = scanFail(js, js->len, "premature end of input");
+    }
+    if (ret == RUE_OK && !js->cnt) {
+        ret = scanFail(js, js->len, "no content");
+    }
+    return ret;
+}
+
+static int utf8Len(const unsigned char* p, const unsigned char* end) {
+    unsigned char c = *p;
+    int n;
+    uint32_t cp;
+    if (c < 0xc2) return 0;
+    if (c < 0xe0) {
+        n = 2;
+        cp = c & 0x1f;
+    } else if (c < 0xf0) {
+        n = 3;
+        cp = c & 0x0f;
+    } else if (c < 0xf5) {
+        n = 4;
+        cp = c & 0x07;
+    } else {
+        return 0;
+    }
+    if (p + n > end) return 0;
+    for (int i = 1; i < n; i++) {
+        if ((p[i] & 0xc0) != 0x80) return 0;
+        cp = (cp << 6) | (p[i] & 0x3f);
+    }
+    // overlong, surrogate or out of range
+    if ((n == 3 && cp < 0x800) || (n == 4 && cp < 0x10000) ||
+        (cp >= 0xd800 && cp <= 0xdfff) || cp > 0x10ffff) return 0;
+    return n;
+}
+
+static int hexQuad(const char* p) {
+    int val = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = p[i];
+        val <<= 4;
+        if (c >= '0' && c <= '9') val |= c - '0';
+        else if (c >= 'a' && c <= 'f') val |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') val |= c - 'A' + 10;
+        else return -1;
+    }
+    return val;
+}
+
+static char* putUtf8(char* t, uint32_t cp) {
+    if (cp < 0x80) {
+        *t++ = (char)cp;
+    } else if (cp < 0x800) {
+        *t++ = (char)(0xc0 | (cp >> 6));
+        *t++ = (char)(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+        *t++ = (char)(0xe0 | (cp >> 12));
+        *t++ = (char)(0x80 | ((cp >> 6) & 0x3f));
+        *t++ = (char)(0x80 | (cp & 0x3f));
+    } else {
+        *t++ = (char)(0xf0 | (cp >> 18));
+        *t++ = (char)(0x80 | ((cp >> 12) & 0x3f));
+        *t++ = (char)(0x80 | ((cp >> 6) & 0x3f));
+        *t++ = (char)(0x80 | (cp & 0x3f));
+    }
+    return t;
+}
+
+static char* scanString(jsonScan* js, jsonTok* tok) {
+    const unsigned char* p = (const unsigned char*)js->in + tok->pos + 1;
+    const unsigned char* end = (const unsigned char*)js->in + tok->aux;
+    char* out = js->chars;
+    char* t = out;
+    while (p < end) {
+        // copy runs of plain ASCII in one go
+        const unsigned char* run = p;
+#ifdef JSON_SSE2
+        while (p + 16 <= end) {
+            __m128i v = sseLoad(p);
+            uint32_t mask = sseHigh(v) | sseCtrl(v) | sseEq(v, '\\');
+            if (mask) {
+                p += lowBit(mask);
+                break;
+            }
+            p += 16;
+        }
+#endif
+        while (p < end && *p >= 0x20 && *p < 0x80 && *p != '\\') p++;
+        if (p > run) {
+            memcpy(t, run, p - run);
+            t += p - run;
+            if (p == end) break;
+        }
+        if (*p >= 0x80) {
+            int n = utf8Len(p, end);
+            if (!n) {
+                scanFail(js, (uint32_t)(p - (const unsigned char*)js->in),
+                         "invalid UTF-8 in string");
+                return NULL;
+            }
+            memcpy(t, p, n);
+            t += n;
+            p += n;
+            continue;
+        }
+        if (*p < 0x20) {
+            scanFail(js, (uint32_t)(p - (const unsigned char*)js->in),
+                     "invalid character in string");
+            return NULL;
+        }
+        // an escape, which strEnd made sure isn't the last character
+        p++;
+        switch (*p) {
+            case '"': *t++ = '"'; break;
+            case '\\': *t++ = '\\'; break;
+            case '/': *t++ = '/'; break;
+            case 'b': *t++ = '\b'; break;
+            case 'f': *t++ = '\f'; break;
+            case 'n': *t++ = '\n'; break;
+            case 'r': *t++ = '\r'; break;
+            case 't': *t++ = '\t'; break;
+            case 'u': {
+                int cp = end - p > 4? hexQuad((const char*)p + 1) : -1;
+                if (cp < 0) {
+                    scanFail(js, (uint32_t)(p - (const unsigned char*)js->in),
+                             "invalid unicode escape");
+                    return NULL;
+                }
+                p += 4;
+                if (cp >= 0xd800 && cp <= 0xdbff && end - p > 6 &&
+                    p[1] == '\\' && p[2] == 'u') {
+                    int lo = hexQuad((const char*)p + 3);
+                    if (lo >= 0xdc00 && lo <= 0xdfff) {
+                        cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+                        p += 6;
+                    }
+                }
+                // like yajl, lone surrogates become a question mark
+                if (cp >= 0xd800 && cp <= 0xdfff) cp = '?';
+                t = putUtf8(t, (uint32_t)cp);
+                break;
+            }
+            default:
+                scanFail(js, (uint32_t)(p - (const unsigned char*)js->in),
+                         "invalid escape");
+                return NULL;
+        }
+        p++;
+    }
+    *t++ = '\0';
+    js->chars = t;
+    return out;
+}
+
+static bool isNumber(const char* p, const char* end) {
+    if (p < end && *p == '-') p++;
+    if (p == end) return false;
+    if (*p == '0') {
+        p++;
+    } else if (*p >= '1' && *p <= '9') {
+        while (p < end && *p >= '0' && *p <= '9') p++;
+    } else {
+        return false;
+    }
+    if (p < end && *p == '.') {
+        p++;
+        if (p == end || *p < '0' || *p > '9') return false;
+        while (p < end && *p >= '0' && *p <= '9') p++;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        if (p < end && (*p == '+' || *p == '-')) p++;
+        if (p == end || *p < '0' || *p > '9') return false;
+        while (p < end && *p >= '0' && *p <= '9') p++;
+    }
+    return p == end;
+}
+
+// integers the same way yajl does it, including the clamping
+static bool scanInt(const char* p, rusize len, long long* out) {
+    bool neg = *p == '-';
+    const char* d = p + neg;
+    long long i = 0;
+    for (; d < p + len; d++) {
+        if (*d < '0' || *d > '9' || i > (LLONG_MAX - (*d - '0')) / 10) {
+            *out = neg? LLONG_MIN : LLONG_MAX;
+            return false;
+        }
+        i = i * 10 + (*d - '0');
+    }
+    *out = neg? -i : i;
+    return true;
+}
+
+static bool scanScalar(jsonScan* js, yajl_val v, jsonTok* tok) {
+    const char* p = js->in + tok->pos;
+    rusize len = tok->aux - tok->pos;
+    if (len == 4 && !memcmp(p, "true", 4)) {
+        v->type = yajl_t_true;
+        return true;
+    }
+    if (len == 5 && !memcmp(p, "false", 5)) {
+        v->type = yajl_t_false;
+        return true;
+    }
+    if (len == 4 && !memcmp(p, "null", 4)) {
+        v->type = yajl_t_null;
+        return true;
+    }
+    if (!isNumber(p, p + len)) {
+        scanFail(js, tok->pos, "invalid literal");
+        return false;
+    }
+    v->type = yajl_t_number;
+    v->u.number.r = js->chars;
+    memcpy(js->chars, p, len);
+    js->chars[len] = '\0';
+    js->chars += len + 1;
+
+    if (scanInt(p, len, &v->u.number.i)) {
+        v->u.number.flags |= YAJL_NUMBER_INT_VALID;
+    }
+    char* endptr = NULL;
+    errno = 0;
+    v->u.number.d = strtod(v->u.number.r, &endptr);
+    if (!errno && endptr && !*endptr) {
+        v->u.number.flags |= YAJL_NUMBER_DOUBLE_VALID;
+    }
+    return true;
+}
+
+static yajl_val scanValue(jsonScan* js);
+
+static jsonTok* scanExpect(jsonScan* js, char c, perm_chars err) {
+    if (js->cur >= js->cnt) {
+        scanFail(js, js->len, "premature end of input");
+        return NULL;
+    }
+    jsonTok* tok = &js->toks[js->cur];
+    if (js->in[tok->pos] != c) {
+        scanFail(js, tok->pos, err);
+        return NULL;
+    }
+    js->cur++;
+    return tok;
+}
+
+static yajl_val scanObject(jsonScan* js, yajl_val v, uint32_t n) {
+    v->type = yajl_t_object;
+    v->u.object.keys = (const char**)js->slots;
+    js->slots += n;
+    v->u.object.values = (yajl_val*)js->slots;
+    js->slots += n;
+    uint32_t* table = NULL;
+    uint32_t buckets = 0;
+    if (js->index && n >= JSON_INDEX_MIN) {
+        buckets = indexBuckets(n);
+        table = (uint32_t*)js->slots;
+        js->slots += (buckets * sizeof(uint32_t) + sizeof(ptr) - 1) / sizeof(ptr);
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        jsonTok* tok = scanExpect(js, '"', "object key expected");
+        if (!tok) return NULL;
+        char* key = scanString(js, tok);
+        if (!key) return NULL;
+        if (!scanExpect(js, ':', "colon expected")) return NULL;
+        yajl_val child = scanValue(js);
+        if (!child) return NULL;
+        v->u.object.keys[i] = key;
+        v->u.object.values[i] = child;
+        v->u.object.len++;
+        if (i + 1 < n && !scanExpect(js, ',', "comma expected")) return NULL;
+    }
+    if (!scanExpect(js, '}', "end of object expected")) return NULL;
+    if (table) indexPut(v, table, buckets);
+    return v;
+}
+
+static yajl_val scanArray(jsonScan* js, yajl_val v, uint32_t n) {
+    v->type = yajl_t_array;
+    v->u.array.values = (yajl_val*)js->slots;
+    js->slots += n;
+    for (uint32_t i = 0; i < n; i++) {
+        yajl_val child = scanValue(js);
+        if (!child) return NULL;
+        v->u.array.values[i] = child;
+        v->u.array.len++;
+        if (i + 1 < n && !scanExpect(js, ',', "comma expected")) return NULL;
+    }
+    if (!scanExpect(js, ']', "end of array expected")) return NULL;
+    return v;
+}
+
+static yajl_val scanValue(jsonScan* js) {
+    if (js->cur >= js->cnt) {
+        scanFail(js, js->len, "premature end of input");
+        return NULL;
+    }
+    jsonTok* tok = &js->toks[js->cur++];
+    yajl_val v = js->nodes++;
+    switch (js->in[tok->pos]) {
+        case '{':
+            return scanObject(js, v, tok->aux);
+        case '[':
+            return scanArray(js, v, tok->aux);
+        case '"':
+            v->type = yajl_t_string;
+            v->u.string = scanString(js, tok);
+            return v->u.string? v : NULL;
+        case '}': case ']': case ',': case ':':
+            scanFail(js, tok->pos, "value expected");
+            return NULL;
+        default:
+            return scanScalar(js, v, tok)? v : NULL;
+    }
+}
+
+static int32_t arenaParse(json* j, trans_chars input, rusize len, uint32_t flags) {
+    jsonScan js;
+    memset(&js, 0, sizeof(jsonScan));
+    js.in = input;
+    js.len = (uint32_t)len;
+    js.index = (flags & RU_JSON_INDEX_KEYS) != 0;
+    int32_t ret = scanIndex(&js);
+    if (ret == RUE_OK) {
+        rusize nodes = js.values * sizeof(struct yajl_val_s);
+        rusize slots = js.children * sizeof(ptr);
+        char* arena = ruMalloc0(nodes + slots + js.bytes, char);
+        js.nodes = (yajl_val)arena;
+        js.slots = (ptr*)(arena + nodes);
+        js.chars = arena + nodes + slots;
+        j->arena = arena;
+        j->node = scanValue(&js);
+        if (j->node && js.cur < js.cnt) {
+            scanFail(&js, js.toks[js.cur].pos, "trailing garbage");
+        }
+        if (js.err) {
+            j->node = NULL;
+            ruFree(j->arena);
+            ret = RUE_INVALID_PARAMETER;
+        }
+    }
+    if (ret != RUE_OK) {
+        ruSetError("parse_error: '%s' at offset %u", js.err, js.errPos);
+    }
+    ruFree(js.toks);
+    return ret;
+}
+//</editor-fold>
+
 //<editor-fold desc="common">
 RUAPI ruJson ruJsonFree(ruJson rj) {
     if (!rj) return NULL;
     json* j = jsonGet(rj, NULL);
     if (j->g) yajl_gen_free(j->g);
-    if (j->node) yajl_tree_free(j->node);
+    if (j->arena) {
+        ruFree(j->arena);
+    } else if (j->node) {
+        yajl_tree_free(j->node);
+    }
     ruFree(j->indent);
     ruFree(j);
     return NULL;
@@ -620,6 +1270,25 @@ RUAPI ruJson ruJsonParse(trans_chars jsonStr, int32_t* status) {
     ruRetWithCode(status, RUE_OK, (ruJson)j);
 }
 
+RUAPI ruJson ruJsonParseLen(trans_chars jsonStr, rusize len, uint32_t flags,
+                            int32_t* status) {
+    ruClearError();
+    if (!jsonStr) ruRetWithCode(status, RUE_PARAMETER_NOT_SET, NULL);
+    if (len == RU_SIZE_AUTO) len = strlen(jsonStr);
+    if (len > UINT32_MAX) {
+        ruSetError("content of %lu bytes exceeds the 4GB limit", (unsigned long)len);
+        ruRetWithCode(status, RUE_OVERFLOW, NULL);
+    }
+    json* j = ruMalloc0(1, json);
+    j->type = MagicJson;
+    int32_t ret = arenaParse(j, jsonStr, len, flags);
+    if (ret != RUE_OK) {
+        ruFree(j);
+        ruRetWithCode(status, ret, NULL);
+    }
+    ruRetWithCode(status, RUE_OK, (ruJson)j);
+}
+
 RUAPI rusize ruJsonArrayLen(ruJson rj, int32_t* status) {
     yajl_val v = getYajlVal(rj, status);
     if (!v) return 0;
@@ -785,3 +1454,1620 @@ RUAPI ruJson ruJsonIdxArray(ruJson rj, rusize index, int32_t* status) {
 
 //</editor-fold>
 
+
+//<editor-fold desc="stream parser">
+/*
+ * The stream parser pulls its input through a read callback into a buffer
+ * that only holds the token, or for ruJsonStreamValue the value, currently
+ * being worked on. The buffer just grows when that doesn't fit, so memory
+ * use is bound by the largest of these and not by the document.
+ */
+#define JSON_STREAM_CHUNK 0x10000
+
+enum {
+    expValue,
+    expFirstValue,  // a value or the end of the array
+    expFirstKey,    // a key or the end of the object
+    expKey,
+    expColon,
+    expNext,        // a comma or the end of the container
+    expDone
+};
+
+enum {
+    capPlain,
+    capString,
+    capEscape,
+    capSlash,
+    capLine,
+    capBlock,
+    capStar
+};
+
+typedef struct {
+    ru_uint type;
+    rcReadFn read;
+    perm_ptr readCtx;
+    uint32_t flags;
+    char* buf;
+    rusize cap;
+    rusize pos;
+    rusize end;
+    // input bytes already dropped from the front of buf
+    uint64_t offset;
+    bool eof;
+    // decoded content of the current event
+    char* text;
+    rusize textCap;
+    rusize textLen;
+    char stack[JSON_MAX_DEPTH];
+    uint32_t depth;
+    int expect;
+    int32_t event;
+    // errors are sticky, the stream can't recover from them
+    int32_t err;
+} jsonStream;
+
+ruMakeTypeGetter(jsonStream, MagicJsonStream)
+
+static int32_t streamFail(jsonStream* js, uint64_t pos, perm_chars err) {
+    js->err = RUE_INVALID_PARAMETER;
+    ruSetError("parse_error: '%s' at offset %llu", err, (unsigned long long)pos);
+    return js->err;
+}
+
+/*
+ * Reads more input, retaining the buffer content from keep onwards.
+ * Returns the number of bytes added, 0 at the end of input or -1 on error.
+ */
+static rusize_s streamFill(jsonStream* js, rusize keep) {
+    if (js->err) return -1;
+    if (js->eof) return 0;
+    if (keep) {
+        memmove(js->buf, js->buf + keep, js->end - keep);
+        js->pos -= keep;
+        js->end -= keep;
+        js->offset += keep;
+    }
+    if (js->end == js->cap) {
+        js->cap *= 2;
+        js->buf = ruRealloc(js->buf, js->cap, char);
+    }
+    rusize_s got = js->read(js->readCtx, js->buf + js->end, js->cap - js->end);
+    if (got < 0) {
+        js->err = RUE_GENERAL;
+        ruSetError("failed reading JSON input at offset %llu",
+                   (unsigned long long)(js->offset + js->end));
+        return -1;
+    }
+    if (!got) js->eof = true;
+    js->end += got;
+    return got;
+}
+
+static int streamPeek(jsonStream* js) {
+    while (js->pos == js->end) {
+        if (streamFill(js, js->pos) <= 0) return -1;
+    }
+    return (unsigned char)js->buf[js->pos];
+}
+
+/*
+ * Skips white space and comments and returns the next character, or -1 at
+ * the end of input or on error, which is then set in js->err.
+ */
+static int streamSkip(jsonStream* js) {
+    for (;;) {
+        int c = streamPeek(js);
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            js->pos++;
+            continue;
+        }
+        if (c != '/') return c;
+        js->pos++;
+        c = streamPeek(js);
+        if (c == '/') {
+            while ((c = streamPeek(js)) >= 0 && c != '\n') js->pos++;
+        } else if (c == '*') {
+            bool star = false;
+            js->pos++;
+            c = 0;
+            while (!star || c != '/') {
+                star = c == '*';
+                if ((c = streamPeek(js)) < 0) {
+                    if (!js->err) {
+                        streamFail(js, js->offset + js->pos, "unterminated comment");
+                    }
+                    return -1;
+                }
+                js->pos++;
+            }
+        } else {
+            if (!js->err) {
+                streamFail(js, js->offset + js->pos - 1, "invalid character");
+            }
+            return -1;
+        }
+    }
+}
+
+static char* streamText(jsonStream* js, rusize len) {
+    if (len >= js->textCap) {
+        js->textCap = len + 64;
+        ruFree(js->text);
+        js->text = ruMalloc0(js->textCap, char);
+    }
+    return js->text;
+}
+
+static int32_t streamString(jsonStream* js) {
+    // the opening quote stays at pos until the string is complete
+    rusize rel = 1;
+    const char* q;
+    while (!(q = strEnd(js->buf + js->pos + rel, js->buf + js->end))) {
+        // resume in front of trailing backslashes, they may start an escape
+        rel = js->end - js->pos;
+        while (rel > 1 && js->buf[js->pos + rel - 1] == '\\') rel--;
+        rusize_s got = streamFill(js, js->pos);
+        if (got < 0) return js->err;
+        if (!got) {
+            return streamFail(js, js->offset + js->pos, "unterminated string");
+        }
+    }
+    rusize len = q - (js->buf + js->pos);
+    if (len > UINT32_MAX) {
+        return streamFail(js, js->offset + js->pos, "string exceeds 4GB");
+    }
+    jsonScan sc;
+    memset(&sc, 0, sizeof(jsonScan));
+    sc.in = js->buf + js->pos;
+    sc.chars = streamText(js, len);
+    jsonTok tok = {0, (uint32_t)len};
+    if (!scanString(&sc, &tok)) {
+        return streamFail(js, js->offset + js->pos + sc.errPos, sc.err);
+    }
+    js->textLen = sc.chars - js->text - 1;
+    js->pos += len + 1;
+    return RUE_OK;
+}
+
+static int32_t streamScalar(jsonStream* js) {
+    rusize rel = 0;
+    for (;;) {
+        while (js->pos + rel < js->end && !isDelim(js->buf[js->pos + rel])) rel++;
+        if (js->pos + rel < js->end) break;
+        rusize_s got = streamFill(js, js->pos);
+        if (got < 0) return js->err;
+        if (!got) break;
+    }
+    const char* p = js->buf + js->pos;
+    if (!rel) return streamFail(js, js->offset + js->pos, "value expected");
+    if (rel == 4 && !memcmp(p, "true", 4)) {
+        js->event = RU_JSON_EV_TRUE;
+    } else if (rel == 5 && !memcmp(p, "false", 5)) {
+        js->event = RU_JSON_EV_FALSE;
+    } else if (rel == 4 && !memcmp(p, "null", 4)) {
+        js->event = RU_JSON_EV_NULL;
+    } else if (isNumber(p, p + rel)) {
+        js->event = RU_JSON_EV_NUMBER;
+    } else {
+        return streamFail(js, js->offset + js->pos, "invalid literal");
+    }
+    memcpy(streamText(js, rel), p, rel);
+    js->text[rel] = '\0';
+    js->textLen = rel;
+    js->pos += rel;
+    return RUE_OK;
+}
+
+static void streamValueDone(jsonStream* js) {
+    js->expect = js->depth? expNext : expDone;
+}
+
+static int32_t streamValue(jsonStream* js, int c) {
+    int32_t ret;
+    if (c == '{' || c == '[') {
+        if (js->depth == JSON_MAX_DEPTH) {
+            return streamFail(js, js->offset + js->pos, "nesting too deep");
+        }
+        js->stack[js->depth++] = (char)c;
+        js->pos++;
+        if (c == '{') {
+            js->event = RU_JSON_EV_MAP_START;
+            js->expect = expFirstKey;
+        } else {
+            js->event = RU_JSON_EV_ARRAY_START;
+            js->expect = expFirstValue;
+        }
+        return RUE_OK;
+    }
+    if (c == '"') {
+        ret = streamString(js);
+        js->event = RU_JSON_EV_STRING;
+    } else {
+        ret = streamScalar(js);
+    }
+    if (ret == RUE_OK) streamValueDone(js);
+    return ret;
+}
+
+static int32_t streamClose(jsonStream* js, int c) {
+    bool map = js->stack[js->depth-1] == '{';
+    if (c != (map? '}' : ']')) {
+        return streamFail(js, js->offset + js->pos, map?
+                "end of object expected" : "end of array expected");
+    }
+    js->depth--;
+    js->pos++;
+    js->event = map? RU_JSON_EV_MAP_END : RU_JSON_EV_ARRAY_END;
+    streamValueDone(js);
+    return RUE_OK;
+}
+
+/*
+ * Finds the end of the value starting at pos, reading as much as needed.
+ * Only strings, comments and brackets are tracked, the arena parser takes
+ * care of everything else.
+ */
+static int32_t streamCapture(jsonStream* js, int c, rusize* len) {
+    bool scalar = c != '{' && c != '[' && c != '"';
+    int state = capPlain;
+    uint32_t depth = 0;
+    rusize rel = 0;
+    for (;;) {
+        if (js->pos + rel == js->end) {
+            rusize_s got = streamFill(js, js->pos);
+            if (got < 0) return js->err;
+            if (!got) {
+                if (scalar) break;
+                return streamFail(js, js->offset + js->end, "premature end of input");
+            }
+            continue;
+        }
+        char ch = js->buf[js->pos + rel];
+        if (scalar) {
+            if (isDelim(ch)) break;
+            rel++;
+            continue;
+        }
+        rel++;
+        bool done = false;
+        switch (state) {
+            case capString:
+                if (ch == '\\') {
+                    state = capEscape;
+                } else if (ch == '"') {
+                    state = capPlain;
+                    done = !depth;
+                }
+                break;
+            case capEscape:
+                state = capString;
+                break;
+            case capSlash:
+                state = ch == '/'? capLine : ch == '*'? capBlock : capPlain;
+                break;
+            case capLine:
+                if (ch == '\n') state = capPlain;
+                break;
+            case capBlock:
+                if (ch == '*') state = capStar;
+                break;
+            case capStar:
+                state = ch == '/'? capPlain : ch == '*'? capStar : capBlock;
+                break;
+            default:
+                if (ch == '"') {
+                    state = capString;
+                } else if (ch == '/') {
+                    state = capSlash;
+                } else if (ch == '{' || ch == '[') {
+                    depth++;
+                } else if (ch == '}' || ch == ']') {
+                    done = !--depth;
+                }
+        }
+        if (done) break;
+    }
+    if (rel > UINT32_MAX) {
+        return streamFail(js, js->offset + js->pos, "value exceeds 4GB");
+    }
+    *len = rel;
+    return RUE_OK;
+}
+
+RUAPI ruJsonStream ruJsonStreamNew(rcReadFn reader, perm_ptr ctx, uint32_t flags,
+                                   int32_t* code) {
+    ruClearError();
+    if (!reader) ruRetWithCode(code, RUE_PARAMETER_NOT_SET, NULL);
+    jsonStream* js = ruMalloc0(1, jsonStream);
+    js->type = MagicJsonStream;
+    js->read = reader;
+    js->readCtx = ctx;
+    js->flags = flags;
+    js->cap = JSON_STREAM_CHUNK;
+    js->buf = ruMalloc0(js->cap, char);
+    ruRetWithCode(code, RUE_OK, (ruJsonStream)js);
+}
+
+RUAPI ruJsonStream ruJsonStreamFree(ruJsonStream rjs) {
+    jsonStream* js = jsonStreamGet(rjs, NULL);
+    if (!js) return NULL;
+    ruFree(js->buf);
+    ruFree(js->text);
+    memset(js, 0, sizeof(jsonStream));
+    ruFree(js);
+    return NULL;
+}
+
+RUAPI int32_t ruJsonStreamNext(ruJsonStream rjs, int32_t* event) {
+    int32_t ret;
+    jsonStream* js = jsonStreamGet(rjs, &ret);
+    if (!js) return ret;
+    if (!event) return RUE_PARAMETER_NOT_SET;
+    *event = 0;
+    js->event = 0;
+    if (js->err) return js->err;
+    for (;;) {
+        int c = streamSkip(js);
+        if (c < 0) {
+            if (js->err) return js->err;
+            if (js->expect != expDone) {
+                return streamFail(js, js->offset + js->pos, "premature end of input");
+            }
+            js->event = RU_JSON_EV_END;
+            break;
+        }
+        switch (js->expect) {
+            case expDone:
+                return streamFail(js, js->offset + js->pos, "trailing garbage");
+            case expColon:
+                if (c != ':') {
+                    return streamFail(js, js->offset + js->pos, "colon expected");
+                }
+                js->pos++;
+                js->expect = expValue;
+                continue;
+            case expNext:
+                if (c == ',') {
+                    js->pos++;
+                    js->expect = js->stack[js->depth-1] == '{'? expKey : expValue;
+                    continue;
+                }
+                ret = streamClose(js, c);
+                break;
+            case expFirstKey:
+                if (c == '}') {
+                    ret = streamClose(js, c);
+                    break;
+                }
+                // fall through
+            case expKey:
+                if (c != '"') {
+                    return streamFail(js, js->offset + js->pos, "object key expected");
+                }
+                ret = streamString(js);
+                js->event = RU_JSON_EV_KEY;
+                js->expect = expColon;
+                break;
+            case expFirstValue:
+                if (c == ']') {
+                    ret = streamClose(js, c);
+                    break;
+                }
+                // fall through
+            default:
+                ret = streamValue(js, c);
+        }
+        if (ret != RUE_OK) return ret;
+        break;
+    }
+    *event = js->event;
+    return RUE_OK;
+}
+
+RUAPI ruJson ruJsonStreamValue(ruJsonStream rjs, int32_t* status) {
+    int32_t ret;
+    jsonStream* js = jsonStreamGet(rjs, &ret);
+    if (!js) ruRetWithCode(status, ret, NULL);
+    js->event = 0;
+    if (js->err) ruRetWithCode(status, js->err, NULL);
+    int c;
+    for (;;) {
+        c = streamSkip(js);
+        if (c < 0) {
+            if (js->err) ruRetWithCode(status, js->err, NULL);
+            if (js->expect == expDone) ruRetWithCode(status, RUE_FILE_NOT_FOUND, NULL);
+            ret = streamFail(js, js->offset + js->pos, "premature end of input");
+            ruRetWithCode(status, ret, NULL);
+        }
+        // step over the separators ruJsonStreamNext would have skipped
+        if (js->expect == expColon && c == ':') {
+            js->expect = expValue;
+        } else if (js->expect == expNext && c == ',' &&
+                   js->stack[js->depth-1] == '[') {
+            js->expect = expValue;
+        } else {
+            break;
+        }
+        js->pos++;
+    }
+    if (js->expect != expValue && (js->expect != expFirstValue || c == ']')) {
+        if (js->expect == expDone || c == '}' || c == ']') {
+            // the end event is left for ruJsonStreamNext
+            ruRetWithCode(status, RUE_FILE_NOT_FOUND, NULL);
+        }
+        ruSetError("the stream is not positioned at a value");
+        ruRetWithCode(status, RUE_INVALID_STATE, NULL);
+    }
+    rusize len = 0;
+    ret = streamCapture(js, c, &len);
+    if (ret != RUE_OK) ruRetWithCode(status, ret, NULL);
+    json* j = ruMalloc0(1, json);
+    j->type = MagicJson;
+    ret = arenaParse(j, js->buf + js->pos, len, js->flags);
+    if (ret != RUE_OK) {
+        ruFree(j);
+        js->err = ret;
+        ruRetWithCode(status, ret, NULL);
+    }
+    js->pos += len;
+    streamValueDone(js);
+    ruRetWithCode(status, RUE_OK, (ruJson)j);
+}
+
+RUAPI uint32_t ruJsonStreamDepth(ruJsonStream rjs) {
+    jsonStream* js = jsonStreamGet(rjs, NULL);
+    if (!js) return 0;
+    return js->depth;
+}
+
+RUAPI perm_chars ruJsonStreamStr(ruJsonStream rjs, rusize* len, int32_t* status) {
+    int32_t ret;
+    jsonStream* js = jsonStreamGet(rjs, &ret);
+    if (!js) ruRetWithCode(status, ret, NULL);
+    switch (js->event) {
+        case RU_JSON_EV_KEY: case RU_JSON_EV_STRING: case RU_JSON_EV_NUMBER:
+        case RU_JSON_EV_TRUE: case RU_JSON_EV_FALSE: case RU_JSON_EV_NULL:
+            break;
+        default:
+            ruRetWithCode(status, RUE_INVALID_STATE, NULL);
+    }
+    if (len) *len = js->textLen;
+    ruRetWithCode(status, RUE_OK, js->text);
+}
+
+RUAPI int64_t ruJsonStreamInt(ruJsonStream rjs, int32_t* status) {
+    int32_t ret;
+    jsonStream* js = jsonStreamGet(rjs, &ret);
+    if (!js) ruRetWithCode(status, ret, 0);
+    if (js->event != RU_JSON_EV_NUMBER) ruRetWithCode(status, RUE_INVALID_STATE, 0);
+    long long out;
+    if (!scanInt(js->text, js->textLen, &out)) {
+        ruRetWithCode(status, RUE_INVALID_PARAMETER, 0);
+    }
+    ruRetWithCode(status, RUE_OK, out);
+}
+
+RUAPI double ruJsonStreamDouble(ruJsonStream rjs, int32_t* status) {
+    int32_t ret;
+    jsonStream* js = jsonStreamGet(rjs, &ret);
+    if (!js) ruRetWithCode(status, ret, 0);
+    if (js->event != RU_JSON_EV_NUMBER) ruRetWithCode(status, RUE_INVALID_STATE, 0);
+    char* endptr = NULL;
+    errno = 0;
+    double out = strtod(js->text, &endptr);
+    if (errno || !endptr || *endptr) ruRetWithCode(status, RUE_INVALID_PARAMETER, 0);
+    ruRetWithCode(status, RUE_OK, out);
+}
+
+//</editor-fold>
+
+//<editor-fold desc="writer">
+/*
+ * The writer formats straight into a fixed size buffer that's handed to the
+ * sink whenever it fills up, so output of any size never needs more memory
+ * than that. Strings are scanned in blocks of 16 or 8 bytes for anything
+ * that needs escaping and copied in runs.
+ */
+#define JSON_WRITE_CHUNK 0x10000
+#define JSON_WRITE_INDENT "    "
+#define swarHasLess(v, n) (((v) - SWAR_ONES * (n)) & ~(v) & SWAR_HIGHS)
+
+typedef struct {
+    ru_uint type;
+    rcWriteFn write;
+    perm_ptr writeCtx;
+    uint32_t flags;
+    char* buf;
+    rusize cap;
+    rusize len;
+    char open[JSON_MAX_DEPTH];
+    bool items[JSON_MAX_DEPTH];
+    uint32_t depth;
+    // a key was written and awaits its value
+    bool key;
+    bool done;
+    // sink errors are sticky
+    int32_t err;
+} jsonWriter;
+
+ruMakeTypeGetter(jsonWriter, MagicJsonWriter)
+
+static const char digitPairs[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233"
+        "34353637383940414243444546474849505152535455565758596061626364656667"
+        "6869707172737475767778798081828384858687888990919293949596979899";
+
+static rusize_s stringSink(perm_ptr ctx, trans_ptr buf, rusize len) {
+    if (ruStringAppendn((ruString)ctx, (trans_chars)buf, len) != RUE_OK) return -1;
+    return (rusize_s)len;
+}
+
+static int32_t writerFlush(jsonWriter* jw) {
+    if (jw->err) return jw->err;
+    char* buf = jw->buf;
+    while (jw->len) {
+        rusize_s done = jw->write(jw->writeCtx, buf, jw->len);
+        if (done <= 0) {
+            ruSetError("failed writing %lu bytes of JSON", (unsigned long)jw->len);
+            jw->err = RUE_CANT_WRITE;
+            return jw->err;
+        }
+        buf += done;
+        jw->len -= done;
+    }
+    return RUE_OK;
+}
+
+static int32_t writerPut(jsonWriter* jw, const void* data, rusize len) {
+    const char* p = data;
+    while (len) {
+        if (jw->len == jw->cap) {
+            int32_t ret = writerFlush(jw);
+            if (ret != RUE_OK) return ret;
+        }
+        rusize n = jw->cap - jw->len;
+        if (n > len) n = len;
+        memcpy(jw->buf + jw->len, p, n);
+        jw->len += n;
+        p += n;
+        len -= n;
+    }
+    return RUE_OK;
+}
+
+static int32_t writerIndent(jsonWriter* jw, uint32_t depth) {
+    int32_t ret = writerPut(jw, "\n", 1);
+    for (uint32_t i = 0; i < depth && ret == RUE_OK; i++) {
+        ret = writerPut(jw, JSON_WRITE_INDENT, sizeof(JSON_WRITE_INDENT) - 1);
+    }
+    return ret;
+}
+
+/*
+ * Checks that a key or value may come next and writes the separator
+ * in front of it.
+ */
+static int32_t writerSep(jsonWriter* jw, bool key) {
+    if (jw->err) return jw->err;
+    if (!jw->depth) {
+        if (jw->done || key) return RUE_INVALID_STATE;
+        return RUE_OK;
+    }
+    bool map = jw->open[jw->depth-1] == '{';
+    if (key) {
+        if (!map || jw->key) return RUE_INVALID_STATE;
+    } else if (map) {
+        if (!jw->key) return RUE_INVALID_STATE;
+        jw->key = false;
+        return RUE_OK;
+    }
+    int32_t ret = RUE_OK;
+    if (jw->items[jw->depth-1]) ret = writerPut(jw, ",", 1);
+    if (ret == RUE_OK && jw->flags & RU_JSON_PRETTIFY) {
+        ret = writerIndent(jw, jw->depth);
+    }
+    jw->items[jw->depth-1] = true;
+    return ret;
+}
+
+static int32_t writerDone(jsonWriter* jw, int32_t ret) {
+    if (ret != RUE_OK || jw->depth) return ret;
+    jw->done = true;
+    if (jw->flags & RU_JSON_PRETTIFY) ret = writerPut(jw, "\n", 1);
+    return ret;
+}
+
+static bool validUtf8(const unsigned char* p, const unsigned char* end) {
+    while (p < end) {
+#ifdef JSON_SSE2
+        if (p + 16 <= end) {
+            uint32_t mask = sseHigh(sseLoad(p));
+            if (!mask) {
+                p += 16;
+                continue;
+            }
+            p += lowBit(mask);
+        }
+#else
+        if (p + 8 <= end) {
+            uint64_t w;
+            memcpy(&w, p, 8);
+            if (!(w & SWAR_HIGHS)) {
+                p += 8;
+                continue;
+            }
+        }
+#endif
+        if (*p < 0x80) {
+            p++;
+            continue;
+        }
+        int n = utf8Len(p, end);
+        if (!n) return false;
+        p += n;
+    }
+    return true;
+}
+
+static int32_t writerCheck(trans_chars str, rusize len) {
+    if (validUtf8((const unsigned char*)str, (const unsigned char*)str + len)) {
+        return RUE_OK;
+    }
+    ruSetError("string contains invalid UTF-8");
+    return RUE_INVALID_PARAMETER;
+}
+
+// expects valid UTF-8
+static int32_t writerString(jsonWriter* jw, trans_chars str, rusize len) {
+    const unsigned char* p = (const unsigned char*)str;
+    const unsigned char* end = p + len;
+    bool slash = (jw->flags & RU_JSON_ESCAPE_SLASH) != 0;
+    int32_t ret = writerPut(jw, "\"", 1);
+    while (ret == RUE_OK && p < end) {
+        const unsigned char* run = p;
+#ifdef JSON_SSE2
+        while (p + 16 <= end) {
+            __m128i v = sseLoad(p);
+            uint32_t mask = sseEq(v, '"') | sseEq(v, '\\') | sseCtrl(v);
+            if (slash) mask |= sseEq(v, '/');
+            if (mask) {
+                p += lowBit(mask);
+                break;
+            }
+            p += 16;
+        }
+#else
+        while (p + 8 <= end) {
+            uint64_t w;
+            memcpy(&w, p, 8);
+            if (swarHasZero(w ^ (SWAR_ONES * '"')) ||
+                swarHasZero(w ^ (SWAR_ONES * '\\')) || swarHasLess(w, 0x20) ||
+                (slash && swarHasZero(w ^ (SWAR_ONES * '/')))) break;
+            p += 8;
+        }
+#endif
+        while (p < end && *p >= 0x20 && *p != '"' && *p != '\\' &&
+               (!slash || *p != '/')) p++;
+        if (p > run) ret = writerPut(jw, run, p - run);
+        if (p == end || ret != RUE_OK) break;
+        char esc[6] = {'\\', 0, '0', '0', 0, 0};
+        int n = 2;
+        switch (*p) {
+            case '"': case '\\': case '/': esc[1] = (char)*p; break;
+            case '\b': esc[1] = 'b'; break;
+            case '\f': esc[1] = 'f'; break;
+            case '\n': esc[1] = 'n'; break;
+            case '\r': esc[1] = 'r'; break;
+            case '\t': esc[1] = 't'; break;
+            default:
+                esc[1] = 'u';
+                esc[4] = "0123456789abcdef"[*p >> 4];
+                esc[5] = "0123456789abcdef"[*p & 0xf];
+                n = 6;
+        }
+        ret = writerPut(jw, esc, n);
+        p++;
+    }
+    if (ret == RUE_OK) ret = writerPut(jw, "\"", 1);
+    return ret;
+}
+
+static rusize fmtInt(char* out, int64_t val) {
+    char tmp[24];
+    char* t = tmp + sizeof(tmp);
+    uint64_t v = val < 0? 0 - (uint64_t)val : (uint64_t)val;
+    while (v >= 100) {
+        t -= 2;
+        memcpy(t, digitPairs + (v % 100) * 2, 2);
+        v /= 100;
+    }
+    if (v >= 10) {
+        t -= 2;
+        memcpy(t, digitPairs + v * 2, 2);
+    } else {
+        *--t = (char)('0' + v);
+    }
+    if (val < 0) *--t = '-';
+    rusize len = tmp + sizeof(tmp) - t;
+    memcpy(out, t, len);
+    return len;
+}
+
+/*
+ * Whole numbers below 1e15 go through fmtInt. Anything else gets 15
+ * significant digits if those read back as the same double, which covers
+ * the values people write down, and 17 otherwise, which always do. That's
+ * at most two snprintf and one strtod call, at the price of 17 digits where
+ * 16 would have done.
+ */
+static rusize fmtDouble(char* out, rusize size, double val) {
+    if (fabs(val) < 1e15 && val == (double)(int64_t)val &&
+        (val != 0 || !signbit(val))) {
+        rusize len = fmtInt(out, (int64_t)val);
+        memcpy(out + len, ".0", 3);
+        return len + 2;
+    }
+    int len = snprintf(out, size, "%.15g", val);
+    if (strtod(out, NULL) != val) len = snprintf(out, size, "%.17g", val);
+    // keep it recognizable as a double like yajl does
+    if (strspn(out, "0123456789-") == (rusize)len) {
+        memcpy(out + len, ".0", 3);
+        len += 2;
+    }
+    return len;
+}
+
+RUAPI ruJsonWriter ruJsonWriterNewSink(rcWriteFn writer, perm_ptr ctx,
+                                       rusize flushAt, uint32_t flags,
+                                       int32_t* code) {
+    ruClearError();
+    if (!writer) ruRetWithCode(code, RUE_PARAMETER_NOT_SET, NULL);
+    jsonWriter* jw = ruMalloc0(1, jsonWriter);
+    jw->type = MagicJsonWriter;
+    jw->write = writer;
+    jw->writeCtx = ctx;
+    jw->flags = flags;
+    jw->cap = flushAt? flushAt : JSON_WRITE_CHUNK;
+    jw->buf = ruMalloc0(jw->cap, char);
+    ruRetWithCode(code, RUE_OK, (ruJsonWriter)jw);
+}
+
+RUAPI ruJsonWriter ruJsonWriterNew(ruString out, uint32_t flags, int32_t* code) {
+    int32_t ret;
+    if (!out) ruRetWithCode(code, RUE_PARAMETER_NOT_SET, NULL);
+    ruStringLen(out, &ret);
+    if (ret != RUE_OK) ruRetWithCode(code, ret, NULL);
+    return ruJsonWriterNewSink(stringSink, out, 0, flags, code);
+}
+
+RUAPI ruJsonWriter ruJsonWriterFree(ruJsonWriter rjw) {
+    jsonWriter* jw = jsonWriterGet(rjw, NULL);
+    if (!jw) return NULL;
+    writerFlush(jw);
+    ruFree(jw->buf);
+    memset(jw, 0, sizeof(jsonWriter));
+    ruFree(jw);
+    return NULL;
+}
+
+RUAPI int32_t ruJsonWriterFlush(ruJsonWriter rjw) {
+    int32_t ret;
+    jsonWriter* jw = jsonWriterGet(rjw, &ret);
+    if (!jw) return ret;
+    return writerFlush(jw);
+}
+
+static int32_t writerOpen(ruJsonWriter rjw, char open) {
+    int32_t ret;
+    jsonWriter* jw = jsonWriterGet(rjw, &ret);
+    if (!jw) return ret;
+    if (jw->depth == JSON_MAX_DEPTH) return RUE_OVERFLOW;
+    ret = writerSep(jw, false);
+    if (ret != RUE_OK) return ret;
+    jw->open[jw->depth] = open;
+    jw->items[jw->depth] = false;
+    jw->depth++;
+    return writerPut(jw, &open, 1);
+}
+
+static int32_t writerClose(ruJsonWriter rjw, char open) {
+    int32_t ret;
+    jsonWriter* jw = jsonWriterGet(rjw, &ret);
+    if (!jw) return ret;
+    if (jw->err) return jw->err;
+    if (!jw->depth || jw->open[jw->depth-1] != open || jw->key) {
+        return RUE_INVALID_STATE;
+    }
+    jw->depth--;
+    ret = RUE_OK;
+    if (jw->items[jw->depth] && jw->flags & RU_JSON_PRETTIFY) {
+        ret = writerIndent(jw, jw->depth);
+    }
+    if (ret == RUE_OK) ret = writerPut(jw, open == '{'? "}" : "]", 1);
+    return writerDone(jw, ret);
+}
+
+RUAPI int32_t ruJsonWriterStartMap(ruJsonWriter jw) {
+    return writerOpen(jw, '{');
+}
+
+RUAPI int32_t ruJsonWriterEndMap(ruJsonWriter jw) {
+    return writerClose(jw, '{');
+}
+
+RUAPI int32_t ruJsonWriterStartArray(ruJsonWriter jw) {
+    return writerOpen(jw, '[');
+}
+
+RUAPI int32_t ruJsonWriterEndArray(ruJsonWriter jw) {
+    return writerClose(jw, '[');
+}
+
+RUAPI int32_t ruJsonWriterKey(ruJsonWriter rjw, trans_chars key) {
+    int32_t ret;
+    jsonWriter* jw = jsonWriterGet(rjw, &ret);
+    if (!jw) return ret;
+    if (!key) return RUE_PARAMETER_NOT_SET;
+    rusize len = strlen(key);
+    ret = writerCheck(key, len);
+    if (ret != RUE_OK) return ret;
+    ret = writerSep(jw, true);
+    if (ret != RUE_OK) return ret;
+    ret = writerString(jw, key, len);
+    if (ret != RUE_OK) return ret;
+    jw->key = true;
+    if (jw->flags & RU_JSON_PRETTIFY) return writerPut(jw, ": ", 2);
+    return writerPut(jw, ":", 1);
+}
+
+RUAPI int32_t ruJsonWriterStrLen(ruJsonWriter rjw, trans_chars val, rusize len) {
+    int32_t ret;
+    jsonWriter* jw = jsonWriterGet(rjw, &ret);
+    if (!jw) return ret;
+    if (!val) return ruJsonWriterNull(rjw);
+    if (len == RU_SIZE_AUTO) len = strlen(val);
+    ret = writerCheck(val, len);
+    if (ret != RUE_OK) return ret;
+    ret = writerSep(jw, false);
+    if (ret != RUE_OK) return ret;
+    return writerDone(jw, writerString(jw, val, len));
+}
+
+RUAPI int32_t ruJsonWriterStr(ruJsonWriter jw, trans_chars val) {
+    return ruJsonWriterStrLen(jw, val, RU_SIZE_AUTO);
+}
+
+RUAPI int32_t ruJsonWriterInt(ruJsonWriter rjw, int64_t val) {
+    int32_t ret;
+    jsonWriter* jw = jsonWriterGet(rjw, &ret);
+    if (!jw) return ret;
+    ret = writerSep(jw, false);
+    if (ret != RUE_OK) return ret;
+    char num[24];
+    return writerDone(jw, writerPut(jw, num, fmtInt(num, val)));
+}
+
+RUAPI int32_t ruJsonWriterDouble(ruJsonWriter rjw, double val) {
+    int32_t ret;
+    jsonWriter* jw = jsonWriterGet(rjw, &ret);
+    if (!jw) return ret;
+    if (isnan(val) || isinf(val)) return RUE_INVALID_PARAMETER;
+    ret = writerSep(jw, false);
+    if (ret != RUE_OK) return ret;
+    char num[40];
+    return writerDone(jw, writerPut(jw, num, fmtDouble(num, sizeof(num), val)));
+}
+
+RUAPI int32_t ruJsonWriterBool(ruJsonWriter rjw, bool val) {
+    int32_t ret;
+    jsonWriter* jw = jsonWriterGet(rjw, &ret);
+    if (!jw) return ret;
+    ret = writerSep(jw, false);
+    if (ret != RUE_OK) return ret;
+    return writerDone(jw, val? writerPut(jw, "true", 4) : writerPut(jw, "false", 5));
+}
+
+RUAPI int32_t ruJsonWriterNull(ruJsonWriter rjw) {
+    int32_t ret;
+    jsonWriter* jw = jsonWriterGet(rjw, &ret);
+    if (!jw) return ret;
+    ret = writerSep(jw, false);
+    if (ret != RUE_OK) return ret;
+    return writerDone(jw, writerPut(jw, "null", 4));
+}
+
+//</editor-fold>
+
+//<editor-fold desc="path queries">
+/*
+ * Compiled paths form a trie of steps, so a set of paths sharing prefixes
+ * resolves each shared step once. Evaluation only follows pointers and
+ * writes into the caller's result array.
+ */
+#define PATH_MATCH_MAX 64
+
+enum {
+    stepKey,
+    stepIdx,
+    // a JSON pointer token, which works as key or, when numeric, as index
+    stepAny
+};
+
+typedef struct {
+    alloc_chars key;
+    uint32_t hash;
+    uint8_t kind;
+    bool numeric;
+    int64_t idx;
+    // first path ending here or -1
+    int32_t result;
+    // first child and next sibling, 0 for none as the root is never either
+    uint32_t child;
+    uint32_t next;
+} pathNode;
+
+typedef struct {
+    ru_uint type;
+    pathNode* nodes;
+    uint32_t cnt;
+    uint32_t cap;
+    // further paths ending at the same node, indexed by path
+    int32_t* sameEnd;
+    rusize paths;
+    // where the first path ends
+    uint32_t first;
+} jsonPath;
+
+ruMakeTypeGetter(jsonPath, MagicJsonPath)
+
+static int32_t pathFail(trans_chars expr, rusize pos, perm_chars err) {
+    ruSetError("invalid path '%s': %s at offset %lu", expr, err, (unsigned long)pos);
+    return RUE_INVALID_PARAMETER;
+}
+
+static bool stepEquals(pathNode* a, pathNode* b) {
+    if (a->kind != b->kind) return false;
+    if (a->kind == stepIdx) return a->idx == b->idx;
+    return !strcmp(a->key, b->key);
+}
+
+// takes ownership of step->key
+static uint32_t pathAdd(jsonPath* jp, uint32_t parent, pathNode* step) {
+    uint32_t* link = &jp->nodes[parent].child;
+    while (*link) {
+        if (stepEquals(&jp->nodes[*link], step)) {
+            ruFree(step->key);
+            return *link;
+        }
+        link = &jp->nodes[*link].next;
+    }
+    if (jp->cnt == jp->cap) {
+        // link points into the array that's about to move
+        rusize at = (char*)link - (char*)jp->nodes;
+        jp->cap *= 2;
+        jp->nodes = ruRealloc(jp->nodes, jp->cap, pathNode);
+        link = (uint32_t*)((char*)jp->nodes + at);
+    }
+    uint32_t n = jp->cnt++;
+    jp->nodes[n] = *step;
+    jp->nodes[n].result = -1;
+    if (step->key) jp->nodes[n].hash = keyHash(step->key);
+    *link = n;
+    return n;
+}
+
+static bool parseIndex(trans_chars p, rusize len, bool sign, int64_t* out) {
+    bool neg = sign && len && *p == '-';
+    if (neg) {
+        p++;
+        len--;
+    }
+    // no leading zeros, just like array indices in RFC 6901
+    if (!len || len > 18 || (*p == '0' && len > 1)) return false;
+    int64_t i = 0;
+    for (rusize c = 0; c < len; c++) {
+        if (p[c] < '0' || p[c] > '9') return false;
+        i = i * 10 + (p[c] - '0');
+    }
+    *out = neg? -i : i;
+    return true;
+}
+
+static int32_t pathPointer(jsonPath* jp, trans_chars expr, uint32_t* end) {
+    uint32_t n = 0;
+    trans_chars p = expr;
+    while (*p) {
+        if (*p != '/') return pathFail(expr, p - expr, "'/' expected");
+        trans_chars tok = ++p;
+        while (*p && *p != '/') p++;
+        pathNode step;
+        memset(&step, 0, sizeof(pathNode));
+        step.kind = stepAny;
+        step.key = ruMalloc0(p - tok + 1, char);
+        char* k = step.key;
+        for (trans_chars c = tok; c < p; c++) {
+            if (*c == '~') {
+                if (c[1] == '0') {
+                    *k++ = '~';
+                } else if (c[1] == '1') {
+                    *k++ = '/';
+                } else {
+                    ruFree(step.key);
+                    return pathFail(expr, c - expr, "invalid escape");
+                }
+                c++;
+            } else {
+                *k++ = *c;
+            }
+        }
+        step.numeric = parseIndex(tok, p - tok, false, &step.idx);
+        n = pathAdd(jp, n, &step);
+    }
+    *end = n;
+    return RUE_OK;
+}
+
+static int32_t pathDotted(jsonPath* jp, trans_chars expr, uint32_t* end) {
+    uint32_t n = 0;
+    trans_chars p = expr + 1;
+    while (*p) {
+        pathNode step;
+        memset(&step, 0, sizeof(pathNode));
+        if (*p == '.') {
+            trans_chars name = ++p;
+            while (*p && *p != '.' && *p != '[') p++;
+            if (p == name) return pathFail(expr, p - expr, "name expected");
+            step.kind = stepKey;
+            step.key = ruStrNDup(name, p - name);
+        } else if (*p == '[' && (p[1] == '\'' || p[1] == '"')) {
+            char quote = p[1];
+            p += 2;
+            trans_chars name = p;
+            while (*p && *p != quote) p += *p == '\\' && p[1]? 2 : 1;
+            if (!*p || p[1] != ']') {
+                return pathFail(expr, p - expr, "unterminated name");
+            }
+            step.kind = stepKey;
+            step.key = ruMalloc0(p - name + 1, char);
+            char* k = step.key;
+            for (trans_chars c = name; c < p; c++) {
+                if (*c == '\\') c++;
+                *k++ = *c;
+            }
+            p += 2;
+        } else if (*p == '[') {
+            trans_chars num = ++p;
+            while (*p && *p != ']') p++;
+            if (!*p || !parseIndex(num, p - num, true, &step.idx)) {
+                return pathFail(expr, num - expr, "index expected");
+            }
+            step.kind = stepIdx;
+            p++;
+        } else {
+            return pathFail(expr, p - expr, "'.' or '[' expected");
+        }
+        n = pathAdd(jp, n, &step);
+    }
+    *end = n;
+    return RUE_OK;
+}
+
+static yajl_val objectGet(yajl_val v, pathNode* step) {
+    if (v->u.number.flags) return indexFind(v, step->key, step->hash);
+    for (rusize i = 0; i < v->u.object.len; i++) {
+        if (!strcmp(v->u.object.keys[i], step->key)) return v->u.object.values[i];
+    }
+    return NULL;
+}
+
+static yajl_val arrayGet(yajl_val v, pathNode* step) {
+    if (step->kind == stepAny && !step->numeric) return NULL;
+    int64_t i = step->idx;
+    if (i < 0) i += (int64_t)v->u.array.len;
+    if (i < 0 || (uint64_t)i >= v->u.array.len) return NULL;
+    return v->u.array.values[i];
+}
+
+static rusize pathWalk(jsonPath* jp, uint32_t n, yajl_val v, ruJson* results) {
+    rusize found = 0;
+    pathNode* node = &jp->nodes[n];
+    for (int32_t r = node->result; r >= 0; r = jp->sameEnd[r]) {
+        results[r] = v;
+        found++;
+    }
+    if (!node->child) return found;
+    if (YAJL_IS_ARRAY(v)) {
+        for (uint32_t c = node->child; c; c = jp->nodes[c].next) {
+            if (jp->nodes[c].kind == stepKey) continue;
+            yajl_val child = arrayGet(v, &jp->nodes[c]);
+            if (child) found += pathWalk(jp, c, child, results);
+        }
+        return found;
+    }
+    if (!YAJL_IS_OBJECT(v)) return found;
+
+    uint32_t keys = 0;
+    for (uint32_t c = node->child; c; c = jp->nodes[c].next) {
+        if (jp->nodes[c].kind != stepIdx) keys++;
+    }
+    if (v->u.number.flags || keys < 2 || keys > PATH_MATCH_MAX) {
+        for (uint32_t c = node->child; c; c = jp->nodes[c].next) {
+            if (jp->nodes[c].kind == stepIdx) continue;
+            yajl_val child = objectGet(v, &jp->nodes[c]);
+            if (child) found += pathWalk(jp, c, child, results);
+        }
+        return found;
+    }
+    // a single pass over the object serves all wanted keys
+    uint64_t matched = 0, all = keys == 64? UINT64_MAX : (1ULL << keys) - 1;
+    for (rusize i = 0; i < v->u.object.len && matched != all; i++) {
+        trans_chars key = v->u.object.keys[i];
+        uint32_t hash = keyHash(key);
+        uint32_t bit = 0;
+        for (uint32_t c = node->child; c; c = jp->nodes[c].next) {
+            pathNode* step = &jp->nodes[c];
+            if (step->kind == stepIdx) continue;
+            // the first of duplicate keys wins
+            if (!(matched & (1ULL << bit)) && step->hash == hash &&
+                !strcmp(step->key, key)) {
+                matched |= 1ULL << bit;
+                found += pathWalk(jp, c, v->u.object.values[i], results);
+            }
+            bit++;
+        }
+    }
+    return found;
+}
+
+RUAPI ruJsonPath ruJsonPathCompileAll(trans_chars* exprs, rusize count,
+                                      int32_t* code) {
+    ruClearError();
+    if (!exprs || !count) ruRetWithCode(code, RUE_PARAMETER_NOT_SET, NULL);
+    if (count > INT32_MAX) ruRetWithCode(code, RUE_OVERFLOW, NULL);
+    jsonPath* jp = ruMalloc0(1, jsonPath);
+    jp->type = MagicJsonPath;
+    jp->cap = 16;
+    jp->nodes = ruMalloc0(jp->cap, pathNode);
+    jp->cnt = 1;
+    jp->nodes[0].result = -1;
+    jp->sameEnd = ruMalloc0(count, int32_t);
+    jp->paths = count;
+    int32_t ret = RUE_OK;
+    for (rusize i = 0; i < count && ret == RUE_OK; i++) {
+        trans_chars expr = exprs[i];
+        uint32_t end = 0;
+        if (!expr) {
+            ret = RUE_PARAMETER_NOT_SET;
+        } else if (*expr == '$') {
+            ret = pathDotted(jp, expr, &end);
+        } else {
+            ret = pathPointer(jp, expr, &end);
+        }
+        if (ret != RUE_OK) break;
+        if (!i) jp->first = end;
+        jp->sameEnd[i] = jp->nodes[end].result;
+        jp->nodes[end].result = (int32_t)i;
+    }
+    if (ret != RUE_OK) {
+        jp = ruJsonPathFree(jp);
+        ruRetWithCode(code, ret, NULL);
+    }
+    ruRetWithCode(code, RUE_OK, (ruJsonPath)jp);
+}
+
+RUAPI ruJsonPath ruJsonPathCompile(trans_chars expr, int32_t* code) {
+    if (!expr) ruRetWithCode(code, RUE_PARAMETER_NOT_SET, NULL);
+    return ruJsonPathCompileAll(&expr, 1, code);
+}
+
+RUAPI ruJsonPath ruJsonPathFree(ruJsonPath rjp) {
+    jsonPath* jp = jsonPathGet(rjp, NULL);
+    if (!jp) return NULL;
+    for (uint32_t i = 0; i < jp->cnt; i++) ruFree(jp->nodes[i].key);
+    ruFree(jp->nodes);
+    ruFree(jp->sameEnd);
+    memset(jp, 0, sizeof(jsonPath));
+    ruFree(jp);
+    return NULL;
+}
+
+RUAPI rusize ruJsonPathGetAll(ruJsonPath rjp, ruJson rj, ruJson* results,
+                              int32_t* status) {
+    int32_t ret;
+    jsonPath* jp = jsonPathGet(rjp, &ret);
+    if (!jp) ruRetWithCode(status, ret, 0);
+    if (!results) ruRetWithCode(status, RUE_PARAMETER_NOT_SET, 0);
+    memset(results, 0, jp->paths * sizeof(ruJson));
+    yajl_val v = getYajlVal(rj, status);
+    if (!v) return 0;
+    rusize found = pathWalk(jp, 0, v, results);
+    ruRetWithCode(status, found? RUE_OK : RUE_FILE_NOT_FOUND, found);
+}
+
+RUAPI ruJson ruJsonPathGet(ruJsonPath rjp, ruJson rj, int32_t* status) {
+    int32_t ret;
+    jsonPath* jp = jsonPathGet(rjp, &ret);
+    if (!jp) ruRetWithCode(status, ret, NULL);
+    yajl_val v = getYajlVal(rj, status);
+    if (!v) return NULL;
+    // follow the first path, which is the only one in the common case
+    for (uint32_t n = 0; ; ) {
+        if (n == jp->first) ruRetWithCode(status, RUE_OK, v);
+        uint32_t c = jp->nodes[n].child;
+        // the first path always runs along the first children
+        pathNode* step = &jp->nodes[c];
+        if (YAJL_IS_OBJECT(v) && step->kind != stepIdx) {
+            v = objectGet(v, step);
+        } else if (YAJL_IS_ARRAY(v) && step->kind != stepKey) {
+            v = arrayGet(v, step);
+        } else {
+            v = NULL;
+        }
+        if (!v) break;
+        n = c;
+    }
+    ruRetWithCode(status, RUE_FILE_NOT_FOUND, NULL);
+}
+
+RUAPI perm_chars ruJsonPathStr(ruJsonPath jp, ruJson rj, int32_t* status) {
+    yajl_val v = ruJsonPathGet(jp, rj, status);
+    if (!v) return NULL;
+    return nodeStr(v, status);
+}
+
+RUAPI int64_t ruJsonPathInt(ruJsonPath jp, ruJson rj, int32_t* status) {
+    yajl_val v = ruJsonPathGet(jp, rj, status);
+    if (!v) return 0;
+    return nodeInt(v, status);
+}
+
+RUAPI double ruJsonPathDouble(ruJsonPath jp, ruJson rj, int32_t* status) {
+    yajl_val v = ruJsonPathGet(jp, rj, status);
+    if (!v) return 0;
+    return nodeDouble(v, status);
+}
+
+RUAPI bool ruJsonPathBool(ruJsonPath jp, ruJson rj, int32_t* status) {
+    yajl_val v = ruJsonPathGet(jp, rj, status);
+    if (!v) return false;
+    return nodeBool(v, status);
+}
+
+//</editor-fold>
+
+//<editor-fold desc="binary image">
+/*
+ * A binary image is the arena layout of a document with its pointers
+ * turned into offsets from the start of the image. Loading it takes one
+ * read and a linear pass over the nodes to turn them back into pointers,
+ * after which the getters work on it like on any other arena document.
+ * Since it holds yajl_val nodes as they are in memory, an image only loads
+ * on the platform layout it was written with.
+ */
+#define JSON_IMAGE_MAGIC "RUJB"
+#define JSON_IMAGE_VERSION 1
+#define JSON_IMAGE_ORDER 0x01020304
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t order;
+    uint16_t ptrSize;
+    uint16_t nodeSize;
+    uint64_t nodes;
+    uint64_t slots;
+    uint64_t chars;
+} jsonImageHead;
+
+typedef struct {
+    char* base;
+    yajl_val nodes;
+    ptr* slots;
+    char* chars;
+    rusize size;
+    // region boundaries as offsets into base
+    rusize nodesAt;
+    rusize slotsAt;
+    rusize charsAt;
+} jsonImage;
+
+static rusize tableSlots(uint32_t buckets) {
+    return (buckets * sizeof(uint32_t) + sizeof(ptr) - 1) / sizeof(ptr);
+}
+
+static void imageSize(yajl_val v, jsonImageHead* h) {
+    h->nodes++;
+    if (YAJL_IS_STRING(v)) {
+        h->chars += strlen(v->u.string) + 1;
+    } else if (YAJL_IS_NUMBER(v)) {
+        if (v->u.number.r) h->chars += strlen(v->u.number.r) + 1;
+    } else if (YAJL_IS_OBJECT(v)) {
+        h->slots += v->u.object.len * 2;
+        if (v->u.number.flags) h->slots += tableSlots(v->u.number.flags);
+        for (rusize i = 0; i < v->u.object.len; i++) {
+            h->chars += strlen(v->u.object.keys[i]) + 1;
+            imageSize(v->u.object.values[i], h);
+        }
+    } else if (YAJL_IS_ARRAY(v)) {
+        h->slots += v->u.array.len;
+        for (rusize i = 0; i < v->u.array.len; i++) {
+            imageSize(v->u.array.values[i], h);
+        }
+    }
+}
+
+static char* imageStr(jsonImage* im, trans_chars str) {
+    if (!str) return NULL;
+    char* out = im->chars;
+    rusize len = strlen(str) + 1;
+    memcpy(out, str, len);
+    im->chars += len;
+    return out;
+}
+
+static yajl_val imageCopy(jsonImage* im, yajl_val v) {
+    yajl_val n = im->nodes++;
+    *n = *v;
+    if (YAJL_IS_STRING(v)) {
+        n->u.string = imageStr(im, v->u.string);
+    } else if (YAJL_IS_NUMBER(v)) {
+        n->u.number.r = imageStr(im, v->u.number.r);
+    } else if (YAJL_IS_OBJECT(v)) {
+        rusize len = v->u.object.len;
+        n->u.object.keys = (const char**)im->slots;
+        n->u.object.values = (yajl_val*)im->slots + len;
+        im->slots += len * 2;
+        if (v->u.number.flags) {
+            // the key index is positional, so it's good as is
+            memcpy(im->slots, v->u.object.values + len,
+                   v->u.number.flags * sizeof(uint32_t));
+            im->slots += tableSlots(v->u.number.flags);
+        }
+        for (rusize i = 0; i < len; i++) {
+            n->u.object.keys[i] = imageStr(im, v->u.object.keys[i]);
+            n->u.object.values[i] = imageCopy(im, v->u.object.values[i]);
+        }
+    } else if (YAJL_IS_ARRAY(v)) {
+        n->u.array.values = (yajl_val*)im->slots;
+        im->slots += v->u.array.len;
+        for (rusize i = 0; i < v->u.array.len; i++) {
+            n->u.array.values[i] = imageCopy(im, v->u.array.values[i]);
+        }
+    }
+    return n;
+}
+
+#define imageOff(im, p) ((p)? (ptr)((char*)(p) - (im)->base + 1) : NULL)
+
+// turns the pointers of the freshly copied nodes into offsets
+static void imageStore(jsonImage* im, yajl_val nodes, rusize cnt) {
+    for (yajl_val v = nodes; v < nodes + cnt; v++) {
+        if (YAJL_IS_STRING(v)) {
+            v->u.string = imageOff(im, v->u.string);
+        } else if (YAJL_IS_NUMBER(v)) {
+            v->u.number.r = imageOff(im, v->u.number.r);
+        } else if (YAJL_IS_OBJECT(v)) {
+            for (rusize i = 0; i < v->u.object.len; i++) {
+                v->u.object.keys[i] = imageOff(im, v->u.object.keys[i]);
+                v->u.object.values[i] = imageOff(im, v->u.object.values[i]);
+            }
+            v->u.object.keys = imageOff(im, v->u.object.keys);
+            v->u.object.values = imageOff(im, v->u.object.values);
+        } else if (YAJL_IS_ARRAY(v)) {
+            for (rusize i = 0; i < v->u.array.len; i++) {
+                v->u.array.values[i] = imageOff(im, v->u.array.values[i]);
+            }
+            v->u.array.values = imageOff(im, v->u.array.values);
+        }
+    }
+}
+
+/*
+ * The image may come from anywhere, so every offset is checked to land in
+ * its region before it becomes a pointer.
+ */
+static bool imagePtr(jsonImage* im, ptr* p, rusize from, rusize to,
+                     rusize align, rusize bytes) {
+    uintptr_t off = (uintptr_t)*p;
+    if (!off--) return false;
+    if (off < from || off >= to || bytes > to - off || (off - from) % align) {
+        return false;
+    }
+    *p = im->base + off;
+    return true;
+}
+
+static bool imageStrPtr(jsonImage* im, char** p) {
+    // the chars region is known to end with a terminator
+    return imagePtr(im, (ptr*)p, im->charsAt, im->size, 1, 1);
+}
+
+// nodes are stored in pre-order, so children always follow their parent and
+// anything else would let a damaged image loop back onto itself
+static bool imageNodePtr(jsonImage* im, yajl_val* p, yajl_val parent) {
+    return imagePtr(im, (ptr*)p, im->nodesAt, im->slotsAt,
+                    sizeof(struct yajl_val_s), sizeof(struct yajl_val_s)) &&
+           *p > parent;
+}
+
+static bool imageSlotsPtr(jsonImage* im, ptr* p, rusize cnt) {
+    // empty containers point at the end of the region
+    if (!cnt && (uintptr_t)*p == im->charsAt + 1) {
+        *p = im->base + im->charsAt;
+        return true;
+    }
+    return imagePtr(im, p, im->slotsAt, im->charsAt, sizeof(ptr),
+                    cnt * sizeof(ptr));
+}
+
+static bool imageLoad(jsonImage* im, yajl_val nodes, rusize cnt) {
+    rusize maxLen = (im->charsAt - im->slotsAt) / sizeof(ptr);
+    for (yajl_val v = nodes; v < nodes + cnt; v++) {
+        switch (v->type) {
+            case yajl_t_string:
+                if (!imageStrPtr(im, &v->u.string)) return false;
+                break;
+            case yajl_t_number:
+                if (v->u.number.r && !imageStrPtr(im, &v->u.number.r)) return false;
+                break;
+            case yajl_t_object: {
+                rusize len = v->u.object.len;
+                uint32_t buckets = v->u.number.flags;
+                if (len > maxLen / 2) return false;
+                if (buckets && (buckets & (buckets - 1) || buckets < len ||
+                                tableSlots(buckets) > maxLen - len * 2)) {
+                    return false;
+                }
+                if (!imageSlotsPtr(im, (ptr*)&v->u.object.keys, len) ||
+                    !imageSlotsPtr(im, (ptr*)&v->u.object.values,
+                                   len + (buckets? tableSlots(buckets) : 0))) {
+                    return false;
+                }
+                for (rusize i = 0; i < len; i++) {
+                    if (!imageStrPtr(im, (char**)&v->u.object.keys[i]) ||
+                        !imageNodePtr(im, &v->u.object.values[i], v)) return false;
+                }
+                if (buckets) {
+                    // lookups stop at empty buckets, so there must be one
+                    uint32_t* table = (uint32_t*)(v->u.object.values + len);
+                    bool empty = false;
+                    for (uint32_t b = 0; b < buckets; b++) {
+                        if (table[b] > len) return false;
+                        if (!table[b]) empty = true;
+                    }
+                    if (!empty) return false;
+                }
+                break;
+            }
+            case yajl_t_array: {
+                rusize len = v->u.array.len;
+                if (len > maxLen ||
+                    !imageSlotsPtr(im, (ptr*)&v->u.array.values, len)) return false;
+                for (rusize i = 0; i < len; i++) {
+                    if (!imageNodePtr(im, &v->u.array.values[i], v)) return false;
+                }
+                break;
+            }
+            case yajl_t_true: case yajl_t_false: case yajl_t_null:
+                break;
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+static void imageRegions(jsonImage* im, jsonImageHead* h) {
+    im->nodesAt = sizeof(jsonImageHead);
+    im->slotsAt = im->nodesAt + (rusize)h->nodes * sizeof(struct yajl_val_s);
+    im->charsAt = im->slotsAt + (rusize)h->slots * sizeof(ptr);
+    im->size = im->charsAt + (rusize)h->chars;
+}
+
+// takes ownership of buf
+static ruJson imageOpen(alloc_ptr buf, rusize len, int32_t* status) {
+    jsonImageHead h;
+    if (len < sizeof(jsonImageHead)) {
+        ruFree(buf);
+        ruSetError("binary JSON image of %lu bytes is too short", (unsigned long)len);
+        ruRetWithCode(status, RUE_INVALID_PARAMETER, NULL);
+    }
+    memcpy(&h, buf, sizeof(jsonImageHead));
+    if (memcmp(h.magic, JSON_IMAGE_MAGIC, 4) || h.version != JSON_IMAGE_VERSION) {
+        ruFree(buf);
+        ruSetError("data is no binary JSON image of version %d", JSON_IMAGE_VERSION);
+        ruRetWithCode(status, RUE_INVALID_PARAMETER, NULL);
+    }
+    if (h.order != JSON_IMAGE_ORDER || h.ptrSize != sizeof(ptr) ||
+        h.nodeSize != sizeof(struct yajl_val_s)) {
+        ruFree(buf);
+        ruSetError("binary JSON image was made on a different platform");
+        ruRetWithCode(status, RUE_FEATURE_NOT_SUPPORTED, NULL);
+    }
+    jsonImage im;
+    memset(&im, 0, sizeof(jsonImage));
+    im.base = buf;
+    imageRegions(&im, &h);
+    uint64_t maxNodes = len / sizeof(struct yajl_val_s);
+    if (!h.nodes || h.nodes > maxNodes || h.slots > len / sizeof(ptr) ||
+        h.chars > len || im.size != len ||
+        (h.chars && im.base[im.size - 1])) {
+        ruFree(buf);
+        ruSetError("binary JSON image is corrupt");
+        ruRetWithCode(status, RUE_INVALID_PARAMETER, NULL);
+    }
+    yajl_val nodes = (yajl_val)(im.base + im.nodesAt);
+    if (!imageLoad(&im, nodes, (rusize)h.nodes)) {
+        ruFree(buf);
+        ruSetError("binary JSON image is corrupt");
+        ruRetWithCode(status, RUE_INVALID_PARAMETER, NULL);
+    }
+    json* j = ruMalloc0(1, json);
+    j->type = MagicJson;
+    j->arena = buf;
+    j->node = nodes;
+    ruRetWithCode(status, RUE_OK, (ruJson)j);
+}
+
+RUAPI alloc_ptr ruJsonToBinary(ruJson rj, rusize* len, int32_t* status) {
+    ruClearError();
+    if (!len) ruRetWithCode(status, RUE_PARAMETER_NOT_SET, NULL);
+    *len = 0;
+    yajl_val v = getYajlVal(rj, status);
+    if (!v) return NULL;
+    jsonImageHead h;
+    memset(&h, 0, sizeof(jsonImageHead));
+    memcpy(h.magic, JSON_IMAGE_MAGIC, 4);
+    h.version = JSON_IMAGE_VERSION;
+    h.order = JSON_IMAGE_ORDER;
+    h.ptrSize = sizeof(ptr);
+    h.nodeSize = sizeof(struct yajl_val_s);
+    imageSize(v, &h);
+
+    jsonImage im;
+    memset(&im, 0, sizeof(jsonImage));
+    imageRegions(&im, &h);
+    // spare a byte so there's always something to allocate
+    im.base = ruMalloc0(im.size + 1, char);
+    memcpy(im.base, &h, sizeof(jsonImageHead));
+    im.nodes = (yajl_val)(im.base + im.nodesAt);
+    im.slots = (ptr*)(im.base + im.slotsAt);
+    im.chars = im.base + im.charsAt;
+    imageCopy(&im, v);
+    imageStore(&im, (yajl_val)(im.base + im.nodesAt), (rusize)h.nodes);
+    *len = im.size;
+    ruRetWithCode(status, RUE_OK, im.base);
+}
+
+RUAPI ruJson ruJsonFromBinary(trans_ptr data, rusize len, int32_t* status) {
+    ruClearError();
+    if (!data) ruRetWithCode(status, RUE_PARAMETER_NOT_SET, NULL);
+    alloc_ptr buf = ruMalloc0(len + 1, char);
+    memcpy(buf, data, len);
+    return imageOpen(buf, len, status);
+}
+
+RUAPI int32_t ruJsonSaveBinary(ruJson rj, trans_chars filePath) {
+    int32_t ret;
+    if (!filePath) return RUE_PARAMETER_NOT_SET;
+    rusize len = 0;
+    alloc_ptr img = ruJsonToBinary(rj, &len, &ret);
+    if (!img) return ret;
+    ret = ruFileSetContents(filePath, img, len);
+    ruFree(img);
+    return ret;
+}
+
+RUAPI ruJson ruJsonLoadBinary(trans_chars filePath, int32_t* status) {
+    ruClearError();
+    if (!filePath) ruRetWithCode(status, RUE_PARAMETER_NOT_SET, NULL);
+    alloc_chars buf = NULL;
+    rusize len = 0;
+    int32_t ret = ruFileGetContents(filePath, &buf, &len);
+    if (ret != RUE_OK) ruRetWithCode(status, ret, NULL);
+    return imageOpen(buf, len, status);
+}
+
+//</editor-fold>
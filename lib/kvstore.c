@@ -21,6 +21,10 @@
  */
 #include "lib.h"
 
+#ifdef _WIN32
+#define close _close
+#endif
+
 //<editor-fold desc="generic store">
 ruMakeTypeGetter(KvStore, KvStoreMagic)
 
@@ -134,37 +138,29 @@ bool isEscaped(char c, bool ends) {
     return false;
 }
 
-static char* keyToPath(FileKvStore *fks, const char* key) {
-    rusize cnt = 0, klen = strlen(key);
-    rusize base = strlen(fks->folderPath) + 1; // trailing slash
-    const char *end = key+klen-1;
-    for(const char *p = key; p <= end; p++) {
-        if (isEscaped(*p, p == key || p == end)) cnt ++;
-        else cnt += 3;
-    }
-    char *replacement = ruMalloc0(base+cnt+1, char);
-    sprintf(replacement, "%s/", fks->folderPath);
-    char *t = replacement + base;
-    for (const char *s = key; s <= end; s++) {
-        if (*s == '*' && s == end && *(t-1) == '/') {
+static int32_t keyToPath(FileKvStore *fks, const char* key, ruPathBuf* pb) {
+    int32_t ret = ruPathBufSet(pb, fks->folderPath);
+    if (ret == RUE_OK) ret = ruPathBufAppend(pb, "/", 1);
+    const char *end = key+strlen(key)-1;
+    for (const char *s = key; ret == RUE_OK && s <= end; s++) {
+        char last = ruPathBufStr(pb)[ruPathBufLen(pb)-1];
+        if (*s == '*' && s == end && last == '/') {
             // leave the last * as wild card for delete
-            *t = *s;
-            t++;
+            ret = ruPathBufAppend(pb, s, 1);
         } else if (*s == ' ') {
             // we collapse multiple WS into a single space or /
-            if (t == replacement || *(t-1) != '/') {
-                *t = '/';
-                t++;
+            if (last != '/') {
+                ret = ruPathBufAppend(pb, "/", 1);
             }
-        } else if (isEscaped(*s, s == key || s == end || *(t-1) == '/' || *(s+1) == ' ')) {
-            *t = *s;
-            t++;
+        } else if (isEscaped(*s, s == key || s == end || last == '/' || *(s+1) == ' ')) {
+            ret = ruPathBufAppend(pb, s, 1);
         } else {
-            snprintf(t, 4, "_%x", *s);
-            t += 3;
+            char hex[4];
+            snprintf(hex, sizeof(hex), "_%x", *s);
+            ret = ruPathBufAppend(pb, hex, 3);
         }
     }
-    return replacement;
+    return ret;
 }
 
 RUAPI int32_t ruFileStoreSet (KvStore *kvs, const char* key,
@@ -177,9 +173,19 @@ RUAPI int32_t ruFileStoreSet (KvStore *kvs, const char* key,
     if (!kvs) return ret;
     FileKvStore *fks = FileKvStoreGet(kvs->ctx, &ret);
     if (!fks) return ret;
-    char *filepath = keyToPath(fks, key);
-    char *dirpath = ruDirName(filepath);
+    char fbuf[PATH_BUF_MIN], dbuf[PATH_BUF_MIN];
+    ruPathBuf fpb, dpb;
+    ruPathBufInit(&fpb, fbuf, sizeof(fbuf), RU_PATH_GROW);
+    ruPathBufInit(&dpb, dbuf, sizeof(dbuf), RU_PATH_GROW);
+    perm_chars filepath = ruPathBufStr(&fpb);
+    perm_chars dirpath = ruPathBufStr(&dpb);
     do {
+        ret = keyToPath(fks, key, &fpb);
+        if (ret == RUE_OK) ret = ruPathBufSet(&dpb, ruPathBufStr(&fpb));
+        if (ret != RUE_OK) break;
+        ruPathBufPop(&dpb);
+        filepath = ruPathBufStr(&fpb);
+        dirpath = ruPathBufStr(&dpb);
         if (ruStrEndsWith(filepath, "*", NULL)) {
             if (val) {
                 ruSetError("Trailing wildcard * is only valid with NULL values");
@@ -212,8 +218,8 @@ RUAPI int32_t ruFileStoreSet (KvStore *kvs, const char* key,
             }
         }
     } while (0);
-    ruFree(dirpath);
-    ruFree(filepath);
+    ruPathBufFree(&dpb);
+    ruPathBufFree(&fpb);
     return ret;
 }
 
@@ -226,9 +232,12 @@ RUAPI int32_t ruFileStoreGet (KvStore *kvs, const char* key, char **val,
     if (!kvs) return ret;
     FileKvStore *fks = FileKvStoreGet(kvs->ctx, &ret);
     if (!fks) return ret;
-    char *filepath = keyToPath(fks, key);
-    ret = ruFileGetContents(filepath, (char**)val, len);
-    ruFree(filepath);
+    char buf[PATH_BUF_MIN];
+    ruPathBuf pb;
+    ruPathBufInit(&pb, buf, sizeof(buf), RU_PATH_GROW);
+    ret = keyToPath(fks, key, &pb);
+    if (ret == RUE_OK) ret = ruFileGetContents(ruPathBufStr(&pb), (char**)val, len);
+    ruPathBufFree(&pb);
     return ret;
 }
 
@@ -254,19 +263,23 @@ RUAPI int32_t ruFileStoreList (KvStore *kvs, const char* key, ruList* result) {
     if (!kvs) return ret;
     FileKvStore *fks = FileKvStoreGet(kvs->ctx, &ret);
     if (!fks) return ret;
-    char *path, *dirpath = NULL, *filepath = keyToPath(fks, key);
-    if (ruStrEndsWith(filepath, "*", NULL)) {
-        path = dirpath = ruDirName(filepath);
-    } else {
-        path = filepath;
+    char buf[PATH_BUF_MIN];
+    ruPathBuf pb;
+    ruPathBufInit(&pb, buf, sizeof(buf), RU_PATH_GROW);
+    ret = keyToPath(fks, key, &pb);
+    if (ret != RUE_OK) {
+        ruPathBufFree(&pb);
+        return ret;
+    }
+    if (ruStrEndsWith(ruPathBufStr(&pb), "*", NULL)) {
+        ruPathBufPop(&pb);
     }
     ruList lst = ruListNew(ruTypePtrFree());
     struct _storeList sl;
     sl.fks = fks;
     sl.lst = lst;
-    ret = ruFolderWalk(path, RU_WALK_FOLDER_LAST,lister, &sl);
-    ruFree(dirpath);
-    ruFree(filepath);
+    ret = ruFolderWalk(ruPathBufStr(&pb), RU_WALK_FOLDER_LAST,lister, &sl);
+    ruPathBufFree(&pb);
     if (ret != RUE_OK) {
         lst = ruListFree(lst);
     }
@@ -275,6 +288,976 @@ RUAPI int32_t ruFileStoreList (KvStore *kvs, const char* key, ruList* result) {
 }
 //</editor-fold>
 
+//<editor-fold desc="log store">
+/*
+ * All values live in one append only log file. Each record is a header
+ * followed by the key and the value:
+ *   crc32c   over the rest of the header, key and value
+ *   marker   LOG_MARK
+ *   keyLen
+ *   valLen   LOG_GONE for a removal
+ * An in memory hash index maps each key to its latest record.
+ */
+#define LOG_FILE        "kvstore.log"
+#define LOG_MAGIC       "RUKVLOG1"
+#define LOG_MAGIC_LEN   8
+#define LOG_MARK        0x52474f4cU
+#define LOG_HEAD        16
+#define LOG_GONE        UINT32_MAX
+#define LOG_NONE        UINT32_MAX
+#define LOG_READ_CHUNK  0x100000
+// logs smaller than this are never compacted automatically
+#define LOG_COMPACT_MIN 0x400000
+
+typedef struct {
+    uint64_t offset;    // record offset in the log
+    uint32_t keyOff;    // offset in keys
+    uint32_t keyLen;
+    uint32_t valLen;    // LOG_GONE when removed
+    uint32_t hash;
+} logEntry;
+
+typedef struct LogKvStore_ {
+    ru_uint type;
+    char* logPath;
+    int fd;
+    uint64_t logSize;
+    uint64_t liveSize;  // bytes of records that are still current
+    ruMutex mux;
+    char* keys;
+    uint32_t keyLen;
+    uint32_t keyCap;
+    logEntry* entries;
+    uint32_t count;
+    uint32_t cap;
+    uint32_t* slots;    // entry number + 1 or 0 when empty
+    uint32_t mask;
+    char* rec;          // record scratch buffer
+    rusize recCap;
+} LogKvStore;
+ruMakeTypeGetter(LogKvStore, MagicLogKvStore)
+
+static rusize_s logPread(int fd, ptr buf, rusize len, uint64_t offset) {
+#ifdef _WIN32
+    if (_lseeki64(fd, offset, SEEK_SET) < 0) return -1;
+    return _read(fd, buf, (unsigned int)len);
+#else
+    return pread(fd, buf, len, (off_t)offset);
+#endif
+}
+
+static rusize_s logPwrite(int fd, trans_ptr buf, rusize len, uint64_t offset) {
+#ifdef _WIN32
+    if (_lseeki64(fd, offset, SEEK_SET) < 0) return -1;
+    return ruWrite(fd, buf, len);
+#else
+    return pwrite(fd, buf, len, (off_t)offset);
+#endif
+}
+
+static int32_t logReadAll(LogKvStore* ls, int fd, ptr buf, rusize len,
+                          uint64_t offset) {
+    rusize done = 0;
+    while (done < len) {
+        rusize_s rd = logPread(fd, (char*)buf + done, len - done, offset + done);
+        if (rd < 0 && errno == EINTR) continue;
+        if (rd <= 0) {
+            ruSetError("failed reading '%s' at %" PRIu64 " errno: %d - %s",
+                       ls->logPath, offset + done, errno, strerror(errno));
+            return rd ? errno2rfec(errno) : RUE_FILE_NOT_FOUND;
+        }
+        done += rd;
+    }
+    return RUE_OK;
+}
+
+static int32_t logWriteAll(LogKvStore* ls, int fd, trans_ptr buf, rusize len,
+                           uint64_t offset) {
+    rusize done = 0;
+    while (done < len) {
+        rusize_s wr = logPwrite(fd, (const char*)buf + done, len - done,
+                                offset + done);
+        if (wr < 0 && errno == EINTR) continue;
+        if (wr <= 0) {
+            ruSetError("failed writing '%s' at %" PRIu64 " errno: %d - %s",
+                       ls->logPath, offset + done, errno, strerror(errno));
+            return RUE_CANT_WRITE;
+        }
+        done += wr;
+    }
+    return RUE_OK;
+}
+
+static int32_t logSync(LogKvStore* ls, int fd) {
+#ifdef _WIN32
+    if (!_commit(fd)) return RUE_OK;
+#else
+    if (!fsync(fd)) return RUE_OK;
+#endif
+    ruSetError("failed syncing '%s' errno: %d - %s",
+               ls->logPath, errno, strerror(errno));
+    return errno2rfec(errno);
+}
+
+static int32_t logTruncate(LogKvStore* ls, uint64_t size) {
+#ifdef _WIN32
+    int err = _chsize_s(ls->fd, (__int64)size);
+#else
+    int err = ftruncate(ls->fd, (off_t)size) ? errno : 0;
+#endif
+    if (!err) return RUE_OK;
+    ruSetError("failed truncating '%s' errno: %d - %s",
+               ls->logPath, err, strerror(err));
+    return errno2rfec(err);
+}
+
+static inline void logPut32(char* p, uint32_t v) {
+    p[0] = (char)(v & 0xff);
+    p[1] = (char)((v >> 8) & 0xff);
+    p[2] = (char)((v >> 16) & 0xff);
+    p[3] = (char)((v >> 24) & 0xff);
+}
+
+static inline uint32_t logGet32(trans_chars p) {
+    const uint8_t* u = (const uint8_t*)p;
+    return u[0] | ((uint32_t)u[1] << 8) | ((uint32_t)u[2] << 16) |
+           ((uint32_t)u[3] << 24);
+}
+
+static inline rusize logRecSize(uint32_t keyLen, uint32_t valLen) {
+    return LOG_HEAD + (rusize)keyLen + (valLen == LOG_GONE ? 0 : valLen);
+}
+
+static char* logScratch(LogKvStore* ls, rusize len) {
+    if (len > ls->recCap) {
+        ruFree(ls->rec);
+        ls->recCap = len < 4096 ? 4096 : len;
+        ls->rec = ruMalloc0(ls->recCap, char);
+    }
+    return ls->rec;
+}
+
+/* Collapses runs of spaces and drops leading and trailing ones */
+static alloc_chars logKey(trans_chars key, uint32_t* len) {
+    rusize klen = strlen(key);
+    char* out = ruMalloc0(klen + 1, char);
+    char* o = out;
+    for (trans_chars s = key; *s; s++) {
+        if (*s == ' ' && (o == out || o[-1] == ' ')) continue;
+        *o++ = *s;
+    }
+    if (o > out && o[-1] == ' ') o--;
+    *o = '\0';
+    *len = (uint32_t)(o - out);
+    return out;
+}
+
+static inline uint32_t logHash(trans_chars key, uint32_t len) {
+    return (uint32_t)ruXxh64(key, len, 0);
+}
+
+static uint32_t logFind(LogKvStore* ls, trans_chars key, uint32_t len,
+                        uint32_t hash) {
+    for (uint32_t s = hash & ls->mask; ls->slots[s]; s = (s + 1) & ls->mask) {
+        logEntry* e = &ls->entries[ls->slots[s] - 1];
+        if (e->hash == hash && e->keyLen == len &&
+            !memcmp(ls->keys + e->keyOff, key, len)) {
+            return ls->slots[s] - 1;
+        }
+    }
+    return LOG_NONE;
+}
+
+static void logSlot(LogKvStore* ls, uint32_t entry) {
+    uint32_t s = ls->entries[entry].hash & ls->mask;
+    while (ls->slots[s]) s = (s + 1) & ls->mask;
+    ls->slots[s] = entry + 1;
+}
+
+static void logIndexReset(LogKvStore* ls) {
+    ruFree(ls->keys);
+    ruFree(ls->entries);
+    ruFree(ls->slots);
+    ls->keyCap = 4096;
+    ls->keys = ruMalloc0(ls->keyCap, char);
+    ls->keyLen = 0;
+    ls->cap = 64;
+    ls->entries = ruMalloc0(ls->cap, logEntry);
+    ls->count = 0;
+    ls->mask = 127;
+    ls->slots = ruMalloc0(ls->mask + 1, uint32_t);
+    ls->liveSize = 0;
+}
+
+static int32_t logAdd(LogKvStore* ls, trans_chars key, uint32_t len,
+                      uint32_t hash, uint32_t* entry) {
+    if ((rusize)ls->keyLen + len > UINT32_MAX - 1) {
+        ruSetError("too many keys in '%s'", ls->logPath);
+        return RUE_OVERFLOW;
+    }
+    if (ls->keyLen + len > ls->keyCap) {
+        rusize cap = (rusize)ls->keyCap * 2;
+        if (cap < (rusize)ls->keyLen + len) cap = (rusize)ls->keyLen + len;
+        if (cap > UINT32_MAX - 1) cap = UINT32_MAX - 1;
+        ls->keyCap = (uint32_t)cap;
+        ls->keys = ruRealloc(ls->keys, ls->keyCap, char);
+    }
+    if (ls->count == ls->cap) {
+        ls->cap *= 2;
+        ls->entries = ruRealloc(ls->entries, ls->cap, logEntry);
+    }
+    if (ls->count * 2 >= ls->mask) {
+        ls->mask = ls->mask * 2 + 1;
+        ruFree(ls->slots);
+        ls->slots = ruMalloc0(ls->mask + 1, uint32_t);
+        for (uint32_t i = 0; i < ls->count; i++) logSlot(ls, i);
+    }
+    logEntry* e = &ls->entries[ls->count];
+    memcpy(ls->keys + ls->keyLen, key, len);
+    e->keyOff = ls->keyLen;
+    e->keyLen = len;
+    e->valLen = LOG_GONE;
+    e->hash = hash;
+    e->offset = 0;
+    ls->keyLen += len;
+    *entry = ls->count++;
+    logSlot(ls, *entry);
+    return RUE_OK;
+}
+
+/* Points the index at the record at offset */
+static int32_t logApply(LogKvStore* ls, trans_chars key, uint32_t keyLen,
+                        uint32_t valLen, uint64_t offset) {
+    uint32_t hash = logHash(key, keyLen);
+    uint32_t entry = logFind(ls, key, keyLen, hash);
+    if (entry == LOG_NONE) {
+        if (valLen == LOG_GONE) return RUE_OK;
+        int32_t ret = logAdd(ls, key, keyLen, hash, &entry);
+        if (ret != RUE_OK) return ret;
+    }
+    logEntry* e = &ls->entries[entry];
+    if (e->valLen != LOG_GONE) ls->liveSize -= logRecSize(e->keyLen, e->valLen);
+    e->valLen = valLen;
+    e->offset = offset;
+    if (valLen != LOG_GONE) ls->liveSize += logRecSize(keyLen, valLen);
+    return RUE_OK;
+}
+
+static uint32_t logCrc(trans_chars rec, rusize len) {
+    return ruCrc32c(0, rec + 4, len - 4);
+}
+
+static int32_t logAppend(LogKvStore* ls, trans_chars key, uint32_t keyLen,
+                         trans_chars val, uint32_t valLen) {
+    rusize len = logRecSize(keyLen, valLen);
+    char* rec = logScratch(ls, len);
+    logPut32(rec + 4, LOG_MARK);
+    logPut32(rec + 8, keyLen);
+    logPut32(rec + 12, valLen);
+    memcpy(rec + LOG_HEAD, key, keyLen);
+    if (valLen != LOG_GONE) memcpy(rec + LOG_HEAD + keyLen, val, valLen);
+    logPut32(rec, logCrc(rec, len));
+    int32_t ret = logWriteAll(ls, ls->fd, rec, len, ls->logSize);
+    if (ret != RUE_OK) {
+        // drop whatever made it so the log stays readable
+        logTruncate(ls, ls->logSize);
+        return ret;
+    }
+    uint64_t offset = ls->logSize;
+    ls->logSize += len;
+    return logApply(ls, key, keyLen, valLen, offset);
+}
+
+static uint64_t logEnd(LogKvStore* ls) {
+#ifdef _WIN32
+    int64_t end = _lseeki64(ls->fd, 0, SEEK_END);
+#else
+    int64_t end = lseek(ls->fd, 0, SEEK_END);
+#endif
+    return end < 0 ? 0 : (uint64_t)end;
+}
+
+typedef struct {
+    char* buf;
+    rusize cap;
+    rusize len;
+    uint64_t off;   // file offset of buf
+} logScan;
+
+/* Returns need bytes at offset off or NULL if the file is shorter */
+static trans_chars scanAt(LogKvStore* ls, logScan* sc, uint64_t off,
+                          rusize need, uint64_t end) {
+    if (off + need > end) return NULL;
+    if (off >= sc->off && off + need <= sc->off + sc->len) {
+        return sc->buf + (off - sc->off);
+    }
+    if (need > sc->cap) {
+        ruFree(sc->buf);
+        sc->cap = need;
+        sc->buf = ruMalloc0(sc->cap, char);
+    }
+    rusize len = sc->cap;
+    if (len > end - off) len = (rusize)(end - off);
+    sc->off = off;
+    sc->len = 0;
+    if (logReadAll(ls, ls->fd, sc->buf, len, off) != RUE_OK) return NULL;
+    sc->len = len;
+    return sc->buf;
+}
+
+/* Reads the log and drops a torn or damaged tail */
+static int32_t logRecover(LogKvStore* ls) {
+    logIndexReset(ls);
+    uint64_t end = logEnd(ls);
+    char magic[LOG_MAGIC_LEN];
+    if (end < LOG_MAGIC_LEN) {
+        // new log or one that never got its header
+        int32_t ret = logTruncate(ls, 0);
+        if (ret == RUE_OK) ret = logWriteAll(ls, ls->fd, LOG_MAGIC,
+                                             LOG_MAGIC_LEN, 0);
+        ls->logSize = LOG_MAGIC_LEN;
+        return ret;
+    }
+    int32_t ret = logReadAll(ls, ls->fd, magic, LOG_MAGIC_LEN, 0);
+    if (ret != RUE_OK) return ret;
+    if (memcmp(magic, LOG_MAGIC, LOG_MAGIC_LEN) != 0) {
+        ruSetError("'%s' is not a key value log", ls->logPath);
+        return RUE_INVALID_PARAMETER;
+    }
+
+    logScan sc;
+    memset(&sc, 0, sizeof(sc));
+    sc.cap = LOG_READ_CHUNK;
+    sc.buf = ruMalloc0(sc.cap, char);
+    uint64_t off = LOG_MAGIC_LEN;
+    while (ret == RUE_OK) {
+        trans_chars rec = scanAt(ls, &sc, off, LOG_HEAD, end);
+        if (!rec || logGet32(rec + 4) != LOG_MARK) break;
+        uint32_t keyLen = logGet32(rec + 8), valLen = logGet32(rec + 12);
+        rusize size = logRecSize(keyLen, valLen);
+        rec = scanAt(ls, &sc, off, size, end);
+        if (!rec || logGet32(rec) != logCrc(rec, size)) break;
+        ret = logApply(ls, rec + LOG_HEAD, keyLen, valLen, off);
+        off += size;
+    }
+    ruFree(sc.buf);
+    if (ret != RUE_OK) return ret;
+
+    ls->logSize = off;
+    if (end > off) {
+        ruWarnLogf("dropping %" PRIu64 " damaged bytes at the end of '%s'",
+                   end - off, ls->logPath);
+        ret = logTruncate(ls, off);
+    }
+    return ret;
+}
+
+static ptr logStoreFree(ptr ctx) {
+    LogKvStore *ls = LogKvStoreGet(ctx, NULL);
+    if (!ls) return NULL;
+    if (ls->fd >= 0) {
+        logSync(ls, ls->fd);
+        close(ls->fd);
+    }
+    ls->mux = ruMutexFree(ls->mux);
+    ruFree(ls->logPath);
+    ruFree(ls->keys);
+    ruFree(ls->entries);
+    ruFree(ls->slots);
+    ruFree(ls->rec);
+    ls->type = 0;
+    ruFree(ls);
+    return NULL;
+}
+
+static int logOpen(trans_chars path, int32_t* code) {
+    int flags = O_CREAT | O_RDWR;
+#ifdef _WIN32
+    flags |= O_BINARY;
+#endif
+    return ruOpen(path, flags, 0644, code);
+}
+
+RUAPI KvStore* ruNewLogStore(const char *folderPath, int32_t* code) {
+    if (!folderPath) ruRetWithCode(code, RUE_PARAMETER_NOT_SET, NULL);
+    int32_t ret;
+    if (!ruIsDir(folderPath)) {
+        ret = ruMkdir(folderPath, 0755, true);
+        if (ret != RUE_OK) ruRetWithCode(code, ret, NULL);
+    }
+    LogKvStore* ls = ruMalloc0(1, LogKvStore);
+    ls->type = MagicLogKvStore;
+    ls->logPath = ruPathJoin(folderPath, LOG_FILE);
+    ls->fd = logOpen(ls->logPath, &ret);
+    if (ret == RUE_OK) ret = logRecover(ls);
+    if (ret != RUE_OK) {
+        logStoreFree(ls);
+        ruRetWithCode(code, ret, NULL);
+    }
+    ls->mux = ruMutexInit();
+
+    KvStore* kvs = ruNewStore();
+    kvs->ctx = ls;
+    kvs->ctxFree = (ruFreeFunc)logStoreFree;
+    kvs->get = ruLogStoreGet;
+    kvs->set = ruLogStoreSet;
+    kvs->list = ruLogStoreList;
+    ruRetWithCode(code, RUE_OK, kvs);
+}
+
+/* Rewrites the log with only the current records */
+static int32_t logCompact(LogKvStore* ls) {
+    alloc_chars tmpPath = ruDupPrintf("%s.tmp", ls->logPath);
+    int32_t ret;
+    int fd = logOpen(tmpPath, &ret);
+    if (ret != RUE_OK) {
+        ruFree(tmpPath);
+        return ret;
+    }
+    ret = logWriteAll(ls, fd, LOG_MAGIC, LOG_MAGIC_LEN, 0);
+    uint64_t off = LOG_MAGIC_LEN;
+    // gather consecutive records into one buffer per write
+    rusize outCap = LOG_READ_CHUNK, outLen = 0;
+    char* out = ruMalloc0(outCap, char);
+    // the index keeps the old offsets until the new log is in place
+    uint64_t* offs = ruMalloc0(ls->count? ls->count : 1, uint64_t);
+    for (uint32_t i = 0; ret == RUE_OK && i < ls->count; i++) {
+        logEntry* e = &ls->entries[i];
+        if (e->valLen == LOG_GONE) continue;
+        rusize len = logRecSize(e->keyLen, e->valLen);
+        if (outLen + len > outCap) {
+            ret = logWriteAll(ls, fd, out, outLen, off);
+            off += outLen;
+            outLen = 0;
+            if (len > outCap) {
+                outCap = len;
+                ruFree(out);
+                out = ruMalloc0(outCap, char);
+            }
+        }
+        if (ret == RUE_OK) ret = logReadAll(ls, ls->fd, out + outLen, len,
+                                            e->offset);
+        // new offset, relative to what has been written so far
+        offs[i] = off + outLen;
+        outLen += len;
+    }
+    if (ret == RUE_OK && outLen) ret = logWriteAll(ls, fd, out, outLen, off);
+    off += outLen;
+    ruFree(out);
+    if (ret == RUE_OK) ret = logSync(ls, fd);
+    close(fd);
+    if (ret == RUE_OK) {
+        close(ls->fd);
+        ls->fd = -1;
+        ret = ruFileRename(tmpPath, ls->logPath);
+        int32_t rc;
+        ls->fd = logOpen(ls->logPath, &rc);
+        if (ret == RUE_OK) ret = rc;
+    }
+    if (ret != RUE_OK) {
+        // the old log is still in place unless the rename went through
+        ruFileRemove(tmpPath);
+        ruFree(tmpPath);
+        ruFree(offs);
+        return ret;
+    }
+    ruFree(tmpPath);
+    ls->logSize = off;
+
+    // drop removed keys from the index
+    char* keys = ruMalloc0(ls->keyCap, char);
+    uint32_t keyLen = 0, count = 0;
+    for (uint32_t i = 0; i < ls->count; i++) {
+        logEntry* e = &ls->entries[i];
+        if (e->valLen == LOG_GONE) continue;
+        e->offset = offs[i];
+        memcpy(keys + keyLen, ls->keys + e->keyOff, e->keyLen);
+        e->keyOff = keyLen;
+        keyLen += e->keyLen;
+        ls->entries[count++] = *e;
+    }
+    ruFree(offs);
+    ruFree(ls->keys);
+    ls->keys = keys;
+    ls->keyLen = keyLen;
+    ls->count = count;
+    memset(ls->slots, 0, (ls->mask + 1) * sizeof(uint32_t));
+    for (uint32_t i = 0; i < ls->count; i++) logSlot(ls, i);
+    return RUE_OK;
+}
+
+static void logMaybeCompact(LogKvStore* ls) {
+    if (ls->logSize < LOG_COMPACT_MIN || ls->liveSize * 2 > ls->logSize) return;
+    int32_t ret = logCompact(ls);
+    if (ret != RUE_OK) {
+        ruWarnLogf("failed compacting '%s' ec: %d", ls->logPath, ret);
+    }
+}
+
+RUAPI int32_t ruLogStoreCompact(KvStore *kvs) {
+    ruClearError();
+    int32_t ret = RUE_OK;
+    kvs = KvStoreGet(kvs, &ret);
+    if (!kvs) return ret;
+    LogKvStore *ls = LogKvStoreGet(kvs->ctx, &ret);
+    if (!ls) return ret;
+    ruMutexLock(ls->mux);
+    ret = logCompact(ls);
+    ruMutexUnlock(ls->mux);
+    return ret;
+}
+
+/* Removes all keys starting with prefix */
+static int32_t logRemoveAll(LogKvStore* ls, trans_chars prefix, uint32_t len) {
+    if (!len) {
+        // everything goes
+        int32_t ret = logTruncate(ls, LOG_MAGIC_LEN);
+        if (ret == RUE_OK) ret = logSync(ls, ls->fd);
+        if (ret != RUE_OK) return ret;
+        ls->logSize = LOG_MAGIC_LEN;
+        logIndexReset(ls);
+        return RUE_OK;
+    }
+    int32_t ret = RUE_OK;
+    for (uint32_t i = 0; ret == RUE_OK && i < ls->count; i++) {
+        logEntry* e = &ls->entries[i];
+        if (e->valLen == LOG_GONE || e->keyLen < len ||
+            memcmp(ls->keys + e->keyOff, prefix, len) != 0) continue;
+        ret = logAppend(ls, ls->keys + e->keyOff, e->keyLen, NULL, LOG_GONE);
+    }
+    return ret;
+}
+
+RUAPI int32_t ruLogStoreSet (KvStore *kvs, const char* key,
+                             const char *val, rusize len) {
+    ruClearError();
+    if (!key) return RUE_PARAMETER_NOT_SET;
+    if (!strlen(key)) return RUE_INVALID_PARAMETER;
+    int32_t ret = RUE_OK;
+    kvs = KvStoreGet(kvs, &ret);
+    if (!kvs) return ret;
+    LogKvStore *ls = LogKvStoreGet(kvs->ctx, &ret);
+    if (!ls) return ret;
+    if (val && len == RU_SIZE_AUTO) len = strlen(val);
+    if (val && len >= LOG_GONE) {
+        ruSetError("value of %" PRIu64 " bytes is too large", (uint64_t)len);
+        return RUE_OVERFLOW;
+    }
+    uint32_t klen;
+    alloc_chars nkey = logKey(key, &klen);
+    if (!klen) {
+        ruFree(nkey);
+        return RUE_INVALID_PARAMETER;
+    }
+    bool wild = nkey[klen - 1] == '*' && (klen == 1 || nkey[klen - 2] == ' ');
+    if (wild && val) {
+        ruFree(nkey);
+        ruSetError("Trailing wildcard * is only valid with NULL values");
+        return RUE_INVALID_PARAMETER;
+    }
+    ruMutexLock(ls->mux);
+    if (wild) {
+        ret = logRemoveAll(ls, nkey, klen - 1);
+    } else if (val) {
+        ret = logAppend(ls, nkey, klen, val, (uint32_t)len);
+    } else {
+        uint32_t entry = logFind(ls, nkey, klen, logHash(nkey, klen));
+        if (entry != LOG_NONE && ls->entries[entry].valLen != LOG_GONE) {
+            ret = logAppend(ls, nkey, klen, NULL, LOG_GONE);
+        }
+    }
+    if (ret == RUE_OK) logMaybeCompact(ls);
+    ruMutexUnlock(ls->mux);
+    ruFree(nkey);
+    return ret;
+}
+
+RUAPI int32_t ruLogStoreGet (KvStore *kvs, const char* key, char **val,
+                             rusize* len) {
+    if (!key || !val || !len) return RUE_PARAMETER_NOT_SET;
+    if (!strlen(key)) return RUE_INVALID_PARAMETER;
+    int32_t ret = RUE_OK;
+    kvs = KvStoreGet(kvs, &ret);
+    if (!kvs) return ret;
+    LogKvStore *ls = LogKvStoreGet(kvs->ctx, &ret);
+    if (!ls) return ret;
+    uint32_t klen;
+    alloc_chars nkey = logKey(key, &klen);
+    ruMutexLock(ls->mux);
+    uint32_t entry = logFind(ls, nkey, klen, logHash(nkey, klen));
+    ruFree(nkey);
+    if (entry == LOG_NONE || ls->entries[entry].valLen == LOG_GONE) {
+        ruMutexUnlock(ls->mux);
+        return RUE_FILE_NOT_FOUND;
+    }
+    logEntry e = ls->entries[entry];
+    rusize size = logRecSize(e.keyLen, e.valLen);
+    char* rec = ruMalloc0(size + 1, char);
+    ret = logReadAll(ls, ls->fd, rec, size, e.offset);
+    ruMutexUnlock(ls->mux);
+    if (ret == RUE_OK && logGet32(rec) != logCrc(rec, size)) {
+        ruSetError("damaged record at %" PRIu64 " in '%s'",
+                   e.offset, ls->logPath);
+        ret = RUE_GENERAL;
+    }
+    if (ret != RUE_OK) {
+        ruFree(rec);
+        return ret;
+    }
+    memmove(rec, rec + LOG_HEAD + e.keyLen, e.valLen);
+    rec[e.valLen] = '\0';
+    *val = rec;
+    *len = e.valLen;
+    return RUE_OK;
+}
+
+RUAPI int32_t ruLogStoreList (KvStore *kvs, const char* key, ruList* result) {
+    if (!key || !result) return RUE_PARAMETER_NOT_SET;
+    if (!strlen(key)) return RUE_INVALID_PARAMETER;
+    int32_t ret = RUE_OK;
+    kvs = KvStoreGet(kvs, &ret);
+    if (!kvs) return ret;
+    LogKvStore *ls = LogKvStoreGet(kvs->ctx, &ret);
+    if (!ls) return ret;
+    uint32_t klen;
+    alloc_chars prefix = logKey(key, &klen);
+    if (klen && prefix[klen - 1] == '*' && (klen == 1 || prefix[klen - 2] == ' ')) {
+        // "a b *" lists everything under "a b "
+        prefix[--klen] = '\0';
+    } else if (klen) {
+        prefix = ruRealloc(prefix, klen + 2, char);
+        prefix[klen++] = ' ';
+        prefix[klen] = '\0';
+    }
+    ruList lst = ruListNew(ruTypePtrFree());
+    ruMutexLock(ls->mux);
+    for (uint32_t i = 0; i < ls->count; i++) {
+        logEntry* e = &ls->entries[i];
+        if (e->valLen == LOG_GONE || e->keyLen < klen ||
+            memcmp(ls->keys + e->keyOff, prefix, klen) != 0) continue;
+        ruListAppend(lst, ruStrNDup(ls->keys + e->keyOff, e->keyLen));
+    }
+    ruMutexUnlock(ls->mux);
+    ruFree(prefix);
+    *result = lst;
+    return RUE_OK;
+}
+//</editor-fold>
+
+//<editor-fold desc="cache store">
+// per entry bookkeeping added to the budget
+#define CACHE_OVERHEAD 64
+
+typedef struct cacheEntry_ {
+    alloc_chars key;
+    alloc_chars val;        // NULL for a pending removal
+    rusize len;
+    bool dirty;
+    struct cacheEntry_* prev;
+    struct cacheEntry_* next;
+} cacheEntry;
+
+typedef struct CacheKvStore_ {
+    ru_uint type;
+    KvStore* store;
+    uint32_t flags;
+    rusize budget;
+    ruMutex mux;
+    ruMap map;              // key: cacheEntry*
+    cacheEntry* head;       // most recently used
+    cacheEntry* tail;
+    uint64_t writeGen;      // bumped whenever the wrapped store is changed
+    ruCacheStats stats;
+} CacheKvStore;
+ruMakeTypeGetter(CacheKvStore, MagicCacheKvStore)
+
+static inline rusize cacheSize(cacheEntry* ce) {
+    return strlen(ce->key) + ce->len + CACHE_OVERHEAD;
+}
+
+static alloc_chars cacheCopy(trans_chars val, rusize len) {
+    char* copy = ruMalloc0(len + 1, char);
+    memcpy(copy, val, len);
+    return copy;
+}
+
+static ptr cacheEntryFree(ptr o) {
+    cacheEntry* ce = (cacheEntry*)o;
+    if (!ce) return NULL;
+    ruFree(ce->key);
+    ruFree(ce->val);
+    ruFree(ce);
+    return NULL;
+}
+
+static void cacheUnlink(CacheKvStore* cs, cacheEntry* ce) {
+    if (ce->prev) ce->prev->next = ce->next;
+    else cs->head = ce->next;
+    if (ce->next) ce->next->prev = ce->prev;
+    else cs->tail = ce->prev;
+    ce->prev = ce->next = NULL;
+}
+
+static void cachePushFront(CacheKvStore* cs, cacheEntry* ce) {
+    ce->next = cs->head;
+    if (cs->head) cs->head->prev = ce;
+    cs->head = ce;
+    if (!cs->tail) cs->tail = ce;
+}
+
+static void cacheDrop(CacheKvStore* cs, cacheEntry* ce) {
+    cacheUnlink(cs, ce);
+    cs->stats.bytes -= cacheSize(ce);
+    cs->stats.entries--;
+    ruMapRemove(cs->map, ce->key, NULL);
+}
+
+/* Hands a changed entry to the backing store */
+static int32_t cacheWrite(CacheKvStore* cs, cacheEntry* ce) {
+    if (!ce->dirty) return RUE_OK;
+    int32_t ret = cs->store->set(cs->store, ce->key, ce->val, ce->len);
+    if (ret == RUE_FILE_NOT_FOUND && !ce->val) ret = RUE_OK;
+    if (ret != RUE_OK) return ret;
+    ce->dirty = false;
+    cs->writeGen++;
+    cs->stats.writes++;
+    return RUE_OK;
+}
+
+static int32_t cacheEvict(CacheKvStore* cs) {
+    while (cs->stats.bytes > cs->budget && cs->tail) {
+        cacheEntry* ce = cs->tail;
+        int32_t ret = cacheWrite(cs, ce);
+        if (ret != RUE_OK) {
+            ruSetError("failed writing back '%s' ec: %d", ce->key, ret);
+            return ret;
+        }
+        cacheDrop(cs, ce);
+        cs->stats.evictions++;
+    }
+    return RUE_OK;
+}
+
+/* Caches the given value and takes ownership of key and val */
+static int32_t cachePut(CacheKvStore* cs, alloc_chars key, alloc_chars val,
+                        rusize len, bool dirty) {
+    cacheEntry* ce = NULL;
+    if (ruMapGet(cs->map, key, &ce) == RUE_OK) {
+        cs->stats.bytes -= cacheSize(ce);
+        ruFree(ce->val);
+        ruFree(key);
+        cacheUnlink(cs, ce);
+    } else {
+        ce = ruMalloc0(1, cacheEntry);
+        ce->key = key;
+        ruMapPut(cs->map, ce->key, ce);
+        cs->stats.entries++;
+    }
+    ce->val = val;
+    ce->len = len;
+    ce->dirty = dirty;
+    cs->stats.bytes += cacheSize(ce);
+    cachePushFront(cs, ce);
+    return cacheEvict(cs);
+}
+
+static int32_t cacheFlush(CacheKvStore* cs) {
+    int32_t ret = RUE_OK;
+    for (cacheEntry* ce = cs->tail; ce; ) {
+        cacheEntry* prev = ce->prev;
+        int32_t rc = cacheWrite(cs, ce);
+        if (rc != RUE_OK && ret == RUE_OK) ret = rc;
+        // written removals have nothing left to cache
+        if (rc == RUE_OK && !ce->val) cacheDrop(cs, ce);
+        ce = prev;
+    }
+    return ret;
+}
+
+static ptr cacheStoreFree(ptr ctx) {
+    CacheKvStore *cs = CacheKvStoreGet(ctx, NULL);
+    if (!cs) return NULL;
+    int32_t ret = cacheFlush(cs);
+    if (ret != RUE_OK) {
+        ruWarnLogf("failed writing back cached values ec: %d", ret);
+    }
+    cs->map = ruMapFree(cs->map);
+    ruFreeStore(cs->store);
+    cs->mux = ruMutexFree(cs->mux);
+    cs->type = 0;
+    ruFree(cs);
+    return NULL;
+}
+
+RUAPI KvStore* ruNewCacheStore(KvStore* store, rusize budget, uint32_t flags,
+                               int32_t* code) {
+    int32_t ret;
+    if (!store) ruRetWithCode(code, RUE_PARAMETER_NOT_SET, NULL);
+    if (!KvStoreGet(store, &ret)) ruRetWithCode(code, ret, NULL);
+    if (!store->set || !store->get || !store->list) {
+        ruRetWithCode(code, RUE_INVALID_PARAMETER, NULL);
+    }
+    CacheKvStore* cs = ruMalloc0(1, CacheKvStore);
+    cs->type = MagicCacheKvStore;
+    cs->store = store;
+    cs->flags = flags;
+    cs->budget = budget;
+    cs->mux = ruMutexInit();
+    cs->map = ruMapNew(ruTypeStrRef(), ruTypePtr(cacheEntryFree));
+
+    KvStore* kvs = ruNewStore();
+    kvs->ctx = cs;
+    kvs->ctxFree = (ruFreeFunc)cacheStoreFree;
+    kvs->get = ruCacheStoreGet;
+    kvs->set = ruCacheStoreSet;
+    kvs->list = ruCacheStoreList;
+    ruRetWithCode(code, RUE_OK, kvs);
+}
+
+static CacheKvStore* cacheStoreGet(KvStore* kvs, int32_t* code) {
+    kvs = KvStoreGet(kvs, code);
+    if (!kvs) return NULL;
+    return CacheKvStoreGet(kvs->ctx, code);
+}
+
+/* Drops cached entries under prefix, dirty or not */
+static void cacheDropAll(CacheKvStore* cs, trans_chars prefix, rusize len) {
+    for (cacheEntry* ce = cs->head; ce; ) {
+        cacheEntry* next = ce->next;
+        if (!strncmp(ce->key, prefix, len)) cacheDrop(cs, ce);
+        ce = next;
+    }
+}
+
+RUAPI int32_t ruCacheStoreSet (KvStore *kvs, const char* key,
+                               const char *val, rusize len) {
+    ruClearError();
+    if (!key) return RUE_PARAMETER_NOT_SET;
+    if (!strlen(key)) return RUE_INVALID_PARAMETER;
+    int32_t ret = RUE_OK;
+    CacheKvStore *cs = cacheStoreGet(kvs, &ret);
+    if (!cs) return ret;
+    if (val && len == RU_SIZE_AUTO) len = strlen(val);
+    uint32_t klen;
+    alloc_chars nkey = logKey(key, &klen);
+    if (!klen) {
+        ruFree(nkey);
+        return RUE_INVALID_PARAMETER;
+    }
+    bool wild = nkey[klen - 1] == '*' && (klen == 1 || nkey[klen - 2] == ' ');
+    bool back = (cs->flags & RU_CACHE_WRITE_BACK) && !wild &&
+                klen + (val ? len : 0) + CACHE_OVERHEAD <= cs->budget;
+
+    ruMutexLock(cs->mux);
+    if (wild) {
+        // pending changes underneath are superseded by the removal
+        cacheDropAll(cs, nkey, klen - 1);
+    }
+    if (!back) {
+        ret = cs->store->set(cs->store, key, val, len);
+        cs->writeGen++;
+        if (ret == RUE_OK && !wild) {
+            cacheEntry* ce = NULL;
+            if (ruMapGet(cs->map, nkey, &ce) == RUE_OK) cacheDrop(cs, ce);
+            if (val && klen + len + CACHE_OVERHEAD <= cs->budget) {
+                ret = cachePut(cs, nkey, cacheCopy(val, len), len, false);
+                nkey = NULL;
+            }
+        }
+    } else {
+        ret = cachePut(cs, nkey, val ? cacheCopy(val, len) : NULL, len, true);
+        nkey = NULL;
+    }
+    ruMutexUnlock(cs->mux);
+    ruFree(nkey);
+    return ret;
+}
+
+RUAPI int32_t ruCacheStoreGet (KvStore *kvs, const char* key, char **val,
+                               rusize* len) {
+    if (!key || !val || !len) return RUE_PARAMETER_NOT_SET;
+    if (!strlen(key)) return RUE_INVALID_PARAMETER;
+    int32_t ret = RUE_OK;
+    CacheKvStore *cs = cacheStoreGet(kvs, &ret);
+    if (!cs) return ret;
+    uint32_t klen;
+    alloc_chars nkey = logKey(key, &klen);
+    ruMutexLock(cs->mux);
+    cacheEntry* ce = NULL;
+    if (ruMapGet(cs->map, nkey, &ce) == RUE_OK) {
+        cs->stats.hits++;
+        cacheUnlink(cs, ce);
+        cachePushFront(cs, ce);
+        if (ce->val) {
+            *val = cacheCopy(ce->val, ce->len);
+            *len = ce->len;
+        } else {
+            ret = RUE_FILE_NOT_FOUND;
+        }
+        ruMutexUnlock(cs->mux);
+        ruFree(nkey);
+        return ret;
+    }
+    cs->stats.misses++;
+    uint64_t gen = cs->writeGen;
+    // other callers get to use the cache while the wrapped store is read
+    ruMutexUnlock(cs->mux);
+    char* got = NULL;
+    rusize glen = 0;
+    ret = cs->store->get(cs->store, key, &got, &glen);
+    if (ret == RUE_OK && got && klen + glen + CACHE_OVERHEAD <= cs->budget) {
+        ruMutexLock(cs->mux);
+        // what we read may already be outdated when the store was changed
+        if (gen == cs->writeGen && ruMapGet(cs->map, nkey, &ce) != RUE_OK) {
+            // the caller gets its own copy. Failing to evict only concerns
+            // other dirty entries, which stay cached until a later flush.
+            cachePut(cs, nkey, cacheCopy(got, glen), glen, false);
+            nkey = NULL;
+        }
+        ruMutexUnlock(cs->mux);
+    }
+    ruFree(nkey);
+    *val = got;
+    *len = glen;
+    return ret;
+}
+
+RUAPI int32_t ruCacheStoreList (KvStore *kvs, const char* key, ruList* result) {
+    if (!key || !result) return RUE_PARAMETER_NOT_SET;
+    if (!strlen(key)) return RUE_INVALID_PARAMETER;
+    int32_t ret = RUE_OK;
+    CacheKvStore *cs = cacheStoreGet(kvs, &ret);
+    if (!cs) return ret;
+    ruMutexLock(cs->mux);
+    ret = cacheFlush(cs);
+    if (ret == RUE_OK) ret = cs->store->list(cs->store, key, result);
+    ruMutexUnlock(cs->mux);
+    return ret;
+}
+
+RUAPI int32_t ruCacheStoreFlush(KvStore *kvs) {
+    ruClearError();
+    int32_t ret = RUE_OK;
+    CacheKvStore *cs = cacheStoreGet(kvs, &ret);
+    if (!cs) return ret;
+    ruMutexLock(cs->mux);
+    ret = cacheFlush(cs);
+    ruMutexUnlock(cs->mux);
+    return ret;
+}
+
+RUAPI int32_t ruCacheStoreStats(KvStore *kvs, ruCacheStats* stats) {
+    if (!stats) return RUE_PARAMETER_NOT_SET;
+    int32_t ret = RUE_OK;
+    CacheKvStore *cs = cacheStoreGet(kvs, &ret);
+    if (!cs) return ret;
+    ruMutexLock(cs->mux);
+    *stats = cs->stats;
+    ruMutexUnlock(cs->mux);
+    return RUE_OK;
+}
+//</editor-fold>
+
 //<editor-fold desc="ini store">
 //</editor-fold>
 
@@ -141,6 +141,9 @@ extern "C" {
 
 // Error reporting
 #define RU_ERRBUF_SIZE 2048
+// initial stack buffer size for ruPathBuf based path building
+#define PATH_BUF_MIN 256
+
 #ifdef RUMS
 
 #define RU_SLASH '\\'
@@ -215,6 +218,16 @@ void ruClearError(void);
 #define MagicSinkCtx        2315
 #define MagicPreCtx         2316
 #define MagicCond           2317
+#define MagicAio            2318
+#define MagicWriteBatch     2319
+#define MagicHasher         2320
+#define MagicJsonStream     2321
+#define MagicJsonWriter     2322
+#define MagicJsonPath       2323
+#define MagicLogKvStore     2324
+#define MagicCacheKvStore   2325
+#define MagicRegexSet       2326
+#define MagicArena          2327
 // cleaner.c #define MagicCleaner 2410
 
 /*
@@ -223,13 +236,20 @@ void ruClearError(void);
 #ifdef _WIN32
 typedef CONDITION_VARIABLE ruCond_t;
 typedef CRITICAL_SECTION ruMutex_t;
+typedef INIT_ONCE ruOnce_t;
+#define RU_ONCE_INIT INIT_ONCE_STATIC_INIT
 #else
 #include <pthread.h>
 #include <sched.h>
 typedef pthread_cond_t ruCond_t;
 typedef pthread_mutex_t ruMutex_t;
+typedef pthread_once_t ruOnce_t;
+#define RU_ONCE_INIT PTHREAD_ONCE_INIT
 #endif
 
+// runs init exactly once per once flag, concurrent callers wait for it
+void runOnce(ruOnce_t* once, void (*init)(void));
+
 typedef struct Trace_ {
     ru_uint type;     // magic
     alloc_chars filePath;
@@ -274,10 +294,20 @@ typedef struct tsc_ {
     int64_t count;  // counter
 } tsc;
 
+#define REGEX_POOL 8
 typedef struct regex_ {
     ru_uint type;
-    ruMutex mux;
-    URegularExpression* ex;
+    ruMutex mux;                    // guards the matcher pool only
+    URegularExpression* ex;         // compiled pattern, only used for cloning
+    URegularExpression* pool[REGEX_POOL]; // idle matchers ready for reuse
+    int32_t idle;                   // number of matchers in pool
+    int32_t groups;                 // number of capture groups in pattern
+    // regex cache bookkeeping
+    alloc_chars key;                // cache key when handed out by the cache
+    int32_t refs;                   // outstanding ruRegexCached references
+    bool cached;                    // still held by the cache
+    struct regex_* prev;            // LRU neighbours
+    struct regex_* next;
 } regex;
 /*
  * JSON
@@ -287,6 +317,8 @@ typedef struct json_ json;
 struct json_ {
     ru_uint type;
     yajl_val node;
+    // set when node was built by ruJsonParseLen
+    alloc_ptr arena;
     yajl_gen g;
     alloc_chars indent;
     yajl_type open;
@@ -295,11 +327,21 @@ struct json_ {
 /*
  *  Strings
  */
+typedef struct Arena_ {
+    ru_uint type;
+    rusize blockSize;
+    struct arenaBlock_* head; // block currently allocated from, older ones follow
+} Arena;
+
+// smallest buffer a string starts with, arena strings carry it inline
+#define RU_STRING_MIN 32
+
 typedef struct String_ {
     ru_uint type;
     char *start;
     rusize idx;
     rusize len;
+    Arena* arena; // owner of start and this object when set
 } String;
 /**
  * Replaces non standard file slashes with the proper ones
@@ -410,10 +452,13 @@ typedef struct Map_ {
 /*
  * Ini Files
  */
+typedef struct IniIndex_ IniIndex;
+
 typedef struct Ini_ {
     ru_uint type;     // magic
     ruMap keys;         // char*: char*
     ruMap sections;     // char*: ruMap(char*: char*)
+    IniIndex* idx;      // set instead of the maps when read by the indexed engine
 } Ini;
 
 /**
@@ -479,6 +524,18 @@ alloc_chars utf8SwitchCase(trans_chars instr, bool isUpper);
 // io stuff
 int32_t errno2rfec(int err);
 rusize_s ruWrite(int oh, const void* contents, rusize length);
+/**
+ * Writes contents to a new temporary file next to filename.
+ * @param filename The file the temporary file will eventually replace.
+ * @param contents Data to write.
+ * @param length Number of bytes to write or \ref RU_SIZE_AUTO.
+ * @param tmpName Where the allocated temporary file path will be stored.
+ * @param fd Where the still open handle of the temporary file will be stored.
+ * @return \ref RUE_OK on success else an error code. On error nothing needs
+ *         to be cleaned up.
+ */
+int32_t writeTmpFile(trans_chars filename, trans_chars contents,
+                     rusize length, alloc_chars* tmpName, int* fd);
 
 #if defined(__EMSCRIPTEN__)
 // wasm
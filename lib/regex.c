@@ -23,6 +23,42 @@
 
 ruMakeTypeGetter(regex, MagicRegex)
 
+/*
+ * The compiled pattern in re->ex is never matched against directly. Each call
+ * checks out a matcher from a small pool, cloning a new one when the pool is
+ * empty, so concurrent callers do not serialize on a single matcher.
+ */
+static URegularExpression* regexAcquire(regex* re, int32_t* code) {
+    URegularExpression* m = NULL;
+    ruMutexLock(re->mux);
+    if (re->idle) m = re->pool[--re->idle];
+    ruMutexUnlock(re->mux);
+    if (m) ruRetWithCode(code, RUE_OK, m);
+
+    UErrorCode errorCode = U_ZERO_ERROR;
+    m = uregex_clone(re->ex, &errorCode);
+    if (U_FAILURE(errorCode)) {
+        ruSetError("error in uregex_clone error=%s", u_errorName(errorCode));
+        if (m) uregex_close(m);
+        ruRetWithCode(code, RUE_GENERAL, NULL);
+    }
+    ruRetWithCode(code, RUE_OK, m);
+}
+
+static void regexRelease(regex* re, URegularExpression* m) {
+    static const UChar empty[] = {0};
+    UErrorCode errorCode = U_ZERO_ERROR;
+    // drop the reference to the callers text before it gets freed
+    uregex_setText(m, empty, 0, &errorCode);
+    ruMutexLock(re->mux);
+    if (re->idle < REGEX_POOL) {
+        re->pool[re->idle++] = m;
+        m = NULL;
+    }
+    ruMutexUnlock(re->mux);
+    if (m) uregex_close(m);
+}
+
 RUAPI ruRegex ruRegexNew(const char* pattern, ruRegexFlag flags, int32_t* code) {
     ruClearError();
 
@@ -52,16 +88,157 @@ RUAPI ruRegex ruRegexNew(const char* pattern, ruRegexFlag flags, int32_t* code)
     re->type = MagicRegex;
     re->mux = ruMutexInit();
     re->ex = ure;
+    re->groups = uregex_groupCount(ure, &errorcode);
     ruRetWithCode(code, RUE_OK, (ruRegex)re);
 }
 
+static void regexDestroy(regex* re) {
+    ruMutexFree(re->mux);
+    for (int32_t i = 0; i < re->idle; i++) {
+        uregex_close(re->pool[i]);
+    }
+    uregex_close((URegularExpression*)re->ex);
+    ruFree(re->key);
+    ruFree(re);
+}
+
+//<editor-fold desc="regex cache">
+#define REGEX_CACHE_DEFAULT_SIZE 128
+
+static ruOnce_t cacheOnce_ = RU_ONCE_INIT;
+static ruMutex cacheMux_ = NULL;
+static ruMap cacheMap_ = NULL;
+static regex* cacheHead_ = NULL;    // most recently used
+static regex* cacheTail_ = NULL;
+static uint32_t cacheMax_ = REGEX_CACHE_DEFAULT_SIZE;
+static uint32_t cacheSize_ = 0;
+static bool cacheOff_ = false;
+static ruRegexCacheStats cacheStats_;
+
+static void cacheMuxInit(void) {
+    cacheMux_ = ruMutexInit();
+}
+
+static void cacheInit(void) {
+    runOnce(&cacheOnce_, cacheMuxInit);
+}
+
+static void cacheUnlink(regex* re) {
+    if (re->prev) re->prev->next = re->next;
+    else cacheHead_ = re->next;
+    if (re->next) re->next->prev = re->prev;
+    else cacheTail_ = re->prev;
+    re->prev = re->next = NULL;
+}
+
+static void cachePush(regex* re) {
+    re->next = cacheHead_;
+    re->prev = NULL;
+    if (cacheHead_) cacheHead_->prev = re;
+    cacheHead_ = re;
+    if (!cacheTail_) cacheTail_ = re;
+}
+
+// drops an entry, which lives on until its last user frees it
+static void cacheDrop(regex* re) {
+    cacheUnlink(re);
+    ruMapRemove(cacheMap_, re->key, NULL);
+    re->cached = false;
+    cacheSize_--;
+    if (!re->refs) regexDestroy(re);
+}
+
+static void cacheTrim(uint32_t max) {
+    while (cacheSize_ > max) {
+        cacheDrop(cacheTail_);
+        cacheStats_.evictions++;
+    }
+}
+
+RUAPI void ruRegexCacheSet(uint32_t maxEntries) {
+    cacheInit();
+    ruMutexLock(cacheMux_);
+    cacheOff_ = !maxEntries;
+    cacheMax_ = maxEntries;
+    cacheTrim(cacheMax_);
+    if (cacheOff_) cacheMap_ = ruMapFree(cacheMap_);
+    ruMutexUnlock(cacheMux_);
+}
+
+RUAPI int32_t ruRegexCacheGetStats(ruRegexCacheStats* stats) {
+    ruClearError();
+    if (!stats) return RUE_PARAMETER_NOT_SET;
+    cacheInit();
+    ruMutexLock(cacheMux_);
+    *stats = cacheStats_;
+    stats->entries = cacheSize_;
+    ruMutexUnlock(cacheMux_);
+    return RUE_OK;
+}
+
+RUAPI ruRegex ruRegexCached(const char* pattern, ruRegexFlag flags,
+                            int32_t* code) {
+    ruClearError();
+    if (!pattern) ruRetWithCode(code, RUE_PARAMETER_NOT_SET, NULL);
+    cacheInit();
+    alloc_chars key = ruDupPrintf("%x:%s", (uint32_t)flags, pattern);
+    regex* re = NULL;
+    ruMutexLock(cacheMux_);
+    if (!cacheOff_ && cacheMap_ && RUE_OK == ruMapGet(cacheMap_, key, &re)) {
+        re->refs++;
+        cacheStats_.hits++;
+        cacheUnlink(re);
+        cachePush(re);
+        ruMutexUnlock(cacheMux_);
+        ruFree(key);
+        ruRetWithCode(code, RUE_OK, (ruRegex)re);
+    }
+    cacheStats_.misses++;
+    ruMutexUnlock(cacheMux_);
+
+    // compile without holding up other lookups
+    int32_t ret;
+    regex* fresh = (regex*)ruRegexNew(pattern, flags, &ret);
+    if (!fresh) {
+        ruFree(key);
+        ruRetWithCode(code, ret, NULL);
+    }
+    fresh->key = key;
+    fresh->refs = 1;
+
+    ruMutexLock(cacheMux_);
+    if (!cacheOff_) {
+        if (!cacheMap_) cacheMap_ = ruMapNew(ruTypeStrRef(), ruTypePtr(NULL));
+        if (RUE_OK == ruMapGet(cacheMap_, key, &re)) {
+            // another thread compiled the same pattern in the meantime
+            re->refs++;
+            ruMutexUnlock(cacheMux_);
+            regexDestroy(fresh);
+            ruRetWithCode(code, RUE_OK, (ruRegex)re);
+        }
+        fresh->cached = true;
+        ruMapPut(cacheMap_, fresh->key, fresh);
+        cachePush(fresh);
+        cacheSize_++;
+        cacheTrim(cacheMax_);
+    }
+    ruMutexUnlock(cacheMux_);
+    ruRetWithCode(code, RUE_OK, (ruRegex)fresh);
+}
+//</editor-fold>
+
 RUAPI ruRegex ruRegexFree(ruRegex rr) {
     ruClearError();
     regex* re = regexGet(rr, NULL);
     if (!re) return NULL;
-    ruMutexFree(re->mux);
-    uregex_close((URegularExpression*)re->ex);
-    ruFree(re);
+    if (re->key) {
+        // handed out by ruRegexCached
+        ruMutexLock(cacheMux_);
+        if (re->refs > 0 && !--re->refs && !re->cached) regexDestroy(re);
+        ruMutexUnlock(cacheMux_);
+        return NULL;
+    }
+    regexDestroy(re);
     return NULL;
 }
 
@@ -83,29 +260,30 @@ RUAPI char* ruRegexReplace(ruRegex rr, const char* original, const char* replace
     int32_t ret = RUE_OK, dlen = 0;
     UErrorCode errorCode = U_ZERO_ERROR;
     UChar *urep = NULL, *usrc = NULL, *udst = NULL;
+    URegularExpression* ex = regexAcquire(re, &ret);
+    if (!ex) ruRetWithCode(code, ret, NULL);
 
     do {
-        ruMutexLock(re->mux);
         usrc = charToUni(original);
         if (!usrc) {
             ret = RUE_INVALID_PARAMETER;
             break;
         }
-        uregex_setText(re->ex, usrc, -1, &errorCode);
+        uregex_setText(ex, usrc, -1, &errorCode);
 
         urep = charToUni(replacement);
         if (!urep) {
             ret = RUE_INVALID_PARAMETER;
             break;
         }
-        int32_t needed = uregex_replaceAll(re->ex, urep,
+        int32_t needed = uregex_replaceAll(ex, urep,
                                            -1, udst,
                                            dlen,&errorCode);
         dlen = needed + 1; // terminator
         if (errorCode == U_BUFFER_OVERFLOW_ERROR) {
             udst = ruMalloc0(dlen, UChar);
             errorCode = U_ZERO_ERROR;
-            uregex_replaceAll(re->ex, urep,
+            uregex_replaceAll(ex, urep,
                               -1, udst,
                               dlen, &errorCode);
         }
@@ -123,36 +301,39 @@ RUAPI char* ruRegexReplace(ruRegex rr, const char* original, const char* replace
     if (ret == RUE_OK) {
         out = uniToChar(udst);
     }
-    ruMutexUnlock(re->mux);
+    regexRelease(re, ex);
     ruFree(udst);
     ruRetWithCode(code, ret, out);
 }
 
-bool ruRegexSearch(ruRegex rr, const char* original, bool fully, ruList matches, int32_t* code) {
-    UBool does = false;
-    if (!rr || !original) {
-        ruRetWithCode(code, RUE_PARAMETER_NOT_SET, does);
-    }
-    regex* re = regexGet(rr, code);
-    if (!re) return does;
-
+/*
+ * Runs the expression over the UTF-8 original in place. The text is wrapped in
+ * a UText rather than converted to UTF-16, so offsets are byte positions in
+ * original.
+ */
+static bool regexSearch(regex* re, trans_chars original, rusize len, bool fully,
+                        ruRegexSpan* spans, uint32_t spanCount, int32_t* code) {
+    bool does = false;
     int32_t ret = RUE_OK;
     UErrorCode errorCode = U_ZERO_ERROR;
-    UChar *usrc = NULL, *ubuf = NULL;
+    UText ut = UTEXT_INITIALIZER;
+    URegularExpression* ex = regexAcquire(re, &ret);
+    if (!ex) ruRetWithCode(code, ret, does);
+    if (len == RU_SIZE_AUTO) len = strlen(original);
 
     do {
-        ruMutexLock(re->mux);
-        usrc = charToUni(original);
-        if (!usrc) {
+        utext_openUTF8(&ut, original, (int64_t)len, &errorCode);
+        uregex_setUText(ex, &ut, &errorCode);
+        if (U_FAILURE(errorCode)) {
+            ruSetError("error in uregex_setUText error=%s",
+                       u_errorName(errorCode));
             ret = RUE_INVALID_PARAMETER;
             break;
         }
-        uregex_setText(re->ex, usrc, -1, &errorCode);
-
         if (fully) {
-            does = uregex_matches64(re->ex, 0, &errorCode);
+            does = uregex_matches64(ex, 0, &errorCode);
         } else {
-            does = uregex_find64(re->ex, 0, &errorCode);
+            does = uregex_find64(ex, 0, &errorCode);
         }
         if (U_FAILURE(errorCode)) {
             ruSetError("error in uregex_matches64 error=%s",
@@ -160,83 +341,908 @@ bool ruRegexSearch(ruRegex rr, const char* original, bool fully, ruList matches,
             ret = RUE_GENERAL;
             break;
         }
-        if (!does || !matches) break;
-        int32_t cnt = uregex_groupCount(re->ex, &errorCode);
-        if (U_FAILURE(errorCode)) {
-            ruSetError("error in uregex_groupCount error=%s",
-                       u_errorName(errorCode));
-            ret = RUE_GENERAL;
-            break;
-        }
-        for (int i = 0; i <= cnt; i++) {
-            int32_t needLen = uregex_group(re->ex, i,
-                                           NULL, 0,
-                                           &errorCode);
-            // we usually get U_BUFFER_OVERFLOW_ERROR but when optioonal matches
-            // fail we get U_STRING_NOT_TERMINATED_WARNING and needLen == 0
-            if (!(errorCode == U_BUFFER_OVERFLOW_ERROR ||
-                (errorCode == U_STRING_NOT_TERMINATED_WARNING && !needLen))) {
-                ruSetError("error in uregex_group estimate error=%s",
-                           u_errorName(errorCode));
-                ret = RUE_GENERAL;
-                break;
-            }
-            needLen++; // terminator
-            ubuf = ruMalloc0(needLen, UChar);
-            errorCode = U_ZERO_ERROR;
-            uregex_group(re->ex, i, ubuf,
-                         needLen*(int32_t)sizeof(UChar),
-                         &errorCode);
+        if (!does || !spans) break;
+        for (uint32_t i = 0; i < spanCount; i++) {
+            spans[i].offset = -1;
+            spans[i].length = 0;
+            if ((int32_t)i > re->groups) continue;
+            int64_t start = uregex_start64(ex, (int32_t)i, &errorCode);
+            int64_t end = uregex_end64(ex, (int32_t)i, &errorCode);
             if (U_FAILURE(errorCode)) {
-                ruSetError("error in uregex_group error=%s",
+                ruSetError("error in uregex_start64 error=%s",
                            u_errorName(errorCode));
                 ret = RUE_GENERAL;
                 break;
             }
-            char *buf = uniToChar(ubuf);
-            ruListAppend(matches, buf);
-            ruFree(ubuf);
+            // optional groups that did not participate stay at -1
+            if (start < 0) continue;
+            spans[i].offset = (rusize_s)start;
+            spans[i].length = (rusize)(end - start);
         }
     } while(0);
     if (ret != RUE_OK) does = false;
 
-    ruMutexUnlock(re->mux);
-    ruFree(ubuf);
-    ruFree(usrc);
+    regexRelease(re, ex);
+    utext_close(&ut);
     ruRetWithCode(code, ret, does);
 }
 
+// appends all groups of a match to out, unmatched groups as empty strings
+static bool regexGroups(ruRegex rr, trans_chars original, bool fully,
+                        ruList out, int32_t* code) {
+    if (!rr || !original) {
+        ruRetWithCode(code, RUE_PARAMETER_NOT_SET, false);
+    }
+    regex* re = regexGet(rr, code);
+    if (!re) return false;
+
+    ruRegexSpan stackSpans[8];
+    uint32_t cnt = (uint32_t)re->groups + 1;
+    ruRegexSpan* spans = stackSpans;
+    if (cnt > 8) spans = ruMalloc0(cnt, ruRegexSpan);
+
+    bool does = regexSearch(re, original, RU_SIZE_AUTO, fully, spans, cnt, code);
+    if (does) {
+        for (uint32_t i = 0; i < cnt; i++) {
+            char* grp;
+            if (spans[i].offset < 0) {
+                grp = ruStrDup("");
+            } else {
+                grp = ruStrNDup(original + spans[i].offset, spans[i].length);
+            }
+            ruListAppend(out, grp);
+        }
+    }
+    if (spans != stackSpans) ruFree(spans);
+    return does;
+}
+
+static ruList regexGroupList(ruRegex rr, trans_chars original, bool fully,
+                             int32_t* code) {
+    ruList out = ruListNew(ruTypePtrFree());
+    if (!regexGroups(rr, original, fully, out, code)) return ruListFree(out);
+    return out;
+}
+
+static bool regexSpans(ruRegex rr, trans_chars original, rusize len, bool fully,
+                       ruRegexSpan* spans, uint32_t spanCount, int32_t* code) {
+    if (!rr || !original) {
+        ruRetWithCode(code, RUE_PARAMETER_NOT_SET, false);
+    }
+    if (spanCount && !spans) {
+        ruRetWithCode(code, RUE_INVALID_PARAMETER, false);
+    }
+    regex* re = regexGet(rr, code);
+    if (!re) return false;
+    return regexSearch(re, original, len, fully, spans, spanCount, code);
+}
+
+// Undocumented but exported in earlier releases, kept for binary compatibility
+RUAPI bool ruRegexSearch(ruRegex rr, const char* original, bool fully,
+                         ruList matches, int32_t* code) {
+    if (!matches) {
+        return regexSpans(rr, original, RU_SIZE_AUTO, fully, NULL, 0, code);
+    }
+    return regexGroups(rr, original, fully, matches, code);
+}
+
 RUAPI bool ruRegexMatch(ruRegex rr, const char* original, int32_t* code) {
     ruClearError();
-    return ruRegexSearch(rr, original, true, NULL, code);
+    return regexSpans(rr, original, RU_SIZE_AUTO, true, NULL, 0, code);
 }
 
 RUAPI bool ruRegexFind(ruRegex rr, const char* original, int32_t* code) {
     ruClearError();
-    return ruRegexSearch(rr, original, false, NULL, code);
+    return regexSpans(rr, original, RU_SIZE_AUTO, false, NULL, 0, code);
 }
 
 RUAPI ruList ruRegexMatchGroups(ruRegex rr, const char* original, int32_t* code) {
     ruClearError();
-    ruList out = ruListNew(ruTypePtrFree());
-    if (!ruRegexSearch(rr, original, true, out, code)) {
-        return ruListFree(out);
+    return regexGroupList(rr, original, true, code);
+}
+
+RUAPI ruList ruRegexFindGroups(ruRegex rr, const char* original, int32_t* code) {
+    ruClearError();
+    return regexGroupList(rr, original, false, code);
+}
+
+RUAPI int32_t ruRegexGroupCount(ruRegex rr, int32_t* code) {
+    ruClearError();
+    regex* re = regexGet(rr, code);
+    if (!re) return -1;
+    ruRetWithCode(code, RUE_OK, re->groups);
+}
+
+RUAPI bool ruRegexMatchSpans(ruRegex rr, trans_chars original, rusize len,
+                             ruRegexSpan* spans, uint32_t spanCount,
+                             int32_t* code) {
+    ruClearError();
+    return regexSpans(rr, original, len, true, spans, spanCount, code);
+}
+
+RUAPI bool ruRegexFindSpans(ruRegex rr, trans_chars original, rusize len,
+                            ruRegexSpan* spans, uint32_t spanCount,
+                            int32_t* code) {
+    ruClearError();
+    return regexSpans(rr, original, len, false, spans, spanCount, code);
+}
+
+//<editor-fold desc="regex set">
+/*
+ * A regex set runs many patterns over a text in one pass. Patterns that stay
+ * within a common subset of the syntax are parsed into a small AST, compiled
+ * into one shared Thompson NFA and matched with a lazily built DFA. Everything
+ * else, and patterns whose ASCII only semantics would differ from ICU on non
+ * ASCII input, is handed to ICU.
+ */
+#define RS_MAX_STATES 2048
+#define RS_MAX_NODES 20000
+#define RS_MAX_REPEAT 100
+#define RS_MAX_DEPTH 100
+
+// how a pattern gets matched
+#define RS_ICU 0    // ICU only
+#define RS_DFA 1    // DFA for any text
+#define RS_ASCII 2  // DFA for ASCII text, ICU otherwise
+
+// nfa node types
+#define N_BYTE 0
+#define N_SPLIT 1
+#define N_BOL 2
+#define N_EOL 3
+#define N_MATCH 4
+
+// ast node types
+#define A_EMPTY 0
+#define A_SET 1
+#define A_CAT 2
+#define A_ALT 3
+#define A_REP 4
+#define A_BOL 5
+#define A_EOL 6
+
+typedef struct {
+    uint8_t bits[32];
+} rsBytes;
+
+typedef struct {
+    int32_t type;
+    int32_t out;
+    int32_t out1;
+    int32_t arg;    // byte set for N_BYTE, pattern for N_MATCH
+} rsNode;
+
+typedef struct {
+    int32_t type;
+    int32_t a;      // child or byte set
+    int32_t b;      // second child
+    int32_t min;
+    int32_t max;    // -1 for unbounded
+} rsAst;
+
+typedef struct {
+    int32_t* nfa;   // sorted nfa nodes this state stands for
+    int32_t nfaLen;
+    int32_t* hits;  // patterns matching in this state
+    int32_t hitLen;
+    bool hasEol;    // has pending $ assertions
+    uint32_t hash;
+    int32_t next[256];
+} rsState;
+
+typedef struct {
+    const char* p;
+    const char* end;
+    bool ci;
+    bool dotall;
+    bool asciiOnly;
+    bool fail;
+    int32_t depth;
+    rsAst* ast;
+    int32_t astLen;
+    int32_t astCap;
+} rsParse;
+
+typedef struct regexSet_ {
+    ru_uint type;
+    ruMutex mux;            // guards the dfa cache
+    // patterns
+    ruRegex* icu;
+    int32_t* kind;
+    int32_t count;
+    int32_t cap;
+    int32_t* starts;        // nfa entry of each dfa pattern
+    int32_t startLen;
+    int32_t asciiCount;     // number of RS_ASCII patterns
+    // nfa
+    rsNode* nodes;
+    int32_t nodeLen;
+    int32_t nodeCap;
+    rsBytes* sets;
+    int32_t setLen;
+    int32_t setCap;
+    // dfa cache
+    rsState** states;
+    int32_t stateLen;
+    int32_t* slots;         // open addressing table of state indices
+    int32_t state0;         // start state at the beginning of the text
+    // closure scratch space
+    int32_t* mark;
+    int32_t gen;
+    int32_t* stack;
+    int32_t* found;
+} regexSet;
+
+ruMakeTypeGetter(regexSet, MagicRegexSet)
+
+static ptr rsGrow(ptr buf, rusize count, rusize size) {
+    if (!buf) return ruMallocSize(count, size);
+    return ruReallocSize(buf, count, size);
+}
+
+static inline bool bytesHas(rsBytes* bs, uint8_t c) {
+    return (bs->bits[c >> 3] & (1 << (c & 7))) != 0;
+}
+
+static inline void bytesAdd(rsBytes* bs, uint8_t c) {
+    bs->bits[c >> 3] |= (uint8_t)(1 << (c & 7));
+}
+
+static void bytesRange(rsBytes* bs, int32_t lo, int32_t hi) {
+    for (int32_t c = lo; c <= hi; c++) bytesAdd(bs, (uint8_t)c);
+}
+
+// ASCII semantics of ICU's class escapes
+static void bytesEscape(rsBytes* bs, char c) {
+    rsBytes cls;
+    memset(&cls, 0, sizeof(cls));
+    char lc = (char)tolower(c);
+    if (lc == 'd') {
+        bytesRange(&cls, '0', '9');
+    } else if (lc == 'w') {
+        bytesRange(&cls, '0', '9');
+        bytesRange(&cls, 'A', 'Z');
+        bytesRange(&cls, 'a', 'z');
+        bytesAdd(&cls, '_');
+    } else {
+        bytesRange(&cls, 0x09, 0x0d);
+        bytesAdd(&cls, ' ');
     }
-    if (!ruListSize(out, NULL)) {
-        return ruListFree(out);
+    for (int32_t i = 0; i < 32; i++) {
+        bs->bits[i] |= isupper(c) ? (uint8_t)~cls.bits[i] : cls.bits[i];
     }
-    return out;
 }
 
-RUAPI ruList ruRegexFindGroups(ruRegex rr, const char* original, int32_t* code) {
+static void bytesFold(rsBytes* bs) {
+    for (int32_t c = 'a'; c <= 'z'; c++) {
+        if (bytesHas(bs, (uint8_t)c) || bytesHas(bs, (uint8_t)(c - 32))) {
+            bytesAdd(bs, (uint8_t)c);
+            bytesAdd(bs, (uint8_t)(c - 32));
+        }
+    }
+}
+
+static int32_t setNew(regexSet* rs) {
+    if (rs->setLen == rs->setCap) {
+        rs->setCap = rs->setCap ? rs->setCap * 2 : 64;
+        rs->sets = rsGrow(rs->sets, rs->setCap, sizeof(rsBytes));
+    }
+    memset(&rs->sets[rs->setLen], 0, sizeof(rsBytes));
+    return rs->setLen++;
+}
+
+static int32_t nodeNew(regexSet* rs, int32_t type, int32_t out, int32_t out1,
+                       int32_t arg) {
+    if (rs->nodeLen == rs->nodeCap) {
+        rs->nodeCap = rs->nodeCap ? rs->nodeCap * 2 : 256;
+        rs->nodes = rsGrow(rs->nodes, rs->nodeCap, sizeof(rsNode));
+    }
+    rsNode* n = &rs->nodes[rs->nodeLen];
+    n->type = type;
+    n->out = out;
+    n->out1 = out1;
+    n->arg = arg;
+    return rs->nodeLen++;
+}
+
+static int32_t astNew(rsParse* ps, int32_t type, int32_t a, int32_t b) {
+    if (ps->astLen == ps->astCap) {
+        ps->astCap = ps->astCap ? ps->astCap * 2 : 64;
+        ps->ast = rsGrow(ps->ast, ps->astCap, sizeof(rsAst));
+    }
+    rsAst* n = &ps->ast[ps->astLen];
+    n->type = type;
+    n->a = a;
+    n->b = b;
+    n->min = n->max = 0;
+    return ps->astLen++;
+}
+
+static int32_t astByte(regexSet* rs, rsParse* ps, uint8_t c) {
+    int32_t set = setNew(rs);
+    bytesAdd(&rs->sets[set], c);
+    if (ps->ci) bytesFold(&rs->sets[set]);
+    return astNew(ps, A_SET, set, 0);
+}
+
+static int32_t parseFail(rsParse* ps) {
+    ps->fail = true;
+    return -1;
+}
+
+static int32_t parseAlt(regexSet* rs, rsParse* ps);
+
+static int32_t parseEscapeByte(char c) {
+    switch (c) {
+        case 't': return '\t';
+        case 'n': return '\n';
+        case 'r': return '\r';
+        case 'f': return '\f';
+        case 'a': return 0x07;
+        case 'e': return 0x1b;
+        default: break;
+    }
+    // backreferences, \b, \p, \x and friends are left to ICU
+    if (isalnum((uint8_t)c) || (uint8_t)c >= 0x80) return -1;
+    return (uint8_t)c;
+}
+
+// returns the byte read, -1 when a class escape was added to bs or -2 on failure
+static int32_t parseClassChar(rsParse* ps, rsBytes* bs) {
+    uint8_t c = (uint8_t)*ps->p;
+    if (c >= 0x80 || isspace(c) || c == '[' || c == '$' ||
+        c == '{' || c == '}') {
+        return -2;
+    }
+    if (c == '&' && ps->p[1] == '&') return -2;
+    if (c == '-' && ps->p[1] == '-') return -2;
+    ps->p++;
+    if (c != '\\') return c;
+    if (ps->p >= ps->end) return -2;
+    c = (uint8_t)*ps->p++;
+    if (c == 'd' || c == 'w' || c == 's') {
+        ps->asciiOnly = true;
+        bytesEscape(bs, (char)c);
+        return -1;
+    }
+    int32_t b = parseEscapeByte((char)c);
+    return b < 0 ? -2 : b;
+}
+
+static int32_t parseClass(regexSet* rs, rsParse* ps) {
+    rsBytes bs;
+    memset(&bs, 0, sizeof(bs));
+    bool neg = false;
+    ps->p++;
+    if (ps->p < ps->end && *ps->p == '^') {
+        neg = true;
+        ps->p++;
+    }
+    if (ps->p >= ps->end || *ps->p == ']' || *ps->p == ':') return parseFail(ps);
+    while (ps->p < ps->end && *ps->p != ']') {
+        int32_t lo = parseClassChar(ps, &bs);
+        if (lo == -2) return parseFail(ps);
+        if (lo == -1) continue;
+        if (ps->p + 1 < ps->end && *ps->p == '-' && ps->p[1] != ']') {
+            ps->p++;
+            int32_t hi = parseClassChar(ps, &bs);
+            if (hi < lo) return parseFail(ps);
+            bytesRange(&bs, lo, hi);
+        } else {
+            bytesAdd(&bs, (uint8_t)lo);
+        }
+    }
+    if (ps->p >= ps->end) return parseFail(ps);
+    ps->p++;
+    if (ps->ci) bytesFold(&bs);
+    if (neg) {
+        ps->asciiOnly = true;
+        for (int32_t i = 0; i < 32; i++) bs.bits[i] = (uint8_t)~bs.bits[i];
+    }
+    int32_t set = setNew(rs);
+    rs->sets[set] = bs;
+    return astNew(ps, A_SET, set, 0);
+}
+
+static int32_t parseAtom(regexSet* rs, rsParse* ps) {
+    uint8_t c = (uint8_t)*ps->p;
+    if (c == '(') {
+        ps->p++;
+        if (ps->p < ps->end && *ps->p == '?') {
+            // only non capturing groups, no flags or look arounds
+            if (ps->p + 1 >= ps->end || ps->p[1] != ':') return parseFail(ps);
+            ps->p += 2;
+        }
+        if (++ps->depth > RS_MAX_DEPTH) return parseFail(ps);
+        int32_t n = parseAlt(rs, ps);
+        ps->depth--;
+        if (ps->fail || ps->p >= ps->end || *ps->p != ')') return parseFail(ps);
+        ps->p++;
+        return n;
+    }
+    if (c == '[') return parseClass(rs, ps);
+    ps->p++;
+    if (c == '.') {
+        ps->asciiOnly = true;
+        int32_t set = setNew(rs);
+        bytesRange(&rs->sets[set], 0, 255);
+        if (!ps->dotall) {
+            for (int32_t t = 0x0a; t <= 0x0d; t++) {
+                rs->sets[set].bits[t >> 3] &= (uint8_t)~(1 << (t & 7));
+            }
+        }
+        return astNew(ps, A_SET, set, 0);
+    }
+    if (c == '^') return astNew(ps, A_BOL, 0, 0);
+    if (c == '$') {
+        // also matches before a final U+0085, U+2028 or U+2029
+        ps->asciiOnly = true;
+        return astNew(ps, A_EOL, 0, 0);
+    }
+    if (c == '*' || c == '+' || c == '?' || c == '{') return parseFail(ps);
+    if (c == '\\') {
+        if (ps->p >= ps->end) return parseFail(ps);
+        c = (uint8_t)*ps->p++;
+        if (strchr("dDwWsS", c)) {
+            ps->asciiOnly = true;
+            int32_t set = setNew(rs);
+            bytesEscape(&rs->sets[set], (char)c);
+            return astNew(ps, A_SET, set, 0);
+        }
+        int32_t b = parseEscapeByte((char)c);
+        if (b < 0) return parseFail(ps);
+        return astByte(rs, ps, (uint8_t)b);
+    }
+    if (c < 0x80) return astByte(rs, ps, c);
+
+    // a multi byte character is matched as its byte sequence
+    int32_t len = c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : c >= 0xc0 ? 2 : 0;
+    if (!len || ps->ci || ps->p + len - 1 > ps->end) return parseFail(ps);
+    int32_t n = astByte(rs, ps, c);
+    for (int32_t i = 1; i < len; i++) {
+        uint8_t cc = (uint8_t)*ps->p++;
+        if ((cc & 0xc0) != 0x80) return parseFail(ps);
+        n = astNew(ps, A_CAT, n, astByte(rs, ps, cc));
+    }
+    return n;
+}
+
+static int32_t parseNumber(rsParse* ps) {
+    int32_t n = -1;
+    while (ps->p < ps->end && isdigit((uint8_t)*ps->p)) {
+        n = (n < 0 ? 0 : n) * 10 + (*ps->p++ - '0');
+        if (n > RS_MAX_REPEAT) return -2;
+    }
+    return n;
+}
+
+static int32_t parseRepeat(regexSet* rs, rsParse* ps) {
+    int32_t n = parseAtom(rs, ps);
+    while (!ps->fail && ps->p < ps->end) {
+        int32_t min, max;
+        char c = *ps->p;
+        if (c == '*') {
+            min = 0; max = -1;
+        } else if (c == '+') {
+            min = 1; max = -1;
+        } else if (c == '?') {
+            min = 0; max = 1;
+        } else if (c == '{') {
+            ps->p++;
+            min = max = parseNumber(ps);
+            if (min < 0) return parseFail(ps);
+            if (ps->p < ps->end && *ps->p == ',') {
+                ps->p++;
+                max = parseNumber(ps);
+                if (max == -2 || (max >= 0 && max < min)) return parseFail(ps);
+            }
+            if (ps->p >= ps->end || *ps->p != '}') return parseFail(ps);
+        } else {
+            break;
+        }
+        ps->p++;
+        // lazy quantifiers find the same matches, possessive ones do not
+        if (ps->p < ps->end && *ps->p == '?') ps->p++;
+        else if (ps->p < ps->end && *ps->p == '+') return parseFail(ps);
+        n = astNew(ps, A_REP, n, 0);
+        ps->ast[n].min = min;
+        ps->ast[n].max = max;
+    }
+    return n;
+}
+
+static int32_t parseCat(regexSet* rs, rsParse* ps) {
+    int32_t n = -1;
+    while (!ps->fail && ps->p < ps->end && *ps->p != '|' && *ps->p != ')') {
+        int32_t r = parseRepeat(rs, ps);
+        n = n < 0 ? r : astNew(ps, A_CAT, n, r);
+    }
+    return n < 0 ? astNew(ps, A_EMPTY, 0, 0) : n;
+}
+
+static int32_t parseAlt(regexSet* rs, rsParse* ps) {
+    int32_t n = parseCat(rs, ps);
+    while (!ps->fail && ps->p < ps->end && *ps->p == '|') {
+        ps->p++;
+        n = astNew(ps, A_ALT, n, parseCat(rs, ps));
+    }
+    return n;
+}
+
+// compiles ast node n so that it continues with nfa node next
+static int32_t rsEmit(regexSet* rs, rsParse* ps, int32_t n, int32_t next) {
+    if (ps->fail || rs->nodeLen > RS_MAX_NODES) return parseFail(ps);
+    rsAst a = ps->ast[n];
+    int32_t x, y;
+    switch (a.type) {
+        case A_SET:
+            return nodeNew(rs, N_BYTE, next, -1, a.a);
+        case A_CAT:
+            return rsEmit(rs, ps, a.a, rsEmit(rs, ps, a.b, next));
+        case A_ALT:
+            x = rsEmit(rs, ps, a.a, next);
+            y = rsEmit(rs, ps, a.b, next);
+            return nodeNew(rs, N_SPLIT, x, y, 0);
+        case A_BOL:
+            return nodeNew(rs, N_BOL, next, -1, 0);
+        case A_EOL:
+            return nodeNew(rs, N_EOL, next, -1, 0);
+        case A_REP: {
+            int32_t cur = next;
+            if (a.max < 0) {
+                cur = nodeNew(rs, N_SPLIT, -1, next, 0);
+                x = rsEmit(rs, ps, a.a, cur);
+                rs->nodes[cur].out = x;
+            } else {
+                for (int32_t i = a.min; i < a.max; i++) {
+                    x = rsEmit(rs, ps, a.a, cur);
+                    cur = nodeNew(rs, N_SPLIT, x, next, 0);
+                }
+            }
+            for (int32_t i = 0; i < a.min; i++) {
+                cur = rsEmit(rs, ps, a.a, cur);
+            }
+            return cur;
+        }
+        default:
+            return next;
+    }
+}
+
+/*
+ * Tries to compile pattern into the shared nfa and returns its kind. On
+ * failure the nfa is rolled back and the pattern is left to ICU.
+ */
+static int32_t rsCompile(regexSet* rs, trans_chars pattern, ruRegexFlag flags,
+                         int32_t id) {
+    int32_t nodeMark = rs->nodeLen, setMark = rs->setLen;
+    ruZeroedStruct(rsParse, ps);
+    ps.p = pattern;
+    ps.end = pattern + strlen(pattern);
+    ps.ci = (flags & RUREGEX_CASE_INSENSITIVE) != 0;
+    ps.dotall = (flags & RUREGEX_DOTALL) != 0;
+    ps.asciiOnly = ps.ci;
+    int32_t kind = RS_ICU;
+    if (!(flags & ~(RUREGEX_CASE_INSENSITIVE | RUREGEX_DOTALL |
+                    RUREGEX_ERROR_ON_UNKNOWN_ESCAPES))) {
+        int32_t root = parseAlt(rs, &ps);
+        if (ps.p < ps.end) parseFail(&ps);
+        if (!ps.fail) {
+            int32_t match = nodeNew(rs, N_MATCH, -1, -1, id);
+            int32_t start = rsEmit(rs, &ps, root, match);
+            if (!ps.fail) {
+                rs->starts = rsGrow(rs->starts, rs->startLen + 1,
+                                    sizeof(int32_t));
+                rs->starts[rs->startLen++] = start;
+                kind = ps.asciiOnly ? RS_ASCII : RS_DFA;
+            }
+        }
+    }
+    ruFree(ps.ast);
+    if (kind == RS_ICU) {
+        rs->nodeLen = nodeMark;
+        rs->setLen = setMark;
+    }
+    return kind;
+}
+
+static void stateFlush(regexSet* rs) {
+    for (int32_t i = 0; i < rs->stateLen; i++) {
+        ruFree(rs->states[i]->nfa);
+        ruFree(rs->states[i]->hits);
+        ruFree(rs->states[i]);
+    }
+    rs->stateLen = 0;
+    rs->state0 = -1;
+    if (rs->slots) {
+        for (int32_t i = 0; i < RS_MAX_STATES * 2; i++) rs->slots[i] = -1;
+    }
+}
+
+static void scratchInit(regexSet* rs) {
+    ruFree(rs->mark);
+    ruFree(rs->stack);
+    ruFree(rs->found);
+    // every node is visited once and pushes at most two successors
+    rs->mark = ruMalloc0(rs->nodeLen, int32_t);
+    rs->stack = ruMalloc0(rs->nodeLen * 3 + rs->startLen, int32_t);
+    rs->found = ruMalloc0(rs->nodeLen, int32_t);
+    rs->gen = 0;
+    if (!rs->states) {
+        rs->states = ruMalloc0(RS_MAX_STATES, rsState*);
+        rs->slots = ruMalloc0(RS_MAX_STATES * 2, int32_t);
+    }
+    stateFlush(rs);
+}
+
+static int cmpInt(const void* a, const void* b) {
+    int32_t x = *(const int32_t*)a, y = *(const int32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+/*
+ * Follows the epsilon edges from the seeds and returns the number of nodes
+ * stored in rs->found. Assertions are followed when bol or eol hold and kept
+ * as pending otherwise.
+ */
+static int32_t rsClosure(regexSet* rs, int32_t* seeds, int32_t seedLen,
+                         bool withStarts, bool bol, bool eol) {
+    int32_t sp = 0, fl = 0, gen = ++rs->gen;
+    for (int32_t i = 0; i < seedLen; i++) rs->stack[sp++] = seeds[i];
+    if (withStarts) {
+        for (int32_t i = 0; i < rs->startLen; i++) {
+            rs->stack[sp++] = rs->starts[i];
+        }
+    }
+    while (sp) {
+        int32_t n = rs->stack[--sp];
+        if (n < 0 || rs->mark[n] == gen) continue;
+        rs->mark[n] = gen;
+        rsNode* nd = &rs->nodes[n];
+        switch (nd->type) {
+            case N_SPLIT:
+                rs->stack[sp++] = nd->out1;
+                rs->stack[sp++] = nd->out;
+                break;
+            case N_BOL:
+                if (bol) rs->stack[sp++] = nd->out;
+                break;
+            case N_EOL:
+                if (eol) rs->stack[sp++] = nd->out;
+                else rs->found[fl++] = n;
+                break;
+            default:
+                rs->found[fl++] = n;
+                break;
+        }
+    }
+    qsort(rs->found, (size_t)fl, sizeof(int32_t), cmpInt);
+    return fl;
+}
+
+static uint32_t stateHash(int32_t* nfa, int32_t len) {
+    uint32_t h = 2166136261u;
+    for (int32_t i = 0; i < len; i++) {
+        h = (h ^ (uint32_t)nfa[i]) * 16777619u;
+    }
+    return h;
+}
+
+// returns the index of the state for the closure in rs->found
+static int32_t stateGet(regexSet* rs, int32_t len) {
+    uint32_t h = stateHash(rs->found, len);
+    uint32_t mask = RS_MAX_STATES * 2 - 1;
+    for (uint32_t i = h & mask;; i = (i + 1) & mask) {
+        int32_t s = rs->slots[i];
+        if (s < 0) break;
+        rsState* st = rs->states[s];
+        if (st->hash == h && st->nfaLen == len &&
+            !memcmp(st->nfa, rs->found, len * sizeof(int32_t))) {
+            return s;
+        }
+    }
+    if (rs->stateLen == RS_MAX_STATES) {
+        // start over rather than growing without bounds
+        ruVerbLogf("regex set dfa cache full, flushing %d states", rs->stateLen);
+        stateFlush(rs);
+    }
+    rsState* st = ruMalloc0(1, rsState);
+    st->nfa = ruMemDup(rs->found, len * sizeof(int32_t));
+    st->nfaLen = len;
+    st->hash = h;
+    for (int32_t i = 0; i < 256; i++) st->next[i] = -1;
+    for (int32_t i = 0; i < len; i++) {
+        rsNode* nd = &rs->nodes[st->nfa[i]];
+        if (nd->type == N_MATCH) {
+            st->hits = rsGrow(st->hits, st->hitLen + 1, sizeof(int32_t));
+            st->hits[st->hitLen++] = nd->arg;
+        } else if (nd->type == N_EOL) {
+            st->hasEol = true;
+        }
+    }
+    int32_t s = rs->stateLen++;
+    rs->states[s] = st;
+    for (uint32_t i = h & mask;; i = (i + 1) & mask) {
+        if (rs->slots[i] < 0) {
+            rs->slots[i] = s;
+            break;
+        }
+    }
+    return s;
+}
+
+static int32_t stateStep(regexSet* rs, int32_t s, uint8_t c) {
+    rsState* st = rs->states[s];
+    int32_t len = 0;
+    int32_t* seeds = ruMalloc0(st->nfaLen + 1, int32_t);
+    for (int32_t i = 0; i < st->nfaLen; i++) {
+        rsNode* nd = &rs->nodes[st->nfa[i]];
+        if (nd->type == N_BYTE && bytesHas(&rs->sets[nd->arg], c)) {
+            seeds[len++] = nd->out;
+        }
+    }
+    int32_t fl = rsClosure(rs, seeds, len, true, false, false);
+    ruFree(seeds);
+    int32_t before = rs->stateLen;
+    int32_t n = stateGet(rs, fl);
+    // a flush shrinks the cache and frees st
+    if (rs->stateLen >= before) st->next[c] = n;
+    return n;
+}
+
+// records a DFA hit unless the pattern is left to ICU for this text
+static void rsHit(regexSet* rs, int32_t id, bool ascii, uint8_t* matched,
+                  int32_t* hits) {
+    if (matched[id] || (!ascii && rs->kind[id] == RS_ASCII)) return;
+    matched[id] = 1;
+    (*hits)++;
+}
+
+// collects the matches that $ produces at the current position
+static void stateEol(regexSet* rs, int32_t s, bool bol, bool ascii,
+                     uint8_t* matched, int32_t* hits) {
+    rsState* st = rs->states[s];
+    int32_t fl = rsClosure(rs, st->nfa, st->nfaLen, false, bol, true);
+    for (int32_t i = 0; i < fl; i++) {
+        rsNode* nd = &rs->nodes[rs->found[i]];
+        if (nd->type == N_MATCH) rsHit(rs, nd->arg, ascii, matched, hits);
+    }
+}
+
+// whether only a final line terminator remains, where $ also matches
+static bool atEol(trans_chars text, rusize rest) {
+    if (!rest) return true;
+    if (rest == 2) return text[0] == '\r' && text[1] == '\n';
+    return rest == 1 && text[0] >= 0x0a && text[0] <= 0x0d;
+}
+
+static int32_t rsScan(regexSet* rs, trans_chars text, rusize len, bool ascii,
+                      uint8_t* matched, int32_t want) {
+    int32_t hits = 0;
+    if (!rs->startLen) return hits;
+    if (!rs->mark) scratchInit(rs);
+    if (rs->state0 < 0) {
+        int32_t fl = rsClosure(rs, NULL, 0, true, true, false);
+        rs->state0 = stateGet(rs, fl);
+    }
+    int32_t s = rs->state0;
+    const uint8_t* pos = (const uint8_t*)text;
+    for (rusize i = 0;; i++) {
+        rsState* st = rs->states[s];
+        for (int32_t h = 0; h < st->hitLen; h++) {
+            rsHit(rs, st->hits[h], ascii, matched, &hits);
+        }
+        if (st->hasEol && atEol(text + i, len - i)) {
+            stateEol(rs, s, i == 0, ascii, matched, &hits);
+        }
+        if (i == len || hits >= want) break;
+        int32_t n = st->next[pos[i]];
+        s = n < 0 ? stateStep(rs, s, pos[i]) : n;
+    }
+    return hits;
+}
+
+RUAPI ruRegexSet ruRegexSetNew(int32_t* code) {
     ruClearError();
-    ruList out = ruListNew(ruTypePtrFree());
-    if (!ruRegexSearch(rr, original, false, out, code)) {
-        return ruListFree(out);
+    regexSet* rs = ruMalloc0(1, regexSet);
+    rs->type = MagicRegexSet;
+    rs->mux = ruMutexInit();
+    rs->state0 = -1;
+    ruRetWithCode(code, RUE_OK, (ruRegexSet)rs);
+}
+
+RUAPI ruRegexSet ruRegexSetFree(ruRegexSet rset) {
+    ruClearError();
+    regexSet* rs = regexSetGet(rset, NULL);
+    if (!rs) return NULL;
+    for (int32_t i = 0; i < rs->count; i++) {
+        ruRegexFree(rs->icu[i]);
     }
-    if (!ruListSize(out, NULL)) {
-        return ruListFree(out);
+    stateFlush(rs);
+    ruFree(rs->states);
+    ruFree(rs->slots);
+    ruFree(rs->mark);
+    ruFree(rs->stack);
+    ruFree(rs->found);
+    ruFree(rs->icu);
+    ruFree(rs->kind);
+    ruFree(rs->starts);
+    ruFree(rs->nodes);
+    ruFree(rs->sets);
+    ruMutexFree(rs->mux);
+    ruFree(rs);
+    return NULL;
+}
+
+RUAPI int32_t ruRegexSetAdd(ruRegexSet rset, trans_chars pattern,
+                            ruRegexFlag flags, int32_t* code) {
+    ruClearError();
+    regexSet* rs = regexSetGet(rset, code);
+    if (!rs) return -1;
+    int32_t ret;
+    // ICU validates the syntax and handles whatever the dfa cannot
+    ruRegex rr = ruRegexNew(pattern, flags, &ret);
+    if (!rr) ruRetWithCode(code, ret, -1);
+
+    ruMutexLock(rs->mux);
+    if (rs->count == rs->cap) {
+        rs->cap = rs->cap ? rs->cap * 2 : 16;
+        rs->icu = rsGrow(rs->icu, rs->cap, sizeof(ruRegex));
+        rs->kind = rsGrow(rs->kind, rs->cap, sizeof(int32_t));
     }
-    return out;
+    int32_t id = rs->count++;
+    rs->icu[id] = rr;
+    rs->kind[id] = rsCompile(rs, pattern, flags, id);
+    if (rs->kind[id] == RS_ASCII) rs->asciiCount++;
+    if (rs->kind[id] != RS_ICU) {
+        // the nfa changed so the cached dfa and scratch space are stale
+        stateFlush(rs);
+        ruFree(rs->mark);
+    } else {
+        ruVerbLogf("regex set pattern %d '%s' is matched by ICU", id, pattern);
+    }
+    ruMutexUnlock(rs->mux);
+    ruRetWithCode(code, RUE_OK, id);
 }
 
+RUAPI int32_t ruRegexSetMatch(ruRegexSet rset, trans_chars text, rusize len,
+                              int32_t* ids, int32_t idCount, int32_t* code) {
+    ruClearError();
+    if (!rset || !text) ruRetWithCode(code, RUE_PARAMETER_NOT_SET, -1);
+    if (idCount && !ids) ruRetWithCode(code, RUE_INVALID_PARAMETER, -1);
+    regexSet* rs = regexSetGet(rset, code);
+    if (!rs) return -1;
+    if (len == RU_SIZE_AUTO) len = strlen(text);
+
+    ruMutexLock(rs->mux);
+    int32_t count = rs->count;
+    uint8_t* matched = ruMalloc0(count + 1, uint8_t);
+    bool ascii = true;
+    if (rs->asciiCount) {
+        uint8_t hi = 0;
+        for (rusize i = 0; i < len; i++) hi |= (uint8_t)text[i];
+        ascii = hi < 0x80;
+    }
+    int32_t want = 0;
+    for (int32_t i = 0; i < count; i++) {
+        if (rs->kind[i] == RS_DFA || (ascii && rs->kind[i] == RS_ASCII)) want++;
+    }
+    rsScan(rs, text, len, ascii, matched, want);
+
+    int32_t ret = RUE_OK, hits = 0;
+    for (int32_t i = 0; i < count; i++) {
+        if (rs->kind[i] == RS_ICU || (!ascii && rs->kind[i] == RS_ASCII)) {
+            matched[i] = ruRegexFindSpans(rs->icu[i], text, len,
+                                          NULL, 0, &ret);
+            if (ret != RUE_OK) break;
+        }
+        if (!matched[i]) continue;
+        if (hits < idCount) ids[hits] = i;
+        hits++;
+    }
+    ruMutexUnlock(rs->mux);
+    ruFree(matched);
+    if (ret != RUE_OK) ruRetWithCode(code, ret, -1);
+    ruRetWithCode(code, RUE_OK, hits);
+}
+//</editor-fold>
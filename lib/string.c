@@ -21,6 +21,104 @@
  */
 #include <stdlib.h>
 #include "lib.h"
+#if defined(__GNUC__) && defined(__x86_64__)
+#define STR_SIMD_X64
+#include <immintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define STR_SIMD_X64
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+//<editor-fold desc="arena">
+/*
+ *  ruArena class
+ */
+ruMakeTypeGetter(Arena, MagicArena)
+
+#define ARENA_ALIGN sizeof(void*)
+#define ARENA_BLOCK 4096
+
+typedef struct arenaBlock_ {
+    struct arenaBlock_* next;
+    rusize size;
+    rusize used;
+    char data[];
+} arenaBlock;
+
+static arenaBlock* arenaBlockNew(rusize size) {
+    arenaBlock* ab = (arenaBlock*)ruMallocSize(1, sizeof(arenaBlock) + size);
+    ab->size = size;
+    return ab;
+}
+
+static void* arenaAlloc(Arena* ar, rusize size) {
+    arenaBlock* ab = ar->head;
+    rusize at = (ab->used + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+    if (at + size > ab->size) {
+        if (size > ar->blockSize / 4) {
+            // large chunks get their own block behind the current one
+            arenaBlock* big = arenaBlockNew(size);
+            big->used = size;
+            big->next = ab->next;
+            ab->next = big;
+            return big->data;
+        }
+        ab = arenaBlockNew(ar->blockSize);
+        ab->next = ar->head;
+        ar->head = ab;
+        at = 0;
+    }
+    ab->used = at + size;
+    return ab->data + at;
+}
+
+// grows the last allocation of the current block in place if there is room
+static bool arenaExtend(Arena* ar, void* ptr, rusize oldSize, rusize newSize) {
+    arenaBlock* ab = ar->head;
+    char* p = ptr;
+    if (p + oldSize != ab->data + ab->used) return false;
+    if ((rusize)(p - ab->data) + newSize > ab->size) return false;
+    ab->used = (p - ab->data) + newSize;
+    return true;
+}
+
+static void arenaRelease(arenaBlock* ab) {
+    while (ab) {
+        arenaBlock* next = ab->next;
+        ruFree(ab);
+        ab = next;
+    }
+}
+
+RUAPI ruArena ruArenaNew(rusize blockSize) {
+    Arena* ar = ruMalloc0(1, Arena);
+    ar->type = MagicArena;
+    ar->blockSize = blockSize? blockSize : ARENA_BLOCK;
+    ar->head = arenaBlockNew(ar->blockSize);
+    return (ruArena)ar;
+}
+
+RUAPI int32_t ruArenaReset(ruArena ra) {
+    int32_t ret;
+    Arena* ar = ArenaGet(ra, &ret);
+    if (!ar) return ret;
+    // keep the newest block around for the next round
+    arenaRelease(ar->head->next);
+    ar->head->next = NULL;
+    ar->head->used = 0;
+    return RUE_OK;
+}
+
+RUAPI ruArena ruArenaFree(ruArena ra) {
+    Arena* ar = ArenaGet(ra, NULL);
+    if (!ar) return NULL;
+    arenaRelease(ar->head);
+    memset(ar, 0, sizeof(Arena));
+    ruFree(ar);
+    return NULL;
+}
+//</editor-fold>
 
 /*
  *  ruString class
@@ -31,26 +129,272 @@ static void maybeAdd(String *str, rusize ilen) {
     rusize newlen = str->idx + ilen + 1;
     if (str->len < newlen) {
         newlen <<= 1; // double
-        str->start = ruRealloc(str->start, newlen, char);
+        if (!str->arena) {
+            str->start = ruRealloc(str->start, newlen, char);
+        } else if (!arenaExtend(str->arena, str->start, str->len, newlen)) {
+            // the old buffer stays behind until the arena goes
+            char* buf = arenaAlloc(str->arena, newlen);
+            memcpy(buf, str->start, str->idx + 1);
+            str->start = buf;
+        }
         str->len = newlen;
     }
 }
+
 static int32_t appendf(String *str, const char* format, va_list args) {
-    int32_t ret = RUE_OK;
     if (!format) return RUE_PARAMETER_NOT_SET;
     va_list a2;
     va_copy(a2, args);
-    // stream better be NULL else M$ crt craoks with -1
-    int32_t size  = vsnprintf(NULL, 0, format, a2);
+    // format straight into the spare room and only retry when it didn't fit
+    rusize avail = str->len - str->idx;
+    int32_t size = vsnprintf(str->start+str->idx, avail, format, a2);
     va_end (a2);
-    if (size > 0) {
+    if (size < 0) {
+        // older M$ crts return -1 on truncation instead of the needed size.
+        // stream better be NULL else M$ crt craoks with -1
+        va_copy(a2, args);
+        size = vsnprintf(NULL, 0, format, a2);
+        va_end (a2);
+    }
+    if (size <= 0) {
+        str->start[str->idx] = '\0';
+        return size < 0? RUE_INVALID_PARAMETER : RUE_OK;
+    }
+    if ((rusize)size >= avail) {
         maybeAdd(str, size);
         size = vsnprintf(str->start+str->idx, size+1, format, args);
-        str->idx += size;
     }
-    return ret;
+    str->idx += size;
+    return RUE_OK;
 }
 
+static String* stringNew(Arena* ar, rusize size) {
+    String* str;
+    if (size < RU_STRING_MIN) size = RU_STRING_MIN;
+    if (ar) {
+        // header and initial buffer in one go
+        str = arenaAlloc(ar, sizeof(String) + size);
+        memset(str, 0, sizeof(String));
+        str->start = (char*)(str + 1);
+        str->start[0] = '\0';
+        str->arena = ar;
+    } else {
+        str = ruMalloc0(1, String);
+        str->start = ruMalloc0(size, char);
+    }
+    str->type = MagicString;
+    str->len = size;
+    return str;
+}
+
+//<editor-fold desc="search kernels">
+/*
+ * The searches below lean on memchr, which the C runtimes ship in vectorized
+ * form with their own CPU dispatch. The cases memchr does not cover scan 16
+ * bytes at a time with SSE2 on x86-64 and 8 bytes at a time elsewhere. Longer
+ * spans are first skipped over 32 bytes at a time with AVX2 when the CPU has
+ * it, looked up as in icu.cpp.
+ */
+#define SWAR_ONES  0x0101010101010101ULL
+#define SWAR_HIGHS 0x8080808080808080ULL
+// whether any byte of x is zero
+#define swarHasZero(x) (((x) - SWAR_ONES) & ~(x) & SWAR_HIGHS)
+
+#ifdef STR_SIMD_X64
+// bit mask of the bytes at p that equal the bytes of c
+#define sseEqAt(p, c) (uint32_t)_mm_movemask_epi8( \
+    _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(p)), c))
+
+static inline uint32_t lowBit(uint32_t mask) {
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward(&idx, mask);
+    return (uint32_t)idx;
+#else
+    return (uint32_t)__builtin_ctz(mask);
+#endif
+}
+
+static inline uint32_t highBit(uint32_t mask) {
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanReverse(&idx, mask);
+    return (uint32_t)idx;
+#else
+    return 31 - (uint32_t)__builtin_clz(mask);
+#endif
+}
+
+static bool avx2Available(void) {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    // the OS must save the AVX registers as well
+    if (!(info[2] & (1 << 27)) || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+// whether the span of len bytes is long enough to be worth AVX2
+static bool avx2Worth(rusize len) {
+    // -1 unknown, 0 SSE2, 1 AVX2. Racing threads store the same value.
+    static volatile int avx2 = -1;
+    if (len < 64) return false;
+    if (avx2 < 0) avx2 = avx2Available();
+    return avx2 == 1;
+}
+
+/*
+ * The AVX2 kernels only skip whole 32 byte blocks without a match and return
+ * where the SSE2 loop has to go on, which finds a match right away if there
+ * was one. The upper register halves are cleared before returning, or the
+ * SSE code that follows stalls.
+ */
+#ifdef __GNUC__
+__attribute__((target("avx2")))
+#endif
+static rusize skipNeitherAvx2(trans_chars p, rusize len, char a, char b) {
+    const __m256i va = _mm256_set1_epi8(a), vb = _mm256_set1_epi8(b);
+    rusize i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + i));
+        if (_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, va),
+                                                 _mm256_cmpeq_epi8(v, vb)))) {
+            break;
+        }
+    }
+    _mm256_zeroupper();
+    return i;
+}
+
+#ifdef __GNUC__
+__attribute__((target("avx2")))
+#endif
+static rusize skipBackAvx2(trans_chars p, rusize len, char c) {
+    const __m256i vc = _mm256_set1_epi8(c);
+    rusize i = len;
+    for (; i >= 32; i -= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i*)(p + i - 32));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, vc))) break;
+    }
+    _mm256_zeroupper();
+    return i;
+}
+#endif
+
+// length of str but no more than len without reading past the terminator
+static rusize boundLen(trans_chars str, rusize len) {
+    if (!len || len == RU_SIZE_AUTO) return strlen(str);
+    trans_chars end = memchr(str, '\0', len);
+    return end? (rusize)(end - str) : len;
+}
+
+static inline char lowerChar(char c) {
+    return (c >= 'A' && c <= 'Z')? (char)(c + 32) : c;
+}
+
+// first position of a or b in the len bytes at p
+static trans_chars findEither(trans_chars p, rusize len, char a, char b) {
+    if (a == b) return memchr(p, a, len);
+    rusize i = 0;
+#ifdef STR_SIMD_X64
+    if (avx2Worth(len)) i = skipNeitherAvx2(p, len, a, b);
+    const __m128i va = _mm_set1_epi8(a), vb = _mm_set1_epi8(b);
+    for (; i + 16 <= len; i += 16) {
+        uint32_t mask = sseEqAt(p + i, va) | sseEqAt(p + i, vb);
+        if (mask) return p + i + lowBit(mask);
+    }
+#endif
+    uint64_t ma = SWAR_ONES * (uint8_t)a, mb = SWAR_ONES * (uint8_t)b;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, 8);
+        if (swarHasZero(w ^ ma) | swarHasZero(w ^ mb)) break;
+    }
+    for (; i < len; i++) {
+        if (p[i] == a || p[i] == b) return p + i;
+    }
+    return NULL;
+}
+
+// last position of c in the len bytes at p
+static trans_chars findLast(trans_chars p, rusize len, char c) {
+    rusize i = len;
+#ifdef STR_SIMD_X64
+    if (avx2Worth(len)) i = skipBackAvx2(p, len, c);
+    const __m128i vc = _mm_set1_epi8(c);
+    for (; i >= 16; i -= 16) {
+        uint32_t mask = sseEqAt(p + i - 16, vc);
+        if (mask) return p + i - 16 + highBit(mask);
+    }
+#endif
+    uint64_t mc = SWAR_ONES * (uint8_t)c;
+    for (; i >= 8; i -= 8) {
+        uint64_t w;
+        memcpy(&w, p + i - 8, 8);
+        if (swarHasZero(w ^ mc)) break;
+    }
+    while (i) {
+        if (p[--i] == c) return p + i;
+    }
+    return NULL;
+}
+
+static trans_chars strFind(trans_chars hay, rusize hayLen,
+                           trans_chars needle, rusize needleLen) {
+    if (!needleLen) return hay;
+    if (hayLen < needleLen) return NULL;
+    trans_chars p = hay;
+    trans_chars last = hay + hayLen - needleLen;
+    while (p <= last) {
+        p = memchr(p, needle[0], last - p + 1);
+        if (!p) return NULL;
+        if (!memcmp(p + 1, needle + 1, needleLen - 1)) return p;
+        p++;
+    }
+    return NULL;
+}
+
+static trans_chars strFindCase(trans_chars hay, rusize hayLen,
+                               trans_chars needle, rusize needleLen) {
+    if (!needleLen) return hay;
+    if (hayLen < needleLen) return NULL;
+    char lo = lowerChar(needle[0]);
+    char up = ruAsciiCharToUpper(lo);
+    trans_chars p = hay;
+    trans_chars last = hay + hayLen - needleLen;
+    while (p <= last) {
+        p = findEither(p, last - p + 1, lo, up);
+        if (!p) return NULL;
+        rusize i = 1;
+        while (i < needleLen && lowerChar(p[i]) == lowerChar(needle[i])) i++;
+        if (i == needleLen) return p;
+        p++;
+    }
+    return NULL;
+}
+
+static trans_chars strFindLast(trans_chars hay, rusize hayLen,
+                               trans_chars needle, rusize needleLen) {
+    if (!needleLen) return hay;
+    if (hayLen < needleLen) return NULL;
+    // candidates are the positions up to the last possible start
+    rusize span = hayLen - needleLen + 1;
+    while (span) {
+        trans_chars p = findLast(hay, span, needle[0]);
+        if (!p) return NULL;
+        if (!memcmp(p + 1, needle + 1, needleLen - 1)) return p;
+        span = p - hay;
+    }
+    return NULL;
+}
+//</editor-fold>
+
 static alloc_chars caseThis(trans_chars instr, rusize len, bool up) {
     if (!instr) return NULL;
 
@@ -111,7 +455,7 @@ RUAPI ruString ruStringNew(const char* instr) {
     return ruStringNewn(instr, ruStrLen(instr));
 }
 
-RUAPI ruString ruStringNewn(const char* instr, rusize size) {
+static ruString stringNewn(Arena* ar, const char* instr, rusize size) {
     ruClearError();
     if (!instr && !size) {
         ruSetError("Ignoring bogus invocation with NULL instr and 0 size");
@@ -131,38 +475,41 @@ RUAPI ruString ruStringNewn(const char* instr, rusize size) {
     }
     // we need at least clen + terminator
     if (mlen <= clen) mlen = clen + 1;
-    String *str = ruMalloc0(1, String);
-    str->type = MagicString;
-    str->len = mlen;
-    str->start = ruMalloc0(str->len, char);
+    String *str = stringNew(ar, mlen);
     if (instr) {
-        strncpy(str->start, instr, clen);
+        memcpy(str->start, instr, clen);
+        str->start[clen] = '\0';
         str->idx = clen;
     }
     return (ruString)str;
 }
 
+RUAPI ruString ruStringNewn(const char* instr, rusize size) {
+    return stringNewn(NULL, instr, size);
+}
+
+RUAPI ruString ruStringArenaNew(ruArena ra, const char* instr, rusize size) {
+    Arena* ar = ArenaGet(ra, NULL);
+    if (!ar) {
+        ruClearError();
+        ruSetError("Ignoring invalid arena");
+        return NULL;
+    }
+    if (size == RU_SIZE_AUTO) size = ruStrLen(instr);
+    return stringNewn(ar, instr, size);
+}
+
 RUAPI ruString ruStringNewf(const char* format, ...) {
     ruClearError();
     if (!format) {
         ruSetError("Ignoring bogus null format");
         return NULL;
     }
-    String *str = ruMalloc0(1, String);
-    str->type = MagicString;
+    String *str = stringNew(NULL, strlen(format) + RU_STRING_MIN);
     va_list args;
     va_start (args, format);
-    int32_t size  = vsnprintf(str->start, 0, format, args);
+    appendf(str, format, args);
     va_end (args);
-    if (size > 0) {
-        size++; // terminator
-        str->len = size * 2;
-        str->start = ruMalloc0(str->len, char);
-        va_start (args, format);
-        size = vsnprintf(str->start, size, format, args);
-        va_end (args);
-        str->idx = size;
-    }
     return (ruString)str;
 }
 
@@ -178,6 +525,11 @@ RUAPI int32_t ruStringReset(ruString rs) {
 RUAPI ruString ruStringFree(ruString rs, bool keepBuffer) {
     String *str = StringGet(rs, NULL);
     if (!str) return NULL;
+    if (str->arena) {
+        // memory goes with the arena
+        str->type = 0;
+        return NULL;
+    }
     if (!keepBuffer) ruFree(str->start);
     memset(str, 0, sizeof(String));
     ruFree(str);
@@ -330,8 +682,8 @@ RUAPI rusize ruStrLen(trans_chars str) {
 
 RUAPI char* ruStrNDup(trans_chars str, rusize len) {
     if (!str) return NULL;
-    rusize inlen = strlen(str);
-    if (len < inlen) inlen = len;
+    // only look as far as we may copy
+    rusize inlen = len? boundLen(str, len) : 0;
     char *ret = ruMalloc0(inlen + 1, char); // terminator
     memcpy(ret, str, inlen);
     return ret;
@@ -433,12 +785,8 @@ RUAPI bool ruStrCaseEndsWith(trans_chars str, trans_chars suffix, int32_t *code)
 }
 
 RUAPI bool ruStrHasChar(trans_chars haystack, char needle) {
-    if (!haystack) return false;
-    while(*haystack) {
-        if (needle == *haystack) return true;
-        haystack++;
-    }
-    return false;
+    if (!haystack || !needle) return false;
+    return strchr(haystack, needle) != NULL;
 }
 
 RUAPI perm_chars ruStrStrip(perm_chars instr, trans_chars unwanted,
@@ -624,55 +972,12 @@ RUAPI bool ruStrFindKeyVal(trans_chars inStart, rusize inLen, trans_chars delim,
 
 RUAPI trans_chars ruStrCaseStrLen(trans_chars haystack, trans_chars needle, rusize len) {
     if (!haystack || !needle) return NULL;
-    rusize needleLen = strlen (needle);
-    rusize haystackLen = strlen (haystack);
-    if (len > 0 && len < haystackLen) {
-        haystackLen = len;
-    }
-
-    if (!needleLen) return (char*)haystack;
-
-    if (haystackLen < needleLen) return NULL;
-    char *p = (char*)haystack;
-    const char *stackEnd = haystack + haystackLen - needleLen;
-
-    alloc_chars pin = ruAsciiToLower(needle);
-    while (p <= stackEnd) {
-        for (rusize i = 0; i < needleLen; i++) {
-            if (ruAsciiCharToLower(p[i]) != pin[i]) goto next;
-        }
-        ruFree(pin);
-        return (char *)p;
-        next:
-        p++;
-    }
-    ruFree(pin);
-    return NULL;
+    return strFindCase(haystack, boundLen(haystack, len), needle, strlen(needle));
 }
 
 RUAPI trans_chars ruStrStrLen(trans_chars haystack, trans_chars needle, rusize len) {
     if (!haystack || !needle) return NULL;
-    rusize needleLen = strlen (needle);
-    rusize haystackLen = strlen (haystack);
-    if (len > 0 && len < haystackLen) {
-        haystackLen = len;
-    }
-
-    if (!needleLen) return (char*)haystack;
-
-    if (haystackLen < needleLen) return NULL;
-    char *p = (char*)haystack;
-    const char *stackEnd = haystack + haystackLen - needleLen;
-
-    while (p <= stackEnd) {
-        for (rusize i = 0; i < needleLen; i++) {
-            if (p[i] != needle[i]) goto next;
-        }
-        return (char *)p;
-        next:
-        p++;
-    }
-    return NULL;
+    return strFind(haystack, boundLen(haystack, len), needle, strlen(needle));
 }
 
 RUAPI bool ruStrNEquals(trans_chars str1, rusize s1len, trans_chars str2) {
@@ -688,29 +993,7 @@ RUAPI trans_chars ruStrStr(trans_chars haystack, trans_chars needle) {
 
 RUAPI trans_chars ruLastSubStrLen(trans_chars haystack, trans_chars needle, rusize len) {
     if (!haystack || !needle) return NULL;
-
-    rusize needleLen = strlen (needle);
-    rusize haystackLen = strlen (haystack);
-    if (len > 0 && len < haystackLen) {
-        haystackLen = len;
-    }
-    if (!needleLen) return (char*)haystack;
-
-    if (haystackLen < needleLen) return NULL;
-
-    trans_chars p = (char*)haystack + haystackLen - needleLen;
-    rusize needleEnd = needleLen - 1;
-
-    while (p >= haystack) {
-        rusize i = needleEnd;
-        do {
-            if (p[i] != needle[i]) goto next;
-        } while (i--);
-        return (char *)p;
-        next:
-        p--;
-    }
-    return NULL;
+    return strFindLast(haystack, boundLen(haystack, len), needle, strlen(needle));
 }
 
 RUAPI trans_chars ruLastSubStr(trans_chars haystack, trans_chars needle) {
@@ -721,23 +1004,19 @@ RUAPI ruList ruStrNSplit(trans_chars instr, rusize inlen, trans_chars delim, int
     if (!instr || !inlen || !delim || !delim[0]) return NULL;
 
     if (maxCnt < 1) maxCnt = INT_MAX;
-    if (inlen == RU_SIZE_AUTO) inlen = strlen(instr);
+    inlen = boundLen(instr, inlen);
     trans_chars inPast = instr + inlen;
+    rusize delLen = strlen(delim);
 
     ruList strList = ruListNew(ruTypePtrFree());
-    const char *remainder = instr;
-    char *ptr = strstr(remainder, delim);
-    if (ptr && ptr < inPast) {
-        rusize delLen = strlen(delim);
-        while (--maxCnt && ptr && ptr < inPast) {
-            ruListAppend(strList, ruStrNDup(remainder, ptr - remainder));
-            remainder = ptr + delLen;
-            ptr = strstr(remainder, delim);
-        }
-    }
-    if (remainder) {
-        ruListAppend(strList, ruStrNDup(remainder, inPast - remainder));
+    trans_chars remainder = instr;
+    trans_chars ptr = strFind(remainder, inlen, delim, delLen);
+    while (--maxCnt && ptr) {
+        ruListAppend(strList, ruStrNDup(remainder, ptr - remainder));
+        remainder = ptr + delLen;
+        ptr = strFind(remainder, inPast - remainder, delim, delLen);
     }
+    ruListAppend(strList, ruStrNDup(remainder, inPast - remainder));
     return strList;
 }
 
@@ -745,6 +1024,65 @@ RUAPI ruList ruStrSplit (trans_chars instr, trans_chars delim, int32_t maxCnt) {
     return ruStrNSplit(instr, RU_SIZE_AUTO, delim, maxCnt);
 }
 
+static void spanSet(ruStrSpan* span, trans_chars start, rusize len, bool trim) {
+    if (!span) return;
+    if (trim) {
+        rusize tlen = 0;
+        trans_chars tstart = ruStrTrimBounds(start, len, &tlen);
+        if (tstart) start = tstart;
+        len = tlen;
+    }
+    span->start = start;
+    span->len = len;
+}
+
+RUAPI int32_t ruStrSplitterInit(ruStrSplitter* ss, trans_chars instr,
+                                rusize inlen, trans_chars delim,
+                                int32_t maxCnt, bool trim) {
+    if (!ss) return RUE_PARAMETER_NOT_SET;
+    memset(ss, 0, sizeof(ruStrSplitter));
+    if (!instr || !delim) return RUE_PARAMETER_NOT_SET;
+    if (!inlen || !delim[0]) return RUE_INVALID_PARAMETER;
+    ss->next = instr;
+    ss->past = instr + boundLen(instr, inlen);
+    ss->delim = delim;
+    ss->delimLen = strlen(delim);
+    ss->left = maxCnt < 1? INT_MAX : maxCnt;
+    ss->trim = trim;
+    return RUE_OK;
+}
+
+RUAPI bool ruStrSplitterNext(ruStrSplitter* ss, ruStrSpan* span) {
+    if (!ss || !ss->next) return false;
+    trans_chars start = ss->next;
+    trans_chars end = NULL;
+    if (--ss->left) {
+        end = strFind(start, ss->past - start, ss->delim, ss->delimLen);
+    }
+    if (end) {
+        ss->next = end + ss->delimLen;
+    } else {
+        // last piece
+        end = ss->past;
+        ss->next = NULL;
+    }
+    spanSet(span, start, end - start, ss->trim);
+    return true;
+}
+
+RUAPI uint32_t ruStrSplitSpans(trans_chars instr, rusize inlen,
+                               trans_chars delim, bool trim, ruStrSpan* spans,
+                               uint32_t spanCount, int32_t* code) {
+    if (!spans || !spanCount) ruRetWithCode(code, RUE_PARAMETER_NOT_SET, 0);
+    ruStrSplitter ss;
+    int32_t maxCnt = spanCount > INT_MAX? INT_MAX : (int32_t)spanCount;
+    int32_t ret = ruStrSplitterInit(&ss, instr, inlen, delim, maxCnt, trim);
+    if (ret != RUE_OK) ruRetWithCode(code, ret, 0);
+    uint32_t cnt = 0;
+    while (ruStrSplitterNext(&ss, spans + cnt)) cnt++;
+    ruRetWithCode(code, RUE_OK, cnt);
+}
+
 RUAPI char ruAsciiCharToLower(char in) {
     if (in >= 'A' && in <= 'Z') return in + 0x20;
     return in;
@@ -683,6 +683,26 @@ RUAPI void ruCondWait(ruCond c, ruMutex m) {
 //</editor-fold>
 
 //<editor-fold desc="Mutex">
+#ifdef _WIN32
+typedef struct {
+    void (*init)(void);
+} onceFunc;
+
+static BOOL CALLBACK onceCall(PINIT_ONCE once, PVOID param, PVOID* ctx) {
+    ((onceFunc*)param)->init();
+    return TRUE;
+}
+#endif
+
+void runOnce(ruOnce_t* once, void (*init)(void)) {
+#ifdef _WIN32
+    onceFunc of = {init};
+    InitOnceExecuteOnce(once, onceCall, &of, NULL);
+#else
+    pthread_once(once, init);
+#endif
+}
+
 RUAPI ruMutex ruMutexInit(void) {
     ruClearError();
     Mux *mux = ruMalloc0(1, Mux);
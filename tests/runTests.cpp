@@ -42,6 +42,8 @@ Suite* getSuite(void) {
      suite_add_tcase(suite, htmlTests());
      suite_add_tcase(suite, regexTests());
     suite_add_tcase(suite, ioTests());
+    suite_add_tcase(suite, aioTests());
+    suite_add_tcase(suite, hashTests());
     suite_add_tcase(suite, iniTests());
     suite_add_tcase(suite, jsonTests());
     suite_add_tcase(suite, storeTests());
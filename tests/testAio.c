@@ -0,0 +1,350 @@
+/*
+ * Copyright regify
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "tests.h"
+#if _WIN32
+#define close _close
+#endif
+
+START_TEST(api) {
+    int32_t ret, exp;
+    const char *test = "ruAioNew";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+
+    exp = RUE_INVALID_PARAMETER;
+    ruAio ra = ruAioNew(1000, 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(NULL == ra, retText, test, NULL, ra);
+
+    test = "ruAioRead";
+    exp = RUE_PARAMETER_NOT_SET;
+    char buf[8];
+    uint64_t id = ruAioRead(NULL, 0, buf, sizeof(buf), 0, NULL, NULL, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(0 == id, retText, test, 0, id);
+
+    exp = RUE_INVALID_PARAMETER;
+    id = ruAioRead(NULL, -1, buf, sizeof(buf), 0, NULL, NULL, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    exp = RUE_PARAMETER_NOT_SET;
+    id = ruAioRead(NULL, 0, NULL, sizeof(buf), 0, NULL, NULL, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    test = "ruAioFsync";
+    exp = RUE_INVALID_PARAMETER;
+    id = ruAioFsync(NULL, -1, NULL, NULL, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    test = "ruAioRename";
+    exp = RUE_PARAMETER_NOT_SET;
+    id = ruAioRename(NULL, "foo", NULL, NULL, NULL, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    test = "ruAioRemove";
+    id = ruAioRemove(NULL, NULL, NULL, NULL, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    test = "ruAioFileGetContents";
+    id = ruAioFileGetContents(NULL, NULL, NULL, NULL, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    test = "ruAioFileSetContents";
+    id = ruAioFileSetContents(NULL, "foo", "bar", 3, NULL, NULL, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    test = "ruAioPoll";
+    ruAioResult* res = ruAioPoll(NULL, 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(NULL == res, retText, test, NULL, res);
+
+    test = "ruAioWait";
+    ret = ruAioWait(NULL, 0);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    test = "ruAioPending";
+    uint32_t pending = ruAioPending(NULL, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(0 == pending, retText, test, 0, pending);
+
+    test = "ruAioFree";
+    ra = ruAioFree(NULL);
+    fail_unless(NULL == ra, retText, test, NULL, ra);
+}
+END_TEST
+
+static void countCb(ruAioResult* res) {
+    ruCount cnt = (ruCount)res->ctx;
+    if (res->code == RUE_OK) ruCounterInc(cnt, 1);
+}
+
+START_TEST(run) {
+    int32_t ret, exp;
+    const char *test = "ruAioNew";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+    const char *strText = "%s failed wanted '%s' but got '%s'";
+    char* outDir = insureTestFolder("aio");
+
+    ruAio ra = ruAioNew(0, 16, &ret);
+    exp = RUE_OK;
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    // whole file helpers with polling
+    const char* content = "Hello async world";
+    alloc_chars file = ruPathJoin(outDir, "first.txt");
+    test = "ruAioFileSetContents";
+    uint64_t id = ruAioFileSetContents(ra, file, content, RU_SIZE_AUTO,
+                                       NULL, NULL, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_if(0 == id, retText, test, 0, id);
+
+    ruAioResult* res = ruAioPoll(ra, 5000, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_if(NULL == res, retText, test, NULL, res);
+    fail_unless(id == res->id, retText, test, id, res->id);
+    fail_unless(RU_AIO_SET_CONTENTS == res->op, retText, test,
+                RU_AIO_SET_CONTENTS, res->op);
+    fail_unless(exp == res->code, retText, test, exp, res->code);
+    fail_unless(strlen(content) == res->len, retText, test,
+                strlen(content), res->len);
+    ruAioResultFree(res);
+
+    test = "ruAioFileGetContents";
+    id = ruAioFileGetContents(ra, file, NULL, NULL, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    res = ruAioPoll(ra, 5000, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(exp == res->code, retText, test, exp, res->code);
+    ck_assert_str_eq(content, (char*)res->data);
+    // take ownership
+    alloc_chars data = res->data;
+    res->data = NULL;
+    ruAioResultFree(res);
+    fail_unless(0 == strcmp(content, data), strText, test, content, data);
+    ruFree(data);
+
+    // nothing left to poll
+    test = "ruAioPoll";
+    exp = RUE_FILE_NOT_FOUND;
+    res = ruAioPoll(ra, 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(NULL == res, retText, test, NULL, res);
+
+    // fd based requests
+    exp = RUE_OK;
+    test = "ruAioWrite";
+    int fd = ruOpen(file, O_RDWR, 0666, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    id = ruAioWrite(ra, fd, "HELLO", 5, 0, NULL, NULL, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    res = ruAioPoll(ra, 5000, &ret);
+    fail_unless(exp == res->code, retText, test, exp, res->code);
+    fail_unless(5 == res->len, retText, test, 5, res->len);
+    ruAioResultFree(res);
+
+    test = "ruAioFsync";
+    id = ruAioFsync(ra, fd, NULL, NULL, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    res = ruAioPoll(ra, 5000, &ret);
+    fail_unless(exp == res->code, retText, test, exp, res->code);
+    ruAioResultFree(res);
+
+    test = "ruAioRead";
+    char buf[32];
+    memset(buf, 0, sizeof(buf));
+    id = ruAioRead(ra, fd, buf, sizeof(buf) - 1, 6, NULL, NULL, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    res = ruAioPoll(ra, 5000, &ret);
+    fail_unless(exp == res->code, retText, test, exp, res->code);
+    fail_unless(11 == res->len, retText, test, 11, res->len);
+    fail_unless(buf == res->data, retText, test, buf, res->data);
+    ruAioResultFree(res);
+    ck_assert_str_eq("async world", buf);
+    close(fd);
+
+    test = "ruAioRename";
+    alloc_chars second = ruPathJoin(outDir, "second.txt");
+    id = ruAioRename(ra, file, second, NULL, NULL, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    res = ruAioPoll(ra, 5000, &ret);
+    fail_unless(exp == res->code, retText, test, exp, res->code);
+    ck_assert_str_eq(file, res->path);
+    ruAioResultFree(res);
+    fail_if(ruFileExists(file), retText, test, false, true);
+    fail_unless(ruFileExists(second), retText, test, true, false);
+
+    test = "ruAioRemove";
+    id = ruAioRemove(ra, second, NULL, NULL, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    res = ruAioPoll(ra, 5000, &ret);
+    fail_unless(exp == res->code, retText, test, exp, res->code);
+    ruAioResultFree(res);
+    fail_if(ruFileExists(second), retText, test, false, true);
+
+    test = "ruAioFileGetContents";
+    exp = RUE_FILE_NOT_FOUND;
+    id = ruAioFileGetContents(ra, second, NULL, NULL, &ret);
+    res = ruAioPoll(ra, 5000, &ret);
+    fail_unless(exp == res->code, retText, test, exp, res->code);
+    fail_unless(NULL == res->data, retText, test, NULL, res->data);
+    ruAioResultFree(res);
+
+    // a burst of callback requests
+    test = "ruAioWait";
+    exp = RUE_OK;
+    ruCount cnt = ruCounterNew(0);
+    int files = 100;
+    for (int i = 0; i < files; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "burst%d.txt", i);
+        alloc_chars path = ruPathJoin(outDir, name);
+        ruAioFileSetContents(ra, path, content, RU_SIZE_AUTO,
+                             countCb, cnt, &ret);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        ruFree(path);
+    }
+    ret = ruAioWait(ra, 10000);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    int64_t done = ruCounterRead(cnt);
+    fail_unless(files == done, retText, test, files, done);
+    uint32_t pending = ruAioPending(ra, &ret);
+    fail_unless(0 == pending, retText, test, 0, pending);
+    // the folder itself is counted as well
+    ru_int entries = ruFolderEntries(outDir);
+    fail_unless(files + 1 == entries, retText, test, files + 1, entries);
+
+    // freeing drains the queue
+    test = "ruAioFree";
+    ruCountSet(cnt, 0);
+    for (int i = 0; i < files; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "burst%d.txt", i);
+        alloc_chars path = ruPathJoin(outDir, name);
+        ruAioRemove(ra, path, countCb, cnt, &ret);
+        ruFree(path);
+    }
+    ra = ruAioFree(ra);
+    done = ruCounterRead(cnt);
+    fail_unless(files == done, retText, test, files, done);
+    entries = ruFolderEntries(outDir);
+    fail_unless(1 == entries, retText, test, 1, entries);
+
+    ruCountFree(cnt);
+    ruFree(second);
+    ruFree(file);
+    ruFree(outDir);
+}
+END_TEST
+
+START_TEST(batch) {
+    int32_t ret, exp;
+    const char *test = "ruWriteBatchNew";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+    char* outDir = insureTestFolder("batch");
+
+    exp = RUE_INVALID_PARAMETER;
+    ruWriteBatch wb = ruWriteBatchNew((ruAio)outDir, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(NULL == wb, retText, test, NULL, wb);
+
+    test = "ruWriteBatchAdd";
+    exp = RUE_PARAMETER_NOT_SET;
+    ret = ruWriteBatchAdd(NULL, "foo", "bar", 3);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    test = "ruWriteBatchCommit";
+    ret = ruWriteBatchCommit(NULL);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    test = "ruWriteBatchFree";
+    wb = ruWriteBatchFree(NULL);
+    fail_unless(NULL == wb, retText, test, NULL, wb);
+
+    // once sequentially and once with parallel flushes
+    ruAio ra = ruAioNew(4, 0, NULL);
+    ruAio engines[] = {NULL, ra};
+    const char* content = "durable content";
+    int files = 20;
+    for (int e = 0; e < 2; e++) {
+        exp = RUE_OK;
+        test = "ruWriteBatchNew";
+        wb = ruWriteBatchNew(engines[e], &ret);
+        fail_unless(exp == ret, retText, test, exp, ret);
+
+        test = "ruWriteBatchAdd";
+        for (int i = 0; i < files; i++) {
+            char name[32];
+            snprintf(name, sizeof(name), "batch%d-%d.txt", e, i);
+            alloc_chars path = ruPathJoin(outDir, name);
+            ret = ruWriteBatchAdd(wb, path, content, RU_SIZE_AUTO);
+            fail_unless(exp == ret, retText, test, exp, ret);
+            // not visible before the commit
+            fail_if(ruFileExists(path), retText, test, false, true);
+            ruFree(path);
+        }
+        uint32_t sz = ruWriteBatchSize(wb, &ret);
+        fail_unless(files == sz, retText, test, files, sz);
+
+        test = "ruWriteBatchCommit";
+        ret = ruWriteBatchCommit(wb);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        sz = ruWriteBatchSize(wb, &ret);
+        fail_unless(0 == sz, retText, test, 0, sz);
+        // no temporary files are left behind
+        ru_int want = files * (e + 1) + 1;
+        ru_int entries = ruFolderEntries(outDir);
+        fail_unless(want == entries, retText, test, want, entries);
+
+        for (int i = 0; i < files; i++) {
+            char name[32];
+            snprintf(name, sizeof(name), "batch%d-%d.txt", e, i);
+            alloc_chars path = ruPathJoin(outDir, name);
+            alloc_chars data = NULL;
+            ret = ruFileGetContents(path, &data, NULL);
+            fail_unless(exp == ret, retText, test, exp, ret);
+            ck_assert_str_eq(content, data);
+            ruFree(data);
+            ruFree(path);
+        }
+
+        // uncommitted entries are discarded
+        test = "ruWriteBatchFree";
+        alloc_chars path = ruPathJoin(outDir, "dropped.txt");
+        ret = ruWriteBatchAdd(wb, path, content, RU_SIZE_AUTO);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        wb = ruWriteBatchFree(wb);
+        fail_if(ruFileExists(path), retText, test, false, true);
+        entries = ruFolderEntries(outDir);
+        fail_unless(want == entries, retText, test, want, entries);
+        ruFree(path);
+    }
+    ruAioFree(ra);
+    ruFree(outDir);
+}
+END_TEST
+
+TCase* aioTests(void) {
+    TCase *tcase = tcase_create("aio");
+    tcase_add_test(tcase, api);
+    tcase_add_test(tcase, run);
+    tcase_add_test(tcase, batch);
+    return tcase;
+}
@@ -473,8 +473,42 @@ START_TEST(run) {
 }
 END_TEST
 
+START_TEST(statcache) {
+    int32_t ret, exp = RUE_OK;
+    const char *test = "ruFamEventNew";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+    char* outDir = insureTestFolder("famstat");
+    alloc_chars kept = ruPathJoin(outDir, "kept.txt");
+    alloc_chars changed = ruPathJoin(outDir, "changed.txt");
+    ret = ruFileSetContents(kept, "kept", RU_SIZE_AUTO);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    ruStatCacheSet(60000, 0);
+    fail_unless(ruFileExists(kept), retText, test, true, false);
+    fail_if(ruFileExists(changed), retText, test, false, true);
+
+    // remove kept behind the library's back, so only the cache has it
+    remove(kept);
+    FILE* fh = fopen(changed, "w");
+    fclose(fh);
+
+    // an event without a destination must only drop its own path
+    ruFamEvent* fe = ruFamEventNew(RU_FAM_CREATED, changed, NULL);
+    fail_unless(ruFileExists(changed), retText, test, true, false);
+    fail_unless(ruFileExists(kept), retText, test, true, false);
+    fe = ruFamEventFree(fe);
+
+    ruStatCacheSet(0, 0);
+    fail_if(ruFileExists(kept), retText, test, false, true);
+    ruFree(changed);
+    ruFree(kept);
+    ruFree(outDir);
+}
+END_TEST
+
 TCase* famTests(void) {
     TCase *tcase = tcase_create("fam");
     tcase_add_test(tcase, run);
+    tcase_add_test(tcase, statcache);
     return tcase;
 }
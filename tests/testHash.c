@@ -0,0 +1,205 @@
+/*
+ * Copyright regify
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#include "tests.h"
+
+START_TEST(api) {
+    int32_t ret, exp;
+    const char *test = "ruHasherNew";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+
+    exp = RUE_INVALID_PARAMETER;
+    ruHasher rh = ruHasherNew(42, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(NULL == rh, retText, test, NULL, rh);
+
+    test = "ruHasherUpdate";
+    exp = RUE_PARAMETER_NOT_SET;
+    ret = ruHasherUpdate(NULL, "a", 1);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    test = "ruHasherDigest";
+    exp = RUE_OK;
+    rh = ruHasherNew(RU_HASH_SHA256, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    unsigned char digest[RU_HASH_MAX_SIZE];
+    exp = RUE_WRONG_PARAMETER_LENGTH;
+    ret = ruHasherDigest(rh, digest, 16);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    rh = ruHasherFree(rh);
+
+    test = "ruHashSize";
+    fail_unless(0 == ruHashSize(0), retText, test, 0, ruHashSize(0));
+    fail_unless(8 == ruHashSize(RU_HASH_XXH64), retText, test, 8,
+                ruHashSize(RU_HASH_XXH64));
+
+    test = "ruFileHash";
+    exp = RUE_PARAMETER_NOT_SET;
+    alloc_chars hex = ruFileHash(NULL, RU_HASH_XXH64, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(NULL == hex, retText, test, NULL, hex);
+    exp = RUE_FILE_NOT_FOUND;
+    hex = ruFileHash("/does/not/exist", RU_HASH_XXH64, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(NULL == hex, retText, test, NULL, hex);
+}
+END_TEST
+
+START_TEST(run) {
+    int32_t ret, exp = RUE_OK;
+    const char *test = "ruHashData";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+    perm_chars spam = "Nobody inspects the spammish repetition";
+    struct {
+        int32_t algo;
+        perm_chars in;
+        perm_chars hex;
+    } vectors[] = {
+            {RU_HASH_XXH64, "", "ef46db3751d8e999"},
+            {RU_HASH_XXH64, "abc", "44bc2cf5ad770999"},
+            {RU_HASH_XXH64, spam, "fbcea83c8a378bf1"},
+            {RU_HASH_CRC32C, "", "00000000"},
+            {RU_HASH_CRC32C, "123456789", "e3069283"},
+            {RU_HASH_SHA256, "",
+             "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+            {RU_HASH_SHA256, "abc",
+             "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+            {RU_HASH_SHA256,
+             "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq",
+             "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+            {0, NULL, NULL}
+    };
+    for (int i = 0; vectors[i].in; i++) {
+        alloc_chars hex = ruHashData(vectors[i].algo, vectors[i].in,
+                                     RU_SIZE_AUTO, &ret);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        ck_assert_str_eq(vectors[i].hex, hex);
+        ruFree(hex);
+    }
+
+    // many blocks in one go
+    alloc_chars million = ruMalloc0(1000000, char);
+    memset(million, 'a', 1000000);
+    alloc_chars mhex = ruHashData(RU_HASH_SHA256, million, 1000000, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_str_eq("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0",
+                     mhex);
+    ruFree(mhex);
+    ruFree(million);
+
+    // fed in uneven chunks the result must not change
+    test = "ruHasherUpdate";
+    rusize len = 100000;
+    alloc_chars data = ruMalloc0(len, char);
+    for (rusize i = 0; i < len; i++) data[i] = (char)(i * 31 + 7);
+    char* outDir = insureTestFolder("hash");
+    alloc_chars file = ruPathJoin(outDir, "data.bin");
+    ret = ruFileSetContents(file, data, len);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    int32_t algos[] = {RU_HASH_XXH64, RU_HASH_CRC32C, RU_HASH_SHA256, 0};
+    for (int a = 0; algos[a]; a++) {
+        alloc_chars whole = ruHashData(algos[a], data, len, &ret);
+        fail_unless(exp == ret, retText, test, exp, ret);
+
+        ruHasher rh = ruHasherNew(algos[a], &ret);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        rusize off = 0, step = 1;
+        while (off < len) {
+            rusize chunk = step < len - off? step : len - off;
+            ret = ruHasherUpdate(rh, data + off, chunk);
+            fail_unless(exp == ret, retText, test, exp, ret);
+            off += chunk;
+            step = step * 3 + 1;
+        }
+        alloc_chars hex = ruHasherHex(rh);
+        ck_assert_str_eq(whole, hex);
+        ruFree(hex);
+
+        // the digest leaves the state intact
+        hex = ruHasherHex(rh);
+        ck_assert_str_eq(whole, hex);
+        ruFree(hex);
+
+        ret = ruHasherReset(rh);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        ret = ruHasherUpdate(rh, data, len);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        hex = ruHasherHex(rh);
+        ck_assert_str_eq(whole, hex);
+        ruFree(hex);
+        rh = ruHasherFree(rh);
+
+        test = "ruFileHash";
+        hex = ruFileHash(file, algos[a], &ret);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        ck_assert_str_eq(whole, hex);
+        ruFree(hex);
+        ruFree(whole);
+    }
+
+    test = "ruXxh64";
+    uint64_t want = 0xfbcea83c8a378bf1ULL;
+    uint64_t got = ruXxh64(spam, strlen(spam), 0);
+    fail_unless(want == got, retText, test, want, got);
+
+    test = "ruCrc32c";
+    uint32_t crc = ruCrc32c(0, "1234", 4);
+    crc = ruCrc32c(crc, "56789", 5);
+    fail_unless(0xe3069283 == crc, retText, test, 0xe3069283, crc);
+
+    ruFree(file);
+    ruFree(outDir);
+    ruFree(data);
+}
+END_TEST
+
+START_TEST(speed) {
+    const char *test = "speed";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+    int32_t ret, exp = RUE_OK;
+    rusize len = 16 * 1024 * 1024;
+    alloc_chars data = ruMalloc0(len, char);
+    for (rusize i = 0; i < len; i++) data[i] = (char)(i * 131 + 17);
+
+    int32_t algos[] = {RU_HASH_XXH64, RU_HASH_CRC32C, RU_HASH_SHA256, 0};
+    perm_chars names[] = {"xxh64", "crc32c", "sha256"};
+    for (int a = 0; algos[a]; a++) {
+        msec_t start = ruTimeMs();
+        alloc_chars hex = ruHashData(algos[a], data, len, &ret);
+        msec_t took = ruTimeMs() - start;
+        fail_unless(exp == ret, retText, test, exp, ret);
+        ruInfoLogf("%s hashed %lu MB in %ld ms, %ld MB/s", names[a],
+                   (unsigned long)(len >> 20), (long)took,
+                   took? (long)((len >> 20) * 1000 / took) : -1L);
+        ruFree(hex);
+    }
+    ruFree(data);
+}
+END_TEST
+
+TCase* hashTests ( void ) {
+    TCase *tcase = tcase_create ( "hash" );
+    tcase_add_test(tcase, api);
+    tcase_add_test(tcase, run);
+    tcase_add_test(tcase, speed);
+    return tcase;
+}
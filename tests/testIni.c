@@ -219,9 +219,348 @@ START_TEST ( run ) {
     ruFree(inifile);
 }
 END_TEST
+
+START_TEST ( indexed ) {
+    int32_t ret, exp;
+    const char *test = "ruIniReadIndexed";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+    char* iniDir = insureTestFolder("iniIndexed");
+    char* inifile = ruPathJoin(iniDir, "indexed.ini");
+    ruIni cf = NULL, ref = NULL;
+
+    exp = RUE_PARAMETER_NOT_SET;
+    ret = ruIniReadIndexed(NULL, &cf);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruIniReadIndexed(inifile, NULL);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    exp = RUE_FILE_NOT_FOUND;
+    ret = ruIniReadIndexed(inifile, &cf);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    trans_chars content = "\xEF\xBB\xBF"
+            "global = one\n"
+            "; a comment\n"
+            "# another one\n"
+            "\n"
+            "[sec]\n"
+            "  key=  value ; inline comment\n"
+            "colon : sep\r\n"
+            "multi = first\n"
+            "   second\n"
+            "empty =\n"
+            "bare\n"
+            "semi = a;b\n"
+            "[void]\n"
+            "[sec]\n"
+            "key = again\n";
+    ret = ruFileSetContents(inifile, content, RU_SIZE_AUTO);
+    exp = RUE_OK;
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    ret = ruIniReadIndexed(inifile, &cf);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruIniRead(inifile, &ref);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    // both engines must agree on every section and key
+    ruList secs = NULL, keys = NULL;
+    ret = ruIniSections(cf, &secs);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    rusize sz = ruListSize(secs, &ret), esz = 2;
+    fail_unless(esz == sz, retText, test, esz, sz);
+    ck_assert_str_eq("sec", ruListIdx(secs, 0, char*, &ret));
+    ck_assert_str_eq("void", ruListIdx(secs, 1, char*, &ret));
+    for (rusize s = 0; s <= sz; s++) {
+        // the last round checks the global keys
+        trans_chars sec = s < sz ? ruListIdx(secs, s, char*, &ret) : NULL;
+        ret = ruIniKeys(cf, sec, &keys);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        ruIterator li = ruListIter(keys);
+        for (char* key = ruIterNext(li, char*); li;
+             key = ruIterNext(li, char*)) {
+            perm_chars val = NULL, refVal = NULL;
+            int32_t rret = ruIniGet(ref, sec, key, &refVal);
+            ret = ruIniGet(cf, sec, key, &val);
+            fail_unless(rret == ret, retText, test, rret, ret);
+            fail_unless(ruStrEquals(refVal, val), retText, test, refVal, val);
+        }
+        keys = ruListFree(keys);
+    }
+    secs = ruListFree(secs);
+
+    perm_chars val = NULL;
+    ret = ruIniGet(cf, NULL, "global", &val);
+    ck_assert_str_eq("one", val);
+    ret = ruIniGet(cf, "sec", "key", &val);
+    ck_assert_str_eq("valueagain", val);
+    ret = ruIniGet(cf, "sec", "colon", &val);
+    ck_assert_str_eq("sep", val);
+    ret = ruIniGet(cf, "sec", "multi", &val);
+    ck_assert_str_eq("firstsecond", val);
+    ret = ruIniGet(cf, "sec", "semi", &val);
+    ck_assert_str_eq("a;b", val);
+    ret = ruIniGet(cf, "sec", "bare", &val);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(NULL == val, retText, test, NULL, val);
+    val = ruIniGetDef(cf, "sec", "empty", "def", &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_str_eq("def", val);
+    val = ruIniGetDef(cf, "nope", "key", "def", &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_str_eq("def", val);
+
+    ret = ruIniKeys(cf, "nope", &keys);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    sz = ruListSize(keys, &ret);
+    esz = 0;
+    fail_unless(esz == sz, retText, test, esz, sz);
+    keys = ruListFree(keys);
+
+    exp = RUE_FILE_NOT_FOUND;
+    ret = ruIniGet(cf, "nope", "key", &val);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruIniGet(cf, "void", "key", &val);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruIniGet(cf, NULL, "key", &val);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    // changes switch over to the maps
+    exp = RUE_OK;
+    ret = ruIniSet(cf, "sec", "new", "fresh");
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruIniGet(cf, "sec", "key", &val);
+    ck_assert_str_eq("valueagain", val);
+    ret = ruIniGet(cf, "sec", "new", &val);
+    ck_assert_str_eq("fresh", val);
+    cf = ruIniFree(cf);
+    ref = ruIniFree(ref);
+
+    ret = ruFileSetContents(inifile, "[sec\nkey = val\n", RU_SIZE_AUTO);
+    exp = RUE_GENERAL;
+    ret = ruIniReadIndexed(inifile, &cf);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(NULL == cf, retText, test, NULL, cf);
+
+    // a large generated file
+    ruString big = ruStringNew("");
+    uint32_t sections = 200, perSection = 500;
+    for (uint32_t s = 0; s < sections; s++) {
+        ruStringAppendf(big, "[section%u]\n", s);
+        for (uint32_t k = 0; k < perSection; k++) {
+            ruStringAppendf(big, "key%u = value %u.%u\n", k, s, k);
+        }
+    }
+    ret = ruFileSetContents(inifile, ruStringGetCString(big), RU_SIZE_AUTO);
+    big = ruStringFree(big, false);
+    exp = RUE_OK;
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    int64_t start = ruTimeMs();
+    ret = ruIniRead(inifile, &ref);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    int64_t mapTime = ruTimeMs() - start;
+    start = ruTimeMs();
+    ret = ruIniReadIndexed(inifile, &cf);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    int64_t idxTime = ruTimeMs() - start;
+    ruInfoLogf("read %u keys in %ld ms with maps, %ld ms indexed",
+               sections * perSection, (long)mapTime, (long)idxTime);
+
+    char sec[32], key[32], want[32];
+    for (uint32_t s = 0; s < sections; s += 7) {
+        snprintf(sec, sizeof(sec), "section%u", s);
+        for (uint32_t k = 0; k < perSection; k += 3) {
+            snprintf(key, sizeof(key), "key%u", k);
+            snprintf(want, sizeof(want), "value %u.%u", s, k);
+            ret = ruIniGet(cf, sec, key, &val);
+            fail_unless(exp == ret, retText, test, exp, ret);
+            ck_assert_str_eq(want, val);
+        }
+    }
+    cf = ruIniFree(cf);
+    ref = ruIniFree(ref);
+
+    ruFree(iniDir);
+    ruFree(inifile);
+}
+END_TEST
+
+START_TEST ( edit ) {
+    int32_t ret, exp;
+    const char *test = "ruIniEdit";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+    char* iniDir = insureTestFolder("iniEdit");
+    char* inifile = ruPathJoin(iniDir, "edit.ini");
+    ruIni cf = NULL;
+
+    exp = RUE_PARAMETER_NOT_SET;
+    ret = ruIniEdit(NULL, &cf);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruIniEdit(inifile, NULL);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    trans_chars content =
+            "; settings\n"
+            "[main]\n"
+            "name = old   ; who\n"
+            "size:10\n"
+            "multi = a\n"
+            "   b\n"
+            "flag\n"
+            "\n"
+            "# trailing comment\n"
+            "[other]\n"
+            "keep=1";
+    ret = ruFileSetContents(inifile, content, RU_SIZE_AUTO);
+    exp = RUE_OK;
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    ret = ruIniEdit(inifile, &cf);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    perm_chars val = NULL;
+    ret = ruIniGet(cf, "main", "multi", &val);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_str_eq("ab", val);
+
+    // unchanged objects write their file as is
+    ret = ruIniWrite(cf, inifile);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    alloc_chars got = NULL;
+    rusize len = 0;
+    ret = ruFileGetContents(inifile, &got, &len);
+    ck_assert_str_eq(content, got);
+    ruFree(got);
+
+    test = "ruIniSet";
+    ret = ruIniSet(cf, "main", "name", "new");
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruIniSet(cf, "main", "size", "2000");
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruIniSet(cf, "main", "multi", NULL);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruIniSet(cf, "main", "flag", "on");
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruIniSet(cf, "main", "added", "yes");
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruIniSet(cf, "other", "more", "2");
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruIniSet(cf, NULL, "global", "g");
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruIniSet(cf, "fresh", "k", "v");
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruIniSet(cf, "empty", NULL, NULL);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    exp = RUE_INVALID_PARAMETER;
+    ret = ruIniSet(cf, "main", "name", "two\nlines");
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruIniSet(cf, "main", "a=b", "x");
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruIniSet(cf, "se]c", "a", "x");
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    exp = RUE_OK;
+    ret = ruIniGet(cf, "main", "name", &val);
+    ck_assert_str_eq("new", val);
+    exp = RUE_FILE_NOT_FOUND;
+    ret = ruIniGet(cf, "main", "multi", &val);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    test = "ruIniWrite";
+    exp = RUE_OK;
+    ret = ruIniWrite(cf, inifile);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    trans_chars want =
+            "; settings\n"
+            "global = g\n"
+            "[main]\n"
+            "name = new   ; who\n"
+            "size:2000\n"
+            "flag = on\n"
+            "added = yes\n"
+            "\n"
+            "# trailing comment\n"
+            "[other]\n"
+            "keep=1\n"
+            "more = 2\n"
+            "\n"
+            "[fresh]\n"
+            "k = v\n"
+            "\n"
+            "[empty]\n";
+    ret = ruFileGetContents(inifile, &got, &len);
+    ck_assert_str_eq(want, got);
+    ruFree(got);
+
+    // the written layout is the base for the next round
+    ret = ruIniSet(cf, "main", "name", "ab");
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruIniSet(cf, "fresh", "k", NULL);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruIniSet(cf, "main", "multi", "back");
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruIniWrite(cf, inifile);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    want =  "; settings\n"
+            "global = g\n"
+            "[main]\n"
+            "name = ab   ; who\n"
+            "size:2000\n"
+            "flag = on\n"
+            "added = yes\n"
+            "multi = back\n"
+            "\n"
+            "# trailing comment\n"
+            "[other]\n"
+            "keep=1\n"
+            "more = 2\n"
+            "\n"
+            "[fresh]\n"
+            "\n"
+            "[empty]\n";
+    ret = ruFileGetContents(inifile, &got, &len);
+    ck_assert_str_eq(want, got);
+    ruFree(got);
+    cf = ruIniFree(cf);
+
+    // the regular reader agrees
+    ret = ruIniRead(inifile, &cf);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruIniGet(cf, "main", "name", &val);
+    ck_assert_str_eq("ab", val);
+    ret = ruIniGet(cf, "main", "size", &val);
+    ck_assert_str_eq("2000", val);
+    ret = ruIniGet(cf, NULL, "global", &val);
+    ck_assert_str_eq("g", val);
+    cf = ruIniFree(cf);
+
+    // new files
+    ruFree(inifile);
+    inifile = ruPathJoin(iniDir, "new.ini");
+    ret = ruIniEdit(inifile, &cf);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruIniSet(cf, NULL, "top", "1");
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruIniSet(cf, "sec", "key", "");
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruIniWrite(cf, inifile);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruFileGetContents(inifile, &got, &len);
+    ck_assert_str_eq("top = 1\n\n[sec]\nkey = \n", got);
+    ruFree(got);
+    cf = ruIniFree(cf);
+
+    ruFree(iniDir);
+    ruFree(inifile);
+}
+END_TEST
+
 TCase* iniTests ( void ) {
     TCase *tcase = tcase_create ( "ini" );
     tcase_add_test ( tcase, api );
     tcase_add_test ( tcase, run );
+    tcase_add_test ( tcase, indexed );
+    tcase_add_test ( tcase, edit );
     return tcase;
 }
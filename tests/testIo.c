@@ -913,11 +913,178 @@ START_TEST(folderwalk) {
 }
 END_TEST
 
+START_TEST(statcache) {
+    int32_t ret, exp;
+    const char *test = "ruStatCacheSet";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+    char* outDir = insureTestFolder("statcache");
+    alloc_chars file = ruPathJoin(outDir, "cached.txt");
+    alloc_chars folder = ruPathJoin(outDir, "sub");
+    alloc_chars subFile = ruPathJoin(folder, "child.txt");
+
+    ruStatCacheSet(60000, 0);
+
+    // negative results are cached and dropped on library writes
+    fail_if(ruFileExists(file), retText, test, false, true);
+    exp = RUE_OK;
+    ret = ruFileSetContents(file, "12345", RU_SIZE_AUTO);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(ruIsFile(file), retText, test, true, false);
+    rusize sz = ruFileSize(file, &ret);
+    fail_unless(5 == sz, retText, test, 5, sz);
+
+    ret = ruFileSetContents(file, "1234567", RU_SIZE_AUTO);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    sz = ruFileSize(file, &ret);
+    fail_unless(7 == sz, retText, test, 7, sz);
+
+    // changes behind the library's back are served from the cache
+    test = "ruStatCacheInvalidate";
+    FILE* fh = fopen(file, "a");
+    fputs("89", fh);
+    fclose(fh);
+    sz = ruFileSize(file, &ret);
+    fail_unless(7 == sz, retText, test, 7, sz);
+    ruStatCacheInvalidate(file);
+    sz = ruFileSize(file, &ret);
+    fail_unless(9 == sz, retText, test, 9, sz);
+
+    alloc_chars data = NULL;
+    ret = ruFileGetContents(file, &data, &sz);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_str_eq("123456789", data);
+    ruFree(data);
+
+    // folders drop their children
+    fail_if(ruIsDir(folder), retText, test, false, true);
+    ret = ruMkdir(folder, 0755, false);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(ruIsDir(folder), retText, test, true, false);
+    ret = ruFileSetContents(subFile, "x", RU_SIZE_AUTO);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(ruFileExists(subFile), retText, test, true, false);
+    ret = ruFolderRemove(folder);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_if(ruFileExists(subFile), retText, test, false, true);
+    fail_if(ruIsDir(folder), retText, test, false, true);
+
+    test = "ruFileRename";
+    alloc_chars moved = ruPathJoin(outDir, "moved.txt");
+    fail_if(ruFileExists(moved), retText, test, false, true);
+    ret = ruFileRename(file, moved);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_if(ruFileExists(file), retText, test, false, true);
+    fail_unless(ruFileExists(moved), retText, test, true, false);
+
+    test = "ruFileRemove";
+    ret = ruFileRemove(moved);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_if(ruFileExists(moved), retText, test, false, true);
+
+    // disabled the cache sees external changes right away
+    test = "ruStatCacheSet";
+    ruStatCacheSet(0, 0);
+    fh = fopen(moved, "w");
+    fclose(fh);
+    fail_unless(ruFileExists(moved), retText, test, true, false);
+
+    ruFree(moved);
+    ruFree(subFile);
+    ruFree(folder);
+    ruFree(file);
+    ruFree(outDir);
+}
+END_TEST
+
+START_TEST(pathbuf) {
+    int32_t ret, exp;
+    const char *test = "ruPathBufInit";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+    ruPathBuf pb;
+    char buf[16];
+
+    exp = RUE_PARAMETER_NOT_SET;
+    ret = ruPathBufInit(NULL, buf, sizeof(buf), 0);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruPathBufInit(&pb, NULL, 0, 0);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    exp = RUE_OK;
+    ret = ruPathBufInit(&pb, buf, sizeof(buf), 0);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_str_eq("", ruPathBufStr(&pb));
+
+    test = "ruPathBufPush";
+    ret = ruPathBufSet(&pb, "/tmp");
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruPathBufPush(&pb, "/foo", RU_SIZE_AUTO);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    rusize mark = ruPathBufLen(&pb);
+    ret = ruPathBufPush(&pb, "bar.txt", 3);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_str_eq("/tmp/foo/bar", ruPathBufStr(&pb));
+
+    test = "ruPathBufTruncate";
+    exp = RUE_INVALID_PARAMETER;
+    ret = ruPathBufTruncate(&pb, 100);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    exp = RUE_OK;
+    ret = ruPathBufTruncate(&pb, mark);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_str_eq("/tmp/foo", ruPathBufStr(&pb));
+
+    test = "ruPathBufAppend";
+    // doesn't fit, path remains as it was
+    exp = RUE_OVERFLOW;
+    ret = ruPathBufAppend(&pb, "/long.name", RU_SIZE_AUTO);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_str_eq("/tmp/foo", ruPathBufStr(&pb));
+
+    test = "ruPathBufPop";
+    exp = RUE_OK;
+    ret = ruPathBufPop(&pb);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_str_eq("/tmp", ruPathBufStr(&pb));
+    ret = ruPathBufPop(&pb);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_str_eq("/", ruPathBufStr(&pb));
+    exp = RUE_FILE_NOT_FOUND;
+    ret = ruPathBufPop(&pb);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ruPathBufFree(&pb);
+
+    test = "ruPathBufNormalize";
+    exp = RUE_OK;
+    ruPathBufInit(&pb, buf, sizeof(buf), RU_PATH_GROW);
+    const char* paths[][2] = {
+            {"/a/./b//c/../d/", "/a/b/d/"},
+            {"a/../..", ".."},
+            {"a/..", "."},
+            {"/../a", "/a"},
+            {"../a/../../b", "../../b"},
+            {"/tmp/some/longer/path/../file.txt", "/tmp/some/longer/file.txt"},
+            {NULL, NULL}
+    };
+    for (int i = 0; paths[i][0]; i++) {
+        ret = ruPathBufSet(&pb, paths[i][0]);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        ret = ruPathBufNormalize(&pb);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        ck_assert_str_eq(paths[i][1], ruPathBufStr(&pb));
+    }
+    // grown onto the heap
+    fail_unless(pb.buf != buf, retText, test, true, false);
+    ruPathBufFree(&pb);
+}
+END_TEST
+
 TCase* ioTests ( void ) {
     TCase *tcase = tcase_create ( "io" );
     tcase_add_test(tcase, api);
     tcase_add_test(tcase, filetest);
     tcase_add_test(tcase, fileopen);
     tcase_add_test(tcase, folderwalk);
+    tcase_add_test(tcase, statcache);
+    tcase_add_test(tcase, pathbuf);
     return tcase;
 }
@@ -186,7 +186,13 @@ START_TEST(api) {
 }
 END_TEST
 
-START_TEST(get) {
+typedef ruJson (*jsonParser)(trans_chars jsonStr, int32_t* status);
+
+static ruJson arenaParse(trans_chars jsonStr, int32_t* status) {
+    return ruJsonParseLen(jsonStr, RU_SIZE_AUTO, 0, status);
+}
+
+static void runGet(jsonParser parse) {
     int32_t ret, exp;
     const char *retText = "failed wanted ret '%d' but got '%d'";
     ruJson jsn = NULL;
@@ -196,13 +202,13 @@ START_TEST(get) {
     perm_chars jsonStr = "{\"key\":\"2342";
     exp = RUE_INVALID_PARAMETER;
 
-    jsn = ruJsonParse(jsonStr, &ret);
+    jsn = parse(jsonStr, &ret);
     fail_unless(NULL == jsn, retText, NULL, jsn);
     fail_unless(exp == ret, retText, exp, ret);
 
     jsonStr = "{\"key\":\"2342\", \"num\": 2342}";
     exp = RUE_OK;
-    jsn = ruJsonParse(jsonStr, &ret);
+    jsn = parse(jsonStr, &ret);
     fail_if(NULL == jsn, retText, NULL, jsn);
     fail_unless(exp == ret, retText, exp, ret);
 
@@ -221,7 +227,7 @@ START_TEST(get) {
     fail_unless(NULL == jsn, retText, NULL, jsn);
 
     jsonStr = "[2342,\"2342\"]";
-    jsn = ruJsonParse(jsonStr, &ret);
+    jsn = parse(jsonStr, &ret);
     fail_if(NULL == jsn, retText, NULL, jsn);
     fail_unless(exp == ret, retText, exp, ret);
 
@@ -249,7 +255,7 @@ START_TEST(get) {
     fail_unless(NULL == jsn, retText, NULL, jsn);
 
     jsonStr = "[{\"key\": \"2342\", \"num\": 2342}, [2342, \"2342\"]]";
-    jsn = ruJsonParse(jsonStr, &ret);
+    jsn = parse(jsonStr, &ret);
     fail_if(NULL == jsn, retText, NULL, jsn);
     fail_unless(exp == ret, retText, exp, ret);
 
@@ -296,7 +302,7 @@ START_TEST(get) {
 
     jsonStr = "{\"map\": {\"key\": \"2342\", \"num\": 2342, \"dbl\": 23.42, \"truth\": \"TRUE\", "
               " \"good\": true, \"bad\": false}, \"arr\": [2342, \"2342\", 23.42, 1]}";
-    jsn = ruJsonParse(jsonStr, &ret);
+    jsn = parse(jsonStr, &ret);
     fail_if(NULL == jsn, retText, NULL, jsn);
     fail_unless(exp == ret, retText, exp, ret);
 
@@ -412,7 +418,7 @@ START_TEST(get) {
     // "2342"
     exp = RUE_OK;
     jsonStr = "\"2342\"";
-    jsn = ruJsonParse(jsonStr, &ret);
+    jsn = parse(jsonStr, &ret);
     fail_if(NULL == jsn, retText, NULL, jsn);
     fail_unless(exp == ret, retText, exp, ret);
 
@@ -429,7 +435,7 @@ START_TEST(get) {
 
     // 2342
     jsonStr = "2342";
-    jsn = ruJsonParse(jsonStr, &ret);
+    jsn = parse(jsonStr, &ret);
     fail_if(NULL == jsn, retText, NULL, jsn);
     fail_unless(exp == ret, retText, exp, ret);
 
@@ -441,7 +447,7 @@ START_TEST(get) {
     fail_unless(NULL == jsn, retText, NULL, jsn);
 
     jsonStr = "{\"bool1\":true,\"bool0\":false,\"num\":1,\"decimal\":1.0,\"nada\":null}";
-    jsn = ruJsonParse(jsonStr, &ret);
+    jsn = parse(jsonStr, &ret);
     fail_if(NULL == jsn, retText, NULL, jsn);
     fail_unless(exp == ret, retText, exp, ret);
 
@@ -472,6 +478,885 @@ START_TEST(get) {
     jsn = ruJsonFree(jsn);
     fail_unless(NULL == jsn, retText, NULL, jsn);
 }
+
+START_TEST(get) {
+    runGet(ruJsonParse);
+}
+END_TEST
+
+START_TEST(getArena) {
+    runGet(arenaParse);
+}
+END_TEST
+
+START_TEST(arena) {
+    int32_t ret, exp;
+    perm_chars test = "ruJsonParseLen";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+    ruJson jsn;
+    perm_chars str;
+
+    exp = RUE_PARAMETER_NOT_SET;
+    jsn = ruJsonParseLen(NULL, 3, 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(NULL == jsn, retText, test, NULL, jsn);
+
+    // malformed content
+    perm_chars bad[] = {
+            "", "  ", "{", "[1,]", "[1 2]", "{\"a\" 1}", "{\"a\":1,}", "{1:2}",
+            "[1]]", "[}", "tru", "01", "1.", "-", "\"abc", "\"\\x\"",
+            "\"\\u12g4\"", "\"a\tb\"", "\"\xc3\x28\"", "[1] 2", "/* open",
+            "{,}", NULL
+    };
+    exp = RUE_INVALID_PARAMETER;
+    for (int i = 0; bad[i]; i++) {
+        jsn = ruJsonParseLen(bad[i], RU_SIZE_AUTO, 0, &ret);
+        fail_unless(exp == ret, "%s failed on '%s' wanted ret '%d' but got '%d'",
+                    test, bad[i], exp, ret);
+        fail_unless(NULL == jsn, retText, test, NULL, jsn);
+    }
+    // the error points at the problem rather than dumping the input
+    ruJsonParseLen("[1 2]", RU_SIZE_AUTO, 0, &ret);
+    ck_assert_str_eq("parse_error: 'end of array expected' at offset 3", ruLastError());
+
+    // only the given length is looked at
+    exp = RUE_OK;
+    perm_chars jsonStr = "[1,2,3]garbage";
+    jsn = ruJsonParseLen(jsonStr, 7, 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    rusize sz = ruJsonArrayLen(jsn, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(3 == sz, retText, test, 3, sz);
+    jsn = ruJsonFree(jsn);
+
+    jsonStr = "// comment\n{\"esc\": \"a\\\"b\\\\c\\/\\n\\u00e4\\ud83d\\ude00\", "
+              "/* more */ \"utf\": \"\xc3\xa4\", \"big\": 99999999999999999999, "
+              "\"neg\": -42, \"exp\": 1.5e3, \"nil\": null, \"deep\": [[[[{}]]], []]}";
+    jsn = ruJsonParseLen(jsonStr, RU_SIZE_AUTO, 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    str = ruJsonKeyStr(jsn, "esc", &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_str_eq("a\"b\\c/\n\xc3\xa4\xf0\x9f\x98\x80", str);
+
+    str = ruJsonKeyStr(jsn, "utf", &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_str_eq("\xc3\xa4", str);
+
+    // too big for an integer, so only a double
+    exp = RUE_INVALID_PARAMETER;
+    ruJsonKeyInt(jsn, "big", &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    exp = RUE_OK;
+    double db = ruJsonKeyDouble(jsn, "big", &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(db > 9.9e19, retText, test, 1, 0);
+
+    int64_t i64 = ruJsonKeyInt(jsn, "neg", &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(-42 == i64, retText, test, -42, i64);
+
+    db = ruJsonKeyDouble(jsn, "exp", &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(1500.0 == db, retText, test, 1500, (int)db);
+
+    ruJson ja = ruJsonKeyArray(jsn, "deep", &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    sz = ruJsonArrayLen(ja, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(2 == sz, retText, test, 2, sz);
+    jsn = ruJsonFree(jsn);
+
+    // escapes, UTF-8 and bad characters on either side of the scan blocks
+    for (int off = 0; off < 40; off++) {
+        char pad[41];
+        memset(pad, 'x', off);
+        pad[off] = '\0';
+        char doc[128], want[128];
+        snprintf(doc, sizeof(doc), "{\"k\":\"%s\\\"\xc3\xa4%s\\\\\"}", pad, pad);
+        snprintf(want, sizeof(want), "%s\"\xc3\xa4%s\\", pad, pad);
+        exp = RUE_OK;
+        jsn = ruJsonParseLen(doc, RU_SIZE_AUTO, 0, &ret);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        str = ruJsonKeyStr(jsn, "k", &ret);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        ck_assert_str_eq(want, str);
+        jsn = ruJsonFree(jsn);
+
+        snprintf(doc, sizeof(doc), "[\"%s\t%s\"]", pad, pad);
+        exp = RUE_INVALID_PARAMETER;
+        jsn = ruJsonParseLen(doc, RU_SIZE_AUTO, 0, &ret);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        fail_unless(NULL == jsn, retText, test, NULL, jsn);
+    }
+
+    // nesting is limited rather than running out of stack
+    rusize depth = 5000;
+    alloc_chars nested = ruMalloc0(depth * 2 + 1, char);
+    memset(nested, '[', depth);
+    memset(nested + depth, ']', depth);
+    exp = RUE_INVALID_PARAMETER;
+    jsn = ruJsonParseLen(nested, RU_SIZE_AUTO, 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(NULL == jsn, retText, test, NULL, jsn);
+    ruFree(nested);
+}
+END_TEST
+
+START_TEST(speed) {
+    int32_t ret, exp = RUE_OK;
+    perm_chars test = "speed";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+    ruString rs = ruStringNew("[");
+    for (int i = 0; i < 200; i++) {
+        ruStringAppendf(rs, "%s{\"id\": %d, \"name\": \"entry number %d\", "
+                            "\"ratio\": %d.25, \"active\": %s, \"tags\": "
+                            "[\"a\", \"b\", \"c\"], \"owner\": {\"first\": "
+                            "\"J\\u00fcrgen\", \"last\": null}}",
+                        i? ", " : "", i, i, i, i % 2? "true" : "false");
+    }
+    ruStringAppend(rs, "]");
+    perm_chars doc = ruStringGetCString(rs);
+    rusize len = ruStringLen(rs, NULL);
+
+    int rounds = 200;
+    perm_chars names[] = {"yajl", "arena"};
+    for (int e = 0; e < 2; e++) {
+        msec_t start = ruTimeMs();
+        for (int i = 0; i < rounds; i++) {
+            ruJson jsn = e? ruJsonParseLen(doc, len, 0, &ret) : ruJsonParse(doc, &ret);
+            fail_unless(exp == ret, retText, test, exp, ret);
+            ruJsonFree(jsn);
+        }
+        msec_t took = ruTimeMs() - start;
+        ruInfoLogf("%s parsed %d x %lu bytes in %ld ms", names[e], rounds,
+                   (unsigned long)len, (long)took);
+    }
+    ruStringFree(rs, false);
+}
+END_TEST
+
+START_TEST(keyIndex) {
+    int32_t ret, exp = RUE_OK;
+    perm_chars test = "RU_JSON_INDEX_KEYS";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+    int keys = 5000;
+    ruString rs = ruStringNew("{\"dup\": 1, \"inner\": {");
+    for (int i = 0; i < 20; i++) {
+        ruStringAppendf(rs, "%s\"in%d\": %d", i? ", " : "", i, i);
+    }
+    ruStringAppend(rs, "}");
+    for (int i = 0; i < keys; i++) {
+        ruStringAppendf(rs, ", \"key%d\": \"val%d\"", i, i);
+    }
+    ruStringAppend(rs, ", \"dup\": 2}");
+    perm_chars doc = ruStringGetCString(rs);
+
+    ruJson plain = ruJsonParseLen(doc, RU_SIZE_AUTO, 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ruJson indexed = ruJsonParseLen(doc, RU_SIZE_AUTO, RU_JSON_INDEX_KEYS, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    // the first of duplicate keys wins either way
+    int64_t i64 = ruJsonKeyInt(indexed, "dup", &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(1 == i64, retText, test, 1, i64);
+
+    ruJson inner = ruJsonKeyMap(indexed, "inner", &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    i64 = ruJsonKeyInt(inner, "in19", &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(19 == i64, retText, test, 19, i64);
+
+    // wrong type and missing keys
+    exp = RUE_FILE_NOT_FOUND;
+    ruJsonKeyInt(indexed, "key1", &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ruJsonKeyStr(indexed, "nokey", &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    exp = RUE_OK;
+    char key[32], val[32];
+    ruJson docs[] = {plain, indexed};
+    perm_chars names[] = {"scanned", "indexed"};
+    for (int d = 0; d < 2; d++) {
+        msec_t start = ruTimeMs();
+        for (int i = 0; i < keys; i++) {
+            snprintf(key, sizeof(key), "key%d", i);
+            snprintf(val, sizeof(val), "val%d", i);
+            perm_chars str = ruJsonKeyStr(docs[d], key, &ret);
+            fail_unless(exp == ret, retText, test, exp, ret);
+            ck_assert_str_eq(val, str);
+        }
+        ruInfoLogf("%s lookup of %d keys took %ld ms", names[d], keys,
+                   (long)(ruTimeMs() - start));
+    }
+    ruJsonFree(plain);
+    ruJsonFree(indexed);
+    ruStringFree(rs, false);
+}
+END_TEST
+
+typedef struct {
+    perm_chars data;
+    rusize len;
+    rusize pos;
+    rusize chunk;
+} memReader;
+
+static rusize_s memRead(perm_ptr ctx, ptr buf, rusize len) {
+    memReader* mr = (memReader*)ctx;
+    rusize left = mr->len - mr->pos;
+    if (len > mr->chunk) len = mr->chunk;
+    if (len > left) len = left;
+    memcpy(buf, mr->data + mr->pos, len);
+    mr->pos += len;
+    return (rusize_s)len;
+}
+
+static ruJsonStream memStream(memReader* mr, perm_chars data, rusize chunk) {
+    int32_t ret;
+    mr->data = data;
+    mr->len = strlen(data);
+    mr->pos = 0;
+    mr->chunk = chunk;
+    ruJsonStream js = ruJsonStreamNew(memRead, mr, 0, &ret);
+    fail_unless(RUE_OK == ret, "ruJsonStreamNew failed with '%d'", ret);
+    return js;
+}
+
+START_TEST(stream) {
+    int32_t ret, exp, ev;
+    perm_chars test = "ruJsonStream";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+    memReader mr;
+    ruJsonStream js;
+    perm_chars str;
+    rusize len;
+
+    exp = RUE_PARAMETER_NOT_SET;
+    js = ruJsonStreamNew(NULL, NULL, 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(NULL == js, retText, test, NULL, js);
+
+    // tiny chunks make every token straddle a read
+    perm_chars jsonStr = "/* head */ {\"esc\\\"aped\": \"a\\\\b\\u00e4\\ud83d\\ude00\", "
+                         "\"nums\": [1, -2.5e1, 99999999999999999999], // tail\n"
+                         "\"lits\": [true, false, null], \"empty\": {}}  ";
+    int32_t evs[] = {
+            RU_JSON_EV_MAP_START, RU_JSON_EV_KEY, RU_JSON_EV_STRING,
+            RU_JSON_EV_KEY, RU_JSON_EV_ARRAY_START, RU_JSON_EV_NUMBER,
+            RU_JSON_EV_NUMBER, RU_JSON_EV_NUMBER, RU_JSON_EV_ARRAY_END,
+            RU_JSON_EV_KEY, RU_JSON_EV_ARRAY_START, RU_JSON_EV_TRUE,
+            RU_JSON_EV_FALSE, RU_JSON_EV_NULL, RU_JSON_EV_ARRAY_END,
+            RU_JSON_EV_KEY, RU_JSON_EV_MAP_START, RU_JSON_EV_MAP_END,
+            RU_JSON_EV_MAP_END, RU_JSON_EV_END, RU_JSON_EV_END
+    };
+    perm_chars texts[] = {
+            NULL, "esc\"aped", "a\\b\xc3\xa4\xf0\x9f\x98\x80", "nums", NULL,
+            "1", "-2.5e1", "99999999999999999999", NULL, "lits", NULL, "true",
+            "false", "null", NULL, "empty", NULL, NULL, NULL, NULL, NULL
+    };
+    rusize chunks[] = {1, 3, 1000};
+    exp = RUE_OK;
+    for (int c = 0; c < 3; c++) {
+        js = memStream(&mr, jsonStr, chunks[c]);
+        for (int i = 0; i < (int)(sizeof(evs) / sizeof(evs[0])); i++) {
+            ret = ruJsonStreamNext(js, &ev);
+            fail_unless(exp == ret, retText, test, exp, ret);
+            fail_unless(evs[i] == ev, "%s event %d wanted '%d' but got '%d'",
+                        test, i, evs[i], ev);
+            str = ruJsonStreamStr(js, &len, &ret);
+            if (texts[i]) {
+                fail_unless(exp == ret, retText, test, exp, ret);
+                ck_assert_str_eq(texts[i], str);
+                fail_unless(strlen(texts[i]) == len, retText, test,
+                            strlen(texts[i]), len);
+            } else {
+                fail_unless(RUE_INVALID_STATE == ret, retText, test,
+                            RUE_INVALID_STATE, ret);
+            }
+            if (i == 4) {
+                fail_unless(2 == ruJsonStreamDepth(js), retText, test, 2,
+                            ruJsonStreamDepth(js));
+            } else if (i == 5) {
+                int64_t i64 = ruJsonStreamInt(js, &ret);
+                fail_unless(exp == ret, retText, test, exp, ret);
+                fail_unless(1 == i64, retText, test, 1, i64);
+            } else if (i == 6) {
+                ruJsonStreamInt(js, &ret);
+                fail_unless(RUE_INVALID_PARAMETER == ret, retText, test,
+                            RUE_INVALID_PARAMETER, ret);
+                double db = ruJsonStreamDouble(js, &ret);
+                fail_unless(exp == ret, retText, test, exp, ret);
+                fail_unless(-25.0 == db, retText, test, -25, (int)db);
+            }
+        }
+        js = ruJsonStreamFree(js);
+    }
+
+    // malformed content reports the absolute offset
+    perm_chars bad[] = {
+            "", "{", "[1,]", "[1 2]", "{\"a\" 1}", "{\"a\":1,}", "{1:2}",
+            "[1]]", "[}", "tru", "01", "\"abc", "\"\\x\"", "\"a\tb\"",
+            "\"\xc3\x28\"", "[1] 2", "/* open", "/", "{,}", NULL
+    };
+    exp = RUE_INVALID_PARAMETER;
+    for (int i = 0; bad[i]; i++) {
+        js = memStream(&mr, bad[i], 2);
+        do {
+            ret = ruJsonStreamNext(js, &ev);
+        } while (ret == RUE_OK && ev != RU_JSON_EV_END);
+        fail_unless(exp == ret, "%s failed on '%s' wanted ret '%d' but got '%d'",
+                    test, bad[i], exp, ret);
+        // and it sticks
+        ret = ruJsonStreamNext(js, &ev);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        js = ruJsonStreamFree(js);
+    }
+    js = memStream(&mr, "[1, 2 3]", 2);
+    for (int i = 0; i < 3; i++) ruJsonStreamNext(js, &ev);
+    ret = ruJsonStreamNext(js, &ev);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_str_eq("parse_error: 'end of array expected' at offset 6", ruLastError());
+    js = ruJsonStreamFree(js);
+
+    // records of an array as separate documents, one being bigger than the
+    // initial buffer
+    ruString rs = ruStringNew("{\"skip\": [1], \"recs\": [");
+    int recs = 50;
+    for (int i = 0; i < recs; i++) {
+        ruStringAppendf(rs, "%s{\"id\": %d, \"name\": \"rec [%d]\", \"pad\": \"",
+                        i? ", " : "", i, i);
+        for (int p = 0; p < (i == 20? 10000 : 1); p++) {
+            ruStringAppend(rs, "0123456789");
+        }
+        ruStringAppend(rs, "\"}");
+    }
+    ruStringAppend(rs, "], \"num\": 7}");
+
+    exp = RUE_OK;
+    js = memStream(&mr, ruStringGetCString(rs), 4096);
+    ret = ruJsonStreamNext(js, &ev);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(RU_JSON_EV_MAP_START == ev, retText, test, RU_JSON_EV_MAP_START, ev);
+    ret = ruJsonStreamNext(js, &ev);
+    fail_unless(RU_JSON_EV_KEY == ev, retText, test, RU_JSON_EV_KEY, ev);
+
+    // a key comes next after a whole value
+    ruJson jsn = ruJsonStreamValue(js, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(1 == ruJsonArrayLen(jsn, &ret), retText, test, 1, 0);
+    jsn = ruJsonFree(jsn);
+    jsn = ruJsonStreamValue(js, &ret);
+    fail_unless(RUE_INVALID_STATE == ret, retText, test, RUE_INVALID_STATE, ret);
+    fail_unless(NULL == jsn, retText, test, NULL, jsn);
+
+    ret = ruJsonStreamNext(js, &ev);
+    fail_unless(RU_JSON_EV_KEY == ev, retText, test, RU_JSON_EV_KEY, ev);
+    ret = ruJsonStreamNext(js, &ev);
+    fail_unless(RU_JSON_EV_ARRAY_START == ev, retText, test, RU_JSON_EV_ARRAY_START, ev);
+    int cnt = 0;
+    char name[32];
+    while ((jsn = ruJsonStreamValue(js, &ret))) {
+        int64_t id = ruJsonKeyInt(jsn, "id", &ret);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        fail_unless(cnt == id, retText, test, cnt, id);
+        snprintf(name, sizeof(name), "rec [%d]", cnt);
+        ck_assert_str_eq(name, ruJsonKeyStr(jsn, "name", &ret));
+        str = ruJsonKeyStr(jsn, "pad", &ret);
+        fail_unless((cnt == 20? 100000 : 10) == strlen(str), retText, test,
+                    cnt == 20? 100000 : 10, strlen(str));
+        jsn = ruJsonFree(jsn);
+        cnt++;
+    }
+    fail_unless(RUE_FILE_NOT_FOUND == ret, retText, test, RUE_FILE_NOT_FOUND, ret);
+    fail_unless(recs == cnt, retText, test, recs, cnt);
+    ret = ruJsonStreamNext(js, &ev);
+    fail_unless(RU_JSON_EV_ARRAY_END == ev, retText, test, RU_JSON_EV_ARRAY_END, ev);
+    ret = ruJsonStreamNext(js, &ev);
+    fail_unless(RU_JSON_EV_KEY == ev, retText, test, RU_JSON_EV_KEY, ev);
+    jsn = ruJsonStreamValue(js, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(7 == ruJsonInt(jsn, &ret), retText, test, 7, 0);
+    jsn = ruJsonFree(jsn);
+    jsn = ruJsonStreamValue(js, &ret);
+    fail_unless(RUE_FILE_NOT_FOUND == ret, retText, test, RUE_FILE_NOT_FOUND, ret);
+    ret = ruJsonStreamNext(js, &ev);
+    fail_unless(RU_JSON_EV_MAP_END == ev, retText, test, RU_JSON_EV_MAP_END, ev);
+    ret = ruJsonStreamNext(js, &ev);
+    fail_unless(RU_JSON_EV_END == ev, retText, test, RU_JSON_EV_END, ev);
+    js = ruJsonStreamFree(js);
+    ruStringFree(rs, false);
+}
+END_TEST
+
+static rusize_s failSink(perm_ptr ctx, trans_ptr buf, rusize len) {
+    return -1;
+}
+
+static rusize_s collectSink(perm_ptr ctx, trans_ptr buf, rusize len) {
+    // hand back a little less to exercise partial writes
+    if (len > 1) len--;
+    ruStringAppendn((ruString)ctx, (trans_chars)buf, len);
+    return (rusize_s)len;
+}
+
+static void writeRecords(ruJsonWriter jw, int cnt) {
+    int32_t ret, exp = RUE_OK;
+    perm_chars test = "writeRecords";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+    ret = ruJsonWriterStartArray(jw);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    for (int i = 0; i < cnt; i++) {
+        ruJsonWriterStartMap(jw);
+        ruJsonWriterKey(jw, "id");
+        ruJsonWriterInt(jw, i);
+        ruJsonWriterKey(jw, "name");
+        ruJsonWriterStr(jw, "entry \"number\" \xc3\xa4 with a somewhat longer text");
+        ruJsonWriterKey(jw, "ratio");
+        ruJsonWriterDouble(jw, i + 0.25);
+        ruJsonWriterKey(jw, "tags");
+        ruJsonWriterStartArray(jw);
+        ruJsonWriterStr(jw, "a");
+        ruJsonWriterBool(jw, i % 2);
+        ruJsonWriterNull(jw);
+        ruJsonWriterEndArray(jw);
+        ret = ruJsonWriterEndMap(jw);
+        fail_unless(exp == ret, retText, test, exp, ret);
+    }
+    ret = ruJsonWriterEndArray(jw);
+    fail_unless(exp == ret, retText, test, exp, ret);
+}
+
+START_TEST(writeNative) {
+    int32_t ret, exp;
+    perm_chars test = "ruJsonWriter";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+    ruJsonWriter jw;
+
+    exp = RUE_PARAMETER_NOT_SET;
+    jw = ruJsonWriterNew(NULL, 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(NULL == jw, retText, test, NULL, jw);
+    jw = ruJsonWriterNewSink(NULL, NULL, 0, 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(NULL == jw, retText, test, NULL, jw);
+
+    exp = RUE_OK;
+    ruString rs = ruStringNew("");
+    jw = ruJsonWriterNew(rs, 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ruJsonWriterStartMap(jw);
+
+    // values need keys in maps and keys need maps
+    exp = RUE_INVALID_STATE;
+    ret = ruJsonWriterInt(jw, 1);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruJsonWriterEndArray(jw);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    exp = RUE_OK;
+    ret = ruJsonWriterKey(jw, "esc");
+    fail_unless(exp == ret, retText, test, exp, ret);
+    exp = RUE_INVALID_STATE;
+    ret = ruJsonWriterKey(jw, "twice");
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruJsonWriterEndMap(jw);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    exp = RUE_INVALID_PARAMETER;
+    ret = ruJsonWriterStr(jw, "bad \xc3\x28");
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    exp = RUE_OK;
+    ret = ruJsonWriterStr(jw, "quote\" back\\ slash/ tab\t nl\n bell\x07 \xc3\xa4\xf0\x9f\x98\x80");
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ruJsonWriterKey(jw, "nums");
+    ruJsonWriterStartArray(jw);
+    ruJsonWriterInt(jw, 0);
+    ruJsonWriterInt(jw, -7);
+    ruJsonWriterInt(jw, INT64_MIN);
+    ruJsonWriterInt(jw, INT64_MAX);
+    ruJsonWriterDouble(jw, 0.1);
+    ruJsonWriterDouble(jw, 3);
+    ruJsonWriterDouble(jw, -1.5e300);
+    exp = RUE_INVALID_PARAMETER;
+    ret = ruJsonWriterDouble(jw, NAN);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    exp = RUE_OK;
+    ruJsonWriterEndArray(jw);
+    ruJsonWriterKey(jw, "zero");
+    ret = ruJsonWriterStrLen(jw, "a\0b", 3);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ruJsonWriterKey(jw, "empty");
+    ruJsonWriterStartMap(jw);
+    ruJsonWriterEndMap(jw);
+    ruJsonWriterKey(jw, "nil");
+    ruJsonWriterStr(jw, NULL);
+    ret = ruJsonWriterEndMap(jw);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    // the document is complete
+    exp = RUE_INVALID_STATE;
+    ret = ruJsonWriterNull(jw);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    exp = RUE_OK;
+    ret = ruJsonWriterFlush(jw);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    jw = ruJsonWriterFree(jw);
+    ck_assert_str_eq("{\"esc\":\"quote\\\" back\\\\ slash/ tab\\t nl\\n bell\\u0007 "
+                     "\xc3\xa4\xf0\x9f\x98\x80\",\"nums\":[0,-7,-9223372036854775808,"
+                     "9223372036854775807,0.1,3.0,-1.5e+300],\"zero\":\"a\\u0000b\","
+                     "\"empty\":{},\"nil\":null}", ruStringGetCString(rs));
+
+    // pretty and escaped slashes
+    ruStringReset(rs);
+    jw = ruJsonWriterNew(rs, RU_JSON_PRETTIFY | RU_JSON_ESCAPE_SLASH, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ruJsonWriterStartMap(jw);
+    ruJsonWriterKey(jw, "a/b");
+    ruJsonWriterStartArray(jw);
+    ruJsonWriterInt(jw, 1);
+    ruJsonWriterStartArray(jw);
+    ruJsonWriterEndArray(jw);
+    ruJsonWriterEndArray(jw);
+    ruJsonWriterKey(jw, "c");
+    ruJsonWriterBool(jw, true);
+    ruJsonWriterEndMap(jw);
+    jw = ruJsonWriterFree(jw);
+    ck_assert_str_eq("{\n    \"a\\/b\": [\n        1,\n        []\n    ],\n"
+                     "    \"c\": true\n}\n", ruStringGetCString(rs));
+
+    // doubles are as short as they can be while reading back the same
+    ruStringReset(rs);
+    jw = ruJsonWriterNew(rs, 0, &ret);
+    ruJsonWriterStartArray(jw);
+    double dbls[] = {-0.0, 123456789012345.0, 1e15, 2.5e-8, 1.0 / 3, 0.1 + 0.2};
+    for (int i = 0; i < sizeof(dbls) / sizeof(dbls[0]); i++) {
+        ruJsonWriterDouble(jw, dbls[i]);
+    }
+    ruJsonWriterEndArray(jw);
+    jw = ruJsonWriterFree(jw);
+    ck_assert_str_eq("[-0.0,123456789012345.0,1e+15,2.5e-08,"
+                     "0.33333333333333331,0.30000000000000004]",
+                     ruStringGetCString(rs));
+    ruJson dj = ruJsonParseLen(ruStringGetCString(rs), RU_SIZE_AUTO, 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    for (int i = 0; i < sizeof(dbls) / sizeof(dbls[0]); i++) {
+        fail_unless(dbls[i] == ruJsonIdxDouble(dj, i, &ret), retText, test, 1, 0);
+    }
+    ruJsonFree(dj);
+
+    // characters to escape on either side of the scan blocks
+    for (int off = 0; off < 40; off++) {
+        char pad[41], str[128], want[128];
+        memset(pad, 'x', off);
+        pad[off] = '\0';
+        snprintf(str, sizeof(str), "%s/\x01%s\xc3\xa4\"", pad, pad);
+        snprintf(want, sizeof(want), "[\"%s\\/\\u0001%s\xc3\xa4\\\"\"]", pad, pad);
+        ruStringReset(rs);
+        jw = ruJsonWriterNew(rs, RU_JSON_ESCAPE_SLASH, &ret);
+        ruJsonWriterStartArray(jw);
+        ret = ruJsonWriterStr(jw, str);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        ruJsonWriterEndArray(jw);
+        jw = ruJsonWriterFree(jw);
+        ck_assert_str_eq(want, ruStringGetCString(rs));
+    }
+
+    // a tiny buffer yields the same as a big one
+    ruStringReset(rs);
+    jw = ruJsonWriterNew(rs, 0, &ret);
+    writeRecords(jw, 100);
+    jw = ruJsonWriterFree(jw);
+    ruString small = ruStringNew("");
+    jw = ruJsonWriterNewSink(collectSink, small, 7, 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    writeRecords(jw, 100);
+    ret = ruJsonWriterFlush(jw);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    jw = ruJsonWriterFree(jw);
+    ck_assert_str_eq(ruStringGetCString(rs), ruStringGetCString(small));
+    ruStringFree(small, false);
+
+    ruJson jsn = ruJsonParseLen(ruStringGetCString(rs), RU_SIZE_AUTO, 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ruJson rec = ruJsonIdxMap(jsn, 99, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_str_eq("entry \"number\" \xc3\xa4 with a somewhat longer text",
+                     ruJsonKeyStr(rec, "name", &ret));
+    fail_unless(99.25 == ruJsonKeyDouble(rec, "ratio", &ret), retText, test, 1, 0);
+    jsn = ruJsonFree(jsn);
+
+    // write errors stick
+    jw = ruJsonWriterNewSink(failSink, NULL, 16, 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ruJsonWriterStartArray(jw);
+    exp = RUE_CANT_WRITE;
+    ret = ruJsonWriterStr(jw, "this is longer than the buffer");
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruJsonWriterNull(jw);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruJsonWriterFlush(jw);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    jw = ruJsonWriterFree(jw);
+
+    // compare with the yajl based generator
+    exp = RUE_OK;
+    int rounds = 20, recs = 1000;
+    msec_t start = ruTimeMs();
+    for (int r = 0; r < rounds; r++) {
+        ruJson gen = ruJsonStart(false);
+        for (int i = 0; i < recs; i++) {
+            ruJsonStartMap(gen);
+            ruJsonSetKeyInt(gen, "id", i);
+            ruJsonSetKeyStr(gen, "name", "entry \"number\" \xc3\xa4 with a somewhat longer text");
+            ruJsonSetKeyDouble(gen, "ratio", i + 0.25);
+            ruJsonStartKeyArray(gen, "tags");
+            ruJsonSetStr(gen, "a");
+            ruJsonSetInt(gen, i % 2);
+            ruJsonSetStr(gen, NULL);
+            ruJsonEndArray(gen);
+            ruJsonEndMap(gen);
+        }
+        perm_chars out = NULL;
+        ret = ruJsonWrite(gen, &out);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        ruJsonFree(gen);
+    }
+    ruInfoLogf("yajl generated %d x %d records in %ld ms", rounds, recs,
+               (long)(ruTimeMs() - start));
+    start = ruTimeMs();
+    for (int r = 0; r < rounds; r++) {
+        ruStringReset(rs);
+        jw = ruJsonWriterNew(rs, 0, &ret);
+        writeRecords(jw, recs);
+        jw = ruJsonWriterFree(jw);
+    }
+    ruInfoLogf("writer generated %d x %d records in %ld ms", rounds, recs,
+               (long)(ruTimeMs() - start));
+    ruStringFree(rs, false);
+}
+END_TEST
+
+START_TEST(paths) {
+    int32_t ret, exp;
+    perm_chars test = "ruJsonPath";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+    ruJsonPath jp;
+
+    exp = RUE_PARAMETER_NOT_SET;
+    jp = ruJsonPathCompile(NULL, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(NULL == jp, retText, test, NULL, jp);
+
+    perm_chars bad[] = {"a", "/a~2", "$x", "$.", "$[01]", "$[a]", "$['a",
+                        "$['a'x", "$.a[", NULL};
+    exp = RUE_INVALID_PARAMETER;
+    for (int i = 0; bad[i]; i++) {
+        jp = ruJsonPathCompile(bad[i], &ret);
+        fail_unless(exp == ret, "%s failed on '%s' wanted ret '%d' but got '%d'",
+                    test, bad[i], exp, ret);
+        fail_unless(NULL == jp, retText, test, NULL, jp);
+    }
+
+    perm_chars doc = "{\"users\": [{\"name\": \"anna\", \"age\": 31, "
+                     "\"tags\": [\"a\", \"b\"]}, {\"name\": \"bert\", \"age\": 42.5, "
+                     "\"admin\": true}], \"a/b\": 1, \"m~n\": 2, \"odd.key\": "
+                     "{\"0\": \"zero\"}, \"dup\": 1, \"dup\": 2}";
+    ruJson docs[3];
+    docs[0] = ruJsonParse(doc, &ret);
+    docs[1] = ruJsonParseLen(doc, RU_SIZE_AUTO, 0, &ret);
+    docs[2] = ruJsonParseLen(doc, RU_SIZE_AUTO, RU_JSON_INDEX_KEYS, &ret);
+
+    trans_chars exprs[] = {
+            "/users/0/name", "$.users[1].name", "$['users'][-1][\"name\"]",
+            "/a~1b", "/m~0n", "$['odd.key']['0']", "/odd.key/0", "/users/2",
+            "/users/0/tags/1", "/users/0/nope", "$.users[0].name", "/dup",
+            "/users/x", ""
+    };
+    rusize count = sizeof(exprs) / sizeof(exprs[0]);
+    perm_chars strs[] = {"anna", "bert", "bert", NULL, NULL, "zero", "zero",
+                         NULL, "b", NULL, "anna", NULL, NULL, NULL};
+    int found[] = {1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 1, 1, 0, 1};
+
+    ruJsonPath all = ruJsonPathCompileAll(exprs, count, &ret);
+    fail_unless(RUE_OK == ret, retText, test, RUE_OK, ret);
+    ruJson results[sizeof(exprs) / sizeof(exprs[0])];
+    for (int d = 0; d < 3; d++) {
+        fail_unless(docs[d] != NULL, retText, test, 1, 0);
+        for (rusize i = 0; i < count; i++) {
+            jp = ruJsonPathCompile(exprs[i], &ret);
+            fail_unless(RUE_OK == ret, retText, test, RUE_OK, ret);
+            ruJson v = ruJsonPathGet(jp, docs[d], &ret);
+            exp = found[i]? RUE_OK : RUE_FILE_NOT_FOUND;
+            fail_unless(exp == ret, "%s failed on '%s' wanted ret '%d' but got '%d'",
+                        test, exprs[i], exp, ret);
+            if (strs[i]) {
+                perm_chars str = ruJsonPathStr(jp, docs[d], &ret);
+                fail_unless(RUE_OK == ret, retText, test, RUE_OK, ret);
+                ck_assert_str_eq(strs[i], str);
+            }
+            jp = ruJsonPathFree(jp);
+
+            // the batch finds the very same nodes
+            rusize cnt = ruJsonPathGetAll(all, docs[d], results, &ret);
+            fail_unless(RUE_OK == ret, retText, test, RUE_OK, ret);
+            fail_unless(11 == cnt, retText, test, 11, cnt);
+            fail_unless(v == results[i], "%s batch differs on '%s'", test, exprs[i]);
+        }
+        fail_unless(1 == ruJsonInt(results[3], &ret), retText, test, 1, 0);
+        fail_unless(RUE_OK == ret, retText, test, RUE_OK, ret);
+        jp = ruJsonPathCompile("/dup", &ret);
+        fail_unless(1 == ruJsonPathInt(jp, docs[d], &ret), retText, test, 1, 0);
+        jp = ruJsonPathFree(jp);
+        jp = ruJsonPathCompile("/users/1/age", &ret);
+        ruJsonPathInt(jp, docs[d], &ret);
+        fail_unless(RUE_INVALID_PARAMETER == ret, retText, test,
+                    RUE_INVALID_PARAMETER, ret);
+        fail_unless(42.5 == ruJsonPathDouble(jp, docs[d], &ret), retText, test, 1, 0);
+        jp = ruJsonPathFree(jp);
+        jp = ruJsonPathCompile("$.users[1].admin", &ret);
+        fail_unless(ruJsonPathBool(jp, docs[d], &ret), retText, test, 1, 0);
+        fail_unless(RUE_OK == ret, retText, test, RUE_OK, ret);
+        // relative to a sub object
+        ruJson users = ruJsonKeyArray(docs[d], "users", &ret);
+        ruJsonPath rel = ruJsonPathCompile("$[1].admin", &ret);
+        fail_unless(ruJsonPathBool(rel, users, &ret), retText, test, 1, 0);
+        rel = ruJsonPathFree(rel);
+        jp = ruJsonPathFree(jp);
+        docs[d] = ruJsonFree(docs[d]);
+    }
+    all = ruJsonPathFree(all);
+}
+END_TEST
+
+START_TEST(binary) {
+    int32_t ret, exp;
+    perm_chars test = "ruJsonBinary";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+    rusize len, len2;
+
+    exp = RUE_PARAMETER_NOT_SET;
+    alloc_ptr img = ruJsonToBinary(NULL, &len, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(NULL == img, retText, test, NULL, img);
+    ruJson jsn = ruJsonFromBinary(NULL, 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(NULL == jsn, retText, test, NULL, jsn);
+
+    ruString rs = ruStringNew("{\"name\": \"conf\\u00e4\", \"empty\": {}, \"none\": [], "
+                              "\"nums\": [1, -2, 3.5, 1e400], \"flags\": [true, false, null], "
+                              "\"big\": {");
+    for (int i = 0; i < 100; i++) {
+        ruStringAppendf(rs, "%s\"key%d\": {\"v\": %d}", i? ", " : "", i, i);
+    }
+    ruStringAppend(rs, "}}");
+    perm_chars doc = ruStringGetCString(rs);
+
+    exp = RUE_OK;
+    ruJson docs[3];
+    docs[0] = ruJsonParse(doc, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    docs[1] = ruJsonParseLen(doc, RU_SIZE_AUTO, 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    docs[2] = ruJsonParseLen(doc, RU_SIZE_AUTO, RU_JSON_INDEX_KEYS, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    for (int d = 0; d < 3; d++) {
+        img = ruJsonToBinary(docs[d], &len, &ret);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        jsn = ruJsonFromBinary(img, len, &ret);
+        fail_unless(exp == ret, retText, test, exp, ret);
+
+        // serializing the loaded copy yields the identical image
+        alloc_ptr img2 = ruJsonToBinary(jsn, &len2, &ret);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        fail_unless(len == len2, retText, test, len, len2);
+        fail_unless(!memcmp(img, img2, len), "%s images differ", test);
+        ruFree(img2);
+
+        ck_assert_str_eq("conf\xc3\xa4", ruJsonKeyStr(jsn, "name", &ret));
+        ruJson big = ruJsonKeyMap(jsn, "big", &ret);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        ruJson inner = ruJsonKeyMap(big, "key77", &ret);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        fail_unless(77 == ruJsonKeyInt(inner, "v", &ret), retText, test, 77, 0);
+        ruJson nums = ruJsonKeyArray(jsn, "nums", &ret);
+        fail_unless(4 == ruJsonArrayLen(nums, &ret), retText, test, 4, 0);
+        fail_unless(3.5 == ruJsonIdxDouble(nums, 2, &ret), retText, test, 1, 0);
+        fail_unless(-2 == ruJsonIdxInt(nums, 1, &ret), retText, test, -2, 0);
+        ruJson none = ruJsonKeyArray(jsn, "none", &ret);
+        fail_unless(0 == ruJsonArrayLen(none, &ret), retText, test, 0, 1);
+        ruJsonPath jp = ruJsonPathCompile("/flags/0", &ret);
+        fail_unless(ruJsonPathBool(jp, jsn, &ret), retText, test, 1, 0);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        jp = ruJsonPathFree(jp);
+        jsn = ruJsonFree(jsn);
+
+        if (d == 2) {
+            perm_chars file = makeOutPath("conf.rujb");
+            ret = ruJsonSaveBinary(docs[d], file);
+            fail_unless(exp == ret, retText, test, exp, ret);
+            jsn = ruJsonLoadBinary(file, &ret);
+            fail_unless(exp == ret, retText, test, exp, ret);
+            big = ruJsonKeyMap(jsn, "big", &ret);
+            inner = ruJsonKeyMap(big, "key99", &ret);
+            fail_unless(99 == ruJsonKeyInt(inner, "v", &ret), retText, test, 99, 0);
+            jsn = ruJsonFree(jsn);
+
+            // damaged images are refused
+            exp = RUE_INVALID_PARAMETER;
+            jsn = ruJsonFromBinary(img, len - 1, &ret);
+            fail_unless(exp == ret, retText, test, exp, ret);
+            fail_unless(NULL == jsn, retText, test, NULL, jsn);
+            jsn = ruJsonFromBinary("RUJB", 4, &ret);
+            fail_unless(exp == ret, retText, test, exp, ret);
+            char* bad = ruMemDup(img, len);
+            bad[0] = 'X';
+            jsn = ruJsonFromBinary(bad, len, &ret);
+            fail_unless(exp == ret, retText, test, exp, ret);
+            // garble offsets all over the place
+            for (rusize pos = 48; pos < len; pos += 97) {
+                memcpy(bad, img, len);
+                bad[pos] ^= 0x5a;
+                jsn = ruJsonFromBinary(bad, len, &ret);
+                jsn = ruJsonFree(jsn);
+            }
+            ruFree(bad);
+
+            // containers pointing back at themselves or a parent
+            ruJson nest = ruJsonParse("[[1]]", &ret);
+            rusize nlen;
+            bad = ruJsonToBinary(nest, &nlen, &ret);
+            nest = ruJsonFree(nest);
+            uint16_t nodeSize;
+            uint64_t nodes;
+            memcpy(&nodeSize, bad + 14, sizeof(nodeSize));
+            memcpy(&nodes, bad + 16, sizeof(nodes));
+            rusize slotsAt = 40 + (rusize)nodes * nodeSize;
+            uintptr_t inner, root = 40 + 1;
+            memcpy(&inner, bad + slotsAt, sizeof(inner));
+            memcpy(bad + slotsAt + sizeof(ptr), &inner, sizeof(inner));
+            jsn = ruJsonFromBinary(bad, nlen, &ret);
+            fail_unless(exp == ret, retText, test, exp, ret);
+            fail_unless(NULL == jsn, retText, test, NULL, jsn);
+            memcpy(bad + slotsAt + sizeof(ptr), &root, sizeof(root));
+            jsn = ruJsonFromBinary(bad, nlen, &ret);
+            fail_unless(exp == ret, retText, test, exp, ret);
+            fail_unless(NULL == jsn, retText, test, NULL, jsn);
+            ruFree(bad);
+            exp = RUE_FILE_NOT_FOUND;
+            jsn = ruJsonLoadBinary(makeOutPath("nope.rujb"), &ret);
+            fail_unless(exp == ret, retText, test, exp, ret);
+            exp = RUE_OK;
+        }
+        ruFree(img);
+        docs[d] = ruJsonFree(docs[d]);
+    }
+    ruStringFree(rs, false);
+}
 END_TEST
 
 START_TEST(set) {
@@ -724,6 +1609,14 @@ TCase* jsonTests(void) {
     TCase *tcase = tcase_create("json");
     tcase_add_test(tcase, api);
     tcase_add_test(tcase, get);
+    tcase_add_test(tcase, getArena);
+    tcase_add_test(tcase, arena);
+    tcase_add_test(tcase, speed);
+    tcase_add_test(tcase, keyIndex);
+    tcase_add_test(tcase, stream);
+    tcase_add_test(tcase, writeNative);
+    tcase_add_test(tcase, paths);
+    tcase_add_test(tcase, binary);
     tcase_add_test(tcase, set);
     return tcase;
 }
@@ -276,11 +276,435 @@ START_TEST ( groups2 ) {
 }
 END_TEST
 
+START_TEST ( spans ) {
+    int32_t ret, exp;
+    const char *test = "ruRegexFindSpans";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+    ruRegexSpan sp[4];
+
+    exp = RUE_PARAMETER_NOT_SET;
+    bool does = ruRegexFindSpans(NULL, "foo", RU_SIZE_AUTO, sp, 4, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_if(does, retText, test, false, does);
+
+    ruRegex rr = ruRegexNew("(\\w+)@(\\w+)(\\.de)?", 0, &ret);
+    ck_assert_int_eq(RUE_OK, ret);
+
+    does = ruRegexFindSpans(rr, NULL, RU_SIZE_AUTO, sp, 4, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_if(does, retText, test, false, does);
+
+    exp = RUE_INVALID_PARAMETER;
+    does = ruRegexFindSpans(rr, "foo", RU_SIZE_AUTO, NULL, 4, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_if(does, retText, test, false, does);
+
+    exp = RUE_OK;
+    int32_t groups = ruRegexGroupCount(rr, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_int_eq(3, groups);
+
+    // offsets are bytes into the UTF-8 input
+    const char* orig = "Grüße an bob@host.com heute";
+    does = ruRegexFindSpans(rr, orig, RU_SIZE_AUTO, sp, 4, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(does, retText, test, true, does);
+    ck_assert_int_eq(11, sp[0].offset);
+    ck_assert_int_eq(8, sp[0].length);
+    ck_assert_int_eq(11, sp[1].offset);
+    ck_assert_int_eq(3, sp[1].length);
+    ck_assert_int_eq(15, sp[2].offset);
+    ck_assert_int_eq(4, sp[2].length);
+    ck_assert_int_eq(-1, sp[3].offset);
+    ck_assert_int_eq(0, sp[3].length);
+
+    // the length limits the search
+    does = ruRegexFindSpans(rr, orig, 14, sp, 4, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_if(does, retText, test, false, does);
+
+    // spans beyond the group count are cleared
+    ruRegexSpan many[6];
+    does = ruRegexMatchSpans(rr, "me@x.de", RU_SIZE_AUTO, many, 6, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(does, retText, test, true, does);
+    ck_assert_int_eq(4, many[3].offset);
+    ck_assert_int_eq(3, many[3].length);
+    ck_assert_int_eq(-1, many[4].offset);
+    ck_assert_int_eq(-1, many[5].offset);
+
+    does = ruRegexMatchSpans(rr, orig, RU_SIZE_AUTO, NULL, 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_if(does, retText, test, false, does);
+
+    ruRegexFree(rr);
+}
+END_TEST
+
+START_TEST ( regexSet ) {
+    int32_t ret, exp;
+    const char *test = "ruRegexSetNew";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+    int32_t ids[4];
+
+    exp = RUE_PARAMETER_NOT_SET;
+    int32_t id = ruRegexSetAdd(NULL, "foo", 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_int_eq(-1, id);
+
+    int32_t cnt = ruRegexSetMatch(NULL, "foo", RU_SIZE_AUTO, ids, 4, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_int_eq(-1, cnt);
+
+    exp = RUE_OK;
+    ruRegexSet rs = ruRegexSetNew(&ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_if(NULL == rs, retText, test, NULL, rs);
+
+    exp = RUE_PARAMETER_NOT_SET;
+    cnt = ruRegexSetMatch(rs, NULL, RU_SIZE_AUTO, ids, 4, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    exp = RUE_INVALID_PARAMETER;
+    id = ruRegexSetAdd(rs, "(", 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_int_eq(-1, id);
+
+    cnt = ruRegexSetMatch(rs, "foo", RU_SIZE_AUTO, NULL, 4, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    exp = RUE_OK;
+    cnt = ruRegexSetMatch(rs, "foo", RU_SIZE_AUTO, ids, 4, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_int_eq(0, cnt);
+
+    // dfa, ASCII only dfa and ICU patterns mixed
+    const char* pats[] = {
+        "error", "^GET /api/\\w+", "timeout|refused", "[0-9]{3}\\.[0-9]+",
+        "ab*c?d", "x{2,3}y", "(foo|bar)+baz", "^$", "end$", "Grüße",
+        "^\\s*#", "[^a-z]z", "a.c", "(?i)hello", "\\bword\\b", "(a)\\1",
+        "user(?=@)", "[\\w.]+@[\\w.]+", "colou?r", "a|", "\\d+ms",
+        "[a\\-z]-", "ü+", "x*", "^(?:ab)*$"
+    };
+    ruRegexFlag flags[] = {
+        0, 0, RUREGEX_CASE_INSENSITIVE, 0,
+        0, 0, 0, 0, 0, 0,
+        0, 0, RUREGEX_DOTALL, 0, 0, 0,
+        0, 0, 0, 0, 0,
+        0, 0, RUREGEX_MULTILINE, 0
+    };
+    const char* texts[] = {
+        "", "GET /api/users HTTP/1.1", "connection REFUSED by peer",
+        "took 200.5 seconds", "abbbd", "ad", "xxy", "xy", "foobarbaz",
+        "barbaz", "the end", "the end\n", "the end\r\n", "the end\n\n",
+        "Grüße aus Köln", "  # comment", "Az", "az", "a\nc", "aüc",
+        "HeLLo world", "a word here", "swords", "aa", "user@host.de",
+        "color", "colour", "12ms", "-", "a-", "\xc3\xbc\xc3\xbc", "abab",
+        "aba", "ERROR in line 5", "error", "üx end"
+    };
+    uint32_t patCount = sizeof(pats) / sizeof(pats[0]);
+    uint32_t textCount = sizeof(texts) / sizeof(texts[0]);
+    ruRegex rrs[32];
+    for (uint32_t p = 0; p < patCount; p++) {
+        id = ruRegexSetAdd(rs, pats[p], flags[p], &ret);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        ck_assert_int_eq(p, id);
+        rrs[p] = ruRegexNew(pats[p], flags[p], &ret);
+        fail_unless(exp == ret, retText, test, exp, ret);
+    }
+    int32_t all[32];
+    for (uint32_t t = 0; t < textCount; t++) {
+        cnt = ruRegexSetMatch(rs, texts[t], RU_SIZE_AUTO, all, 32, &ret);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        int32_t n = 0;
+        for (uint32_t p = 0; p < patCount; p++) {
+            bool want = ruRegexFind(rrs[p], texts[t], &ret);
+            bool got = n < cnt && all[n] == (int32_t)p;
+            if (got) n++;
+            fail_unless(want == got, "pattern '%s' on '%s' wanted %d got %d",
+                        pats[p], texts[t], want, got);
+        }
+        ck_assert_int_eq(n, cnt);
+    }
+    for (uint32_t p = 0; p < patCount; p++) ruRegexFree(rrs[p]);
+
+    // only the first idCount ids are stored
+    cnt = ruRegexSetMatch(rs, "error timeout", RU_SIZE_AUTO, ids, 1, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_int_eq(4, cnt);
+    ck_assert_int_eq(0, ids[0]);
+
+    // the length limits the search, "a|" and "x*" match anything
+    cnt = ruRegexSetMatch(rs, "error timeout", 5, ids, 4, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_int_eq(3, cnt);
+    ck_assert_int_eq(0, ids[0]);
+    ck_assert_int_eq(19, ids[1]);
+    ck_assert_int_eq(23, ids[2]);
+
+    ruRegexSetFree(rs);
+
+    // ASCII only patterns go to ICU on other text and must not end the scan
+    rs = ruRegexSetNew(&ret);
+    ck_assert_int_eq(0, ruRegexSetAdd(rs, "a.", 0, &ret));
+    ck_assert_int_eq(1, ruRegexSetAdd(rs, "zzz", 0, &ret));
+    cnt = ruRegexSetMatch(rs, "ab \xc3\xa9 zzz", RU_SIZE_AUTO, ids, 4, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_int_eq(2, cnt);
+    ck_assert_int_eq(0, ids[0]);
+    ck_assert_int_eq(1, ids[1]);
+    ruRegexSetFree(rs);
+}
+END_TEST
+
+START_TEST ( regexSetBench ) {
+    int32_t ret;
+    const char* pats[] = {
+        "ERROR", "WARN(ING)?", "timeout after \\d+ ?ms", "connection (refused|reset)",
+        "GET /api/v[0-9]+/users", "POST /login", "status=5\\d\\d",
+        "status=4\\d\\d", "user=[a-z]+@example\\.com", "disk (full|quota)",
+        "retry #\\d+", "session [0-9a-f]{8}", "OutOfMemory", "deadlock",
+        "slow query", "certificate (expired|invalid)", "^\\[audit\\]",
+        "checksum mismatch", "cache miss", "shutting down"
+    };
+    const char* parts[] = {
+        "GET /api/v2/users status=200", "POST /login status=401",
+        "timeout after 30 ms", "connection reset by peer",
+        "user=bob@example.com cache miss", "retry #3 session deadbeef",
+        "status=503 slow query", "all good here nothing to see"
+    };
+    uint32_t patCount = sizeof(pats) / sizeof(pats[0]);
+    uint32_t lines = 20000;
+    ruRegexSet rs = ruRegexSetNew(&ret);
+    ruRegex rrs[32];
+    for (uint32_t p = 0; p < patCount; p++) {
+        ck_assert_int_eq(p, ruRegexSetAdd(rs, pats[p], 0, &ret));
+        rrs[p] = ruRegexNew(pats[p], 0, &ret);
+    }
+    char line[256];
+    int64_t hitsOne = 0, hitsSet = 0;
+    int64_t start = ruTimeMs();
+    for (uint32_t i = 0; i < lines; i++) {
+        snprintf(line, sizeof(line), "2024-05-%02u 12:00:%02u host%u %s",
+                 i % 28 + 1, i % 60, i % 7, parts[i % 8]);
+        for (uint32_t p = 0; p < patCount; p++) {
+            if (ruRegexFind(rrs[p], line, NULL)) hitsOne++;
+        }
+    }
+    int64_t oneMs = ruTimeMs() - start;
+    start = ruTimeMs();
+    int32_t ids[32];
+    for (uint32_t i = 0; i < lines; i++) {
+        snprintf(line, sizeof(line), "2024-05-%02u 12:00:%02u host%u %s",
+                 i % 28 + 1, i % 60, i % 7, parts[i % 8]);
+        hitsSet += ruRegexSetMatch(rs, line, RU_SIZE_AUTO, ids, 32, NULL);
+    }
+    int64_t setMs = ruTimeMs() - start;
+    ck_assert_int_eq(hitsOne, hitsSet);
+    ruInfoLogf("classifying %u lines with %u patterns: one by one %ld ms "
+               "set %ld ms", lines, patCount, (long)oneMs, (long)setMs);
+    for (uint32_t p = 0; p < patCount; p++) ruRegexFree(rrs[p]);
+    ruRegexSetFree(rs);
+}
+END_TEST
+
+START_TEST ( cache ) {
+    int32_t ret, exp;
+    const char *test = "ruRegexCached";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+    ruRegexCacheStats st0, st;
+
+    exp = RUE_PARAMETER_NOT_SET;
+    ruRegex rr = ruRegexCached(NULL, 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(NULL == rr, retText, test, NULL, rr);
+
+    ret = ruRegexCacheGetStats(NULL);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    exp = RUE_INVALID_PARAMETER;
+    rr = ruRegexCached("(", 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(NULL == rr, retText, test, NULL, rr);
+
+    exp = RUE_OK;
+    ruRegexCacheSet(2);
+    ret = ruRegexCacheGetStats(&st0);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_int_eq(0, st0.entries);
+
+    ruRegex a = ruRegexCached("a+", 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ruRegex a2 = ruRegexCached("a+", 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert(a == a2);
+    ruRegex ai = ruRegexCached("a+", RUREGEX_CASE_INSENSITIVE, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert(a != ai);
+
+    ruRegexCacheGetStats(&st);
+    ck_assert_int_eq(1, st.hits - st0.hits);
+    ck_assert_int_eq(2, st.misses - st0.misses);
+    ck_assert_int_eq(2, st.entries);
+
+    // evicts "a+" which stays usable while referenced
+    ruRegex b = ruRegexCached("b+", 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ruRegexCacheGetStats(&st);
+    ck_assert_int_eq(1, st.evictions - st0.evictions);
+    ck_assert_int_eq(2, st.entries);
+    ck_assert(ruRegexFind(a, "baaa", &ret));
+    ruRegexFree(a);
+    ck_assert(ruRegexMatch(a2, "aaa", &ret));
+    ruRegexFree(a2);
+
+    // a cached entry outlives its users
+    ruRegexFree(b);
+    ruRegex b2 = ruRegexCached("b+", 0, &ret);
+    ck_assert(b == b2);
+    ruRegexFree(b2);
+    ruRegexFree(ai);
+
+    // disabled cache compiles every time
+    ruRegexCacheSet(0);
+    ruRegexCacheGetStats(&st);
+    ck_assert_int_eq(0, st.entries);
+    a = ruRegexCached("a+", 0, &ret);
+    a2 = ruRegexCached("a+", 0, &ret);
+    ck_assert(a != a2);
+    ruRegexFree(a);
+    ruRegexFree(a2);
+
+    ruRegexCacheSet(128);
+    uint32_t loops = 2000;
+    const char* pat = "^(\\w+)://([^/:]+)(?::(\\d+))?(/.*)?$";
+    int64_t start = ruTimeMs();
+    for (uint32_t i = 0; i < loops; i++) {
+        rr = ruRegexNew(pat, 0, &ret);
+        ruRegexFree(rr);
+    }
+    int64_t newMs = ruTimeMs() - start;
+    ruRegexCacheGetStats(&st0);
+    start = ruTimeMs();
+    for (uint32_t i = 0; i < loops; i++) {
+        rr = ruRegexCached(pat, 0, &ret);
+        ruRegexFree(rr);
+    }
+    int64_t cachedMs = ruTimeMs() - start;
+    ruRegexCacheGetStats(&st);
+    ck_assert_int_eq(loops - 1, st.hits - st0.hits);
+    ruInfoLogf("%u compiles: new %ld ms cached %ld ms", loops, (long)newMs,
+               (long)cachedMs);
+    ruRegexCacheSet(0);
+}
+END_TEST
+
+typedef struct {
+    ruRegex rr;
+    uint32_t loops;
+    uint32_t hits;
+} regexJob;
+
+static void* regexRunner(void* ctx) {
+    regexJob* job = (regexJob*)ctx;
+    char line[128];
+    for (uint32_t i = 0; i < job->loops; i++) {
+        snprintf(line, sizeof(line),
+                 "line %u of the log mentions user%u@example.com in passing", i, i);
+        ruList groups = ruRegexFindGroups(job->rr, line, NULL);
+        if (!groups) continue;
+        char* user = ruListIdx(groups, 1, char*, NULL);
+        char want[32];
+        snprintf(want, sizeof(want), "user%u", i);
+        if (user && !strcmp(user, want)) job->hits++;
+        ruListFree(groups);
+    }
+    return NULL;
+}
+
+static int64_t regexRound(ruRegex rr, uint32_t threads, uint32_t loops) {
+    ruThread tids[8];
+    regexJob jobs[8];
+    int64_t start = ruTimeMs();
+    for (uint32_t t = 0; t < threads; t++) {
+        jobs[t].rr = rr;
+        jobs[t].loops = loops / threads;
+        jobs[t].hits = 0;
+        tids[t] = ruThreadCreate(regexRunner, NULL, &jobs[t]);
+        ck_assert(tids[t] != NULL);
+    }
+    for (uint32_t t = 0; t < threads; t++) {
+        ck_assert_int_eq(RUE_OK, ruThreadJoin(tids[t], NULL));
+        ck_assert_int_eq(loops / threads, jobs[t].hits);
+    }
+    return ruTimeMs() - start;
+}
+
+START_TEST ( threads ) {
+    int32_t ret;
+    uint32_t loops = 40000;
+    ruRegex rr = ruRegexNew("(\\w+)@(\\w+)\\.com", RUREGEX_CASE_INSENSITIVE, &ret);
+    ck_assert_int_eq(RUE_OK, ret);
+
+    int64_t single = regexRound(rr, 1, loops);
+    int64_t multi = regexRound(rr, 8, loops);
+    ruInfoLogf("%u regex searches: 1 thread %ld ms 8 threads %ld ms",
+               loops, (long)single, (long)multi);
+
+    // the pooled matchers keep working after the threads are gone
+    ck_assert(ruRegexFind(rr, "me@here.com", &ret));
+    ck_assert_int_eq(RUE_OK, ret);
+    ruRegexFree(rr);
+}
+END_TEST
+
+static volatile bool cacheGo = false;
+
+static void* cacheRunner(void* ctx) {
+    uint32_t* good = (uint32_t*)ctx;
+    int32_t ret;
+    while (!cacheGo) ruSleepMs(1);
+    for (uint32_t i = 0; i < 200; i++) {
+        ruRegex rr = ruRegexCached("c+d", 0, &ret);
+        if (rr && ruRegexMatch(rr, "cccd", &ret)) (*good)++;
+        ruRegexFree(rr);
+    }
+    return NULL;
+}
+
+START_TEST ( cacheThreads ) {
+    // in its own process the threads race the first use of the cache
+    ruThread tids[8];
+    uint32_t good[8];
+    for (uint32_t t = 0; t < 8; t++) {
+        good[t] = 0;
+        tids[t] = ruThreadCreate(cacheRunner, NULL, &good[t]);
+        ck_assert(tids[t] != NULL);
+    }
+    ruSleepMs(50);
+    cacheGo = true;
+    for (uint32_t t = 0; t < 8; t++) {
+        ck_assert_int_eq(RUE_OK, ruThreadJoin(tids[t], NULL));
+        ck_assert_int_eq(200, good[t]);
+    }
+    // at most the one pattern, the cache may have been turned off before
+    ruRegexCacheStats st;
+    ck_assert_int_eq(RUE_OK, ruRegexCacheGetStats(&st));
+    ck_assert(st.entries <= 1);
+}
+END_TEST
+
 TCase* regexTests ( void ) {
     TCase *tcase = tcase_create ( "regex" );
     tcase_add_test ( tcase, api );
     tcase_add_test ( tcase, run );
     tcase_add_test ( tcase, groups );
     tcase_add_test ( tcase, groups2 );
+    tcase_add_test ( tcase, spans );
+    tcase_add_test ( tcase, regexSet );
+    tcase_add_test ( tcase, regexSetBench );
+    tcase_add_test ( tcase, cache );
+    tcase_add_test ( tcase, threads );
+    tcase_add_test ( tcase, cacheThreads );
     return tcase;
 }
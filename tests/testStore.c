@@ -234,10 +234,428 @@ START_TEST ( usage ) {
 }
 END_TEST
 
+START_TEST ( logStore ) {
+    int32_t ret, exp;
+    const char *test = "ruNewLogStore";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+    char *kvDir = insureTestFolder("kvstoreLog");
+    const char* key = "!https://test.foo-bar.com config.json";
+    const char* val = "foo\0bar\0\n";
+    rusize len = 9;
+    ruList lst = NULL;
+
+    exp = RUE_PARAMETER_NOT_SET;
+    KvStore *kvs = ruNewLogStore(NULL, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(NULL == kvs, retText, test, NULL, kvs);
+
+    exp = RUE_OK;
+    kvs = ruNewLogStore(kvDir, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    test = "ruLogStoreSet";
+    exp = RUE_INVALID_PARAMETER;
+    ret = kvs->set(kvs->ctx, key, val, len);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = kvs->set(kvs, "", val, len);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = kvs->set(kvs, "foo *", val, len);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    exp = RUE_OK;
+    ret = kvs->set(kvs, key, val, len);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = kvs->set(kvs, "!https://test.foo-bar.com  other", "1", RU_SIZE_AUTO);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = kvs->set(kvs, "elsewhere", "2", RU_SIZE_AUTO);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    test = "ruLogStoreGet";
+    char *rval = NULL;
+    rusize rlen = 0;
+    ret = kvs->get(kvs, key, &rval, &rlen);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(len == rlen, retText, test, len, rlen);
+    fail_unless(0 == memcmp(val, rval, len), retText, test, 0, 1);
+    ruFree(rval);
+    // keys are normalized like the file store does
+    ret = kvs->get(kvs, " !https://test.foo-bar.com other ", &rval, &rlen);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_str_eq("1", rval);
+    ruFree(rval);
+
+    exp = RUE_FILE_NOT_FOUND;
+    ret = kvs->get(kvs, "none", &rval, &rlen);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    test = "ruLogStoreList";
+    exp = RUE_OK;
+    ret = kvs->list(kvs, "*", &lst);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    rusize sz = ruListSize(lst, &ret);
+    fail_unless(3 == sz, retText, test, 3, sz);
+    lst = ruListFree(lst);
+    ret = kvs->list(kvs, "!https://test.foo-bar.com *", &lst);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    sz = ruListSize(lst, &ret);
+    fail_unless(2 == sz, retText, test, 2, sz);
+    ck_assert_str_eq(key, ruListIdx(lst, 0, char*, &ret));
+    ck_assert_str_eq("!https://test.foo-bar.com other",
+                     ruListIdx(lst, 1, char*, &ret));
+    lst = ruListFree(lst);
+
+    // updates and removals survive a reopen
+    ret = kvs->set(kvs, "elsewhere", "3", RU_SIZE_AUTO);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = kvs->set(kvs, key, NULL, 0);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ruFreeStore(kvs);
+
+    test = "ruNewLogStore";
+    kvs = ruNewLogStore(kvDir, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = kvs->get(kvs, "elsewhere", &rval, &rlen);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_str_eq("3", rval);
+    ruFree(rval);
+    exp = RUE_FILE_NOT_FOUND;
+    ret = kvs->get(kvs, key, &rval, &rlen);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ruFreeStore(kvs);
+
+    // a torn record at the end is dropped
+    char* logFile = ruPathJoin(kvDir, "kvstore.log");
+    rusize goodSize = ruFileSize(logFile, &ret);
+    FILE* fh = ruFOpen(logFile, "ab", &ret);
+    fwrite("\x01\x02\x03\x04LOGR\x05\x00\x00\x00", 1, 12, fh);
+    fclose(fh);
+    exp = RUE_OK;
+    kvs = ruNewLogStore(kvDir, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    sz = ruFileSize(logFile, &ret);
+    fail_unless(goodSize == sz, retText, test, goodSize, sz);
+    ret = kvs->get(kvs, "elsewhere", &rval, &rlen);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_str_eq("3", rval);
+    ruFree(rval);
+
+    // overwrites leave garbage for compaction
+    test = "ruLogStoreCompact";
+    char buf[64];
+    for (int i = 0; i < 1000; i++) {
+        snprintf(buf, sizeof(buf), "value %d", i);
+        ret = kvs->set(kvs, "churn", buf, RU_SIZE_AUTO);
+        fail_unless(exp == ret, retText, test, exp, ret);
+    }
+    rusize before = ruFileSize(logFile, &ret);
+    ret = ruLogStoreCompact(kvs);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    sz = ruFileSize(logFile, &ret);
+    fail_unless(sz < before / 10, retText, test, before / 10, sz);
+    ret = kvs->get(kvs, "churn", &rval, &rlen);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_str_eq("value 999", rval);
+    ruFree(rval);
+    ret = kvs->set(kvs, "after", "compact", RU_SIZE_AUTO);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ruFreeStore(kvs);
+
+    kvs = ruNewLogStore(kvDir, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = kvs->list(kvs, "*", &lst);
+    sz = ruListSize(lst, &ret);
+    fail_unless(4 == sz, retText, test, 4, sz);
+    lst = ruListFree(lst);
+    ret = kvs->get(kvs, "after", &rval, &rlen);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_str_eq("compact", rval);
+    ruFree(rval);
+
+    // wildcard removals
+    ret = kvs->set(kvs, "!https://test.foo-bar.com *", NULL, 0);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = kvs->list(kvs, "*", &lst);
+    sz = ruListSize(lst, &ret);
+    fail_unless(3 == sz, retText, test, 3, sz);
+    lst = ruListFree(lst);
+    ret = kvs->set(kvs, "*", NULL, 0);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = kvs->list(kvs, "*", &lst);
+    sz = ruListSize(lst, &ret);
+    fail_unless(0 == sz, retText, test, 0, sz);
+    lst = ruListFree(lst);
+    ruFreeStore(kvs);
+
+    ruFree(logFile);
+    ruFree(kvDir);
+}
+END_TEST
+
+static int64_t storeRound(KvStore* kvs, uint32_t count, bool sets) {
+    char key[64], val[64];
+    int64_t start = ruTimeMs();
+    for (uint32_t i = 0; i < count; i++) {
+        snprintf(key, sizeof(key), "bench %u item%u", i % 50, i);
+        if (sets) {
+            snprintf(val, sizeof(val), "value of item %u", i);
+            ck_assert_int_eq(RUE_OK, kvs->set(kvs, key, val, RU_SIZE_AUTO));
+        } else {
+            char* got = NULL;
+            rusize len = 0;
+            ck_assert_int_eq(RUE_OK, kvs->get(kvs, key, &got, &len));
+            ruFree(got);
+        }
+    }
+    return ruTimeMs() - start;
+}
+
+START_TEST ( storeBench ) {
+    uint32_t count = 5000;
+    char *fileDir = insureTestFolder("kvstoreBenchFile");
+    char *logDir = insureTestFolder("kvstoreBenchLog");
+    int32_t ret;
+    KvStore* stores[2];
+    stores[0] = ruNewFileStore(fileDir, &ret);
+    stores[1] = ruNewLogStore(logDir, &ret);
+    const char* names[2] = {"file", "log"};
+    for (int s = 0; s < 2; s++) {
+        int64_t setMs = storeRound(stores[s], count, true);
+        int64_t getMs = storeRound(stores[s], count, false);
+        int64_t start = ruTimeMs();
+        ruList lst = NULL;
+        ck_assert_int_eq(RUE_OK, stores[s]->list(stores[s], "bench *", &lst));
+        ck_assert_int_eq(count, ruListSize(lst, NULL));
+        lst = ruListFree(lst);
+        int64_t listMs = ruTimeMs() - start;
+        ruInfoLogf("%s store %u keys: set %ld ms get %ld ms list %ld ms",
+                   names[s], count, (long)setMs, (long)getMs, (long)listMs);
+        ruFreeStore(stores[s]);
+    }
+    ruFree(fileDir);
+    ruFree(logDir);
+}
+END_TEST
+
+START_TEST ( cacheStore ) {
+    int32_t ret, exp;
+    const char *test = "ruNewCacheStore";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+    char *kvDir = insureTestFolder("kvstoreCache");
+    char *rval = NULL;
+    rusize rlen = 0;
+    ruCacheStats st;
+
+    exp = RUE_PARAMETER_NOT_SET;
+    KvStore *kvs = ruNewCacheStore(NULL, 1024, 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(NULL == kvs, retText, test, NULL, kvs);
+
+    exp = RUE_OK;
+    KvStore *inner = ruNewLogStore(kvDir, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    kvs = ruNewCacheStore(inner, 1024, RU_CACHE_WRITE_THROUGH, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    test = "ruCacheStoreSet";
+    ret = kvs->set(kvs, "meta one", "first", RU_SIZE_AUTO);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = inner->get(inner, "meta one", &rval, &rlen);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_str_eq("first", rval);
+    ruFree(rval);
+    ret = inner->set(inner, "meta two", "second", RU_SIZE_AUTO);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    test = "ruCacheStoreGet";
+    ret = kvs->get(kvs, "meta  one", &rval, &rlen);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_str_eq("first", rval);
+    ruFree(rval);
+    for (int i = 0; i < 2; i++) {
+        ret = kvs->get(kvs, "meta two", &rval, &rlen);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        ck_assert_str_eq("second", rval);
+        ruFree(rval);
+    }
+    exp = RUE_FILE_NOT_FOUND;
+    ret = kvs->get(kvs, "meta none", &rval, &rlen);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    test = "ruCacheStoreStats";
+    exp = RUE_OK;
+    ret = ruCacheStoreStats(kvs, &st);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(2 == st.hits, retText, test, 2, st.hits);
+    fail_unless(2 == st.misses, retText, test, 2, st.misses);
+    fail_unless(2 == st.entries, retText, test, 2, st.entries);
+
+    // stays within budget
+    char key[32], val[128];
+    memset(val, 'x', sizeof(val) - 1);
+    val[sizeof(val) - 1] = '\0';
+    for (int i = 0; i < 50; i++) {
+        snprintf(key, sizeof(key), "fill %d", i);
+        ret = kvs->set(kvs, key, val, RU_SIZE_AUTO);
+        fail_unless(exp == ret, retText, test, exp, ret);
+    }
+    ret = ruCacheStoreStats(kvs, &st);
+    fail_unless(st.bytes <= 1024, retText, test, 1024, st.bytes);
+    fail_unless(st.evictions > 0, retText, test, 1, st.evictions);
+    ret = kvs->get(kvs, "fill 0", &rval, &rlen);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(127 == rlen, retText, test, 127, rlen);
+    ruFree(rval);
+
+    ret = kvs->set(kvs, "meta one", NULL, 0);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    exp = RUE_FILE_NOT_FOUND;
+    ret = kvs->get(kvs, "meta one", &rval, &rlen);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ruFreeStore(kvs);
+
+    // write back
+    exp = RUE_OK;
+    inner = ruNewLogStore(kvDir, &ret);
+    kvs = ruNewCacheStore(inner, 4096, RU_CACHE_WRITE_BACK, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    test = "ruCacheStoreSet";
+    ret = kvs->set(kvs, "meta three", "third", RU_SIZE_AUTO);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = kvs->set(kvs, "meta two", NULL, 0);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    exp = RUE_FILE_NOT_FOUND;
+    ret = inner->get(inner, "meta three", &rval, &rlen);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = kvs->get(kvs, "meta two", &rval, &rlen);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    exp = RUE_OK;
+    ret = inner->get(inner, "meta two", &rval, &rlen);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ruFree(rval);
+
+    test = "ruCacheStoreFlush";
+    ret = ruCacheStoreFlush(kvs);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = inner->get(inner, "meta three", &rval, &rlen);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_str_eq("third", rval);
+    ruFree(rval);
+    exp = RUE_FILE_NOT_FOUND;
+    ret = inner->get(inner, "meta two", &rval, &rlen);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    exp = RUE_OK;
+    ret = ruCacheStoreStats(kvs, &st);
+    fail_unless(2 == st.writes, retText, test, 2, st.writes);
+
+    // pending changes are written on free
+    ret = kvs->set(kvs, "meta four", "fourth", RU_SIZE_AUTO);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ruFreeStore(kvs);
+    inner = ruNewLogStore(kvDir, &ret);
+    ret = inner->get(inner, "meta four", &rval, &rlen);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_str_eq("fourth", rval);
+    ruFree(rval);
+    ruFreeStore(inner);
+
+    ruFree(kvDir);
+}
+END_TEST
+
+typedef struct {
+    KvStore* outer;     // gets a new value in the middle of a get when set
+    bool failSet;
+    char val[256];
+} stubStore;
+
+static int32_t stubSet(KvStore* kvs, const char* key, const char* val,
+                       rusize len) {
+    stubStore* st = (stubStore*)kvs->ctx;
+    if (st->failSet) return RUE_GENERAL;
+    if (val) snprintf(st->val, sizeof(st->val), "%s", val);
+    return RUE_OK;
+}
+
+static int32_t stubGet(KvStore* kvs, const char* key, char** val, rusize* len) {
+    stubStore* st = (stubStore*)kvs->ctx;
+    *val = ruStrDup(st->val);
+    *len = strlen(st->val);
+    if (st->outer) {
+        KvStore* outer = st->outer;
+        st->outer = NULL;
+        char big[150];
+        memset(big, 'n', sizeof(big) - 1);
+        big[sizeof(big) - 1] = '\0';
+        outer->set(outer, key, big, RU_SIZE_AUTO);
+    }
+    return RUE_OK;
+}
+
+static int32_t stubList(KvStore* kvs, const char* key, ruList* result) {
+    *result = ruListNew(ruTypePtrFree());
+    return RUE_OK;
+}
+
+static KvStore* newStubStore(stubStore* st) {
+    KvStore* kvs = ruNewStore();
+    kvs->set = stubSet;
+    kvs->get = stubGet;
+    kvs->list = stubList;
+    kvs->ctx = st;
+    return kvs;
+}
+
+START_TEST ( cacheMiss ) {
+    int32_t ret, exp = RUE_OK;
+    const char *test = "ruCacheStoreGet";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+    char *rval = NULL;
+    rusize rlen = 0;
+    stubStore st;
+    memset(&st, 0, sizeof(st));
+    strcpy(st.val, "old");
+
+    // a value that changed while the store was read isn't cached
+    KvStore* inner = newStubStore(&st);
+    KvStore* kvs = ruNewCacheStore(inner, 200, RU_CACHE_WRITE_THROUGH, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    st.outer = kvs;
+    ret = kvs->get(kvs, "meta key", &rval, &rlen);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_str_eq("old", rval);
+    ruFree(rval);
+    ret = kvs->get(kvs, "meta key", &rval, &rlen);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(149 == rlen, retText, test, 149, rlen);
+    ruFree(rval);
+    ruFreeStore(kvs);
+
+    // failing to write back another entry doesn't fail the get
+    inner = newStubStore(&st);
+    kvs = ruNewCacheStore(inner, 200, RU_CACHE_WRITE_BACK, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    memset(st.val, 'o', 60);
+    st.val[60] = '\0';
+    ret = kvs->set(kvs, "meta pending", st.val, RU_SIZE_AUTO);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    st.failSet = true;
+    ret = kvs->get(kvs, "meta other", &rval, &rlen);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(60 == rlen, retText, test, 60, rlen);
+    ruFree(rval);
+    st.failSet = false;
+    ruFreeStore(kvs);
+}
+END_TEST
+
 TCase* storeTests ( void ) {
     TCase *tcase = tcase_create ( "kvstore" );
     tcase_add_test ( tcase, api );
     tcase_add_test ( tcase, run );
     tcase_add_test ( tcase, usage );
+    tcase_add_test ( tcase, logStore );
+    tcase_add_test ( tcase, storeBench );
+    tcase_add_test ( tcase, cacheStore );
+    tcase_add_test ( tcase, cacheMiss );
     return tcase;
 }
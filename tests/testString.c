@@ -980,6 +980,193 @@ START_TEST (StrNSplit) {
 }
 END_TEST
 
+START_TEST (StrSplitSpans) {
+    int32_t ret, exp;
+    perm_chars test = "ruStrSplitterInit";
+    perm_chars retText = "%s failed wanted ret '%d' but got '%d'";
+    ruStrSplitter ss;
+    ruStrSpan sp;
+
+    exp = RUE_PARAMETER_NOT_SET;
+    ret = ruStrSplitterInit(NULL, "a", RU_SIZE_AUTO, ",", 0, false);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruStrSplitterInit(&ss, NULL, RU_SIZE_AUTO, ",", 0, false);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_if(ruStrSplitterNext(&ss, &sp), retText, test, false, true);
+    exp = RUE_INVALID_PARAMETER;
+    ret = ruStrSplitterInit(&ss, "a", RU_SIZE_AUTO, "", 0, false);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ret = ruStrSplitterInit(&ss, "a", 0, ",", 0, false);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    // must yield what ruStrNSplit yields
+    perm_chars inputs[] = {"foo:bar", ":foo:bar:", "", ":", "foo", "a::b::c"};
+    rusize limits[] = {RU_SIZE_AUTO, 6, 7, 1};
+    int32_t counts[] = {0, 1, 2, 3};
+    test = "ruStrSplitterNext";
+    exp = RUE_OK;
+    for (int i = 0; i < 6; i++) {
+        for (int l = 0; l < 4; l++) {
+            for (int c = 0; c < 4; c++) {
+                for (int d = 0; d < 2; d++) {
+                    perm_chars delim = d? "::" : ":";
+                    ruList rl = ruStrNSplit(inputs[i], limits[l], delim, counts[c]);
+                    ret = ruStrSplitterInit(&ss, inputs[i], limits[l], delim,
+                                            counts[c], false);
+                    if (!rl) {
+                        fail_if(exp == ret, retText, test, exp, ret);
+                        continue;
+                    }
+                    fail_unless(exp == ret, retText, test, exp, ret);
+                    uint32_t n = 0;
+                    while (ruStrSplitterNext(&ss, &sp)) {
+                        char* want = ruListIdx(rl, n++, char*, NULL);
+                        ck_assert_int_eq(strlen(want), sp.len);
+                        ck_assert(0 == memcmp(want, sp.start, sp.len));
+                    }
+                    ck_assert_int_eq(ruListSize(rl, NULL), n);
+                    ruListFree(rl);
+                }
+            }
+        }
+    }
+
+    perm_chars line = " id , name,,  last value \t";
+    ret = ruStrSplitterInit(&ss, line, RU_SIZE_AUTO, ",", 0, true);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    perm_chars trimmed[] = {"id", "name", "", "last value"};
+    for (int i = 0; i < 4; i++) {
+        fail_unless(ruStrSplitterNext(&ss, &sp), retText, test, true, false);
+        ck_assert_int_eq(strlen(trimmed[i]), sp.len);
+        ck_assert(0 == memcmp(trimmed[i], sp.start, sp.len));
+    }
+    fail_if(ruStrSplitterNext(&ss, &sp), retText, test, false, true);
+    fail_if(ruStrSplitterNext(&ss, NULL), retText, test, false, true);
+
+    test = "ruStrSplitSpans";
+    ruStrSpan spans[3];
+    exp = RUE_PARAMETER_NOT_SET;
+    uint32_t cnt = ruStrSplitSpans(line, RU_SIZE_AUTO, ",", true, NULL, 3, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_int_eq(0, cnt);
+    cnt = ruStrSplitSpans(line, RU_SIZE_AUTO, NULL, true, spans, 3, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_int_eq(0, cnt);
+
+    exp = RUE_OK;
+    cnt = ruStrSplitSpans(line, RU_SIZE_AUTO, ",", true, spans, 3, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_int_eq(3, cnt);
+    ck_assert_int_eq(4, spans[1].len);
+    ck_assert(line + 6 == spans[1].start);
+    // remainder goes unsplit into the last one
+    ck_assert_int_eq(strlen(",  last value"), spans[2].len);
+    ck_assert(0 == memcmp(",  last value", spans[2].start, spans[2].len));
+
+    rusize len = 1 << 20;
+    alloc_chars big = ruMalloc0(len + 1, char);
+    for (rusize i = 0; i < len; i++) {
+        big[i] = "abcdefghij klmnopqrstuvwxyz,ABCDEF"[i % 34];
+    }
+    int64_t start = ruTimeMs();
+    ruList rl = ruStrSplit(big, ",", 0);
+    cnt = ruListSize(rl, NULL);
+    ruListFree(rl);
+    int64_t listMs = ruTimeMs() - start;
+    start = ruTimeMs();
+    uint32_t n = 0;
+    ruStrSplitterInit(&ss, big, len, ",", 0, true);
+    while (ruStrSplitterNext(&ss, &sp)) n++;
+    ck_assert_int_eq(cnt, n);
+    ruInfoLogf("split %u pieces list: %ld ms spans: %ld ms", n, (long)listMs,
+               (long)(ruTimeMs() - start));
+    ruFree(big);
+}
+END_TEST
+
+static perm_chars naiveFind(perm_chars hay, rusize len, perm_chars needle,
+                            bool nocase, bool last) {
+    rusize nlen = strlen(needle);
+    perm_chars found = NULL;
+    for (rusize i = 0; i + nlen <= len; i++) {
+        rusize j = 0;
+        while (j < nlen && (nocase? ruAsciiCharToLower(hay[i+j]) ==
+                ruAsciiCharToLower(needle[j]) : hay[i+j] == needle[j])) j++;
+        if (j < nlen) continue;
+        found = hay + i;
+        if (!last) break;
+    }
+    return found;
+}
+
+START_TEST (StrSearch) {
+    perm_chars failText = "%s mismatch on round %d";
+    char hay[200], needle[6];
+    srand(4711);
+    for (int round = 0; round < 5000; round++) {
+        // small alphabets make for plenty of partial matches
+        rusize len = rand() % sizeof(hay);
+        for (rusize i = 0; i < len; i++) hay[i] = "abAB-c"[rand() % 6];
+        hay[len] = '\0';
+        rusize nlen = 1 + rand() % (sizeof(needle) - 1);
+        for (rusize i = 0; i < nlen; i++) needle[i] = "abAB-c"[rand() % 6];
+        needle[nlen] = '\0';
+        rusize bound = len? rand() % (len + 1) : 0;
+        rusize want = bound? bound : len;
+
+        fail_unless(ruStrStrLen(hay, needle, bound) ==
+                    naiveFind(hay, want, needle, false, false),
+                    failText, "ruStrStrLen", round);
+        fail_unless(ruStrCaseStrLen(hay, needle, bound) ==
+                    naiveFind(hay, want, needle, true, false),
+                    failText, "ruStrCaseStrLen", round);
+        fail_unless(ruLastSubStrLen(hay, needle, bound) ==
+                    naiveFind(hay, want, needle, false, true),
+                    failText, "ruLastSubStrLen", round);
+        fail_unless(ruStrHasChar(hay, needle[0]) ==
+                    (memchr(hay, needle[0], len) != NULL),
+                    failText, "ruStrHasChar", round);
+    }
+
+    // a lone match anywhere in or around the scan blocks
+    for (int pos = 0; pos < 128; pos++) {
+        memset(hay, 'x', 130);
+        hay[130] = '\0';
+        memcpy(hay + pos, "aB", 2);
+        fail_unless(ruStrCaseStrLen(hay, "Ab", 0) == hay + pos,
+                    failText, "ruStrCaseStrLen", pos);
+        fail_unless(ruLastSubStrLen(hay, "aB", 0) == hay + pos,
+                    failText, "ruLastSubStrLen", pos);
+    }
+
+    // split must stop at the length even when the string goes on
+    ruList parts = ruStrNSplit("a,b,c,d", 4, ",", 0);
+    ck_assert_int_eq(3, ruListSize(parts, NULL));
+    ck_assert_str_eq("", ruListIdx(parts, 2, char*, NULL));
+    ruListFree(parts);
+
+    rusize len = 1 << 20;
+    alloc_chars big = ruMalloc0(len + 1, char);
+    for (rusize i = 0; i < len; i++) {
+        big[i] = "abcdefghij klmnopqrstuvwxyz,ABCDEF"[i % 34];
+    }
+    memcpy(big + len - 12, "needle=Value", 12);
+    int64_t start = ruTimeMs();
+    for (int i = 0; i < 20; i++) {
+        ck_assert(ruStrCaseStrLen(big, "NEEDLE=value", 0) == big + len - 12);
+        ck_assert(ruLastSubStrLen(big, "xyz,A", 0) != NULL);
+    }
+    int64_t searchMs = ruTimeMs() - start;
+    start = ruTimeMs();
+    parts = ruStrNSplit(big, len / 2, ",", 0);
+    ck_assert_int_eq(15421, ruListSize(parts, NULL));
+    ruListFree(parts);
+    ruInfoLogf("1MB searches: %ld ms split: %ld ms", (long)searchMs,
+               (long)(ruTimeMs() - start));
+    ruFree(big);
+}
+END_TEST
+
 START_TEST (StrTrimBounds) {
     perm_chars str = ruStrTrimBounds(NULL, 0, NULL);
     fail_unless(NULL == str, failText, NULL, str);
@@ -1196,6 +1383,87 @@ START_TEST ( buffer ) {
 }
 END_TEST
 
+START_TEST ( arena ) {
+    int32_t ret, exp;
+    const char *test = "ruStringArenaNew";
+    const char *retText = "%s failed wanted ret '%d' but got '%d'";
+
+    ruString rs = ruStringArenaNew(NULL, "foo", RU_SIZE_AUTO);
+    fail_unless(NULL == rs, retText, test, NULL, rs);
+    exp = RUE_PARAMETER_NOT_SET;
+    ret = ruArenaReset(NULL);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    ruArena ra = ruArenaNew(256);
+    fail_if(NULL == ra, retText, test, NULL, ra);
+    rs = ruStringArenaNew(ra, NULL, 0);
+    fail_unless(NULL == rs, retText, test, NULL, rs);
+
+    exp = RUE_OK;
+    rs = ruStringArenaNew(ra, "foo", RU_SIZE_AUTO);
+    ck_assert_str_eq("foo", ruStringGetCString(rs));
+    ruString part = ruStringArenaNew(ra, "foobar", 3);
+    ck_assert_str_eq("foo", ruStringGetCString(part));
+
+    // grow past the inline buffer and the arena block size
+    char* want = ruStrDup("foo");
+    for (int i = 0; i < 50; i++) {
+        ret = ruStringAppendf(rs, "-%d", i);
+        fail_unless(exp == ret, retText, test, exp, ret);
+        char* tmp = ruDupPrintf("%s-%d", want, i);
+        ruFree(want);
+        want = tmp;
+        ret = ruStringAppend(part, "bar");
+        fail_unless(exp == ret, retText, test, exp, ret);
+    }
+    ck_assert_str_eq(want, ruStringGetCString(rs));
+    ck_assert_int_eq(strlen(want), ruStringLen(rs, NULL));
+    ck_assert_int_eq(153, ruStringLen(part, NULL));
+    ruFree(want);
+
+    perm_chars kept = ruStringGetCString(part);
+    rs = ruStringFree(rs, false);
+    ck_assert(0 == strncmp("foobarbar", kept, 9));
+    part = ruStringFree(part, true);
+    ck_assert(0 == strncmp("foobarbar", kept, 9));
+
+    ret = ruArenaReset(ra);
+    fail_unless(exp == ret, retText, test, exp, ret);
+
+    // single pass appendf on heap strings
+    test = "ruStringAppendf";
+    ruString heap = ruStringNewf("%s", "");
+    ck_assert_str_eq("", ruStringGetCString(heap));
+    for (int i = 0; i < 20; i++) {
+        ret = ruStringAppendf(heap, "%08d", i);
+        fail_unless(exp == ret, retText, test, exp, ret);
+    }
+    ck_assert_int_eq(160, ruStringLen(heap, NULL));
+    ck_assert(ruStringEndsWith(heap, "00000019", NULL));
+    ruStringFree(heap, false);
+
+    uint32_t loops = 200000;
+    int64_t start = ruTimeMs();
+    for (uint32_t i = 0; i < loops; i++) {
+        heap = ruStringNewf("id=%u", i);
+        ruStringAppendf(heap, "&name=%s", "value");
+        ruStringFree(heap, false);
+    }
+    int64_t heapMs = ruTimeMs() - start;
+    start = ruTimeMs();
+    for (uint32_t i = 0; i < loops; i++) {
+        rs = ruStringArenaNew(ra, "id=", RU_SIZE_AUTO);
+        ruStringAppendf(rs, "%u&name=%s", i, "value");
+        if (i % 1000 == 999) ruArenaReset(ra);
+    }
+    ruInfoLogf("%u short strings heap: %ld ms arena: %ld ms", loops,
+               (long)heapMs, (long)(ruTimeMs() - start));
+
+    ra = ruArenaFree(ra);
+    fail_unless(NULL == ra, retText, test, NULL, ra);
+}
+END_TEST
+
 int32_t parseInteger(trans_chars start, perm_chars* endptr,
                      uint32_t intBitSize, uint32_t base, int64_t* out);
 
@@ -1371,16 +1639,268 @@ START_TEST (ruvprintf) {
 }
 END_TEST
 
+static void* caseRunner(void* ctx) {
+    perm_chars str = (perm_chars)ctx;
+    intptr_t bad = 0;
+    for (int i = 0; i < 1000; i++) {
+        alloc_uni wstr = ruStrToUtf16(str);
+        alloc_chars back = ruStrFromUtf16(wstr);
+        alloc_chars lower = ruUtf8ToLower(back);
+        if (strcmp(back, str) || strcmp(lower, "grüße aus köln")) bad++;
+        ruFree(wstr);
+        ruFree(back);
+        ruFree(lower);
+    }
+    return (void*)bad;
+}
+
+START_TEST ( caseMap ) {
+    char ascii[128];
+    for (int i = 0; i < 127; i++) ascii[i] = (char)(i + 1);
+    ascii[127] = '\0';
+    // the fast path works in blocks of 16 or 8 bytes, so cover every length
+    for (int len = 0; len < 127; len++) {
+        alloc_chars in = ruStrNDup(ascii + 127 - len, len);
+        alloc_chars exp = ruAsciiToLower(in);
+        alloc_chars out = ruUtf8ToLower(in);
+        ck_assert_str_eq(exp, out);
+        ruFree(exp);
+        ruFree(out);
+        exp = ruAsciiToUpper(in);
+        out = ruUtf8ToUpper(in);
+        ck_assert_str_eq(exp, out);
+        ruFree(exp);
+        ruFree(out);
+        ruFree(in);
+    }
+
+    // non ASCII input at any offset falls back to ICU
+    perm_chars pad = "ABCDEFGHIJKLMNOPQRS";
+    perm_chars lpad = "abcdefghijklmnopqrs";
+    for (int pos = 0; pos < 18; pos++) {
+        alloc_chars in = ruDupPrintf("%.*sÄ%s", pos, pad, pad + pos);
+        alloc_chars exp = ruDupPrintf("%.*sä%s", pos, lpad, lpad + pos);
+        alloc_chars out = ruUtf8ToLower(in);
+        ck_assert_str_eq(exp, out);
+        ruFree(in);
+        ruFree(exp);
+        ruFree(out);
+    }
+
+    // each thread uses its own converter
+    ruThread tids[4];
+    for (int i = 0; i < 4; i++) {
+        tids[i] = ruThreadCreate(caseRunner, NULL, "Grüße aus Köln");
+    }
+    for (int i = 0; i < 4; i++) {
+        void* bad = NULL;
+        ck_assert_int_eq(RUE_OK, ruThreadJoin(tids[i], &bad));
+        ck_assert(NULL == bad);
+    }
+
+    perm_chars mixed[] = {
+        "Content-Type", "X-Forwarded-For", "ACCEPT-ENCODING",
+        "user-agent: Mozilla/5.0 (X11; Linux x86_64)",
+        "Grüße aus KÖLN", "ΑΘΗΝΑ Straße"
+    };
+    uint32_t loops = 100000, ascii4 = 0;
+    int64_t start = ruTimeMs();
+    for (uint32_t i = 0; i < loops; i++) {
+        alloc_chars out = ruUtf8ToLower(mixed[i % 6]);
+        if (i % 6 < 4) ascii4++;
+        ruFree(out);
+    }
+    ruInfoLogf("%u lower case conversions, %u of them ASCII: %ld ms", loops,
+               ascii4, (long)(ruTimeMs() - start));
+}
+END_TEST
+
+START_TEST ( utf ) {
+    ck_assert(!ruStrIsUtf8(NULL, RU_SIZE_AUTO));
+    ck_assert(ruStrIsUtf8("", RU_SIZE_AUTO));
+    ck_assert(ruStrIsUtf8("plain ascii text", RU_SIZE_AUTO));
+    ck_assert(ruStrIsUtf8("Grüße ΑΘΗΝΑ \xe2\x82\xac \xf0\x9f\x98\x80", RU_SIZE_AUTO));
+    ck_assert(ruStrIsUtf8("\xef\xbf\xbf\xf4\x8f\xbf\xbf", RU_SIZE_AUTO));
+    // embedded NULs are fine with an explicit length
+    ck_assert(ruStrIsUtf8("a\0b", 3));
+    perm_chars bad[] = {
+        "\x80", "abc\xbf", "\xc0\x80", "\xc1\xbf", "\xc3", "\xc3(",
+        "\xe0\x80\x80", "\xe0\x9f\xbf", "\xed\xa0\x80", "\xe2\x82",
+        "\xf0\x8f\xbf\xbf", "\xf4\x90\x80\x80", "\xf5\x80\x80\x80",
+        "\xff", "12345678\xe2\x82"
+    };
+    for (uint32_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        fail_if(ruStrIsUtf8(bad[i], RU_SIZE_AUTO), "'%s' passed as UTF-8", bad[i]);
+    }
+    // a truncated length cuts the sequence
+    ck_assert(!ruStrIsUtf8("\xe2\x82\xac", 2));
+
+    // round trip a spread of code points from all encoding lengths
+    ruString rs = ruStringNew("");
+    for (uint32_t cp = 1; cp < 0x110000; cp += 97) {
+        if (cp >= 0xd800 && cp <= 0xdfff) continue;
+        char buf[5] = {0};
+        if (cp < 0x80) {
+            buf[0] = (char)cp;
+        } else if (cp < 0x800) {
+            buf[0] = (char)(0xc0 | (cp >> 6));
+            buf[1] = (char)(0x80 | (cp & 0x3f));
+        } else if (cp < 0x10000) {
+            buf[0] = (char)(0xe0 | (cp >> 12));
+            buf[1] = (char)(0x80 | ((cp >> 6) & 0x3f));
+            buf[2] = (char)(0x80 | (cp & 0x3f));
+        } else {
+            buf[0] = (char)(0xf0 | (cp >> 18));
+            buf[1] = (char)(0x80 | ((cp >> 12) & 0x3f));
+            buf[2] = (char)(0x80 | ((cp >> 6) & 0x3f));
+            buf[3] = (char)(0x80 | (cp & 0x3f));
+        }
+        ruStringAppend(rs, buf);
+    }
+    perm_chars all = ruStringGetCString(rs);
+    ck_assert(ruStrIsUtf8(all, RU_SIZE_AUTO));
+    alloc_uni wstr = ruStrToUtf16(all);
+    alloc_chars back = ruStrFromUtf16(wstr);
+    ck_assert_str_eq(all, back);
+    ruFree(back);
+    ruFree(wstr);
+    ruStringFree(rs, false);
+
+    // surrogate pairs
+    wstr = ruStrToUtf16("x\xf0\x9f\x98\x80");
+    ck_assert_int_eq('x', wstr[0]);
+    ck_assert_int_eq(0xd83d, wstr[1]);
+    ck_assert_int_eq(0xde00, wstr[2]);
+    ck_assert_int_eq(0, wstr[3]);
+    back = ruStrFromNUtf16(wstr, 6);
+    ck_assert_str_eq("x\xf0\x9f\x98\x80", back);
+    ruFree(back);
+    ruFree(wstr);
+
+    // malformed input is still converted with replacement characters
+    wstr = ruStrToUtf16("a\xff" "b");
+    ck_assert_int_eq('a', wstr[0]);
+    ck_assert_int_eq(0xfffd, wstr[1]);
+    ck_assert_int_eq('b', wstr[2]);
+    ruFree(wstr);
+    uint16_t lone[] = {'a', 0xd800, 'b', 0};
+    back = ruStrFromUtf16(lone);
+    ck_assert(ruStrIsUtf8(back, RU_SIZE_AUTO));
+    ck_assert_int_eq('a', back[0]);
+    ruFree(back);
+
+    perm_chars path = "C:\\Users\\someone\\AppData\\Local\\regify\\cache\\file.bin";
+    uint32_t loops = 100000;
+    int64_t start = ruTimeMs();
+    for (uint32_t i = 0; i < loops; i++) {
+        wstr = ruStrToUtf16(path);
+        back = ruStrFromUtf16(wstr);
+        ruFree(wstr);
+        ruFree(back);
+    }
+    ruInfoLogf("%u UTF-16 round trips: %ld ms", loops, (long)(ruTimeMs() - start));
+}
+END_TEST
+
+START_TEST ( normalize ) {
+    int32_t ret, exp;
+    perm_chars test = "ruUtf8CaseNormalizeList";
+    perm_chars retText = "%s failed wanted ret '%d' but got '%d'";
+
+    exp = RUE_PARAMETER_NOT_SET;
+    ruList out = ruUtf8CaseNormalizeList(NULL, ruUtf8Nfc, 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(NULL == out, retText, test, NULL, out);
+
+    ruList in = ruListNew(NULL);
+    exp = RUE_INVALID_PARAMETER;
+    out = ruUtf8CaseNormalizeList(in, 57, 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(NULL == out, retText, test, NULL, out);
+
+    out = ruUtf8CaseNormalizeList(in, ruUtf8Nfc, 57, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(NULL == out, retText, test, NULL, out);
+
+    exp = RUE_OK;
+    out = ruUtf8CaseNormalizeList(in, ruUtf8Nfc, 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_int_eq(0, ruListSize(out, NULL));
+    ruListFree(out);
+
+    // ASCII, precomposed and decomposed names
+    perm_chars names[] = {
+        "Documents/report.pdf", "Fotos/K\xc3\xb6ln.jpg",
+        "Fotos/Ko\xcc\x88ln.jpg", "\xce\x91\xce\x98\xce\x97\xce\x9d\xce\x91"
+    };
+    perm_chars nfc[] = {
+        "Documents/report.pdf", "Fotos/K\xc3\xb6ln.jpg",
+        "Fotos/K\xc3\xb6ln.jpg", "\xce\x91\xce\x98\xce\x97\xce\x9d\xce\x91"
+    };
+    perm_chars nfdLower[] = {
+        "documents/report.pdf", "fotos/ko\xcc\x88ln.jpg",
+        "fotos/ko\xcc\x88ln.jpg", "\xce\xb1\xce\xb8\xce\xb7\xce\xbd\xce\xb1"
+    };
+    for (int i = 0; i < 4; i++) ruListAppend(in, names[i]);
+
+    out = ruUtf8CaseNormalizeList(in, ruUtf8Nfc, ruUtf8NoCase, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    ck_assert_int_eq(4, ruListSize(out, NULL));
+    for (int i = 0; i < 4; i++) {
+        char* str = ruListIdx(out, i, char*, NULL);
+        ck_assert_str_eq(nfc[i], str);
+        alloc_chars one = ruStrFromNfd(names[i]);
+        ck_assert_str_eq(one, str);
+        ruFree(one);
+    }
+    ruListFree(out);
+
+    out = ruUtf8CaseNormalizeList(in, ruUtf8Nfd, ruUtf8Lower, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    for (int i = 0; i < 4; i++) {
+        ck_assert_str_eq(nfdLower[i], ruListIdx(out, i, char*, NULL));
+    }
+    ruListFree(out);
+
+    // normalized input with case mapping still gets mapped
+    alloc_chars str = ruUtf8CaseNormalize(nfc[1], ruUtf8Nfc, ruUtf8Upper);
+    ck_assert_str_eq("FOTOS/K\xc3\x96LN.JPG", str);
+    ruFree(str);
+
+    ruListAppend(in, NULL);
+    exp = RUE_INVALID_PARAMETER;
+    out = ruUtf8CaseNormalizeList(in, ruUtf8Nfc, 0, &ret);
+    fail_unless(exp == ret, retText, test, exp, ret);
+    fail_unless(NULL == out, retText, test, NULL, out);
+    ruListFree(in);
+
+    uint32_t loops = 100000;
+    int64_t start = ruTimeMs();
+    for (uint32_t i = 0; i < loops; i++) {
+        str = ruStrToNfd(names[i % 4]);
+        ruFree(str);
+    }
+    ruInfoLogf("%u NFD conversions of mostly normalized names: %ld ms", loops,
+               (long)(ruTimeMs() - start));
+}
+END_TEST
+
 TCase* stringTests ( void ) {
     TCase *tcase = tcase_create ( "string" );
     tcase_add_test(tcase, api);
     tcase_add_test(tcase, run);
     tcase_add_test(tcase, util);
     tcase_add_test(tcase, StrNSplit);
+    tcase_add_test(tcase, StrSearch);
+    tcase_add_test(tcase, StrSplitSpans);
     tcase_add_test(tcase, StrTrimBounds);
     tcase_add_test(tcase, StrFindKeyVal);
     tcase_add_test(tcase, buffer);
+    tcase_add_test(tcase, arena);
     tcase_add_test(tcase, intParser);
     tcase_add_test(tcase, ruvprintf);
+    tcase_add_test(tcase, caseMap);
+    tcase_add_test(tcase, utf);
+    tcase_add_test(tcase, normalize);
     return tcase;
 }
@@ -60,6 +60,8 @@ TCase* stringTests(void);
 TCase* mapTests(void);
 TCase* setTests(void);
 TCase* ioTests(void);
+TCase* aioTests(void);
+TCase* hashTests(void);
 TCase* iniTests(void);
 TCase* htmlTests(void);
 TCase* jsonTests(void);